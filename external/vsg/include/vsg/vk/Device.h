@@ -52,6 +52,9 @@ namespace vsg
 
         const uint32_t deviceID = 0;
 
+        /// pipeline cache passed to vkCreate*Pipelines, the owner of the cache has to keep it alive while pipelines are compiled
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
         ref_ptr<Queue> getQueue(uint32_t queueFamilyIndex, uint32_t queueIndex = 0);
 
     protected:
@@ -104,11 +104,18 @@ namespace vsgXchange
     };
     
     /// add openexr support using openexr library
+    /// writing a vsg::Objects of images creates a multi-part file with one part per image
     class openexr : public vsg::Inherit<vsg::ReaderWriter, openexr>
     {
     public:
         openexr();
 
+        // write options, the per image settings can also be set as values of the written image which take precedence
+        static constexpr const char* compression = "exr_compression"; /// std::string: none, rle, zips, zip (default), piz, pxr24, b44, b44a, dwaa, dwab
+        static constexpr const char* half_float = "exr_half_float"; /// bool, float images are stored with half precision
+        static constexpr const char* channel_names = "exr_channel_names"; /// std::string, comma separated, only the first components of an image with fewer names are written
+        static constexpr const char* part_name = "exr_part_name"; /// std::string, name of an image in a multi-part file
+
         vsg::ref_ptr<vsg::Object> read(const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options = {}) const override;
         vsg::ref_ptr<vsg::Object> read(std::istream& fin, vsg::ref_ptr<const vsg::Options> options = {}) const override;
         vsg::ref_ptr<vsg::Object> read(const uint8_t* ptr, size_t size, vsg::ref_ptr<const vsg::Options> options = {}) const override;
@@ -116,6 +123,8 @@ namespace vsgXchange
         bool write(const vsg::Object* object, const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> = {}) const override;
         bool write(const vsg::Object* object, std::ostream& fout, vsg::ref_ptr<const vsg::Options> = {}) const override;
 
+        bool readOptions(vsg::Options& options, vsg::CommandLine& arguments) const override;
+
         bool getFeatures(Features& features) const override;
 
     private:
@@ -12,53 +12,14 @@
 #include <algorithm>
 #include <filesystem>
 #include <cstring>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <thread>
 
 
 namespace fs = std::filesystem;
 
-static void DeepCopyAiMesh(aiMesh* source, aiMesh*& target)
-{
-    target = new aiMesh;
-    *target = *source;
-    if (source->mNumVertices > 0)
-    {
-        target->mVertices = new aiVector3D[source->mNumVertices];
-        std::memcpy(target->mVertices, source->mVertices, target->mNumVertices * sizeof(aiVector3D));
-        if (source->mNormals != nullptr)
-        {
-            target->mNormals = new aiVector3D[source->mNumVertices];
-            std::memcpy(target->mNormals, source->mNormals, target->mNumVertices * sizeof(aiVector3D));
-        }
-        if (source->mTangents != nullptr)
-        {
-            target->mTangents = new aiVector3D[source->mNumVertices];
-            std::memcpy(target->mTangents, source->mTangents, target->mNumVertices * sizeof(aiVector3D));
-        }
-        if (source->mBitangents != nullptr)
-        {
-            target->mBitangents = new aiVector3D[source->mNumVertices];
-            std::memcpy(target->mBitangents, source->mBitangents, target->mNumVertices * sizeof(aiVector3D));
-        }
-        for (int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
-        {
-            if (source->mTextureCoords[i] != nullptr)
-            {
-                target->mTextureCoords[i] = new aiVector3D[source->mNumVertices];
-                std::memcpy(target->mTextureCoords[i], source->mTextureCoords[i], target->mNumVertices * sizeof(aiVector3D));
-            }
-        }
-    }
-    target->mFaces = new aiFace[source->mNumFaces];
-    std::memcpy(target->mFaces, source->mFaces, target->mNumFaces * sizeof(aiFace));
-    for (int face_index = 0; face_index < target->mNumFaces; face_index++)
-    {
-        auto& face = target->mFaces[face_index];
-        face.mIndices = new unsigned[face.mNumIndices];
-        std::memcpy(face.mIndices, source->mFaces[face_index].mIndices, face.mNumIndices * sizeof(unsigned));
-    }
-    // TODO: copy remaining data
-}
-
 float AI3DFrontImporter::ceiling_light_strength = 0.8f;
 float AI3DFrontImporter::lamp_light_strength = 7.0f;
 std::unordered_map<std::string, uint32_t> AI3DFrontImporter::category_to_id_map;
@@ -143,99 +104,116 @@ void AI3DFrontImporter::InternReadFile(const std::string& pFile, aiScene* pScene
     LoadMeshes(scene_json, material_id_to_index_map, material_uv_rotations, pScene, model_uid_to_mesh_indices_map);
 
     // load furniture
-    Assimp::Importer importer;
+    // every distinct model is loaded once, in parallel with one importer per worker, all pieces of furniture
+    // using the same model refer to the same meshes
     const auto& furniture = scene_json["furniture"];
-    std::vector<aiMesh*> furniture_meshes;
-    uint32_t total_mesh_count = pScene->mNumMeshes;
-    std::vector<aiMaterial*> furniture_materials;
-    uint32_t total_material_count = pScene->mNumMaterials;
+    std::vector<std::string> model_ids;
+    std::unordered_map<std::string, size_t> model_id_to_model_index;
     for (const auto& piece_of_furniture : furniture)
     {
-        const auto& model_id = piece_of_furniture["jid"];
-        std::string model_category_name = jid_to_category_map[model_id];
-        std::transform(model_category_name.begin(), model_category_name.end(), model_category_name.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
-        for (const auto& furniture_directory : furniture_directories)
+        const std::string model_id = piece_of_furniture["jid"];
+        if (model_id_to_model_index.emplace(model_id, model_ids.size()).second)
         {
-            fs::path furniture_model_path = furniture_directory / fs::path(std::string(model_id));
-            if (!fs::exists(furniture_model_path))
-            {
-                continue;
-            }
-            std::string obj_path_str = (furniture_model_path / fs::path("raw_model.obj")).string();
-            const aiScene* furniture_model_scene = importer.ReadFile(
-                obj_path_str.c_str(),
-                aiProcess_Triangulate | aiProcess_OptimizeMeshes | aiProcess_SortByPType |
-                aiProcess_ImproveCacheLocality | aiProcess_GenUVCoords // same flags as in assimp.cpp
-            );
-            assert(furniture_model_scene->mNumTextures == 0);
-
-            // copy materials
-            std::unordered_map<uint32_t, uint32_t> original_to_new_material_index_map;
-            for (int i = 0; i < furniture_model_scene->mNumMaterials; i++)
-            {
-                auto* material_copy = new aiMaterial;
-                aiMaterial::CopyPropertyList(material_copy, furniture_model_scene->mMaterials[i]);
+            model_ids.push_back(model_id);
+        }
+    }
 
-                // edit texture path
-                for (int prop_index = 0; prop_index < material_copy->mNumProperties; prop_index++)
-                {
-                    auto& property = material_copy->mProperties[prop_index];
-                    if (property->mKey == aiString(_AI_MATKEY_TEXTURE_BASE))
-                    {
-                        // make texture path absolute so that vsg can find the file
-                        std::string full_path = (furniture_model_path / fs::path(&property->mData[6])).string();
-                        property->mDataLength = full_path.length() + 1;
-                        char* new_data = new char[property->mDataLength + 4];
-                        strncpy(&new_data[4], full_path.c_str(), property->mDataLength);
-                        delete property->mData;
-                        property->mData = new_data;
-                        property->mDataLength += 4;
-
-                        // set prefix
-                        property->mData[0] = static_cast<char>(full_path.length());
-                        property->mData[1] = 0;
-                        property->mData[2] = 0;
-                        property->mData[3] = 0;
-                    }
-                }
-                // add emission property if it is a lamp
-                if (model_category_name.find("lamp") != std::string::npos)
+    // the workers only read the category map, jids without a category are added up front
+    for (const auto& model_id : model_ids)
+    {
+        jid_to_category_map.try_emplace(model_id);
+    }
+
+    std::vector<FurnitureModel> furniture_models(model_ids.size());
+    std::atomic<size_t> next_model{0};
+    auto load_models = [&]() {
+        Assimp::Importer importer;
+        try
+        {
+            for (size_t model_index = next_model++; model_index < model_ids.size(); model_index = next_model++)
+            {
+                std::string model_category_name = jid_to_category_map.at(model_ids[model_index]);
+                std::transform(model_category_name.begin(), model_category_name.end(), model_category_name.begin(),
+                               [](unsigned char c) { return std::tolower(c); });
+                for (const auto& furniture_directory : furniture_directories)
                 {
-                    aiString material_name;
-                    if (material_copy->Get(AI_MATKEY_NAME, material_name) == AI_SUCCESS)
+                    fs::path furniture_model_path = furniture_directory / fs::path(model_ids[model_index]);
+                    if (!fs::exists(furniture_model_path))
                     {
-                        // apparently all subobjects of lamps use the same material
-                        // so there is no way to make just the light bulb emissive
-                        //if (std::string{ material_name.C_Str() }.find("glass") == std::string::npos)
-                        {
-                            aiColor3D emissive_color(lamp_light_strength);
-                            material_copy->AddProperty(&emissive_color, 1, AI_MATKEY_COLOR_EMISSIVE);
-                        }
+                        continue;
                     }
+                    LoadFurnitureModel(importer, furniture_model_path, model_category_name, furniture_models[model_index]);
                 }
-                uint32_t category_id = 0;
-                if (const auto& iterator = category_to_id_map.find(model_category_name); iterator != category_to_id_map.end())
-                {
-                    category_id = iterator->second;
-                }
-                material_copy->AddProperty(&category_id, 1, AI_MATKEY_CATEGORY_ID);
-
-
-                furniture_materials.push_back(material_copy);
-                original_to_new_material_index_map[i] = total_material_count++;
             }
-            // copy meshes
-            for (int i = 0; i < furniture_model_scene->mNumMeshes; i++)
+        }
+        catch (...)
+        {
+            // the other workers stop after their current model
+            next_model = model_ids.size();
+            throw;
+        }
+    };
+    unsigned int worker_count = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(model_ids.size())));
+    std::vector<std::future<void>> workers;
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        workers.push_back(std::async(std::launch::async, load_models));
+    }
+    // all workers are finished before the first import error is rethrown, the models loaded until then are freed
+    std::exception_ptr import_error;
+    for (auto& worker : workers)
+    {
+        try
+        {
+            worker.get();
+        }
+        catch (...)
+        {
+            if (!import_error)
             {
-                aiMesh* mesh_copy;
-                DeepCopyAiMesh(furniture_model_scene->mMeshes[i], mesh_copy);
-                mesh_copy->mMaterialIndex = original_to_new_material_index_map[mesh_copy->mMaterialIndex];
-
-                furniture_meshes.push_back(mesh_copy);
-                model_uid_to_mesh_indices_map[piece_of_furniture["uid"]].push_back(total_mesh_count++);
+                import_error = std::current_exception();
+            }
+        }
+    }
+    if (import_error)
+    {
+        for (auto& model : furniture_models)
+        {
+            for (auto* mesh : model.meshes)
+            {
+                delete mesh;
+            }
+            for (auto* material : model.materials)
+            {
+                delete material;
             }
         }
+        std::rethrow_exception(import_error);
+    }
+
+    // append the loaded models to the scene
+    std::vector<aiMesh*> furniture_meshes;
+    uint32_t total_mesh_count = pScene->mNumMeshes;
+    std::vector<aiMaterial*> furniture_materials;
+    uint32_t total_material_count = pScene->mNumMaterials;
+    std::vector<std::vector<uint32_t>> model_mesh_indices(furniture_models.size());
+    for (size_t model_index = 0; model_index < furniture_models.size(); model_index++)
+    {
+        auto& model = furniture_models[model_index];
+        for (auto* mesh : model.meshes)
+        {
+            mesh->mMaterialIndex += total_material_count;
+            furniture_meshes.push_back(mesh);
+            model_mesh_indices[model_index].push_back(total_mesh_count++);
+        }
+        furniture_materials.insert(furniture_materials.end(), model.materials.begin(), model.materials.end());
+        total_material_count += model.materials.size();
+    }
+    for (const auto& piece_of_furniture : furniture)
+    {
+        const auto& mesh_indices = model_mesh_indices[model_id_to_model_index[piece_of_furniture["jid"]]];
+        auto& uid_mesh_indices = model_uid_to_mesh_indices_map[piece_of_furniture["uid"]];
+        uid_mesh_indices.insert(uid_mesh_indices.end(), mesh_indices.begin(), mesh_indices.end());
     }
     // copy mesh data pointers to main scene
     auto* meshes_with_furniture = new aiMesh*[total_mesh_count];
@@ -309,6 +287,86 @@ void AI3DFrontImporter::InternReadFile(const std::string& pFile, aiScene* pScene
         }
     }
 }
+void AI3DFrontImporter::LoadFurnitureModel(Assimp::Importer& importer, const std::filesystem::path& furniture_model_path,
+                                           const std::string& model_category_name, FurnitureModel& model)
+{
+    std::string obj_path_str = (furniture_model_path / fs::path("raw_model.obj")).string();
+    importer.ReadFile(
+        obj_path_str.c_str(),
+        aiProcess_Triangulate | aiProcess_OptimizeMeshes | aiProcess_SortByPType |
+        aiProcess_ImproveCacheLocality | aiProcess_GenUVCoords // same flags as in assimp.cpp
+    );
+    // take ownership of the scene, so meshes and materials can be moved instead of copied
+    aiScene* furniture_model_scene = importer.GetOrphanedScene();
+    if (furniture_model_scene == nullptr)
+    {
+        throw DeadlyImportError("Failed to load furniture model " + obj_path_str + ": " + importer.GetErrorString());
+    }
+    assert(furniture_model_scene->mNumTextures == 0);
+
+    // materials of several model directories with the same jid are appended, mesh material indices are local to the model
+    uint32_t material_offset = model.materials.size();
+    for (int i = 0; i < furniture_model_scene->mNumMaterials; i++)
+    {
+        auto* material = furniture_model_scene->mMaterials[i];
+
+        // edit texture path
+        for (int prop_index = 0; prop_index < material->mNumProperties; prop_index++)
+        {
+            auto& property = material->mProperties[prop_index];
+            if (property->mKey == aiString(_AI_MATKEY_TEXTURE_BASE))
+            {
+                // make texture path absolute so that vsg can find the file
+                std::string full_path = (furniture_model_path / fs::path(&property->mData[6])).string();
+                property->mDataLength = full_path.length() + 1;
+                char* new_data = new char[property->mDataLength + 4];
+                strncpy(&new_data[4], full_path.c_str(), property->mDataLength);
+                delete property->mData;
+                property->mData = new_data;
+                property->mDataLength += 4;
+
+                // set prefix
+                property->mData[0] = static_cast<char>(full_path.length());
+                property->mData[1] = 0;
+                property->mData[2] = 0;
+                property->mData[3] = 0;
+            }
+        }
+        // add emission property if it is a lamp
+        if (model_category_name.find("lamp") != std::string::npos)
+        {
+            aiString material_name;
+            if (material->Get(AI_MATKEY_NAME, material_name) == AI_SUCCESS)
+            {
+                // apparently all subobjects of lamps use the same material
+                // so there is no way to make just the light bulb emissive
+                //if (std::string{ material_name.C_Str() }.find("glass") == std::string::npos)
+                {
+                    aiColor3D emissive_color(lamp_light_strength);
+                    material->AddProperty(&emissive_color, 1, AI_MATKEY_COLOR_EMISSIVE);
+                }
+            }
+        }
+        uint32_t category_id = 0;
+        if (const auto& iterator = category_to_id_map.find(model_category_name); iterator != category_to_id_map.end())
+        {
+            category_id = iterator->second;
+        }
+        material->AddProperty(&category_id, 1, AI_MATKEY_CATEGORY_ID);
+
+        model.materials.push_back(material);
+        furniture_model_scene->mMaterials[i] = nullptr;
+    }
+    for (int i = 0; i < furniture_model_scene->mNumMeshes; i++)
+    {
+        auto* mesh = furniture_model_scene->mMeshes[i];
+        mesh->mMaterialIndex += material_offset;
+        model.meshes.push_back(mesh);
+        furniture_model_scene->mMeshes[i] = nullptr;
+    }
+    // the moved meshes and materials are nullptr in the scene and not deleted with it
+    delete furniture_model_scene;
+}
 void AI3DFrontImporter::FindDataDirectories(const std::string& file_path,
                                             std::vector<fs::path>& texture_directories, std::vector<fs::path>& furniture_directories)
 {
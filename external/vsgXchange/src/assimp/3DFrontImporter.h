@@ -5,10 +5,18 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <filesystem>
 
 #define AI_MATKEY_CATEGORY_ID "$mat.categoryid",0,0
 
+namespace Assimp
+{
+    class Importer;
+}
+struct aiMesh;
+struct aiMaterial;
+
 /*
  * Importer for scenes from the 3D-FRONT data set.
  * https://tianchi.aliyun.com/specials/promotion/alibaba-3d-scene-dataset
@@ -26,6 +34,15 @@ public:
 protected:
     void InternReadFile(const std::string& pFile, aiScene* pScene, Assimp::IOSystem* pIOHandler) override;
 private:
+    // meshes and materials of a single furniture model, material indices of the meshes refer to materials
+    struct FurnitureModel
+    {
+        std::vector<aiMesh*> meshes;
+        std::vector<aiMaterial*> materials;
+    };
+
+    void LoadFurnitureModel(Assimp::Importer& importer, const std::filesystem::path& furniture_model_path,
+                            const std::string& model_category_name, FurnitureModel& model);
     void FindDataDirectories(const std::string& file_path, std::vector<std::filesystem::path>& texture_directories,
                              std::vector<std::filesystem::path>& furniture_directories);
     std::unordered_map<std::string, std::string> LoadJidToCategoryMap(const std::vector<std::filesystem::path>& furniture_directories);
@@ -386,6 +386,9 @@ vsg::ref_ptr<vsg::Object> assimp::Implementation::processScene(const aiScene* sc
     scenegraph->add(vsg::BindGraphicsPipeline::create(_defaultPipeline));
     scenegraph->add(_defaultState);
 
+    // meshes referenced by several nodes, e.g. instanced furniture, are converted once and share their subgraph
+    std::vector<vsg::ref_ptr<vsg::StateGroup>> meshNodes(scene->mNumMeshes);
+
     std::stack<std::pair<aiNode*, vsg::ref_ptr<vsg::Group>>> nodes;
     nodes.push({scene->mRootNode, scenegraph});
 
@@ -404,6 +407,13 @@ vsg::ref_ptr<vsg::Object> assimp::Implementation::processScene(const aiScene* sc
 
             for (unsigned int i = 0; i < node->mNumMeshes; ++i)
             {
+                auto& meshNode = meshNodes[node->mMeshes[i]];
+                if (meshNode)
+                {
+                    xform->addChild(meshNode);
+                    continue;
+                }
+
                 auto mesh = scene->mMeshes[node->mMeshes[i]];
                 auto vertices = vsg::vec3Array::create(mesh->mNumVertices);
                 auto normals = vsg::vec3Array::create(mesh->mNumVertices);
@@ -458,6 +468,7 @@ vsg::ref_ptr<vsg::Object> assimp::Implementation::processScene(const aiScene* sc
 
                 auto stategroup = vsg::StateGroup::create();
                 xform->addChild(stategroup);
+                meshNode = stategroup;
 
                 //qCDebug(lc) << "Using material:" << scene->mMaterials[mesh->mMaterialIndex]->GetName().C_Str();
                 if (mesh->mMaterialIndex < stateSets.size())
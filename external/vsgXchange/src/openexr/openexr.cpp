@@ -6,11 +6,16 @@
 #include <cstring>
 
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <OpenEXR/ImfInputFile.h>
 #include <OpenEXR/ImfOutputFile.h>
 #include <OpenEXR/ImfChannelList.h>
 #include <OpenEXR/ImfFrameBuffer.h>
 #include <OpenEXR/ImfRgbaFile.h>
+#include <OpenEXR/ImfMultiPartOutputFile.h>
+#include <OpenEXR/ImfOutputPart.h>
+#include <OpenEXR/ImfPartType.h>
 #ifdef EXRVERSION3
     #include <Imath/half.h>
     #include <ImfInt64.h>
@@ -252,294 +257,144 @@ vsg::ref_ptr<vsg::Object> openexr::read(const uint8_t* ptr, size_t size, vsg::re
     return parseOpenExr(file);
 }
 
-bool openexr::write(const vsg::Object* object, const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options) const
-{
-    if(const vsg::ushortArray2D* obj = dynamic_cast<const vsg::ushortArray2D*>(object)){ //single precision half float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Y", Imf::Channel(Imf::HALF));
-
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Y", Imf::Slice(Imf::HALF,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
+namespace{
+    // memory layout of an image which can be written to an exr file
+    struct ExrImage{
+        Imf::PixelType type;
+        const char* data;
+        int components;
+        size_t pixelStride;
+        int width, height;
+    };
+
+    template<class A>
+    bool describeImage(const vsg::Object* object, Imf::PixelType type, int components, ExrImage& image){
+        auto array = dynamic_cast<const A*>(object);
+        if(!array) return false;
+        image = {type, reinterpret_cast<const char*>(array->data()), components, sizeof(*array->data()), static_cast<int>(array->width()), static_cast<int>(array->height())};
         return true;
     }
-    if(const vsg::floatArray2D* obj = dynamic_cast<const vsg::floatArray2D*>(object)){ //single precision float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Y", Imf::Channel(Imf::FLOAT));
-
-        int dataSize = obj->dataSize();
-        int space = width * height * sizeof(float);
-        int size = sizeof(*obj->data());
-        float dat = obj->data()[0];
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Y", Imf::Slice(Imf::FLOAT,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
+
+    bool describeImage(const vsg::Object* object, ExrImage& image){
+        return describeImage<vsg::ushortArray2D>(object, Imf::HALF, 1, image) ||
+            describeImage<vsg::floatArray2D>(object, Imf::FLOAT, 1, image) ||
+            describeImage<vsg::uintArray2D>(object, Imf::UINT, 1, image) ||
+            describeImage<vsg::usvec4Array2D>(object, Imf::HALF, 4, image) ||
+            describeImage<vsg::vec4Array2D>(object, Imf::FLOAT, 4, image) ||
+            describeImage<vsg::uivec4Array2D>(object, Imf::UINT, 4, image);
     }
-    if(const vsg::uintArray2D* obj = dynamic_cast<const vsg::uintArray2D*>(object)){ //single precision uint
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Y", Imf::Channel(Imf::UINT));
 
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Y", Imf::Slice(Imf::UINT,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
+    // values set on the image take precedence over the options
+    template<typename T>
+    T imageSetting(const vsg::Object* object, const vsg::Options* options, const char* key, T defaultValue){
+        T value;
+        if(object->getValue(key, value)) return value;
+        if(options && options->getValue(key, value)) return value;
+        return defaultValue;
     }
-    if(const vsg::usvec4Array2D* obj = dynamic_cast<const vsg::usvec4Array2D*>(object)){ //single precision short
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::HALF));
-        header.channels().insert("G", Imf::Channel(Imf::HALF));
-        header.channels().insert("B", Imf::Channel(Imf::HALF));
-        header.channels().insert("A", Imf::Channel(Imf::HALF));
-
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
+
+    Imf::Compression exrCompression(const vsg::Options* options){
+        static const std::map<std::string, Imf::Compression> compressions{
+            {"none", Imf::NO_COMPRESSION}, {"rle", Imf::RLE_COMPRESSION}, {"zips", Imf::ZIPS_COMPRESSION}, {"zip", Imf::ZIP_COMPRESSION},
+            {"piz", Imf::PIZ_COMPRESSION}, {"pxr24", Imf::PXR24_COMPRESSION}, {"b44", Imf::B44_COMPRESSION}, {"b44a", Imf::B44A_COMPRESSION},
+            {"dwaa", Imf::DWAA_COMPRESSION}, {"dwab", Imf::DWAB_COMPRESSION}};
+        std::string name;
+        if(!options || !options->getValue(openexr::compression, name)) return Imf::ZIP_COMPRESSION;
+        auto itr = compressions.find(name);
+        if(itr == compressions.end()){
+            std::cerr << "Unknown exr compression " << name << ", using zip" << std::endl;
+            return Imf::ZIP_COMPRESSION;
+        }
+        return itr->second;
     }
-    if(const vsg::vec4Array2D* obj = dynamic_cast<const vsg::vec4Array2D*>(object)){ //single precision float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("G", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("B", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("A", Imf::Channel(Imf::FLOAT));
-
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
+
+    std::vector<std::string> channelNames(const vsg::Object* object, const vsg::Options* options, const ExrImage& image){
+        std::string names = imageSetting<std::string>(object, options, openexr::channel_names, image.components == 1 ? "Y" : "R,G,B,A");
+        std::vector<std::string> channels;
+        std::stringstream stream(names);
+        for(std::string name; std::getline(stream, name, ',');)
+            channels.push_back(name);
+        return channels;
     }
-    if(const vsg::uivec4Array2D* obj = dynamic_cast<const vsg::uivec4Array2D*>(object)){ //single precision uint
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::UINT));
-        header.channels().insert("G", Imf::Channel(Imf::UINT));
-        header.channels().insert("B", Imf::Channel(Imf::UINT));
-        header.channels().insert("A", Imf::Channel(Imf::UINT));
-
-        Imf::OutputFile file(filename.c_str(), header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
+
+    // header and frame buffer for writing the image, only float images can be converted to half
+    bool setupImage(const vsg::Object* object, const vsg::Options* options, Imf::Header& header, Imf::FrameBuffer& frameBuffer){
+        ExrImage image;
+        if(!describeImage(object, image)) return false;
+        auto channels = channelNames(object, options, image);
+        if(channels.empty() || static_cast<int>(channels.size()) > image.components){
+            std::cerr << "Invalid exr channel names for an image with " << image.components << " components" << std::endl;
+            return false;
+        }
+
+        header = Imf::Header(image.width, image.height);
+        header.compression() = exrCompression(options);
+        Imf::PixelType fileType = image.type == Imf::FLOAT && imageSetting(object, options, openexr::half_float, false) ? Imf::HALF : image.type;
+        size_t componentSize = image.pixelStride / image.components;
+        for(size_t c = 0; c < channels.size(); ++c){
+            header.channels().insert(channels[c], Imf::Channel(fileType));
+            // openexr converts from the memory type of the slice to the channel type of the file
+            frameBuffer.insert(channels[c], Imf::Slice(image.type,
+                                const_cast<char*>(image.data + c * componentSize),
+                                image.pixelStride,
+                                image.pixelStride * image.width));
+        }
         return true;
     }
-    return false;
+
+    template<class Destination>
+    bool writeOpenExr(const vsg::Object* object, Destination& destination, const vsg::Options* options){
+        try{
+            if(auto parts = dynamic_cast<const vsg::Objects*>(object)){
+                std::vector<Imf::Header> headers(parts->children.size());
+                std::vector<Imf::FrameBuffer> frameBuffers(parts->children.size());
+                for(size_t i = 0; i < headers.size(); ++i){
+                    if(!setupImage(parts->children[i].get(), options, headers[i], frameBuffers[i])) return false;
+                    headers[i].setName(imageSetting<std::string>(parts->children[i].get(), nullptr, openexr::part_name, "part" + std::to_string(i)));
+                    headers[i].setType(Imf::SCANLINEIMAGE);
+                }
+                if(headers.empty()) return false;
+                Imf::MultiPartOutputFile file(destination, headers.data(), static_cast<int>(headers.size()));
+                for(size_t i = 0; i < headers.size(); ++i){
+                    Imf::OutputPart part(file, static_cast<int>(i));
+                    part.setFrameBuffer(frameBuffers[i]);
+                    part.writePixels(headers[i].dataWindow().max.y + 1);
+                }
+                return true;
+            }
+
+            Imf::Header header;
+            Imf::FrameBuffer frameBuffer;
+            if(!setupImage(object, options, header, frameBuffer)) return false;
+            Imf::OutputFile file(destination, header);
+            file.setFrameBuffer(frameBuffer);
+            file.writePixels(header.dataWindow().max.y + 1);
+            return true;
+        }
+        catch(const std::exception& e){
+            std::cerr << "Failed to write exr: " << e.what() << std::endl;
+            return false;
+        }
+    }
 }
 
-bool openexr::write(const vsg::Object* object, std::ostream& fout, vsg::ref_ptr<const vsg::Options> options) const
+bool openexr::write(const vsg::Object* object, const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options) const
 {
-    if(const vsg::ushortArray2D* obj = dynamic_cast<const vsg::ushortArray2D*>(object)){ //single precision half float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Z", Imf::Channel(Imf::HALF));
-
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Z", Imf::Slice(Imf::HALF,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    if(const vsg::floatArray2D* obj = dynamic_cast<const vsg::floatArray2D*>(object)){ //single precision float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Z", Imf::Channel(Imf::FLOAT));
+    const char* name = filename.c_str();
+    return writeOpenExr(object, name, options.get());
+}
 
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Z", Imf::Slice(Imf::FLOAT,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    if(const vsg::uintArray2D* obj = dynamic_cast<const vsg::uintArray2D*>(object)){ //single precision uint
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("Z", Imf::Channel(Imf::UINT));
+bool openexr::write(const vsg::Object* object, std::ostream& fout, vsg::ref_ptr<const vsg::Options> options) const
+{
+    CPP_OStream stream(fout, "");
+    return writeOpenExr<Imf::OStream>(object, stream, options.get());
+}
 
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("Z", Imf::Slice(Imf::UINT,
-                            (char*)obj->data(), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    if(const vsg::usvec4Array2D* obj = dynamic_cast<const vsg::usvec4Array2D*>(object)){ //single precision short
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::HALF));
-        header.channels().insert("G", Imf::Channel(Imf::HALF));
-        header.channels().insert("B", Imf::Channel(Imf::HALF));
-        header.channels().insert("A", Imf::Channel(Imf::HALF));
-
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::HALF,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    if(const vsg::vec4Array2D* obj = dynamic_cast<const vsg::vec4Array2D*>(object)){ //single precision float
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("G", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("B", Imf::Channel(Imf::FLOAT));
-        header.channels().insert("A", Imf::Channel(Imf::FLOAT));
-
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::FLOAT,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    if(const vsg::uivec4Array2D* obj = dynamic_cast<const vsg::uivec4Array2D*>(object)){ //single precision uint
-        int width = obj->width(), height = obj->height();
-        Imf::Header header(width, height);
-        header.channels().insert("R", Imf::Channel(Imf::UINT));
-        header.channels().insert("G", Imf::Channel(Imf::UINT));
-        header.channels().insert("B", Imf::Channel(Imf::UINT));
-        header.channels().insert("A", Imf::Channel(Imf::UINT));
-
-        CPP_OStream stream(fout, "");
-        Imf::OutputFile file(stream, header);
-        Imf::FrameBuffer frameBuffer;
-        frameBuffer.insert("R", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->r), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("G", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->g), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("B", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->b), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        frameBuffer.insert("A", Imf::Slice(Imf::UINT,
-                            (char*)(&obj->data()->a), 
-                            sizeof(*obj->data()), 
-                            sizeof(*obj->data()) * width));
-        file.setFrameBuffer(frameBuffer);
-        file.writePixels(height);
-        return true;
-    }
-    return false;
+bool openexr::readOptions(vsg::Options& options, vsg::CommandLine& arguments) const
+{
+    bool result = arguments.readAndAssign<std::string>(openexr::compression, &options);
+    result = arguments.readAndAssign<void>(openexr::half_float, &options) || result;
+    return result;
 }
 
 bool openexr::getFeatures(Features& features) const
@@ -548,5 +403,7 @@ bool openexr::getFeatures(Features& features) const
     {
         features.extensionFeatureMap[ext] = static_cast<vsg::ReaderWriter::FeatureMask>(vsg::ReaderWriter::READ_FILENAME | vsg::ReaderWriter::READ_ISTREAM | vsg::ReaderWriter::READ_MEMORY | vsg::ReaderWriter::WRITE_FILENAME | vsg::ReaderWriter::WRITE_OSTREAM);
     }
+    features.optionNameTypeMap[openexr::compression] = vsg::type_name<std::string>();
+    features.optionNameTypeMap[openexr::half_float] = vsg::type_name<bool>();
     return true;
 }
\ No newline at end of file
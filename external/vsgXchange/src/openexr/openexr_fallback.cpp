@@ -35,6 +35,11 @@ bool openexr::write(const vsg::Object* object, std::ostream& fout, vsg::ref_ptr<
     return false;
 }
 
+bool openexr::readOptions(vsg::Options&, vsg::CommandLine&) const
+{
+    return false;
+}
+
 bool openexr::getFeatures(Features& features) const
 {
     return false;
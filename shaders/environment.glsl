@@ -0,0 +1,65 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include "ptConstants.glsl"
+
+// --------------------------------------------------------------------
+// environment map importance sampling, has to match EnvironmentMap::sample() and EnvironmentMap::pdf()
+// --------------------------------------------------------------------
+vec2 environmentUV(vec3 direction){
+  float phi = atan(direction.y, direction.x);
+  if(phi < 0) phi += 2 * PI;
+  return vec2(phi / (2 * PI), acos(clamp(direction.z, -1, 1)) / PI);
+}
+
+vec3 environmentRadiance(vec3 direction){
+  return textureLod(environmentMap, environmentUV(direction), 0).rgb;
+}
+
+//bin of u in the cdf starting at offset with count bins
+int environmentInterval(int offset, int count, float u){
+  int begin = 0, end = count;
+  while(end - begin > 1){
+    int mid = (begin + end) / 2;
+    if(environmentCdf.c[offset + mid] <= u)
+      begin = mid;
+    else
+      end = mid;
+  }
+  return begin;
+}
+
+//pdf with respect to solid angle
+float environmentPdf(vec3 direction){
+  ivec2 size = textureSize(environmentMap, 0);
+  vec2 uv = environmentUV(direction);
+  float sinTheta = sin(uv.y * PI);
+  if(sinTheta <= 0) return 0;
+  int row = min(int(uv.y * size.y), size.y - 1);
+  int column = min(int(uv.x * size.x), size.x - 1);
+  int conditional = size.y + 1 + row * (size.x + 1);
+  float rowPdf = (environmentCdf.c[row + 1] - environmentCdf.c[row]) * size.y;
+  float columnPdf = (environmentCdf.c[conditional + column + 1] - environmentCdf.c[conditional + column]) * size.x;
+  return rowPdf * columnPdf / (2 * PI * PI * sinTheta);
+}
+
+//samples a direction proportional to the luminance of the map, returns the radiance from that direction
+vec3 sampleEnvironment(vec2 u, out vec3 direction, out float pdf){
+  ivec2 size = textureSize(environmentMap, 0);
+  int row = environmentInterval(0, size.y, u.y);
+  float rowBegin = environmentCdf.c[row], rowEnd = environmentCdf.c[row + 1];
+  float v = (row + (u.y - rowBegin) / (rowEnd - rowBegin)) / size.y;
+
+  int conditional = size.y + 1 + row * (size.x + 1);
+  int column = environmentInterval(conditional, size.x, u.x);
+  float columnBegin = environmentCdf.c[conditional + column], columnEnd = environmentCdf.c[conditional + column + 1];
+  float s = (column + (u.x - columnBegin) / (columnEnd - columnBegin)) / size.x;
+
+  float theta = v * PI, phi = s * 2 * PI;
+  float sinTheta = sin(theta);
+  pdf = sinTheta > 0 ? (rowEnd - rowBegin) * size.y * (columnEnd - columnBegin) * size.x / (2 * PI * PI * sinTheta) : 0;
+  direction = vec3(sinTheta * cos(phi), sinTheta * sin(phi), cos(theta));
+  return textureLod(environmentMap, vec2(s, v), 0).rgb;
+}
+
+#endif //ENVIRONMENT_H
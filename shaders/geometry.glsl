@@ -39,6 +39,46 @@ Vertex unpackVertex(uint index, uint objId){
     return v;
 };
 
+// grid position of the k-th border vertex, walking around the grid: first row, last column, last row backwards, first column backwards
+// has to match TerrainImporter::getBorderVertex()
+uvec2 gridBorderVertex(uint k, uint gridWidth, uint gridHeight){
+    if(k < gridWidth - 1) return uvec2(k, 0);
+    k -= gridWidth - 1;
+    if(k < gridHeight - 1) return uvec2(gridWidth - 1, k);
+    k -= gridHeight - 1;
+    if(k < gridWidth - 1) return uvec2(gridWidth - 1 - k, gridHeight - 1);
+    k -= gridWidth - 1;
+    return uvec2(0, gridHeight - 1 - k);
+}
+
+// position of the grid vertex (x, y) of a regular grid mesh, the position buffer only holds the heights of the vertices
+// the tile origin is the translation of the instance, the vertex spacing is stored after the uv origin and step in the texture buffer
+vec3 unpackGridPosition(uint index, uint x, uint y, uint objId){
+    vec2 spacing = vec2(tex[nonuniformEXT(objId)].t[4], tex[nonuniformEXT(objId)].t[5]);
+    return vec3(vec2(x, y) * spacing, pos[nonuniformEXT(objId)].p[index]);
+}
+
+// vertex of a regular grid mesh which only stores heights
+// the texture buffer holds the uv of the first vertex, the uv step between neighbouring vertices and the vertex spacing,
+// the normal is computed from the neighbouring grid vertices
+// vertices after the grid are pairs of top and bottom skirt vertices, which take uv and normal of their border vertex
+Vertex unpackGridVertex(uint index, uint objId, uint gridWidth, uint gridHeight){
+    Vertex v;
+    uvec2 grid = index < gridWidth * gridHeight ? uvec2(index % gridWidth, index / gridWidth) : gridBorderVertex((index - gridWidth * gridHeight) / 2, gridWidth, gridHeight);
+    uint x = grid.x;
+    uint y = grid.y;
+    v.pos = unpackGridPosition(index, x, y, objId);
+    vec2 uvOrigin = vec2(tex[nonuniformEXT(objId)].t[0], tex[nonuniformEXT(objId)].t[1]);
+    vec2 uvStep = vec2(tex[nonuniformEXT(objId)].t[2], tex[nonuniformEXT(objId)].t[3]);
+    v.uv = uvOrigin + vec2(x, y) * uvStep;
+    uint x0 = x > 0 ? x - 1 : x, x1 = min(x + 1, gridWidth - 1);
+    uint y0 = y > 0 ? y - 1 : y, y1 = min(y + 1, gridHeight - 1);
+    vec3 dx = unpackGridPosition(y * gridWidth + x1, x1, y, objId) - unpackGridPosition(y * gridWidth + x0, x0, y, objId);
+    vec3 dy = unpackGridPosition(y1 * gridWidth + x, x, y1, objId) - unpackGridPosition(y0 * gridWidth + x, x, y0, objId);
+    v.normal = normalize(cross(dy, dx));
+    return v;
+};
+
 WaveFrontMaterial unpackMaterial(WaveFrontMaterialPacked p){
     WaveFrontMaterial m;
     m.ambient = p.ambientRoughness.xyz;
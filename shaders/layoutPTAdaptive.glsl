@@ -0,0 +1,13 @@
+#ifndef LAYOUTPTADAPTIVE_H
+#define LAYOUTPTADAPTIVE_H
+
+#ifdef ADAPTIVE_SAMPLING
+// tiles of ADAPTIVE_TILE_SIZE x ADAPTIVE_TILE_SIZE pixels share one convergence flag, has to match AdaptiveSampler::tileSize
+const uint ADAPTIVE_TILE_SIZE = 8;
+// mean luminance, mean squared luminance and sample count of every pixel
+layout(binding = 33, rgba32f) uniform image2D sampleStatistics;
+// one texel per tile, 1 for converged tiles. written by adaptiveSampling.comp
+layout(binding = 34, r8) uniform image2D convergenceMask;
+#endif
+
+#endif //LAYOUTPTADAPTIVE_H
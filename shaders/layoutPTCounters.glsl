@@ -0,0 +1,24 @@
+#ifndef LAYOUTPTCOUNTERS_H
+#define LAYOUTPTCOUNTERS_H
+
+#ifdef RAY_COUNTERS
+// the header is read back by RayCounters, pathLength holds the primary and bounce rays of every pixel
+layout(binding = 27) buffer RayCounters{
+	uint primaryRays;
+	uint bounceRays;
+	uint shadowRays;
+	uint anyHitInvocations;
+	uint pathLength[];
+} rayCounters;
+
+uint pathLength = 0;
+
+// one atomic per subgroup instead of one per invocation
+#define COUNT_RAY(counter) { uvec4 countedInvocations = subgroupBallot(true); if(subgroupElect()) atomicAdd(rayCounters.counter, subgroupBallotBitCount(countedInvocations)); }
+#define COUNT_PATH_RAY(counter) { COUNT_RAY(counter) ++pathLength; }
+#else
+#define COUNT_RAY(counter)
+#define COUNT_PATH_RAY(counter)
+#endif
+
+#endif //LAYOUTPTCOUNTERS_H
@@ -0,0 +1,11 @@
+#ifndef LAYOUTPTENVIRONMENT_H
+#define LAYOUTPTENVIRONMENT_H
+
+#ifdef ENVIRONMENT_MAP
+// latitude longitude map with +z up and its cdfs built by EnvironmentMap
+layout(binding = 30) uniform sampler2D environmentMap;
+// marginal cdf over the rows (height + 1 entries) followed by the conditional cdfs of the rows (width + 1 entries each)
+layout(binding = 31) buffer EnvironmentCdf{float c[]; } environmentCdf;
+#endif
+
+#endif //LAYOUTPTENVIRONMENT_H
@@ -0,0 +1,24 @@
+#ifndef LAYOUTPTLIGHTTREE_H
+#define LAYOUTPTLIGHTTREE_H
+
+#ifdef LIGHT_SAMPLE_BVH
+// node of the light bvh built by LightBVH, the first child of an inner node directly follows it
+struct LightTreeNode{
+	vec4 boundsMinPower;	// w is the summed power of the lights
+	vec4 boundsMaxCosTheta;	// w is the cosine of the normal cone half angle
+	vec3 axis;				// normal cone axis
+	uint index;				// light index of leaves, index of the second child of inner nodes
+	uint leaf;
+	uint pad0, pad1, pad2;
+};
+
+// the directional lights follow the treeNodeCount tree nodes as leaves
+layout(binding = 28) buffer LightTree{
+	uint treeNodeCount;
+	uint infiniteCount;
+	uint pad0, pad1;
+	LightTreeNode nodes[];
+} lightTree;
+#endif
+
+#endif //LAYOUTPTLIGHTTREE_H
@@ -3,4 +3,13 @@
 
 layout(binding = 12) buffer Lights{Light l[]; } lights;
 
+#ifdef LIGHT_SAMPLE_LIGHT_STRENGTH
+// alias table built by LightAliasTable, slot i keeps light i with probability and picks alias otherwise
+struct LightAliasEntry{
+  float probability;
+  uint alias;
+};
+layout(binding = 29) buffer LightAlias{LightAliasEntry e[]; } lightAlias;
+#endif
+
 #endif //LAYOUTPTLIGHTS_H   
\ No newline at end of file
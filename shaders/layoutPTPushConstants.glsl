@@ -8,6 +8,7 @@ layout(push_constant) uniform PushConstants
 	mat4 prevView;
 	uint frameNumber;
 	uint sampleNumber;
+	uint sequenceNumber;
 } camParams;
 
 #endif //LAYOUTPTPUSHCONSTANTS_H
\ No newline at end of file
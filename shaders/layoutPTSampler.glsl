@@ -0,0 +1,9 @@
+#ifndef LAYOUTPTSAMPLER_H
+#define LAYOUTPTSAMPLER_H
+
+#ifdef SAMPLER_SOBOL
+// 32 direction numbers per dimension of the Sobol sequence, generated by SobolSampler
+layout(binding = 32) buffer SobolMatrices{uint m[]; } sobolMatrices;
+#endif
+
+#endif //LAYOUTPTSAMPLER_H
@@ -2,6 +2,9 @@
 #define LIGHTING_H
 
 #include "math.glsl"
+#ifdef ENVIRONMENT_MAP
+#include "environment.glsl"
+#endif
 
 float powerHeuristics(float a, float b){
     float f = a * a;
@@ -92,26 +95,17 @@ vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float
   pdf = pickedStrength / strengthSum;
   shadowed = true;
   traceRayEXT(tlas, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT | gl_RayFlagsSkipClosestHitShaderEXT | gl_RayFlagsNoOpaqueEXT, 0xFF, 0, 0, 1, pos, tmin, l, tmax, 0);
+  COUNT_RAY(shadowRays)
   return pickedLightStrength * float(!shadowed);
 }
 
 #elif defined(LIGHT_SAMPLE_LIGHT_STRENGTH)
+//picks lights proportional to their strength in O(1) with the alias table
 vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float pdf){
-  float rand = randomFloat(re);
-  float pickedStrength = rand * infos.lightStrengthSum;
-  //binary search in the lights array
-  int begin = 0, end = int(infos.lightCount), mid = (begin + end) / 2; //end is always exclusive
-  int c = 0;
-  while(end - begin > 1 && ++c < 100){
-    if(pickedStrength <= lights.l[mid].strengths.w)
-      end = mid + 1;
-    else
-      begin = mid;
-    mid = (begin + end) / 2;
-  }
-  float lStrength = lights.l[begin].strengths.w;
-  if(begin > 0) lStrength -= lights.l[begin - 1].strengths.w;
-  int i = begin;
+  int i = min(int(randomFloat(re) * infos.lightCount), int(infos.lightCount) - 1);
+  if(randomFloat(re) >= lightAlias.e[i].probability)
+    i = int(lightAlias.e[i].alias);
+  float lStrength = dot(lights.l[i].colAmbient + lights.l[i].colDiffuse + lights.l[i].colSpecular, vec4(1));
   vec3 lightStrength = lights.l[i].colAmbient.xyz + lights.l[i].colDiffuse.xyz + lights.l[i].colSpecular.xyz;
   float d = 0, attenuation = 0;
   float tmax = 1000.0;
@@ -164,9 +158,154 @@ vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float
   pdf = 1.0;//lStrength / infos.lightStrengthSum;
   shadowed = true;
   traceRayEXT(tlas, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT | gl_RayFlagsSkipClosestHitShaderEXT | gl_RayFlagsNoOpaqueEXT, 0xFF, 0, 0, 1, pos, tmin, l, tmax, 0);
+  COUNT_RAY(shadowRays)
   return lightStrength * float(!shadowed) * infos.lightStrengthSum / lStrength;
 }
 
+#elif defined(LIGHT_SAMPLE_BVH)
+// cos(a - b) and sin(a - b) for the angles a, b clamped if a < b
+float cosSubClamped(float sinA, float cosA, float sinB, float cosB){
+  return cosA > cosB ? 1.0 : cosA * cosB + sinA * sinB;
+}
+float sinSubClamped(float sinA, float cosA, float sinB, float cosB){
+  return cosA > cosB ? 0.0 : sinA * cosB - cosA * sinB;
+}
+
+//importance of all lights in a node for the shading point, has to match LightBVH::importance()
+float lightTreeImportance(uint nodeIndex, vec3 pos, vec3 n){
+  vec3 boundsMin = lightTree.nodes[nodeIndex].boundsMinPower.xyz;
+  vec3 boundsMax = lightTree.nodes[nodeIndex].boundsMaxCosTheta.xyz;
+  float power = lightTree.nodes[nodeIndex].boundsMinPower.w;
+  float cosThetaO = lightTree.nodes[nodeIndex].boundsMaxCosTheta.w;
+
+  vec3 center = (boundsMin + boundsMax) * .5f;
+  vec3 wi = pos - center;
+  float wiLength = length(wi);
+  float d2 = max(wiLength * wiLength, length(boundsMax - boundsMin) * .5f);
+  wi = wiLength > 0 ? wi / wiLength : vec3(0, 0, 1);
+
+  float cosThetaW = dot(lightTree.nodes[nodeIndex].axis, wi);
+  float sinThetaW = sqrt(max(1 - cosThetaW * cosThetaW, 0));
+  //cone around wi containing the bounds
+  float cosThetaB = -1;
+  bool inside = all(greaterThanEqual(pos, boundsMin)) && all(lessThanEqual(pos, boundsMax));
+  vec3 radius = boundsMax - center;
+  float radius2 = dot(radius, radius);
+  if(!inside && wiLength * wiLength > radius2)
+    cosThetaB = sqrt(max(1 - radius2 / (wiLength * wiLength), 0));
+  float sinThetaB = sqrt(max(1 - cosThetaB * cosThetaB, 0));
+  float sinThetaO = sqrt(max(1 - cosThetaO * cosThetaO, 0));
+
+  float cosThetaX = cosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+  float sinThetaX = sinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+  float cosThetaP = cosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+  if(cosThetaP <= 0) return 0;
+
+  float cosThetaI = abs(dot(wi, n));
+  float sinThetaI = sqrt(max(1 - cosThetaI * cosThetaI, 0));
+  float cosThetaPI = cosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+  return max(power * cosThetaP * cosThetaPI / d2, 0);
+}
+
+//stochastic traversal of the light bvh, every level picks a child proportional to its importance
+//the directional lights are picked uniformly against the whole tree
+vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float pdf){
+  const float oneMinusEpsilon = 0.99999994;
+  pdf = 0;
+  l = vec3(0);
+  uint infiniteCount = lightTree.infiniteCount;
+  uint treeNodeCount = lightTree.treeNodeCount;
+  float pInfinite = float(infiniteCount) / float(infiniteCount + min(treeNodeCount, 1u));
+  float u = randomFloat(re);
+  float pickedPdf;
+  uint nodeIndex;
+  if(u < pInfinite){
+    nodeIndex = treeNodeCount + min(uint(u / pInfinite * infiniteCount), infiniteCount - 1);
+    pickedPdf = pInfinite / infiniteCount;
+  }
+  else{
+    if(treeNodeCount == 0 || lightTreeImportance(0, pos, n) == 0)
+      return vec3(0);
+    //the random number is rescaled to the picked interval and reused for the next level
+    u = min((u - pInfinite) / (1 - pInfinite), oneMinusEpsilon);
+    pickedPdf = 1 - pInfinite;
+    nodeIndex = 0;
+    while(lightTree.nodes[nodeIndex].leaf == 0){
+      uint child0 = nodeIndex + 1, child1 = lightTree.nodes[nodeIndex].index;
+      float importance0 = lightTreeImportance(child0, pos, n), importance1 = lightTreeImportance(child1, pos, n);
+      if(importance0 == 0 && importance1 == 0)
+        return vec3(0);
+      float p0 = importance0 / (importance0 + importance1);
+      if(u < p0){
+        nodeIndex = child0;
+        u = min(u / p0, oneMinusEpsilon);
+        pickedPdf *= p0;
+      }
+      else{
+        nodeIndex = child1;
+        u = min((u - p0) / (1 - p0), oneMinusEpsilon);
+        pickedPdf *= 1 - p0;
+      }
+    }
+  }
+  int i = int(lightTree.nodes[nodeIndex].index);
+
+  vec3 lightStrength = lights.l[i].colAmbient.xyz + lights.l[i].colDiffuse.xyz + lights.l[i].colSpecular.xyz;
+  float d = 0, attenuation = 0;
+  float tmax = 1000.0;
+  float tmin = 0.001;
+  switch(int(lights.l[i].v0Type.w)){
+    case lst_directional:
+      d = distance(pos, lights.l[i].v0Type.xyz);
+      attenuation = 1.0f / (lights.l[i].strengths.x + lights.l[i].strengths.y * d + lights.l[i].strengths.z * d * d);
+      lightStrength *= max(dot(n, -lights.l[i].dirAngle2.xyz), 0)* attenuation;
+      l = normalize(-lights.l[i].dirAngle2.xyz);
+      break;
+    case lst_point:
+      d = distance(pos, lights.l[i].v0Type.xyz);
+      attenuation = 1.0f / (lights.l[i].strengths.x + lights.l[i].strengths.y * d + lights.l[i].strengths.z * d * d);
+      lightStrength *= max(dot(n, normalize(lights.l[i].v0Type.xyz - pos)), 0) * attenuation;
+      l = normalize(lights.l[i].v0Type.xyz - pos);
+      break;
+    case lst_spot:
+
+      break;
+    case lst_ambient:
+
+      break;
+    case lst_area:
+      //sample triangle position
+      vec2 barycentrics = sampleTriangle(randomVec2(re));
+      vec3 p1 = lights.l[i].v0Type.xyz;
+      vec3 p2 = lights.l[i].v1Strength.xyz;
+      vec3 p3 = lights.l[i].v2Angle.xyz;
+      vec3 lightP = blerp(barycentrics, p1, p2, p3);
+      vec3 lightDir = lightP - pos;
+      vec3 lightNormal = cross(p2 - p1, p3 - p1);
+      float triangleArea = .5f * length(lightNormal);
+      lightNormal = normalize(lightNormal);
+      d = length(lightDir);
+      lightDir /= d;
+      attenuation = 1.0f / (lights.l[i].strengths.x + lights.l[i].strengths.y * d + lights.l[i].strengths.z * d * d);
+      lightStrength *= max(dot(n, lightDir), 0) * max(dot(-lightDir, lightNormal), 0) * attenuation * triangleArea;
+      l = lightDir;
+      tmax = d - tmin;
+      break;
+  }
+
+  if(length(lightStrength) < 1e-6){ // surface not hit by this light
+    l = vec3(0);
+    return vec3(0);
+  }
+
+  //the pick probability is no solid angle density, like the other methods the light is divided by it and not weighted by mis
+  pdf = 1.0;
+  shadowed = true;
+  traceRayEXT(tlas, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT | gl_RayFlagsSkipClosestHitShaderEXT | gl_RayFlagsNoOpaqueEXT, 0xFF, 0, 0, 1, pos, tmin, l, tmax, 0);
+  COUNT_RAY(shadowRays)
+  return lightStrength * float(!shadowed) / pickedPdf;
+}
+
 #else //uinform sampling of all light sources
 vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float pdf){
   float rand = randomFloat(re);
@@ -223,6 +362,7 @@ vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float
   pdf = 1.0;
   shadowed = true;
   traceRayEXT(tlas, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT | gl_RayFlagsSkipClosestHitShaderEXT | gl_RayFlagsNoOpaqueEXT, 0xFF, 0, 0, 1, pos, tmin, l, tmax, 0);
+  COUNT_RAY(shadowRays)
   return lightStrength * float(!shadowed) * infos.lightCount;
 }
 #endif
@@ -232,16 +372,38 @@ vec3 sampleLight(vec3 pos, vec3 n, inout RandomEngine re, out vec3 l, out float
 // --------------------------------------------------------------------s
 vec3 GetSkyColor(vec3 direction) 
 {
+#ifdef ENVIRONMENT_MAP
+	return environmentRadiance(direction);
+#else
 	vec3 upper_color = SRGBtoLINEAR(vec3(0.3, 0.5, 0.92));
 	upper_color = mix(vec3(1), upper_color, max(direction.z, 0));
 	vec3 lower_color = vec3(0.2, 0.2, 0.2);
 	float weight = smoothstep(-0.02, 0.02, direction.z);
 	return mix(lower_color, upper_color, weight);
+#endif
 }
 
 // --------------------------------------------------------------------
 // light calculation methods
 // --------------------------------------------------------------------
+#ifdef ENVIRONMENT_MAP
+//direct lighting from the environment map, weighted against hitting the environment with a brdf sample in indirectLighting()
+vec3 environmentLighting(vec3 pos, vec3 o, SurfaceInfo s, inout RandomEngine re){
+  vec3 l;
+  float environmentPdf;
+  vec3 radiance = sampleEnvironment(randomVec2(re), l, environmentPdf);
+  float cosTheta = dot(l, s.normal);
+  if(environmentPdf < EPSILON || cosTheta <= 0 || radiance == vec3(0)) return vec3(0);
+  shadowed = true;
+  traceRayEXT(tlas, gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT | gl_RayFlagsSkipClosestHitShaderEXT | gl_RayFlagsNoOpaqueEXT, 0xFF, 0, 0, 1, pos, tmin, l, tmax, 0);
+  COUNT_RAY(shadowRays)
+  if(shadowed) return vec3(0);
+  vec3 lh = normalize(l + o);
+  float weight = powerHeuristics(environmentPdf, pdfBRDF(s, o, l, lh));
+  return radiance * BRDF(o, l, lh, s) * cosTheta * weight / environmentPdf;
+}
+#endif
+
 //calculates direct lighting on the surface point at pos
 vec3 nextEventEsitmation(vec3 pos, vec3 o, SurfaceInfo s, vec3 throughput, inout RandomEngine re){
   if(s.normal == vec3(1,1,1)) return GetSkyColor(-o) * throughput;
@@ -250,13 +412,17 @@ vec3 nextEventEsitmation(vec3 pos, vec3 o, SurfaceInfo s, vec3 throughput, inout
   vec3 l;
   float lightPdf;
   vec3 lightCol = sampleLight(pos, s.normal, re, l, lightPdf);
-  if(lightCol == vec3(0)) return lightCol;
-  vec3 lh = normalize(l + o);
-  float cosTheta = dot(l, s.normal);
-  vec3 brdf = BRDF(o, l, lh, s);
-  float brdfPdf = pdfBRDF(s, o, l, lh);
-  float weight = powerHeuristics(lightPdf, brdfPdf);
-  light += lightCol * brdf * weight / lightPdf;   //no multiplication with cosTheta as it is already done in sampleLight()
+  if(lightCol != vec3(0)){
+    vec3 lh = normalize(l + o);
+    float cosTheta = dot(l, s.normal);
+    vec3 brdf = BRDF(o, l, lh, s);
+    float brdfPdf = pdfBRDF(s, o, l, lh);
+    float weight = powerHeuristics(lightPdf, brdfPdf);
+    light += lightCol * brdf * weight / lightPdf;   //no multiplication with cosTheta as it is already done in sampleLight()
+  }
+#ifdef ENVIRONMENT_MAP
+  light += environmentLighting(pos, o, s, re);
+#endif
   return min(throughput * light, vec3(c_MaxRadiance));
 }
 
@@ -281,6 +447,13 @@ vec3 indirectLighting(vec3 pos, vec3 v, SurfaceInfo s, int recDepth, inout vec3
   throughput = pathThroughput;
 
   traceRayEXT(tlas, rayFlags, cullMask, 0, 0, 0, pos, tmin, l, tmax, 1);
+  COUNT_PATH_RAY(bounceRays)
+#ifdef ENVIRONMENT_MAP
+  if(rayPayload.si.normal == vec3(1)){   //environment hit, the refraction pdf is no density and can not be weighted
+    float weight = s.illuminationType == 7 ? 1.0 : powerHeuristics(pdf, environmentPdf(l));
+    return environmentRadiance(l) * throughput * weight;
+  }
+#endif
 
 	//TODO: better firefly suppression (see nvpro samples for a good one)
   return nextEventEsitmation(rayPayload.position, -l, rayPayload.si, throughput, re) + rayPayload.si.emissiveColor * throughput;
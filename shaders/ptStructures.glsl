@@ -11,7 +11,8 @@ struct ObjectInstance{
   mat4 objectMat;
   int meshId;
   uint indexStride;
-  int pad[2];
+  uint gridWidth;   //vertices per row of a regular grid mesh which only stores heights, 0 for other meshes
+  uint gridHeight;  //rows of the grid, vertices after the grid are skirt vertices
 };
 
 // unpacking code is in geometry.glsl
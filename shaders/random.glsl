@@ -1,6 +1,80 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+// the path tracer draws its random numbers through a sampler: RandomEngine, rEInit() for every pixel sample, rESetBounce()
+// before every path segment and randomFloat(). SAMPLER_SOBOL selects the Sobol sampler, otherwise white noise is drawn from a
+// hybrid Tausworthe generator
+
+// Thomas Wang 32-bit hash.
+uint wangHash(uint seed){
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed = seed ^ (seed >> 4);
+    seed *= 0x27d4eb2d;
+    seed = seed ^ (seed >> 15);
+    return seed;
+}
+
+#ifdef SAMPLER_SOBOL
+// Owen scrambled Sobol sampler (Burley 2020, "Practical Hash-based Owen Scrambling") with the direction matrices of SobolSampler.
+// the dimensions are split into groups of the dimensions in the table: every bounce starts a new group and longer bounces
+// continue with further groups. the sample index is shuffled per pixel and group, the points per pixel, group and dimension
+struct RandomEngine{
+    uint index;
+    uint seed;
+    uint bounce;
+    uint dimension;
+};
+
+uint hashCombine(uint seed, uint v){
+    return seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+uint nestedUniformScramble(uint x, uint seed){
+    x = bitfieldReverse(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return bitfieldReverse(x);
+}
+
+uint sobolSample(uint index, uint dimension){
+    uint x = 0;
+    for(uint i = dimension * 32; index != 0; index >>= 1, ++i){
+        if((index & 1) != 0) x ^= sobolMatrices.m[i];
+    }
+    return x;
+}
+
+float randomFloat(inout RandomEngine e){
+    uint dimensionCount = uint(sobolMatrices.m.length()) / 32;
+    uint groupSeed = wangHash(hashCombine(hashCombine(e.seed, e.bounce), e.dimension / dimensionCount));
+    uint dimension = e.dimension % dimensionCount;
+    ++e.dimension;
+    uint index = nestedUniformScramble(e.index, groupSeed);
+    uint x = nestedUniformScramble(sobolSample(index, dimension), wangHash(hashCombine(groupSeed, dimension)));
+    return float(x >> 8) * (1.0 / 16777216.0);   // 24 bits, so the result does not round up to 1
+}
+
+//init random engine, sampleIndex is the number of samples the pixel has accumulated. the sequence index is the frame the
+//accumulation started in, it stays the same for all samples of the accumulation so they draw one scrambled sequence
+RandomEngine rEInit(uvec2 id, uint sequenceIndex, uint sampleIndex){
+    RandomEngine re;
+    re.index = sampleIndex;
+    re.seed = wangHash(hashCombine(hashCombine(wangHash(id.x), id.y), sequenceIndex));
+    re.bounce = 0;
+    re.dimension = 0;
+    return re;
+}
+
+// starts the dimensions of the next path segment, so the same decision of every sample draws the same dimension
+void rESetBounce(inout RandomEngine re, uint bounce){
+    re.bounce = bounce;
+    re.dimension = 0;
+}
+#else
 // Improvement could be made by using https://developer.nvidia.com/gpugems/gpugems3/part-vi-gpu-computing/chapter-37-efficient-random-number-generation-and-application
 // for shorter version see https://math.stackexchange.com/questions/337782/pseudo-random-number-generation-on-the-gpu
 //struct RandomEngine{
@@ -57,34 +131,11 @@ float randomFloat(inout RandomEngine e){
     return randomNumber(e);
 }
 
-uint randomUInt(inout RandomEngine e, uint nmax){
-    float f = randomFloat(e);
-    return uint(floor(f * nmax));
-}
-
-vec2 randomVec2(inout RandomEngine e){
-    return vec2(randomFloat(e), randomFloat(e));
-}
-
-vec3 randomVec3(inout RandomEngine e){
-    return vec3(randomFloat(e), randomFloat(e), randomFloat(e));
-}
-
-// Thomas Wang 32-bit hash.
-uint wangHash(uint seed){
-    seed = (seed ^ 61) ^ (seed >> 16);
-    seed *= 9;
-    seed = seed ^ (seed >> 4);
-    seed *= 0x27d4eb2d;
-    seed = seed ^ (seed >> 15);
-    return seed;
-}
-
 //init random engine
-RandomEngine rEInit(uvec2 id, uint frameIndex){
+RandomEngine rEInit(uvec2 id, uint sequenceIndex, uint sampleIndex){
     uint s0 = id.x;
     uint s1 = id.y;
-    uint s2 = frameIndex;
+    uint s2 = wangHash(sequenceIndex) + sampleIndex;
     uint s3 = (s0 + s1) * s2;
 
     RandomEngine re;
@@ -95,4 +146,22 @@ RandomEngine rEInit(uvec2 id, uint frameIndex){
     return re;
 }
 
+// the random numbers have no dimensions, every call draws the next number
+void rESetBounce(inout RandomEngine re, uint bounce){
+}
+#endif //SAMPLER_SOBOL
+
+uint randomUInt(inout RandomEngine e, uint nmax){
+    float f = randomFloat(e);
+    return uint(floor(f * nmax));
+}
+
+vec2 randomVec2(inout RandomEngine e){
+    return vec2(randomFloat(e), randomFloat(e));
+}
+
+vec3 randomVec3(inout RandomEngine e){
+    return vec3(randomFloat(e), randomFloat(e), randomFloat(e));
+}
+
 #endif //RANDOM_H
\ No newline at end of file
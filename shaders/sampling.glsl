@@ -26,7 +26,7 @@ vec2 sampleTriangle(vec2 u){
     return vec2(1.0f - uxsqrt, u.y * uxsqrt);
 }
 
-vec3 sampleBRDF(SurfaceInfo s, RandomEngine re, vec3 v,out vec3 l,out float pdf){
+vec3 sampleBRDF(SurfaceInfo s, inout RandomEngine re, vec3 v,out vec3 l,out float pdf){
     vec3 h;
     vec3 u = randomVec3(re);
     float specularSW = specularSampleWeight(s);
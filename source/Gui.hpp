@@ -4,6 +4,8 @@
 #include <vsgImGui/imgui.h>
 #include <vsgImGui/RenderImGui.h>
 #include <vsgImGui/SendEventsToImGui.h>
+#include <renderModules/GpuProfiler.hpp>
+#include <renderModules/RayCounters.hpp>
 
 class Gui
 {
@@ -17,11 +19,14 @@ public:
         float testColor[4];
         char testTextInput[200];
         int triangleCount;
-        int raysPerPixel;
+        int raysPerPixel;           // estimate that is shown if the rays are not counted
+        bool rayCountsMeasured = false;
+        RayCounters::Counts rayCounts;
         int width;
         int height;
         uint32_t sampleNumber;
         bool updateTerrainLodButtonPressed;
+        std::vector<GpuProfiler::Statistics> passTimings;
     };
 
     Gui(vsg::ref_ptr<Values> values): _values(values), _state({true})
@@ -42,9 +47,23 @@ public:
         //ImGui::InputText("testTextInput", _values->testTextInput, 200);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS) for %d triangles", 1000.0f / ImGui::GetIO().Framerate,
                     ImGui::GetIO().Framerate, _values->triangleCount);
-        ImGui::Text("Render size is %d by %d with %d rays/pixel resulting in %.3f mRays/second", _values->width, _values->height,
-                    _values->raysPerPixel, ImGui::GetIO().Framerate * _values->raysPerPixel * _values->width * _values->height / 1.0e6);
+        if (_values->rayCountsMeasured)
+        {
+            double rays = static_cast<double>(_values->rayCounts.rays());
+            ImGui::Text("Render size is %d by %d with %.2f traced rays/pixel resulting in %.3f mRays/second", _values->width, _values->height,
+                        rays / (_values->width * _values->height), ImGui::GetIO().Framerate * rays / 1.0e6);
+            ImGui::Text("Rays per frame: %u primary, %u bounce, %u shadow, %u any hit invocations", _values->rayCounts.primary,
+                        _values->rayCounts.bounce, _values->rayCounts.shadow, _values->rayCounts.anyHit);
+        }
+        else
+            ImGui::Text("Render size is %d by %d with %d rays/pixel resulting in %.3f mRays/second", _values->width, _values->height,
+                        _values->raysPerPixel, ImGui::GetIO().Framerate * _values->raysPerPixel * _values->width * _values->height / 1.0e6);
         ImGui::Text("Samples per pixel: %d", _values->sampleNumber);
+        if (!_values->passTimings.empty() && ImGui::CollapsingHeader("GPU passes (mean / p50 / p99 ms)"))
+        {
+            for (const auto& pass : _values->passTimings)
+                ImGui::Text("%-20s %7.3f %7.3f %7.3f", pass.name.c_str(), pass.mean, pass.p50, pass.p99);
+        }
 
         _values->updateTerrainLodButtonPressed = ImGui::Button("Update Terrain LOD", ImVec2(0, 0));
 
@@ -7,15 +7,23 @@
 #include "renderModules/PBRTPipeline.hpp"
 #include "renderModules/Accumulator.hpp"
 #include "renderModules/FormatConverter.hpp"
-#include "renderModules/denoisers/BFR.hpp"
-#include "renderModules/denoisers/BFRBlender.hpp"
-#include "renderModules/denoisers/BMFR.hpp"
+#include "renderModules/denoisers/Denoiser.hpp"
 #include "renderModules/Taa.hpp"
+#include "renderModules/GpuProfiler.hpp"
+#include "renderModules/RayCounters.hpp"
 #include "io/RenderIO.hpp"
+#include "io/CameraPath.hpp"
+#include "io/FrameWriter.hpp"
+#include "io/ReadbackRing.hpp"
+#include "io/GBufferSequence.hpp"
+#include "io/SceneCache.hpp"
+#include "io/Benchmark.hpp"
+#include "io/PipelineCache.hpp"
 
 #include "terrain/TerrainImporter.hpp"
 #include "terrain/TerrainPipeline.hpp"
 #include "terrain/TerrainAccelerationStructureManager.hpp"
+#include "terrain/TerrainBuildAccelerationStructureTraversal.hpp"
 
 #include "Gui.hpp"
 
@@ -25,7 +33,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #include "../external/vsgXchange/src/assimp/3DFrontImporter.h"
 
@@ -37,25 +47,6 @@ public:
     RayTracingPushConstantsValue() {}
 };
 
-enum class DenoisingType
-{
-    None,
-    BMFR,
-    BFR,
-    SVG
-};
-DenoisingType denoisingType = DenoisingType::None;
-
-enum class DenoisingBlockSize
-{
-    x8,
-    x16,
-    x32,
-    x64,
-    x8x16x32
-};
-DenoisingBlockSize denoisingBlockSize = DenoisingBlockSize::x32;
-
 class LoggingRedirectSentry
 {
 public:
@@ -74,10 +65,35 @@ private:
     std::streambuf *originalBuffer;
 };
 
+// creates instance and device without a surface, used for rendering without window and swapchain
+// the physical device only holds an observer to the instance, so the instance has to be kept alive by the caller
+vsg::ref_ptr<vsg::Device> createHeadlessDevice(const vsg::WindowTraits& traits, vsg::ref_ptr<vsg::Instance>& instance)
+{
+    vsg::Names requestedLayers;
+    vsg::Names instanceExtensions = traits.instanceExtensionNames;
+    if (traits.debugLayer || traits.apiDumpLayer)
+    {
+        instanceExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+        requestedLayers.push_back("VK_LAYER_KHRONOS_validation");
+        if (traits.apiDumpLayer) requestedLayers.push_back("VK_LAYER_LUNARG_api_dump");
+    }
+    vsg::Names validatedNames = vsg::validateInstancelayerNames(requestedLayers);
+    instance = vsg::Instance::create(instanceExtensions, validatedNames, traits.vulkanVersion);
+
+    // no device type preference, so that software implementations are found on machines without gpu
+    auto physicalDevice = instance->getPhysicalDevice(traits.queueFlags);
+    if (!physicalDevice)
+        throw vsg::Exception{"Error: createHeadlessDevice(...) no suitable Vulkan PhysicalDevice available.", VK_ERROR_INITIALIZATION_FAILED};
+    int queueFamily = physicalDevice->getQueueFamily(traits.queueFlags);
+    vsg::QueueSettings queueSettings{vsg::QueueSetting{queueFamily, {1.0}}};
+    return vsg::Device::create(physicalDevice, queueSettings, validatedNames, traits.deviceExtensionNames, traits.deviceFeatures, instance->getAllocationCallbacks());
+}
+
 int main(int argc, char **argv)
 {
     try
     {
+        auto startTime = std::chrono::steady_clock::now();
         vsg::CommandLine arguments(&argc, argv);
 
         // load config
@@ -116,9 +132,16 @@ int main(int argc, char **argv)
         if (arguments.read({"--window", "-w"}, windowTraits->width, windowTraits->height))
             windowTraits->fullscreen = false;
         arguments.read("--screen", windowTraits->screenNum);
+        // renders without window, swapchain and gui, the results are only available via the export options
+        bool headless = arguments.read("--headless");
 
         auto numFrames = arguments.value(-1, "-f");
         auto samplesPerPixel = arguments.value(1, "--spp");
+        // stops sampling a frame once the relative error of every tile is below the given error, --spp is the maximum then.
+        // tiles are converged after --adaptive-min-spp samples at the earliest. --time-budget limits the seconds spent on a frame
+        auto adaptiveError = arguments.value(0.0f, "--adaptive");
+        auto adaptiveMinSamples = arguments.value(16u, "--adaptive-min-spp");
+        auto timeBudget = arguments.value(0.0, "--time-budget");
         auto depthPath = arguments.value(std::string(), "--depths");
         auto exportDepthPath = arguments.value(std::string(), "--exportDepth");
         auto positionPath = arguments.value(std::string(), "--positions");
@@ -129,15 +152,45 @@ int main(int argc, char **argv)
         auto exportAlbedoPath = arguments.value(std::string(), "--exportAlbedo");
         auto materialPath = arguments.value(std::string(), "--materials");
         auto exportMaterialPath = arguments.value(std::string(), "--exportMaterial");
+        // all gbuffer layers of a frame in one multi-part exr file
+        auto exportGBufferMultipartPath = arguments.value(std::string(), "--exportGBufferMultipart");
         auto illuminationPath = arguments.value(std::string(), "--illuminations");
         auto exportIlluminationPath = arguments.value(std::string(), "--exportIllumination");
         auto matricesPath = arguments.value(std::string(), "--matrices");
         auto exportMatricesPath = arguments.value(std::string(), "--exportMatrices");
+        // single file gbuffer sequences (see GBufferSequence.hpp), --convertToSequence converts the given file sets and exits
+        auto sequencePath = arguments.value(std::string(), "--sequence");
+        auto exportSequencePath = arguments.value(std::string(), "--exportSequence");
+        auto convertToSequencePath = arguments.value(std::string(), "--convertToSequence");
         auto sceneFilename = arguments.value(std::string(), "-i");
-        bool use_external_buffers = normalPath.size();
-        bool exportIllumination = exportIlluminationPath.size();
-        bool exportGBuffer = exportNormalPath.size() || exportDepthPath.size() || exportPositionPath.size() || exportAlbedoPath.size() || exportMaterialPath.size();
+        auto sceneCacheDirectory = arguments.value(std::string(), "--scene-cache");
+        bool use_external_buffers = normalPath.size() || sequencePath.size();
+        bool exportIllumination = exportIlluminationPath.size() || exportSequencePath.size();
+        bool exportGBuffer = exportNormalPath.size() || exportDepthPath.size() || exportPositionPath.size() || exportAlbedoPath.size() || exportMaterialPath.size() || exportGBufferMultipartPath.size() || exportSequencePath.size();
+        // exr compression and precision, e.g. --exr_compression piz --exr_half_float
+        auto exportOptions = GBufferIO::exportOptions();
+        exportOptions->readOptions(arguments);
         bool storeMatrices = exportGBuffer || exportMatricesPath.size();
+        // external buffers are streamed and exported frames are written while rendering, so only a bounded number of frames is in memory
+        auto ioThreads = arguments.value(std::max(1u, std::thread::hardware_concurrency()), "--io-threads");
+        auto prefetchWindow = arguments.value(16, "--prefetch-window");
+        // number of frames whose readback can be in flight before rendering waits for the oldest one
+        auto readbackSlots = arguments.value(3u, "--readback-slots");
+        // per pass gpu timings are shown in the gui, --profile-trace additionally writes them as chrome trace json
+        auto profileTracePath = arguments.value(std::string(), "--profile-trace");
+        // plays the camera path (any MatrixIO format) after warm-up frames and writes per frame cpu and gpu timings as json or csv
+        auto benchmarkPath = arguments.value(std::string(), "--benchmark");
+        auto benchmarkReportPath = arguments.value(std::string("benchmark.json"), "--benchmark-report");
+        auto benchmarkWarmup = arguments.value(16, "--benchmark-warmup");
+        // instruments the ray tracing shaders to count the traced rays, --path-length-heatmap writes the path lengths of the last frame as exr
+        auto pathLengthHeatmapPath = arguments.value(std::string(), "--path-length-heatmap");
+        bool countRays = arguments.read("--count-rays") || pathLengthHeatmapPath.size();
+        // the driver's pipeline cache is loaded from and saved to this file, so pipelines are not rebuilt on every start
+        auto pipelineCachePath = arguments.value(std::string(), "--pipeline-cache");
+        // an equirectangular hdr image (exr, z up) that replaces the sky color and is importance sampled as a light
+        auto environmentMapPath = arguments.value(std::string(), "--env-map");
+        // sobol draws owen scrambled sobol points, random the white noise of the former random engine
+        auto samplerName = arguments.value(std::string("sobol"), "--sampler");
 
         auto terrainHeightmapFilename = arguments.value(std::string(), "-th");
         auto terrainTextureFilename = arguments.value(std::string(), "-tx");
@@ -151,6 +204,12 @@ int main(int argc, char **argv)
         auto terrainTilesX = arguments.value((uint32_t) 1, "--tilesx");
         auto terrainTilesY = arguments.value((uint32_t) 1, "--tilesy");
         auto terrainTileLengthLodFactor = arguments.value((int)1, "--tile-length-lod-factor");
+        bool terrainCompactVertices = arguments.read("--compact-terrain");
+        bool terrainSkirts = arguments.read("--terrain-skirts");
+        bool terrainStreaming = arguments.read("--terrain-streaming");
+        bool terrainRebuildTlas = arguments.read("--terrain-rebuild-tlas");
+        auto terrainStreamingThreads = arguments.value(std::max(1u, std::thread::hardware_concurrency() / 2), "--terrain-streaming-threads");
+        auto terrainCacheTiles = arguments.value(4 * terrainTilesX * terrainTilesY, "--terrain-cache-tiles");
 
         if (sceneFilename.empty() && !use_external_buffers && terrainHeightmapFilename.empty())
         {
@@ -161,20 +220,36 @@ int main(int argc, char **argv)
         if (arguments.errors())
             return arguments.writeErrorMessages(std::cerr);
 
-        std::string denoisingTypeStr;
-        if (arguments.read("--denoiser", denoisingTypeStr))
+        // denoiser selection, multiple block sizes are denoised separately and blended
+        std::string denoiserName = arguments.value(std::string("none"), "--denoiser");
+        DenoiserSettings denoiserSettings;
+        std::string blockSizes;
+        if (arguments.read("--block", blockSizes) && !denoiserSettings.parseBlockSizes(blockSizes))
         {
-            if (denoisingTypeStr == "bmfr")
-                denoisingType = DenoisingType::BMFR;
-            else if (denoisingTypeStr == "bfr")
-                denoisingType = DenoisingType::BFR;
-            else if (denoisingTypeStr == "svgf")
-                denoisingType = DenoisingType::SVG;
-            else if (denoisingTypeStr == "none")
-            {
-            }
-            else
-                std::cout << "Unknown denoising type: " << denoisingTypeStr << std::endl;
+            std::cout << "Invalid block sizes: " << blockSizes << ", expected a comma separated list like 8,16,32" << std::endl;
+            return 1;
+        }
+        denoiserSettings.fittingKernel = arguments.value(0u, "--fitting-kernel");
+        bool useDenoiser = denoiserName != "none";
+        if (useDenoiser && !DenoiserRegistry::contains(denoiserName))
+        {
+            std::cout << "Unknown denoiser: " << denoiserName << ", available denoisers: none";
+            for (auto& name : DenoiserRegistry::names())
+                std::cout << ", " << name;
+            std::cout << std::endl;
+            return 1;
+        }
+        if (useDenoiser && !denoiserSettings.validate(denoiserName))
+            return 1;
+        if (adaptiveError > 0 && useDenoiser)
+        {
+            std::cout << "Adaptive sampling needs the progressively accumulated image and can not be combined with a denoiser" << std::endl;
+            return 1;
+        }
+        if (samplerName != "sobol" && samplerName != "random")
+        {
+            std::cout << "Unknown sampler: " << samplerName << ", available samplers: sobol, random" << std::endl;
+            return 1;
         }
         bool useTaa = arguments.read("--taa");
         bool useFlyNavigation = arguments.read("--fly");
@@ -202,11 +277,15 @@ int main(int argc, char **argv)
 
         // load scene or images
         vsg::ref_ptr<vsg::Node> loaded_scene;
-        std::vector<vsg::ref_ptr<OfflineGBuffer>> offlineGBuffers;
-        std::vector<vsg::ref_ptr<OfflineIllumination>> offlineIlluminations;
+        vsg::ref_ptr<OfflineGBufferStream> offlineGBufferStream;
+        vsg::ref_ptr<OfflineIlluminationStream> offlineIlluminationStream;
+        vsg::ref_ptr<OfflineGBuffer> firstOfflineGBuffer;
+        vsg::ref_ptr<OfflineIllumination> firstOfflineIllumination;
         std::vector<CameraMatrices> cameraMatrices;
+        // a binary benchmark path stays mapped and only the matrices of the rendered frame are read
+        vsg::ref_ptr<CameraPath> benchmarkCameraPath;
         if (!terrainHeightmapFilename.empty()) {
-            auto terrainImporter = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, terrainHeightmapLod, terrainTextureLod, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor);
+            auto terrainImporter = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, terrainHeightmapLod, terrainTextureLod, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor, terrainCompactVertices, terrainSkirts);
             //auto terrainImporter = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, 0, 0, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor);
             loaded_scene = terrainImporter->importTerrain();
             if (!loaded_scene) {
@@ -218,13 +297,38 @@ int main(int argc, char **argv)
         else if(!use_external_buffers){
             AI3DFrontImporter::ReadConfig(config_json);
             auto options = vsg::Options::create(vsgXchange::assimp::create(), vsgXchange::dds::create(), vsgXchange::stbi::create()); //using the assimp loader
-            loaded_scene = vsg::read_cast<vsg::Node>(sceneFilename, options);
+            auto sceneExtension = vsg::lowerCaseFileExtension(sceneFilename);
+            bool nativeScene = sceneExtension == ".vsgb" || sceneExtension == ".vsgt";
+            if (!sceneCacheDirectory.empty() && !nativeScene)
+                loaded_scene = SceneCache(sceneCacheDirectory).load(sceneFilename, config_json, options);
+            else
+                loaded_scene = vsg::read_cast<vsg::Node>(sceneFilename, options);
             if (!loaded_scene)
             {
                 std::cout << "Scene not found: " << sceneFilename << std::endl;
                 return 1;
             }
         }
+        else if (sequencePath.size())
+        {
+            auto sequence = GBufferSequence::open(sequencePath);
+            if (!sequence)
+                return 1;
+            if (numFrames <= 0 || numFrames > static_cast<int>(sequence->frameCount()))
+                numFrames = sequence->frameCount();
+            cameraMatrices = sequence->matrices();
+            offlineGBufferStream = sequence->streamGBuffer(ioThreads, prefetchWindow);
+            offlineIlluminationStream = sequence->streamIllumination(ioThreads, prefetchWindow);
+            firstOfflineGBuffer = offlineGBufferStream->get(0);
+            firstOfflineIllumination = offlineIlluminationStream->get(0);
+            if (!firstOfflineGBuffer || !firstOfflineGBuffer->depth || !firstOfflineGBuffer->normal || !firstOfflineGBuffer->albedo || !firstOfflineIllumination || !firstOfflineIllumination->noisy)
+            {
+                std::cout << "Gbuffer sequence does not contain gbuffer and illumination" << std::endl;
+                return 1;
+            }
+            windowTraits->width = sequence->width();
+            windowTraits->height = sequence->height();
+        }
         else
         {
             if (numFrames <= 0)
@@ -244,16 +348,40 @@ int main(int argc, char **argv)
                 return 1;
             }
             if (positionPath.size())
+                offlineGBufferStream = GBufferIO::streamGBufferPosition(positionPath, normalPath, materialPath, albedoPath, cameraMatrices, numFrames, ioThreads, prefetchWindow);
+            else
+                offlineGBufferStream = GBufferIO::streamGBufferDepth(depthPath, normalPath, materialPath, albedoPath, numFrames, ioThreads, prefetchWindow);
+            offlineIlluminationStream = IlluminationBufferIO::streamIllumination(illuminationPath, numFrames, ioThreads, prefetchWindow);
+            firstOfflineGBuffer = offlineGBufferStream->get(0);
+            firstOfflineIllumination = offlineIlluminationStream->get(0);
+            if (!firstOfflineGBuffer || !firstOfflineGBuffer->depth || !firstOfflineIllumination || !firstOfflineIllumination->noisy)
             {
-                offlineGBuffers = GBufferIO::importGBufferPosition(positionPath, normalPath, materialPath, albedoPath, cameraMatrices, numFrames);
+                std::cout << "External GBuffer or Illumination could not be loaded" << std::endl;
+                return 1;
             }
-            else
+            windowTraits->width = firstOfflineGBuffer->depth->width();
+            windowTraits->height = firstOfflineGBuffer->depth->height();
+            if (convertToSequencePath.size())
+                return GBufferSequenceIO::convert(convertToSequencePath, offlineGBufferStream, offlineIlluminationStream, cameraMatrices, numFrames) ? 0 : 1;
+        }
+        if (benchmarkPath.size())
+        {
+            // external buffers bring their own camera matrices, a rendered scene follows the benchmark path
+            if (!use_external_buffers)
             {
-                offlineGBuffers = GBufferIO::importGBufferDepth(depthPath, normalPath, materialPath, albedoPath, numFrames);
+                if (vsg::lowerCaseFileExtension(benchmarkPath) == CameraPathFormat::extension)
+                    benchmarkCameraPath = CameraPath::open(benchmarkPath);
+                else
+                    cameraMatrices = MatrixIO::importMatrices(benchmarkPath);
+                if (!benchmarkCameraPath && cameraMatrices.empty())
+                {
+                    std::cout << "Benchmark camera path could not be loaded" << std::endl;
+                    return 1;
+                }
             }
-            offlineIlluminations = IlluminationBufferIO::importIllumination(illuminationPath, numFrames);
-            windowTraits->width = offlineGBuffers[0]->depth->width();
-            windowTraits->height = offlineGBuffers[0]->depth->height();
+            int pathFrames = benchmarkCameraPath ? static_cast<int>(benchmarkCameraPath->frameCount()) : static_cast<int>(cameraMatrices.size());
+            if (numFrames <= 0 || numFrames > pathFrames)
+                numFrames = pathFrames;
         }
         if (exportIllumination)
         {
@@ -262,15 +390,6 @@ int main(int argc, char **argv)
                 std::cout << "No number of frames given. For usage of Illumination export use \"-f\" to inform about the number of frames." << std::endl;
                 return 1;
             }
-            if (offlineIlluminations.empty())
-            {
-                offlineIlluminations.resize(numFrames);
-                for (auto &i : offlineIlluminations)
-                {
-                    i = OfflineIllumination::create();
-                    i->noisy = vsg::vec4Array2D::create(windowTraits->width, windowTraits->height);
-                }
-            }
         }
         if (exportGBuffer)
         {
@@ -279,41 +398,51 @@ int main(int argc, char **argv)
                 std::cout << "No number of frames given. For usage of GBuffer export use \"-f\" to inform about the number of frames." << std::endl;
                 return 1;
             }
-            if (offlineGBuffers.empty())
-            {
-                offlineGBuffers.resize(numFrames);
-                for (auto &i : offlineGBuffers)
-                {
-                    i = OfflineGBuffer::create();
-                    i->depth = vsg::floatArray2D::create(windowTraits->width, windowTraits->height);
-                    i->normal = vsg::vec2Array2D::create(windowTraits->width, windowTraits->height);
-                    i->albedo = vsg::ubvec4Array2D::create(windowTraits->width, windowTraits->height);
-                    i->material = vsg::ubvec4Array2D::create(windowTraits->width, windowTraits->height);
-                }
-            }
         }
+        // the matrices of the rendered frames are stored apart from cameraMatrices, which holds the benchmark path or the
+        // matrices of the external buffers and is read while rendering
+        std::vector<CameraMatrices> exportedMatrices;
         if (storeMatrices)
         {
-            cameraMatrices.resize(numFrames);
-            for (auto &matrix : cameraMatrices)
+            exportedMatrices.resize(numFrames);
+            for (auto &matrix : exportedMatrices)
             {
                 matrix.proj = vsg::mat4();
                 matrix.invProj = vsg::mat4();
             }
         }
 
-        auto window = vsg::Window::create(windowTraits);
-        if (!window)
+        if (headless && numFrames <= 0)
         {
-            std::cout << "Could not create windows." << std::endl;
+            std::cout << "No number of frames given. For headless rendering use \"-f\" to inform about the number of frames." << std::endl;
             return 1;
         }
-        auto viewer = vsg::Viewer::create();
-        viewer->addWindow(window);
 
-        vsg::ref_ptr<vsg::Device> device(window->getOrCreateDevice());
+        vsg::ref_ptr<vsg::Instance> headlessInstance;
+        vsg::ref_ptr<vsg::Window> window;
+        vsg::ref_ptr<vsg::Device> device;
+        auto viewer = vsg::Viewer::create();
+        if (headless)
+        {
+            device = createHeadlessDevice(*windowTraits, headlessInstance);
+        }
+        else
+        {
+            window = vsg::Window::create(windowTraits);
+            if (!window)
+            {
+                std::cout << "Could not create windows." << std::endl;
+                return 1;
+            }
+            viewer->addWindow(window);
+            device = window->getOrCreateDevice();
+        }
+        vsg::ref_ptr<PipelineCache> pipelineCache;
+        if (pipelineCachePath.size())
+            pipelineCache = PipelineCache::create(device, pipelineCachePath);
 
         //setting a custom render pass for imgui non clear rendering
+        if (window)
         {
             vsg::AttachmentDescription colorAttachment = vsg::defaultColorAttachment(window->surfaceFormat().format);
             colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -379,6 +508,7 @@ int main(int argc, char **argv)
         rayTracingPushConstantsValue->value().prevView = lookAt->transform();
         rayTracingPushConstantsValue->value().frameNumber = 0;
         rayTracingPushConstantsValue->value().sampleNumber = 0;
+        rayTracingPushConstantsValue->value().sequenceNumber = 0;
         auto pushConstants = vsg::PushConstants::create(VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, rayTracingPushConstantsValue);
         auto computeConstants = vsg::PushConstants::create(VK_SHADER_STAGE_COMPUTE_BIT, 0, rayTracingPushConstantsValue);
 
@@ -386,7 +516,7 @@ int main(int argc, char **argv)
         vsg::ref_ptr<IlluminationBuffer> illuminationBuffer;
         vsg::ref_ptr<AccumulationBuffer> accumulationBuffer;
         bool writeGBuffer;
-        if (denoisingType != DenoisingType::None)
+        if (useDenoiser)
         {
             writeGBuffer = true;
             gBuffer = GBuffer::create(windowTraits->width, windowTraits->height);
@@ -412,13 +542,29 @@ int main(int argc, char **argv)
         //vsg::ref_ptr<PBRTPipeline> pbrtPipeline;
         vsg::ref_ptr<TerrainPipeline> pbrtPipeline;
         vsg::ref_ptr<vsg::TopLevelAccelerationStructure> tlas;
+        vsg::ref_ptr<RayCounters> rayCounters;
+        vsg::ref_ptr<AdaptiveSampler> adaptiveSampler;
         if(!use_external_buffers)
         {
+            if (countRays)
+                rayCounters = RayCounters::create(windowTraits->width, windowTraits->height, pathLengthHeatmapPath.size() > 0);
+            vsg::ref_ptr<EnvironmentMap> environmentMap;
+            if (environmentMapPath.size())
+            {
+                environmentMap = EnvironmentMap::read(environmentMapPath);
+                if (!environmentMap)
+                    return 1;
+            }
+            vsg::ref_ptr<SobolSampler> sampler;
+            if (samplerName == "sobol")
+                sampler = SobolSampler::create();
+            if (adaptiveError > 0)
+                adaptiveSampler = AdaptiveSampler::create(windowTraits->width, windowTraits->height, adaptiveError, adaptiveMinSamples);
             //pbrtPipeline = PBRTPipeline::create(loaded_scene, gBuffer, illuminationBuffer, writeGBuffer, RayTracingRayOrigin::CAMERA);
-            pbrtPipeline = TerrainPipeline::create(loaded_scene, gBuffer, illuminationBuffer, writeGBuffer, RayTracingRayOrigin::CAMERA, maxRecursionDepth);
+            pbrtPipeline = TerrainPipeline::create(loaded_scene, gBuffer, illuminationBuffer, writeGBuffer, RayTracingRayOrigin::CAMERA, maxRecursionDepth, rayCounters, environmentMap, sampler, adaptiveSampler);
 
             // setup tlas
-            vsg::BuildAccelerationStructureTraversal buildAccelStruct(device);
+            TerrainBuildAccelerationStructureTraversal buildAccelStruct(device);
             loaded_scene->accept(buildAccelStruct);
             pbrtPipeline->setTlas(buildAccelStruct.tlas);
             tlas = buildAccelStruct.tlas;
@@ -426,56 +572,84 @@ int main(int argc, char **argv)
         else
         {
             if (!gBuffer)
-                gBuffer = GBuffer::create(offlineGBuffers[0]->depth->width(), offlineGBuffers[0]->depth->height());
-            switch (offlineIlluminations[0]->noisy->getLayout().format)
+                gBuffer = GBuffer::create(firstOfflineGBuffer->depth->width(), firstOfflineGBuffer->depth->height());
+            switch (firstOfflineIllumination->noisy->getLayout().format)
             {
             case VK_FORMAT_R16G16B16A16_SFLOAT:
-                illuminationBuffer = IlluminationBufferDemodulated::create(offlineIlluminations[0]->noisy->width(), offlineIlluminations[0]->noisy->height());
+                illuminationBuffer = IlluminationBufferDemodulated::create(firstOfflineIllumination->noisy->width(), firstOfflineIllumination->noisy->height());
                 break;
             case VK_FORMAT_R32G32B32A32_SFLOAT:
-                illuminationBuffer = IlluminationBufferDemodulatedFloat::create(offlineIlluminations[0]->noisy->width(), offlineIlluminations[0]->noisy->height());
+                illuminationBuffer = IlluminationBufferDemodulatedFloat::create(firstOfflineIllumination->noisy->width(), firstOfflineIllumination->noisy->height());
                 break;
             default:
                 std::cout << "Offline illumination buffer image format not compatible" << std::endl;
                 return 1;
             }
+            // only needed for the buffer sizes, the render loop takes the frames from the streams
+            firstOfflineGBuffer = {};
+            firstOfflineIllumination = {};
         }
         // -------------------------------------------------------------------------------------
         // image layout conversions and correct binding of different denoising tequniques
         // -------------------------------------------------------------------------------------
-        vsg::CompileTraversal imageLayoutCompile(window);
+        vsg::CompileTraversal imageLayoutCompile = headless ? vsg::CompileTraversal(device) : vsg::CompileTraversal(window);
         auto commands = vsg::Commands::create();
         auto offlineGBufferStager = OfflineGBuffer::create();
         auto offlineIlluminationBufferStager = OfflineIllumination::create();
-        vsg::ref_ptr<vsg::QueryPool> queryPool;
+        // finished readbacks are written on the io threads, at most two frames per thread wait in memory.
+        // the threads are only started if frames are exported
+        vsg::ref_ptr<FrameWriter> frameWriter;
+        if (exportGBuffer || exportIllumination)
+            frameWriter = FrameWriter::create(ioThreads, 2 * ioThreads);
+        auto readbackRing = ReadbackRing::create(readbackSlots);
+        vsg::ref_ptr<GBufferSequenceWriter> sequenceWriter;
+        if (exportSequencePath.size() && gBuffer)
+        {
+            sequenceWriter = GBufferSequenceWriter::create(exportSequencePath, gBuffer->width, gBuffer->height, numFrames);
+            if (!sequenceWriter->valid())
+                return 1;
+        }
+        readbackRing->gBufferReady = [&](int frame, vsg::ref_ptr<OfflineGBuffer> offlineGBuffer) {
+            auto matrix = exportedMatrices[frame];
+            frameWriter->write([=]() {
+                bool written = GBufferIO::exportGBufferFrame(exportPositionPath, exportDepthPath, exportNormalPath, exportMaterialPath, exportAlbedoPath, frame, offlineGBuffer, matrix, exportOptions);
+                if (exportGBufferMultipartPath.size())
+                    written = GBufferIO::exportGBufferFrameMultipart(exportGBufferMultipartPath, frame, offlineGBuffer, matrix, exportOptions) && written;
+                if (sequenceWriter)
+                    written = sequenceWriter->writeGBuffer(frame, offlineGBuffer) && sequenceWriter->writeMatrices(frame, matrix) && written;
+                return written;
+            });
+        };
+        readbackRing->illuminationReady = [&](int frame, vsg::ref_ptr<OfflineIllumination> offlineIllumination) {
+            frameWriter->write([=]() {
+                bool written = true;
+                if (exportIlluminationPath.size())
+                    written = IlluminationBufferIO::exportIlluminationFrame(exportIlluminationPath, frame, offlineIllumination, exportOptions);
+                if (sequenceWriter)
+                    written = sequenceWriter->writeIllumination(frame, offlineIllumination) && written;
+                return written;
+            });
+        };
+        auto profiler = GpuProfiler::create();
+        profiler->recordTimeline = profileTracePath.size();
+        profiler->addFrameBeginToCommandGraph(commands);
         if (pbrtPipeline)
         {
-            queryPool = vsg::QueryPool::create(); //standard init has 1 timestamp place
-            queryPool->queryCount = 2;
-            auto resetQuery = vsg::ResetQueryPool::create(queryPool);
-            auto write1 = vsg::WriteTimestamp::create(queryPool, 0, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
-            auto write2 = vsg::WriteTimestamp::create(queryPool, 1, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
-            commands->addChild(resetQuery);
-            commands->addChild(write1);
-            pbrtPipeline->addTraceRaysToCommandGraph(commands, pushConstants);
-            commands->addChild(write2);
+            pbrtPipeline->addTraceRaysToCommandGraph(commands, pushConstants, profiler);
             illuminationBuffer = pbrtPipeline->getIlluminationBuffer();
+            if (adaptiveSampler)
+                adaptiveSampler->addDispatchToCommandGraph(commands, profiler);
         }
         else
         {
-            if (offlineGBuffers.size() < numFrames || offlineIlluminations.size() < numFrames)
-            {
-                std::cout << "Missing offline GBuffer or offline Illumination Buffer info" << std::endl;
-                return 1;
-            }
             offlineGBufferStager->uploadToGBufferCommand(gBuffer, commands, imageLayoutCompile.context);
             offlineIlluminationBufferStager->uploadToIlluminationBufferCommand(illuminationBuffer, commands, imageLayoutCompile.context);
         }
 
         vsg::ref_ptr<Accumulator> accumulator;
-        if(denoisingType != DenoisingType::None){
+        if(useDenoiser){
             accumulator = Accumulator::create(gBuffer, illuminationBuffer, !use_external_buffers);
-            accumulator->addDispatchToCommandGraph(commands);
+            accumulator->addDispatchToCommandGraph(commands, profiler);
             accumulationBuffer = accumulator->accumulationBuffer;
             illuminationBuffer->compile(imageLayoutCompile.context);
             illuminationBuffer->updateImageLayouts(imageLayoutCompile.context);
@@ -483,130 +657,29 @@ int main(int argc, char **argv)
         }
 
         vsg::ref_ptr<vsg::DescriptorImage> finalDescriptorImage;
-        switch (denoisingType)
+        if (useDenoiser)
         {
-        case DenoisingType::None:
-            finalDescriptorImage = illuminationBuffer->illuminationImages[0];
-            break;
-        case DenoisingType::BFR:
-            switch (denoisingBlockSize)
-            {
-            case DenoisingBlockSize::x8:
-            {
-                auto bfr8 = BFR::create(windowTraits->width, windowTraits->height, 8, 8, gBuffer, illuminationBuffer, accumulationBuffer);
-                bfr8->compile(imageLayoutCompile.context);
-                bfr8->updateImageLayouts(imageLayoutCompile.context);
-                bfr8->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bfr8->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x16:
-            {
-                auto bfr16 = BFR::create(windowTraits->width, windowTraits->height, 16, 16, gBuffer, illuminationBuffer, accumulationBuffer);
-                bfr16->compile(imageLayoutCompile.context);
-                bfr16->updateImageLayouts(imageLayoutCompile.context);
-                bfr16->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bfr16->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x32:
-            {
-                auto bfr32 = BFR::create(windowTraits->width, windowTraits->height, 32, 32, gBuffer, illuminationBuffer, accumulationBuffer);
-                bfr32->compile(imageLayoutCompile.context);
-                bfr32->updateImageLayouts(imageLayoutCompile.context);
-                bfr32->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bfr32->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x8x16x32:
-            {
-                auto bfr8 = BFR::create(windowTraits->width, windowTraits->height, 8, 8, gBuffer, illuminationBuffer, accumulationBuffer);
-                auto bfr16 = BFR::create(windowTraits->width, windowTraits->height, 16, 16, gBuffer, illuminationBuffer, accumulationBuffer);
-                auto bfr32 = BFR::create(windowTraits->width, windowTraits->height, 32, 32, gBuffer, illuminationBuffer, accumulationBuffer);
-                auto blender = BFRBlender::create(windowTraits->width, windowTraits->height,
-                                                  illuminationBuffer->illuminationImages[0], illuminationBuffer->illuminationImages[1],
-                                                  bfr8->getFinalDescriptorImage(), bfr16->getFinalDescriptorImage(), bfr32->getFinalDescriptorImage());
-                bfr8->compile(imageLayoutCompile.context);
-                bfr8->updateImageLayouts(imageLayoutCompile.context);
-                bfr16->compile(imageLayoutCompile.context);
-                bfr16->updateImageLayouts(imageLayoutCompile.context);
-                bfr32->compile(imageLayoutCompile.context);
-                bfr32->updateImageLayouts(imageLayoutCompile.context);
-                blender->compile(imageLayoutCompile.context);
-                blender->updateImageLayouts(imageLayoutCompile.context);
-                bfr8->addDispatchToCommandGraph(commands, computeConstants);
-                bfr16->addDispatchToCommandGraph(commands, computeConstants);
-                bfr32->addDispatchToCommandGraph(commands, computeConstants);
-                blender->addDispatchToCommandGraph(commands);
-                finalDescriptorImage = blender->getFinalDescriptorImage();
-                break;
-            }
-            }
-            break;
-        case DenoisingType::BMFR:
-            switch (denoisingBlockSize)
-            {
-            case DenoisingBlockSize::x8:
-            {
-                auto bmfr8 = BMFR::create(windowTraits->width, windowTraits->height, 8, 8, gBuffer, illuminationBuffer, accumulationBuffer, 64);
-                bmfr8->compile(imageLayoutCompile.context);
-                bmfr8->updateImageLayouts(imageLayoutCompile.context);
-                bmfr8->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bmfr8->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x16:
-            {
-                auto bmfr16 = BMFR::create(windowTraits->width, windowTraits->height, 16, 16, gBuffer, illuminationBuffer, accumulationBuffer);
-                bmfr16->compile(imageLayoutCompile.context);
-                bmfr16->updateImageLayouts(imageLayoutCompile.context);
-                bmfr16->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bmfr16->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x32:
-            {
-                auto bmfr32 = BMFR::create(windowTraits->width, windowTraits->height, 32, 32, gBuffer, illuminationBuffer, accumulationBuffer);
-                bmfr32->compile(imageLayoutCompile.context);
-                bmfr32->updateImageLayouts(imageLayoutCompile.context);
-                bmfr32->addDispatchToCommandGraph(commands, computeConstants);
-                finalDescriptorImage = bmfr32->getFinalDescriptorImage();
-                break;
-            }
-            case DenoisingBlockSize::x8x16x32:
-                auto bmfr8 = BMFR::create(windowTraits->width, windowTraits->height, 8, 8, gBuffer, illuminationBuffer, accumulationBuffer, 64);
-                auto bmfr16 = BMFR::create(windowTraits->width, windowTraits->height, 16, 16, gBuffer, illuminationBuffer, accumulationBuffer);
-                auto bmfr32 = BMFR::create(windowTraits->width, windowTraits->height, 32, 32, gBuffer, illuminationBuffer, accumulationBuffer);
-                auto blender = BFRBlender::create(windowTraits->width, windowTraits->height,
-                                                  illuminationBuffer->illuminationImages[1], illuminationBuffer->illuminationImages[2],
-                                                  bmfr8->getFinalDescriptorImage(), bmfr16->getFinalDescriptorImage(), bmfr32->getFinalDescriptorImage());
-                bmfr8->compile(imageLayoutCompile.context);
-                bmfr8->updateImageLayouts(imageLayoutCompile.context);
-                bmfr16->compile(imageLayoutCompile.context);
-                bmfr16->updateImageLayouts(imageLayoutCompile.context);
-                bmfr32->compile(imageLayoutCompile.context);
-                bmfr32->updateImageLayouts(imageLayoutCompile.context);
-                blender->compile(imageLayoutCompile.context);
-                blender->updateImageLayouts(imageLayoutCompile.context);
-                bmfr8->addDispatchToCommandGraph(commands, computeConstants);
-                bmfr16->addDispatchToCommandGraph(commands, computeConstants);
-                bmfr32->addDispatchToCommandGraph(commands, computeConstants);
-                blender->addDispatchToCommandGraph(commands);
-                finalDescriptorImage = blender->getFinalDescriptorImage();
-                break;
-            }
-            break;
-        case DenoisingType::SVG:
-            std::cout << "Not yet implemented" << std::endl;
-            break;
+            denoiserSettings.width = windowTraits->width;
+            denoiserSettings.height = windowTraits->height;
+            if (!denoiserSettings.validate(denoiserName, &device->getPhysicalDevice()->getProperties().limits))
+                return 1;
+            auto denoiser = DenoiserRegistry::create(denoiserName, denoiserSettings, gBuffer, illuminationBuffer, accumulationBuffer);
+            if (!denoiser)
+                return 1;
+            denoiser->compile(imageLayoutCompile.context);
+            denoiser->updateImageLayouts(imageLayoutCompile.context);
+            denoiser->addDispatchToCommandGraph(commands, computeConstants, profiler);
+            finalDescriptorImage = denoiser->getFinalDescriptorImage();
         }
+        else
+            finalDescriptorImage = illuminationBuffer->illuminationImages[0];
 
         if (useTaa && accumulationBuffer)
         {
             auto taa = Taa::create(windowTraits->width, windowTraits->height, 16, 16, gBuffer, accumulationBuffer, finalDescriptorImage);
             taa->compile(imageLayoutCompile.context);
             taa->updateImageLayouts(imageLayoutCompile.context);
-            taa->addDispatchToCommandGraph(commands);
+            taa->addDispatchToCommandGraph(commands, profiler);
             finalDescriptorImage = taa->getFinalDescriptorImage();
         }
         if (exportGBuffer)
@@ -616,7 +689,6 @@ int main(int argc, char **argv)
                 std::cout << "GBuffer information not available, export not possible" << std::endl;
                 return 1;
             }
-            offlineGBufferStager->downloadFromGBufferCommand(gBuffer, commands, imageLayoutCompile.context);
         }
         if (exportIllumination)
         {
@@ -625,14 +697,16 @@ int main(int argc, char **argv)
                 std::cout << "Final image layout is not compatible illumination buffer export" << std::endl;
                 return 1;
             }
-            offlineIlluminationBufferStager->downloadFromIlluminationBufferCommand(illuminationBuffer, commands, imageLayoutCompile.context);
         }
-        if (finalDescriptorImage->imageInfoList[0]->imageView->image->format != VK_FORMAT_B8G8R8A8_UNORM)
+        if (exportGBuffer || exportIllumination)
+            readbackRing->addDownloadCommands(exportGBuffer ? gBuffer : vsg::ref_ptr<GBuffer>{}, exportIllumination ? illuminationBuffer : vsg::ref_ptr<IlluminationBuffer>{}, commands, imageLayoutCompile.context);
+        // the conversion is only needed for the copy to the swapchain image
+        if (!headless && finalDescriptorImage->imageInfoList[0]->imageView->image->format != VK_FORMAT_B8G8R8A8_UNORM)
         {
             auto converter = FormatConverter::create(finalDescriptorImage->imageInfoList[0]->imageView, VK_FORMAT_B8G8R8A8_UNORM);
             converter->compileImages(imageLayoutCompile.context);
             converter->updateImageLayouts(imageLayoutCompile.context);
-            converter->addDispatchToCommandGraph(commands);
+            converter->addDispatchToCommandGraph(commands, profiler);
             finalDescriptorImage = converter->finalImage;
         }
         if (gBuffer)
@@ -650,6 +724,11 @@ int main(int argc, char **argv)
             illuminationBuffer->compile(imageLayoutCompile.context);
             illuminationBuffer->updateImageLayouts(imageLayoutCompile.context);
         }
+        if (adaptiveSampler)
+        {
+            adaptiveSampler->compile(imageLayoutCompile.context);
+            adaptiveSampler->updateImageLayouts(imageLayoutCompile.context);
+        }
         imageLayoutCompile.context.record();
 
         if (accumulationBuffer)
@@ -667,29 +746,41 @@ int main(int argc, char **argv)
         guiValues->triangleCount = counter.triangleCount;
         guiValues->raysPerPixel = maxRecursionDepth * 2; //for each depth recursion one next event estimate is done
 
-        auto viewport = vsg::ViewportState::create(0, 0, windowTraits->width, windowTraits->height);
-        auto camera = vsg::Camera::create(perspective, lookAt, viewport);
-        auto renderGraph = vsg::createRenderGraphForView(window, camera, vsgImGui::RenderImGui::create(window, Gui(guiValues))); // render graph for gui rendering
-        renderGraph->clearValues.clear();                                                                                        //removing clear values to avoid clearing the raytraced image
-
-        auto commandGraph = vsg::CommandGraph::create(window);
-        commandGraph->addChild(commands);
-        commandGraph->addChild(vsg::CopyImageViewToWindow::create(finalDescriptorImage->imageInfoList[0]->imageView, window));
-        commandGraph->addChild(renderGraph);
-
-        //close handler to close and imgui handler to forward to imgui
-        viewer->addEventHandler(vsgImGui::SendEventsToImGui::create());
-        viewer->addEventHandler(vsg::CloseHandler::create(viewer));
-        if (useFlyNavigation)
-            viewer->addEventHandler(vsg::FlyNavigation::create(camera));
+        vsg::ref_ptr<vsg::CommandGraph> commandGraph;
+        if (headless)
+        {
+            // the same commands are submitted directly to the graphics/compute queue, nothing is presented
+            commandGraph = vsg::CommandGraph::create(device, device->getPhysicalDevice()->getQueueFamily(windowTraits->queueFlags));
+            commandGraph->addChild(commands);
+        }
         else
-            viewer->addEventHandler(vsg::Trackball::create(camera));
+        {
+            auto viewport = vsg::ViewportState::create(0, 0, windowTraits->width, windowTraits->height);
+            auto camera = vsg::Camera::create(perspective, lookAt, viewport);
+            auto renderGraph = vsg::createRenderGraphForView(window, camera, vsgImGui::RenderImGui::create(window, Gui(guiValues))); // render graph for gui rendering
+            renderGraph->clearValues.clear();                                                                                        //removing clear values to avoid clearing the raytraced image
+
+            commandGraph = vsg::CommandGraph::create(window);
+            commandGraph->addChild(commands);
+            commandGraph->addChild(vsg::CopyImageViewToWindow::create(finalDescriptorImage->imageInfoList[0]->imageView, window));
+            commandGraph->addChild(renderGraph);
+
+            //close handler to close and imgui handler to forward to imgui
+            viewer->addEventHandler(vsgImGui::SendEventsToImGui::create());
+            viewer->addEventHandler(vsg::CloseHandler::create(viewer));
+            if (useFlyNavigation)
+                viewer->addEventHandler(vsg::FlyNavigation::create(camera));
+            else
+                viewer->addEventHandler(vsg::Trackball::create(camera));
+        }
         viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph});
         //viewer->compile();
         auto compileTraversal = viewer->compile(device);
         auto context = vsg::ref_ptr<vsg::Context>(&compileTraversal->context);
 
 
+        // the terrain lod levels are only set up and updated when a terrain is rendered, a model scene stays as loaded
+        bool renderTerrain = !terrainHeightmapFilename.empty();
         int maxLod = terrainHeightmapLod;
         if (terrainTextureLod > maxLod) maxLod = terrainHeightmapLod;
 
@@ -697,13 +788,21 @@ int main(int argc, char **argv)
 
         int currentHeightmapLod = terrainHeightmapLod;
         int currentTextureLod = terrainTextureLod;
-        for (int currentLod = maxLod; currentLod >= -terrainTileLengthLodFactor; --currentLod) {
-            auto terrainImporter = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, currentHeightmapLod, currentTextureLod, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor);
-            tasManager->loadLodLevel(terrainImporter, currentLod);
+        for (int currentLod = maxLod; renderTerrain && currentLod >= -terrainTileLengthLodFactor; --currentLod) {
+            auto terrainImporter = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, currentHeightmapLod, currentTextureLod, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor, terrainCompactVertices, terrainSkirts);
+            // when streaming only the coarsest lod is loaded up front, finer tiles are imported on demand
+            if (terrainStreaming && currentLod != maxLod) {
+                tasManager->setLodImporter(currentLod, terrainImporter);
+            } else {
+                tasManager->loadLodLevel(terrainImporter, currentLod);
+            }
 
             if (currentHeightmapLod > 0) --currentHeightmapLod;
             if (currentTextureLod > 0) --currentTextureLod;
         }
+        if (renderTerrain && terrainStreaming) {
+            tasManager->startStreaming(terrainStreamingThreads, terrainCacheTiles);
+        }
 
 
         // waiting for image layout transitions
@@ -715,7 +814,8 @@ int main(int argc, char **argv)
         context->buildAccelerationStructureCommands.clear();
         //tlas2->compile(*context);
         std::vector<vsg::ref_ptr<vsg::TopLevelAccelerationStructure>> tlasTestVector;
-        for (int currentLod = maxLod; currentLod >= -terrainTileLengthLodFactor; --currentLod) {
+        for (int currentLod = maxLod; renderTerrain && currentLod >= -terrainTileLengthLodFactor; --currentLod) {
+            if (terrainStreaming && currentLod != maxLod) break;
             auto tlasTest = tasManager->createTlas(currentLod, true);
             tlasTest->compile(*context);
             tlasTestVector.push_back(tlasTest);
@@ -736,12 +836,38 @@ int main(int argc, char **argv)
         int framesAtSamePositionCount = 0;
         auto oldEyePos = lookAt->eye;
         bool terrainLodUpdatePerformed = false;
+        // resident tiles version of the complete terrain scene bound to the pipeline, see TerrainAccelerationStructureManager
+        uint64_t completeSceneVersion = UINT64_MAX;
+
+        vsg::ref_ptr<Benchmark> benchmark;
+        if (benchmarkPath.size())
+            benchmark = Benchmark::create(benchmarkReportPath, benchmarkWarmup, profiler);
 
         int frame_index = 0;
         int sample_index = 0;
+        auto frameStartTime = std::chrono::steady_clock::now();
         while(viewer->advanceToNextFrame() && (numFrames < 0 || frame_index < numFrames))
         {
+            if (benchmark)
+                benchmark->beginFrame();
             viewer->handleEvents();
+            if (benchmark && !use_external_buffers)
+            {
+                auto pathMatrices = benchmarkCameraPath ? benchmarkCameraPath->matrices(frame_index) : cameraMatrices[frame_index];
+                lookAt->set(vsg::dmat4(pathMatrices.invView));
+                if (pathMatrices.proj)
+                {
+                    // the path was written from a vsg::perspective, so its parameters are recovered for the camera and the
+                    // accumulator, the shaders get the inverse projection of the path as is
+                    const vsg::mat4& proj = pathMatrices.proj.value();
+                    double f = -proj[1][1];
+                    perspective->fieldOfViewY = vsg::degrees(2.0 * std::atan(1.0 / f));
+                    perspective->aspectRatio = f / proj[0][0];
+                    perspective->nearDistance = proj[3][2] / proj[2][2];
+                    perspective->farDistance = proj[2][2] * perspective->nearDistance / (1.0 + proj[2][2]);
+                    rayTracingPushConstantsValue->value().projInverse = pathMatrices.invProj.value();
+                }
+            }
             if ((vsg::mat4)vsg::lookAt(lookAt->eye, lookAt->center, lookAt->up) != rayTracingPushConstantsValue->value().prevView)
             {
                 // clear samples when the camera has moved
@@ -757,9 +883,25 @@ int main(int argc, char **argv)
                 terrainLodUpdatePerformed = false;
             }
 
+            double scaleModifier = terrainScale * 20.0;
+            if (terrainTileLengthLodFactor > 0) {
+                scaleModifier *= (1L << terrainTileLengthLodFactor);
+            } else {
+                scaleModifier /= (1L << -terrainTileLengthLodFactor);
+            }
+
+            auto eyePosInTileCoords = lookAt->eye / scaleModifier;
+            eyePosInTileCoords.y *= -1;
+
+            bool streamedTilesAvailable = false;
+            if (renderTerrain && terrainStreaming) {
+                tasManager->requestTiles(-terrainTileLengthLodFactor, eyePosInTileCoords);
+                streamedTilesAvailable = tasManager->swapInFinishedTiles();
+            }
+
             bool resetSamples = false;
             //if (rayTracingPushConstantsValue->value().frameNumber == 200) {
-            if (guiValues->updateTerrainLodButtonPressed || (framesAtSamePositionCount > 0 && ! terrainLodUpdatePerformed)) {
+            if (renderTerrain && (guiValues->updateTerrainLodButtonPressed || (framesAtSamePositionCount > 0 && ! terrainLodUpdatePerformed) || streamedTilesAvailable)) {
                 std::cout << "update" << std::endl;
 
                 //auto terrainImporter3 = TerrainImporter::create(terrainHeightmapFilename, terrainTextureFilename, terrainScale, terrainScaleVertexHeight, terrainFormatLa2d, textureFormatS3tc, terrainHeightmapLod, terrainTextureLod, 0, terrainTilesX, terrainTilesY, terrainTileLengthLodFactor);
@@ -774,28 +916,45 @@ int main(int argc, char **argv)
                 //tlas2 = tasManager->createTlas(-terrainTileLengthLodFactor, false);
                 //auto terrainScene = tasManager->createScene(-terrainTileLengthLodFactor);
 
-                double scaleModifier = terrainScale * 20.0;
-                if (terrainTileLengthLodFactor > 0) {
-                    scaleModifier *= (1L << terrainTileLengthLodFactor);
-                } else {
-                    scaleModifier /= (1L << -terrainTileLengthLodFactor);
-                }
-
-                auto eyePosInTileCoords = lookAt->eye / scaleModifier;
-                eyePosInTileCoords.y *= -1;
+                vsg::ref_ptr<vsg::Node> terrainScene;
+                if (terrainRebuildTlas) {
+                    auto pair = tasManager->createTlasAndScene(-terrainTileLengthLodFactor, eyePosInTileCoords);
+                    tlas2 = pair.first;
+                    terrainScene = pair.second;
 
-                auto pair = tasManager->createTlasAndScene(-terrainTileLengthLodFactor, eyePosInTileCoords);
-                tlas2 = pair.first;
-                auto terrainScene = pair.second;
+                    context->buildAccelerationStructureCommands.clear();
 
-                context->buildAccelerationStructureCommands.clear();
+                    //tlas2->compile(*context);
 
-                //tlas2->compile(*context);
+                    //pbrtPipeline->updateScene(terrainImporter3->loadedScene, context);
+                    pbrtPipeline->updateScene(terrainScene, context);
+                    pbrtPipeline->updateTlas(tlas2, context);
+                } else {
+                    // the persistent tlas only gets the changed tile instances copied and is refit in place. the scene descriptors
+                    // hold the meshes of all resident tiles, so they only have to be rebuilt when tiles were streamed in or evicted
+                    context->waitForCompletion();
+                    context->buildAccelerationStructureCommands.clear();
+
+                    auto selection = tasManager->selectTiles(-terrainTileLengthLodFactor, eyePosInTileCoords, false);
+                    terrainScene = selection.second;
+                    tlas2 = tasManager->getPersistentTlas();
+
+                    bool residentTilesChanged = tasManager->getResidentTilesVersion() != completeSceneVersion;
+                    if (residentTilesChanged) {
+                        // the descriptor set is recompiled, which the frames in flight must not use anymore
+                        vkDeviceWaitIdle(*device);
+                        completeSceneVersion = tasManager->getResidentTilesVersion();
+                        pbrtPipeline->updateScene(tasManager->createCompleteScene(-terrainTileLengthLodFactor), context);
+                    }
+                    pbrtPipeline->setupGeometryInstances(selection.first);
 
-                //pbrtPipeline->updateScene(terrainImporter3->loadedScene, context);
-                pbrtPipeline->updateScene(terrainScene, context);
+                    auto changes = tlas2.cast<TerrainTopLevelAccelerationStructure>()->updateInstances(*context, selection.first);
+                    std::cout << "changed tlas instances: " << changes.changedInstances.size() << (changes.requiresRebuild ? " (rebuild)" : " (update)") << std::endl;
 
-                pbrtPipeline->updateTlas(tlas2, context);
+                    if (residentTilesChanged) {
+                        pbrtPipeline->updateTlas(tlas2, context);
+                    }
+                }
 
                 context->record();
                 //context->waitForCompletion();
@@ -833,12 +992,18 @@ int main(int argc, char **argv)
             rayTracingPushConstantsValue->value().viewInverse = lookAt->inverse();
             rayTracingPushConstantsValue->value().frameNumber = frame_index;
             rayTracingPushConstantsValue->value().sampleNumber = sample_index;
+            // the samples accumulated since the last reset draw one sequence, every reset starts a new one
+            if (sample_index == 0)
+                rayTracingPushConstantsValue->value().sequenceNumber = frame_index;
             guiValues->sampleNumber = sample_index;
             
             if (use_external_buffers)
             {
-                offlineGBufferStager->transferStagingDataFrom(offlineGBuffers[frame_index]);
-                offlineIlluminationBufferStager->transferStagingDataFrom(offlineIlluminations[frame_index]);
+                // frames before frame_index are released by the streams
+                auto offlineGBuffer = offlineGBufferStream->get(frame_index);
+                auto offlineIllumination = offlineIlluminationStream->get(frame_index);
+                offlineGBufferStager->transferStagingDataFrom(offlineGBuffer);
+                offlineIlluminationBufferStager->transferStagingDataFrom(offlineIllumination);
                 if (accumulator)
                    accumulator->setCameraMatrices(frame_index, cameraMatrices[frame_index], cameraMatrices[frame_index ? frame_index - 1 : frame_index]);
             }
@@ -853,39 +1018,106 @@ int main(int argc, char **argv)
             }
 
             viewer->update();
+            if (sample_index == 0)
+                frameStartTime = std::chrono::steady_clock::now();
+            if (adaptiveSampler)
+                adaptiveSampler->beginFrame(sample_index);
+            // only the last sample of a frame is downloaded
+            bool lastSample = sample_index + 1 >= samplesPerPixel || (adaptiveSampler && adaptiveSampler->converged()) ||
+                              (timeBudget > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStartTime).count() >= timeBudget);
+            lastSample = lastSample && !(benchmark && benchmark->warmingUp());
+            readbackRing->beginFrame(frame_index, lastSample && (exportGBuffer || exportIllumination));
             viewer->recordAndSubmit();
-            viewer->present();
+            if (benchmark)
+                benchmark->submitted();
+            if (!headless)
+                viewer->present();
+            if (viewer->getFrameStamp()->frameCount == 0)
+                std::cout << "First frame submitted after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
 
             rayTracingPushConstantsValue->value().prevView = lookAt->transform();
 
-            if (sample_index + 1 >= samplesPerPixel) {
-                if (exportGBuffer || exportIllumination) {
-                    viewer->deviceWaitIdle();
-                    if (exportIllumination) {
-                        offlineIlluminationBufferStager->transferStagingDataTo(offlineIlluminations[frame_index]);
-                    }
-                    if (exportGBuffer) {
-                        offlineGBufferStager->transferStagingDataTo(offlineGBuffers[frame_index]);
-                    }
-                }
-                if (storeMatrices) {
-                    cameraMatrices[frame_index].view = lookAt->transform();
-                    cameraMatrices[frame_index].invView = lookAt->inverse();
-                    cameraMatrices[frame_index].proj.value() = perspective->transform();
-                    cameraMatrices[frame_index].invProj.value() = perspective->inverse();
+            if (lastSample && storeMatrices) {
+                exportedMatrices[frame_index].view = lookAt->transform();
+                exportedMatrices[frame_index].invView = lookAt->inverse();
+                exportedMatrices[frame_index].proj.value() = perspective->transform();
+                exportedMatrices[frame_index].invProj.value() = perspective->inverse();
+            }
+            // the matrices of the frame are stored before its readback can be handed to the writer
+            readbackRing->endFrame(viewer->recordAndSubmitTasks[0]->fence());
+            readbackRing->collect(false);
+            profiler->advanceFrame(viewer->recordAndSubmitTasks[0]->fence());
+            guiValues->passTimings = profiler->statistics();
+            if (adaptiveSampler)
+                adaptiveSampler->endFrame();
+            if (rayCounters)
+            {
+                rayCounters->advanceFrame(viewer->recordAndSubmitTasks[0]->fence());
+                guiValues->rayCounts = rayCounters->latest();
+                guiValues->rayCountsMeasured = rayCounters->latestFrame() >= 0;
+            }
+
+            if (benchmark)
+            {
+                bool warmup = benchmark->warmingUp();
+                benchmark->endFrame(frame_index);
+                // the warm-up renders the first frame of the path, the measured frames start again at frame number 0.
+                // the path tracer seeds its random numbers with the frame number, so every run traces the same rays
+                if (warmup)
+                {
+                    sample_index = 0;
+                    continue;
                 }
-                frame_index++;
             }
+            if (lastSample)
+                frame_index++;
             sample_index++;
         }
 
-        // exporting all images
-        if (exportGBuffer)
-            GBufferIO::exportGBuffer(exportPositionPath, exportDepthPath, exportNormalPath, exportMaterialPath, exportAlbedoPath, numFrames, offlineGBuffers, cameraMatrices);
-        if (exportIllumination)
-            IlluminationBufferIO::exportIllumination(exportIlluminationPath, numFrames, offlineIlluminations);
+        // all outstanding readbacks are written before the matrices are exported
+        readbackRing->collect(true);
+        if (frameWriter && !frameWriter->finish())
+            std::cout << "Not all frames could be exported" << std::endl;
+        if (sequenceWriter)
+            sequenceWriter->finish();
+        vkDeviceWaitIdle(*device);
+
+        profiler->flush();
+        if (headless)
+        {
+            for (const auto& pass : profiler->statistics())
+                std::cout << pass.name << ": mean " << pass.mean << " ms, p50 " << pass.p50 << " ms, p99 " << pass.p99 << " ms" << std::endl;
+        }
+        if (profileTracePath.size())
+            profiler->writeChromeTrace(profileTracePath);
+        if (pipelineCache)
+            pipelineCache->save();
+        if (rayCounters)
+        {
+            rayCounters->flush();
+            auto counts = rayCounters->latest();
+            std::cout << "Traced rays of the last frame: " << counts.primary << " primary, " << counts.bounce << " bounce, " << counts.shadow
+                      << " shadow, " << counts.anyHit << " any hit invocations" << std::endl;
+            if (pathLengthHeatmapPath.size())
+                rayCounters->writePathLengths(pathLengthHeatmapPath);
+        }
+        if (benchmark)
+        {
+            Benchmark::Info info;
+            info.scene = sceneFilename.size() ? sceneFilename : terrainHeightmapFilename.size() ? terrainHeightmapFilename : sequencePath.size() ? sequencePath : illuminationPath;
+            info.cameraPath = use_external_buffers ? (sequencePath.size() ? sequencePath : matricesPath) : benchmarkPath;
+            info.width = windowTraits->width;
+            info.height = windowTraits->height;
+            info.triangleCount = guiValues->triangleCount;
+            info.denoiser = denoiserName;
+            info.blockSize = useDenoiser ? denoiserSettings.blockSizesString() : "";
+            info.taa = useTaa;
+            info.samplesPerPixel = samplesPerPixel;
+            benchmark->writeReport(info);
+        }
+
         if (exportMatricesPath.size())
-            MatrixIO::exportMatrices(exportMatricesPath, cameraMatrices);
+            MatrixIO::exportMatrices(exportMatricesPath, exportedMatrices);
     }
     catch (const vsg::Exception &e)
     {
@@ -0,0 +1,153 @@
+#include "Benchmark.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace{
+    nlohmann::json summary(std::vector<double> values){
+        if(values.empty()) return nullptr;
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p){return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];};
+        return {{"mean", std::accumulate(values.begin(), values.end(), 0.0) / values.size()}, {"p50", percentile(0.5)}, {"p99", percentile(0.99)},
+                {"min", values.front()}, {"max", values.back()}};
+    }
+}
+
+Benchmark::Benchmark(const std::string& reportFilename, int warmupFrames, vsg::ref_ptr<GpuProfiler> profiler):
+    warmupFrames(std::max(warmupFrames, 0)),
+    reportFilename(reportFilename),
+    profiler(profiler)
+{
+    // the per frame gpu timings are taken from the profiler timeline
+    if(profiler) profiler->recordTimeline = true;
+}
+
+void Benchmark::beginFrame()
+{
+    frameStart = Clock::now();
+    submitMs = 0.0;
+}
+
+void Benchmark::submitted()
+{
+    submitMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+    if(profiler) cpuPassMs = profiler->cpuTimes();
+}
+
+void Benchmark::endFrame(int frame)
+{
+    double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+    bool warmup = warmingUp();
+    ++submissions;
+    if(warmup) return;
+
+    if(frames.empty() || frames.back().frame != frame){
+        frames.emplace_back();
+        frames.back().frame = frame;
+    }
+    auto& current = frames.back();
+    ++current.samples;
+    current.frameMs += frameMs;
+    current.submitMs += submitMs;
+    current.cpuPassMs.resize(std::max(current.cpuPassMs.size(), cpuPassMs.size()));
+    for(size_t p = 0; p < cpuPassMs.size(); ++p) current.cpuPassMs[p] += cpuPassMs[p];
+    // advanceFrame counts the submission only if it contained timestamps
+    if(profiler && profiler->submittedFrames() > 0 && !submissionFrames.count(profiler->submittedFrames() - 1))
+        submissionFrames[profiler->submittedFrames() - 1] = frames.size() - 1;
+}
+
+std::vector<Benchmark::Frame> Benchmark::collectFrames() const
+{
+    auto collected = frames;
+    if(!profiler) return collected;
+    for(const auto& event : profiler->getTimeline()){
+        auto itr = submissionFrames.find(event.frame);
+        if(itr == submissionFrames.end()) continue;     // warm-up frame
+        collected[itr->second].passMs[event.range] += event.duration;
+    }
+    return collected;
+}
+
+bool Benchmark::writeReport(const Info& info) const
+{
+    auto collected = collectFrames();
+    std::vector<std::string> passes = profiler ? profiler->getRangeNames() : std::vector<std::string>{};
+    auto gpuTotal = [](const Frame& f){
+        double total = 0.0;
+        for(const auto& pass : f.passMs) total += pass.second;
+        return total;
+    };
+
+    std::ofstream file(reportFilename);
+    if(!file){
+        std::cout << "Benchmark report " << reportFilename << " unable to open." << std::endl;
+        return false;
+    }
+
+    if(vsg::lowerCaseFileExtension(reportFilename) == ".csv"){
+        file << "# scene," << info.scene << "\n# camera_path," << info.cameraPath << "\n# width," << info.width << "\n# height," << info.height
+             << "\n# triangles," << info.triangleCount << "\n# denoiser," << info.denoiser << "\n# block_size," << info.blockSize
+             << "\n# taa," << info.taa << "\n# samples_per_pixel," << info.samplesPerPixel << "\n# warmup_frames," << warmupFrames << "\n";
+        file << "frame,samples,frame_ms,submit_ms,gpu_total_ms";
+        for(const auto& pass : passes) file << "," << pass;
+        for(const auto& pass : passes) file << ",cpu " << pass;
+        file << "\n";
+        for(const auto& f : collected){
+            file << f.frame << "," << f.samples << "," << f.frameMs << "," << f.submitMs << "," << gpuTotal(f);
+            for(uint32_t p = 0; p < passes.size(); ++p){
+                auto itr = f.passMs.find(p);
+                file << "," << (itr != f.passMs.end() ? itr->second : 0.0);
+            }
+            for(uint32_t p = 0; p < passes.size(); ++p)
+                file << "," << (p < f.cpuPassMs.size() ? f.cpuPassMs[p] : 0.0);
+            file << "\n";
+        }
+    }
+    else{
+        nlohmann::json report = {
+            {"scene", info.scene}, {"cameraPath", info.cameraPath}, {"width", info.width}, {"height", info.height},
+            {"triangles", info.triangleCount}, {"denoiser", info.denoiser}, {"blockSize", info.blockSize}, {"taa", info.taa},
+            {"samplesPerPixel", info.samplesPerPixel}, {"warmupFrames", warmupFrames}, {"frameCount", collected.size()}, {"passes", passes}};
+
+        std::vector<double> frameMs, submitMs, gpuTotalMs;
+        std::vector<std::vector<double>> passMs(passes.size()), cpuPassMs(passes.size());
+        nlohmann::json jsonFrames = nlohmann::json::array();
+        for(const auto& f : collected){
+            nlohmann::json gpu = nlohmann::json::object();
+            for(const auto& pass : f.passMs){
+                gpu[passes[pass.first]] = pass.second;
+                passMs[pass.first].push_back(pass.second);
+            }
+            nlohmann::json cpu = nlohmann::json::object();
+            for(uint32_t p = 0; p < passes.size() && p < f.cpuPassMs.size(); ++p){
+                cpu[passes[p]] = f.cpuPassMs[p];
+                cpuPassMs[p].push_back(f.cpuPassMs[p]);
+            }
+            jsonFrames.push_back({{"frame", f.frame}, {"samples", f.samples}, {"frameMs", f.frameMs}, {"submitMs", f.submitMs},
+                                  {"gpuTotalMs", gpuTotal(f)}, {"gpuMs", gpu}, {"cpuMs", cpu}});
+            frameMs.push_back(f.frameMs);
+            submitMs.push_back(f.submitMs);
+            gpuTotalMs.push_back(gpuTotal(f));
+        }
+        nlohmann::json gpuSummary = nlohmann::json::object(), cpuSummary = nlohmann::json::object();
+        for(uint32_t p = 0; p < passes.size(); ++p){
+            gpuSummary[passes[p]] = summary(passMs[p]);
+            cpuSummary[passes[p]] = summary(cpuPassMs[p]);
+        }
+        report["summary"] = {{"frameMs", summary(frameMs)}, {"submitMs", summary(submitMs)}, {"gpuTotalMs", summary(gpuTotalMs)}, {"gpuMs", gpuSummary},
+                             {"cpuMs", cpuSummary}};
+        report["frames"] = jsonFrames;
+        file << report.dump(4);
+    }
+    file.close();
+    if(file.fail()){
+        std::cout << "Failed to write benchmark report " << reportFilename << std::endl;
+        return false;
+    }
+    std::cout << "Benchmark report written to " << reportFilename << std::endl;
+    return true;
+}
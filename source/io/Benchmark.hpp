@@ -0,0 +1,65 @@
+#pragma once
+
+#include <renderModules/GpuProfiler.hpp>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+// collects the cpu and gpu timings of a scripted camera path run, per frame and per profiler range and writes them as a report
+// the report is written as csv if the filename ends with .csv, as json otherwise
+class Benchmark : public vsg::Inherit<vsg::Object, Benchmark>
+{
+public:
+    // description of the run, written at the top of the report
+    struct Info
+    {
+        std::string scene;
+        std::string cameraPath;
+        uint32_t width = 0, height = 0;
+        int triangleCount = 0;
+        std::string denoiser;
+        std::string blockSize;
+        bool taa = false;
+        int samplesPerPixel = 1;
+    };
+
+    Benchmark(const std::string& reportFilename, int warmupFrames, vsg::ref_ptr<GpuProfiler> profiler);
+
+    // true while the first warmupFrames submissions are rendered, they are not part of the report
+    bool warmingUp() const { return submissions < warmupFrames; }
+    // has to be called at the start of a loop iteration
+    void beginFrame();
+    // has to be called after the frame was submitted and passed to the profiler
+    void submitted();
+    // has to be called at the end of a loop iteration, frame is the index of the rendered camera path frame
+    void endFrame(int frame);
+
+    // the profiler has to be flushed before
+    bool writeReport(const Info& info) const;
+
+    int warmupFrames;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Frame
+    {
+        int frame = -1;
+        int samples = 0;
+        double frameMs = 0.0;   // wall clock time of the whole loop iteration
+        double submitMs = 0.0;  // cpu time until the frame was submitted
+        std::map<uint32_t, double> passMs;
+        std::vector<double> cpuPassMs;  // cpu time spent recording the commands of a pass
+    };
+    std::vector<Frame> collectFrames() const;
+
+    std::string reportFilename;
+    vsg::ref_ptr<GpuProfiler> profiler;
+    Clock::time_point frameStart;
+    double submitMs = 0.0;
+    std::vector<double> cpuPassMs;
+    int submissions = 0;
+    std::vector<Frame> frames;
+    std::map<uint64_t, size_t> submissionFrames;   // profiler submission index -> index into frames
+};
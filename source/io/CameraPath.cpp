@@ -0,0 +1,103 @@
+#include "CameraPath.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace CameraPathFormat;
+
+namespace{
+    uint64_t columnOffset(const Header& header, Column column){
+        uint64_t offset = (sizeof(Header) + 63) / 64 * 64;
+        for(uint32_t c = View; c < column; c <<= 1)
+            if(header.columns & c) offset += (uint64_t(header.frameCount) * sizeof(vsg::mat4) + 63) / 64 * 64;
+        return offset;
+    }
+}
+
+vsg::ref_ptr<CameraPath> CameraPath::open(const std::string& filename)
+{
+    auto mapping = MappedFile::create(filename);
+    if(!mapping->valid() || mapping->size < sizeof(Header)){
+        std::cout << "Camera path " << filename << " unable to open." << std::endl;
+        return {};
+    }
+    auto path = CameraPath::create();
+    std::memcpy(&path->header, mapping->data, sizeof(Header));
+    const auto& header = path->header;
+    bool valid = std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version && (header.columns & View) &&
+        mapping->size >= columnOffset(header, Column(InvProj << 1));
+    if(!valid){
+        std::cout << "Camera path " << filename << " is invalid or has an unsupported version." << std::endl;
+        return {};
+    }
+    path->mapping = mapping;
+    return path;
+}
+
+bool CameraPath::write(const std::string& filename, const CameraMatricesVec& matrices, bool storeInverses)
+{
+    std::ofstream f(filename, std::ios::out | std::ios::binary);
+    if(!f){
+        std::cout << "Camera path " << filename << " unable to open." << std::endl;
+        return false;
+    }
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.frameCount = static_cast<uint32_t>(matrices.size());
+    bool projections = !matrices.empty() && std::all_of(matrices.begin(), matrices.end(), [](const CameraMatrices& m){ return m.proj.has_value(); });
+    header.columns = View | (storeInverses ? InvView : 0) | (projections ? Proj : 0) | (projections && storeInverses ? InvProj : 0);
+
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    auto padTo = [&f](uint64_t offset){
+        static const char zeros[64] = {};
+        uint64_t position = static_cast<uint64_t>(f.tellp());
+        if(position < offset) f.write(zeros, offset - position);
+    };
+    auto writeColumn = [&](Column column, auto get){
+        if(!(header.columns & column)) return;
+        padTo(columnOffset(header, column));
+        for(auto& m: matrices){
+            vsg::mat4 matrix = get(m);
+            f.write(reinterpret_cast<const char*>(&matrix), sizeof(matrix));
+        }
+    };
+    writeColumn(View, [](const CameraMatrices& m){ return m.view; });
+    writeColumn(InvView, [](const CameraMatrices& m){ return m.invView; });
+    writeColumn(Proj, [](const CameraMatrices& m){ return m.proj.value(); });
+    writeColumn(InvProj, [](const CameraMatrices& m){ return m.invProj ? m.invProj.value() : vsg::inverse(m.proj.value()); });
+    padTo(columnOffset(header, Column(InvProj << 1)));
+    return f.good();
+}
+
+bool CameraPath::matrix(int frame, Column column, vsg::mat4& matrix) const
+{
+    if(!(header.columns & column) || frame < 0 || frame >= static_cast<int>(header.frameCount)) return false;
+    std::memcpy(&matrix, mapping->data + columnOffset(header, column) + uint64_t(frame) * sizeof(vsg::mat4), sizeof(vsg::mat4));
+    return true;
+}
+
+CameraMatrices CameraPath::matrices(int frame) const
+{
+    CameraMatrices m;
+    matrix(frame, View, m.view);
+    if(!matrix(frame, InvView, m.invView))
+        m.invView = vsg::inverse(m.view);
+    vsg::mat4 proj;
+    if(matrix(frame, Proj, proj)){
+        m.proj = proj;
+        vsg::mat4 invProj;
+        m.invProj = matrix(frame, InvProj, invProj) ? invProj : vsg::inverse(proj);
+    }
+    return m;
+}
+
+CameraMatricesVec CameraPath::allMatrices() const
+{
+    CameraMatricesVec matrices(header.frameCount);
+    for(uint32_t f = 0; f < header.frameCount; ++f)
+        matrices[f] = this->matrices(static_cast<int>(f));
+    return matrices;
+}
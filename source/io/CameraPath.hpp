@@ -0,0 +1,47 @@
+#pragma once
+
+#include <io/RenderIO.hpp>
+#include <io/MappedFile.hpp>
+
+// binary camera path, an alternative to the json and text formats of MatrixIO for long trajectories
+// layout: header, then one column per stored matrix kind (view, inverse view, projection, inverse projection) holding
+// the column major float matrices of all frames. columns start 64 byte aligned and all values are little endian.
+// the file is memory mapped, so only the pages of the requested frames are read
+namespace CameraPathFormat{
+    constexpr char magic[8] = {'V', 'P', 'B', 'R', 'T', 'C', 'A', 'M'};
+    constexpr uint32_t version = 1;
+    constexpr const char* extension = ".campath";
+
+    enum Column : uint32_t{
+        View = 1 << 0,
+        InvView = 1 << 1,
+        Proj = 1 << 2,
+        InvProj = 1 << 3
+    };
+
+    struct Header{
+        char magic[8];
+        uint32_t version;
+        uint32_t frameCount;
+        uint32_t columns;   // stored columns, inverses missing in the file are computed on access
+        uint32_t reserved;
+    };
+}
+
+class CameraPath: public vsg::Inherit<vsg::Object, CameraPath>{
+public:
+    // maps the file, returns null if it is not a valid camera path
+    static vsg::ref_ptr<CameraPath> open(const std::string& filename);
+    // projections are only stored if every frame has one
+    static bool write(const std::string& filename, const CameraMatricesVec& matrices, bool storeInverses = true);
+
+    uint32_t frameCount() const { return header.frameCount; }
+    CameraMatrices matrices(int frame) const;
+    CameraMatricesVec allMatrices() const;
+
+private:
+    bool matrix(int frame, CameraPathFormat::Column column, vsg::mat4& matrix) const;
+
+    vsg::ref_ptr<MappedFile> mapping;
+    CameraPathFormat::Header header;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// loads the frames of a sequence on a fixed number of worker threads
+// only frames inside the window [last requested frame, last requested frame + windowSize) are loaded and kept,
+// earlier frames are released, so memory is bounded by the window size instead of the sequence length
+// an exception thrown by the load function is caught on the worker and rethrown by get() for that frame
+template<class T>
+class FrameStream : public vsg::Inherit<vsg::Object, FrameStream<T>>
+{
+public:
+    using LoadFunction = std::function<T(int frame)>;
+
+    FrameStream(LoadFunction load, int numFrames, int workerCount, int windowSize) :
+        load(load),
+        numFrames(numFrames),
+        windowSize(std::max(windowSize, 1))
+    {
+        for (int i = 0; i < std::max(workerCount, 1); ++i)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    // blocks until the frame is loaded, frames before it are released. rethrows the exception of a failed load
+    T get(int frame)
+    {
+        if (frame < 0 || frame >= numFrames) return {};
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (frame != windowStart)
+        {
+            // jumping backwards or past the scheduled frames restarts scheduling at the requested frame
+            if (frame < windowStart || frame > nextFrame) nextFrame = frame;
+            windowStart = frame;
+            frames.erase(frames.begin(), frames.lower_bound(frame));
+            frames.erase(frames.lower_bound(frame + windowSize), frames.end());
+            workAvailable.notify_all();
+        }
+        frameLoaded.wait(lock, [&]() {
+            auto itr = frames.find(frame);
+            return itr != frames.end() && itr->second.loaded;
+        });
+        auto& loaded = frames[frame];
+        if (loaded.exception) std::rethrow_exception(loaded.exception);
+        return loaded.value;
+    }
+
+    int frameCount() const { return numFrames; }
+
+protected:
+    virtual ~FrameStream()
+    {
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+private:
+    struct Frame
+    {
+        bool loaded = false;
+        T value{};
+        std::exception_ptr exception;
+    };
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            workAvailable.wait(lock, [&]() { return stopping || (nextFrame < numFrames && nextFrame < windowStart + windowSize); });
+            if (stopping) return;
+
+            int frame = nextFrame++;
+            // still resident from before a jump backwards, or already being loaded
+            if (frames.count(frame)) continue;
+            frames[frame];
+
+            lock.unlock();
+            T value{};
+            std::exception_ptr exception;
+            try
+            {
+                value = load(frame);
+            }
+            catch (...)
+            {
+                // an exception escaping the worker would terminate the program
+                exception = std::current_exception();
+            }
+            lock.lock();
+
+            // the frame might have been released while it was loading
+            if (auto itr = frames.find(frame); itr != frames.end())
+            {
+                itr->second.value = value;
+                itr->second.exception = exception;
+                itr->second.loaded = true;
+            }
+            frameLoaded.notify_all();
+        }
+    }
+
+    LoadFunction load;
+    int numFrames;
+    int windowSize;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable frameLoaded;
+    std::map<int, Frame> frames;
+    int windowStart = 0;
+    int nextFrame = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
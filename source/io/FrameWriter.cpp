@@ -0,0 +1,59 @@
+#include "FrameWriter.hpp"
+
+#include <algorithm>
+
+FrameWriter::FrameWriter(int workerCount, int maxQueued) :
+    maxQueued(std::max(maxQueued, 1))
+{
+    for (int i = 0; i < std::max(workerCount, 1); ++i)
+        workers.emplace_back([this]() { work(); });
+}
+
+FrameWriter::~FrameWriter()
+{
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void FrameWriter::write(WriteFunction writeFunction)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queueChanged.wait(lock, [&]() { return static_cast<int>(queue.size()) < maxQueued; });
+    queue.push_back(std::move(writeFunction));
+    workAvailable.notify_one();
+}
+
+bool FrameWriter::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queueChanged.wait(lock, [&]() { return queue.empty() && activeWrites == 0; });
+    return !failed;
+}
+
+void FrameWriter::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        // queued frames are still written when stopping, so no frame is lost
+        workAvailable.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+
+        auto writeFunction = std::move(queue.front());
+        queue.pop_front();
+        ++activeWrites;
+        queueChanged.notify_all();
+
+        lock.unlock();
+        bool written = writeFunction();
+        lock.lock();
+
+        if (!written) failed = true;
+        --activeWrites;
+        queueChanged.notify_all();
+    }
+}
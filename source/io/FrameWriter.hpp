@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// writes frames on a fixed number of worker threads while rendering continues
+// write() blocks while maxQueued frames are waiting, so memory stays bounded when encoding is slower than rendering
+class FrameWriter : public vsg::Inherit<vsg::Object, FrameWriter>
+{
+public:
+    // returns false if the frame could not be written
+    using WriteFunction = std::function<bool()>;
+
+    FrameWriter(int workerCount, int maxQueued);
+
+    void write(WriteFunction writeFunction);
+    // waits until all queued frames are written, returns false if any write failed
+    bool finish();
+
+protected:
+    virtual ~FrameWriter();
+
+private:
+    void work();
+
+    int maxQueued;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable queueChanged;
+    std::deque<WriteFunction> queue;
+    int activeWrites = 0;
+    bool failed = false;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,291 @@
+#include "GBufferSequence.hpp"
+
+#include <cstring>
+#include <iostream>
+
+using namespace GBufferSequenceFormat;
+
+namespace{
+    uint64_t alignUp(uint64_t value, uint64_t alignment){
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t valueSize(const Header& header, Layer layer){
+        switch(layer){
+        case Depth: return sizeof(float);
+        case Normal: return sizeof(vsg::vec2);
+        case Material:
+        case Albedo: return sizeof(vsg::ubvec4);
+        case Illumination: return header.illuminationValueSize;
+        default: return 0;
+        }
+    }
+
+    // offset of a layer inside of a frame, the layers are 64 byte aligned in the order of their bits
+    uint64_t layerOffset(const Header& header, Layer layer){
+        uint64_t offset = 0;
+        uint64_t pixelCount = uint64_t(header.width) * header.height;
+        for(uint32_t l = Depth; l < layer; l <<= 1)
+            offset = alignUp(offset + valueSize(header, Layer(l)) * pixelCount, 64);
+        return offset;
+    }
+
+    uint64_t frameSize(const Header& header){
+        return layerOffset(header, Matrices);
+    }
+
+    uint32_t illuminationValueSize(VkFormat format){
+        switch(format){
+        case VK_FORMAT_R16G16B16A16_SFLOAT: return sizeof(vsg::usvec4);
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return sizeof(vsg::vec4);
+        default: return 0;
+        }
+    }
+}
+
+// writer ---------------------------------------------------------------------------
+
+GBufferSequenceWriter::GBufferSequenceWriter(const std::string& filename, uint32_t width, uint32_t height, uint32_t frameCount, VkFormat illuminationFormat):
+    filename(filename)
+{
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.width = width;
+    header.height = height;
+    header.frameCount = frameCount;
+    header.illuminationFormat = illuminationFormat;
+    header.illuminationValueSize = illuminationValueSize(illuminationFormat);
+    header.frameStride = alignUp(frameSize(header), pageSize);
+    header.dataOffset = alignUp(sizeof(Header) + sizeof(FrameEntry) * frameCount, pageSize);
+
+    frames.resize(frameCount, FrameEntry{});
+    for(uint32_t f = 0; f < frameCount; ++f)
+        frames[f].offset = header.dataOffset + f * header.frameStride;
+
+    if(header.illuminationValueSize == 0){
+        std::cout << "Unsupported illumination format for gbuffer sequence " << filename << std::endl;
+        return;
+    }
+    file.open(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file){
+        std::cout << "Gbuffer sequence " << filename << " unable to open." << std::endl;
+        return;
+    }
+    // the file gets its final size up front, the frames are written into their slots
+    uint64_t fileSize = header.dataOffset + uint64_t(frameCount) * header.frameStride;
+    file.seekp(fileSize - 1);
+    file.put(0);
+}
+
+GBufferSequenceWriter::~GBufferSequenceWriter()
+{
+    if(!finished && file.is_open()) finish();
+}
+
+bool GBufferSequenceWriter::writeLayer(int frame, Layer layer, vsg::ref_ptr<vsg::Data> data)
+{
+    if(!data) return true;
+    uint64_t size = valueSize(header, layer) * header.width * header.height;
+    if(data->width() != header.width || data->height() != header.height || data->dataSize() != size){
+        std::cout << "Gbuffer sequence " << filename << ": layer of frame " << frame << " does not match the sequence format" << std::endl;
+        return false;
+    }
+    std::scoped_lock lock(mutex);
+    file.seekp(frames[frame].offset + layerOffset(header, layer));
+    file.write(static_cast<const char*>(data->dataPointer()), size);
+    frames[frame].layers |= layer;
+    return file.good();
+}
+
+bool GBufferSequenceWriter::writeGBuffer(int frame, vsg::ref_ptr<OfflineGBuffer> gBuffer)
+{
+    if(frame < 0 || frame >= static_cast<int>(frames.size()) || !gBuffer) return false;
+    return writeLayer(frame, Depth, gBuffer->depth) && writeLayer(frame, Normal, gBuffer->normal) &&
+        writeLayer(frame, Material, gBuffer->material) && writeLayer(frame, Albedo, gBuffer->albedo);
+}
+
+bool GBufferSequenceWriter::writeIllumination(int frame, vsg::ref_ptr<OfflineIllumination> illumination)
+{
+    if(frame < 0 || frame >= static_cast<int>(frames.size()) || !illumination) return false;
+    return writeLayer(frame, Illumination, illumination->noisy);
+}
+
+bool GBufferSequenceWriter::writeMatrices(int frame, const CameraMatrices& matrices)
+{
+    if(frame < 0 || frame >= static_cast<int>(frames.size())) return false;
+    std::scoped_lock lock(mutex);
+    auto& entry = frames[frame];
+    entry.view = matrices.view;
+    entry.invView = matrices.invView;
+    entry.hasProjection = matrices.proj.has_value();
+    if(matrices.proj){
+        entry.proj = matrices.proj.value();
+        entry.invProj = matrices.invProj.value();
+    }
+    entry.layers |= Matrices;
+    return true;
+}
+
+bool GBufferSequenceWriter::finish()
+{
+    std::scoped_lock lock(mutex);
+    finished = true;
+    if(!file.is_open()) return false;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(frames.data()), sizeof(FrameEntry) * frames.size());
+    file.close();
+    if(file.fail()){
+        std::cout << "Failed to write gbuffer sequence " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// reader ---------------------------------------------------------------------------
+
+vsg::ref_ptr<GBufferSequence> GBufferSequence::open(const std::string& filename)
+{
+    auto mapping = MappedFile::create(filename);
+    if(!mapping->valid() || mapping->size < sizeof(Header)){
+        std::cout << "Gbuffer sequence " << filename << " unable to open." << std::endl;
+        return {};
+    }
+    auto sequence = GBufferSequence::create();
+    std::memcpy(&sequence->header, mapping->data, sizeof(Header));
+    const auto& header = sequence->header;
+    // a pixel takes at least 4 bytes, so a pixel count below the file size keeps the size computations from overflowing
+    bool valid = std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version &&
+        header.illuminationValueSize != 0 && header.illuminationValueSize == illuminationValueSize(VkFormat(header.illuminationFormat)) &&
+        uint64_t(header.width) * header.height <= mapping->size &&
+        header.dataOffset >= sizeof(Header) + sizeof(FrameEntry) * uint64_t(header.frameCount) && header.dataOffset <= mapping->size &&
+        frameSize(header) <= mapping->size - header.dataOffset;
+    // the frame table is read from the file, every frame has to lie behind the table and inside of the file
+    const auto* frames = reinterpret_cast<const FrameEntry*>(mapping->data + sizeof(Header));
+    const uint32_t knownLayers = Depth | Normal | Material | Albedo | Illumination | Matrices;
+    for(uint32_t f = 0; valid && f < header.frameCount; ++f){
+        valid = frames[f].offset >= header.dataOffset && frames[f].offset <= mapping->size - frameSize(header) &&
+            (frames[f].layers & ~knownLayers) == 0;
+    }
+    if(!valid){
+        std::cout << "Gbuffer sequence " << filename << " is invalid or has an unsupported version." << std::endl;
+        return {};
+    }
+    sequence->mapping = mapping;
+    sequence->frames = frames;
+    return sequence;
+}
+
+GBufferSequence::~GBufferSequence()
+{
+}
+
+vsg::ref_ptr<vsg::Data> GBufferSequence::layerArray(int frame, Layer layer) const
+{
+    if(frame < 0 || frame >= static_cast<int>(header.frameCount) || !(frames[frame].layers & layer)) return {};
+    uint64_t size = valueSize(header, layer) * header.width * header.height;
+    auto storage = mapping->range(frames[frame].offset + layerOffset(header, layer), size);
+    switch(layer){
+    case Depth:
+        return vsg::floatArray2D::create(storage, 0, sizeof(float), header.width, header.height, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+    case Normal:
+        return vsg::vec2Array2D::create(storage, 0, sizeof(vsg::vec2), header.width, header.height, vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+    case Material:
+    case Albedo:
+        return vsg::ubvec4Array2D::create(storage, 0, sizeof(vsg::ubvec4), header.width, header.height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    case Illumination:
+        if(header.illuminationFormat == VK_FORMAT_R16G16B16A16_SFLOAT)
+            return vsg::usvec4Array2D::create(storage, 0, sizeof(vsg::usvec4), header.width, header.height, vsg::Data::Layout{VK_FORMAT_R16G16B16A16_SFLOAT});
+        return vsg::vec4Array2D::create(storage, 0, sizeof(vsg::vec4), header.width, header.height, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    default:
+        return {};
+    }
+}
+
+vsg::ref_ptr<OfflineGBuffer> GBufferSequence::gBuffer(int frame) const
+{
+    auto gBuffer = OfflineGBuffer::create();
+    gBuffer->depth = layerArray(frame, Depth);
+    gBuffer->normal = layerArray(frame, Normal);
+    gBuffer->material = layerArray(frame, Material);
+    gBuffer->albedo = layerArray(frame, Albedo);
+    return gBuffer;
+}
+
+vsg::ref_ptr<OfflineIllumination> GBufferSequence::illumination(int frame) const
+{
+    auto illumination = OfflineIllumination::create();
+    illumination->noisy = layerArray(frame, Illumination);
+    return illumination;
+}
+
+CameraMatricesVec GBufferSequence::matrices() const
+{
+    CameraMatricesVec matrices(header.frameCount);
+    for(uint32_t f = 0; f < header.frameCount; ++f){
+        const auto& entry = frames[f];
+        matrices[f].view = entry.view;
+        matrices[f].invView = entry.invView;
+        if(entry.hasProjection){
+            matrices[f].proj = entry.proj;
+            matrices[f].invProj = entry.invProj;
+        }
+    }
+    return matrices;
+}
+
+void GBufferSequence::prefetch(int frame) const
+{
+    if(frame < 0 || frame >= static_cast<int>(header.frameCount)) return;
+    mapping->willNeed(frames[frame].offset, frameSize(header));
+}
+
+vsg::ref_ptr<OfflineGBufferStream> GBufferSequence::streamGBuffer(int workerCount, int windowSize)
+{
+    vsg::ref_ptr<GBufferSequence> sequence(this);
+    auto load = [sequence](int f){
+        // the illumination is in the same pages, so the gbuffer stream prefetches the whole frame
+        sequence->prefetch(f);
+        return sequence->gBuffer(f);
+    };
+    return OfflineGBufferStream::create(load, static_cast<int>(header.frameCount), workerCount, windowSize);
+}
+
+vsg::ref_ptr<OfflineIlluminationStream> GBufferSequence::streamIllumination(int workerCount, int windowSize)
+{
+    vsg::ref_ptr<GBufferSequence> sequence(this);
+    auto load = [sequence](int f){
+        return sequence->illumination(f);
+    };
+    return OfflineIlluminationStream::create(load, static_cast<int>(header.frameCount), workerCount, windowSize);
+}
+
+// conversion -----------------------------------------------------------------------
+
+bool GBufferSequenceIO::convert(const std::string& sequenceFilename, vsg::ref_ptr<OfflineGBufferStream> gBuffers, vsg::ref_ptr<OfflineIlluminationStream> illuminations, const CameraMatricesVec& matrices, int numFrames, int verbosity)
+{
+    auto first = gBuffers->get(0);
+    auto firstIllumination = illuminations->get(0);
+    if(!first || !first->depth || !firstIllumination || !firstIllumination->noisy){
+        std::cout << "Gbuffer sequence conversion: first frame could not be loaded" << std::endl;
+        return false;
+    }
+    if(verbosity > 0)
+        std::cout << "Start converting " << numFrames << " frames to gbuffer sequence " << sequenceFilename << std::endl;
+    auto writer = GBufferSequenceWriter::create(sequenceFilename, first->depth->width(), first->depth->height(), numFrames, firstIllumination->noisy->getLayout().format);
+    if(!writer->valid())
+        return false;
+    bool fine = true;
+    for(int f = 0; f < numFrames && fine; ++f){
+        fine = writer->writeGBuffer(f, gBuffers->get(f)) && writer->writeIllumination(f, illuminations->get(f));
+        if(f < static_cast<int>(matrices.size()))
+            writer->writeMatrices(f, matrices[f]);
+        if(verbosity > 1)
+            std::cout << "Gbuffer sequence: converted frame " << f << std::endl;
+    }
+    fine = writer->finish() && fine;
+    if(verbosity > 0)
+        std::cout << "Done converting gbuffer sequence" << std::endl;
+    return fine;
+}
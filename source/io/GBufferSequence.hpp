@@ -0,0 +1,108 @@
+#pragma once
+
+#include <io/RenderIO.hpp>
+#include <io/MappedFile.hpp>
+
+#include <fstream>
+#include <mutex>
+
+// single file container for offline gbuffer and illumination sequences
+// the file starts with a header and a frame table holding the offset, the stored layers and the camera matrices of every frame.
+// a frame stores its layers in the staging layout of OfflineGBuffer and OfflineIllumination at a page aligned offset,
+// so the frames are memory mapped and uploaded without a decode step. all values are stored little endian
+namespace GBufferSequenceFormat{
+    constexpr char magic[8] = {'V', 'P', 'B', 'R', 'T', 'S', 'E', 'Q'};
+    constexpr uint32_t version = 1;
+    constexpr uint64_t pageSize = 4096;
+
+    enum Layer : uint32_t{
+        Depth = 1 << 0,         // float
+        Normal = 1 << 1,        // vec2, spherical coordinates
+        Material = 1 << 2,      // ubvec4
+        Albedo = 1 << 3,        // ubvec4
+        Illumination = 1 << 4,  // illuminationValueSize bytes per pixel in illuminationFormat
+        Matrices = 1 << 5
+    };
+
+    struct Header{
+        char magic[8];
+        uint32_t version;
+        uint32_t width, height, frameCount;
+        int32_t illuminationFormat;
+        uint32_t illuminationValueSize;
+        uint64_t frameStride;
+        uint64_t dataOffset;
+    };
+
+    struct FrameEntry{
+        uint64_t offset;
+        uint32_t layers;    // layers written for this frame
+        uint32_t hasProjection;
+        vsg::mat4 view, invView, proj, invProj;
+    };
+}
+
+class GBufferSequenceWriter: public vsg::Inherit<vsg::Object, GBufferSequenceWriter>{
+public:
+    // illuminationFormat is VK_FORMAT_R16G16B16A16_SFLOAT or VK_FORMAT_R32G32B32A32_SFLOAT
+    GBufferSequenceWriter(const std::string& filename, uint32_t width, uint32_t height, uint32_t frameCount, VkFormat illuminationFormat = VK_FORMAT_R32G32B32A32_SFLOAT);
+
+    // the write functions are thread safe and frames can be written in any order
+    bool writeGBuffer(int frame, vsg::ref_ptr<OfflineGBuffer> gBuffer);
+    bool writeIllumination(int frame, vsg::ref_ptr<OfflineIllumination> illumination);
+    bool writeMatrices(int frame, const CameraMatrices& matrices);
+    // writes the frame table, has to be called after all frames are written
+    bool finish();
+
+    bool valid() const { return file.good(); }
+
+protected:
+    virtual ~GBufferSequenceWriter();
+
+private:
+    bool writeLayer(int frame, GBufferSequenceFormat::Layer layer, vsg::ref_ptr<vsg::Data> data);
+
+    std::string filename;
+    GBufferSequenceFormat::Header header;
+    std::vector<GBufferSequenceFormat::FrameEntry> frames;
+    std::fstream file;
+    std::mutex mutex;
+    bool finished = false;
+};
+
+class GBufferSequence: public vsg::Inherit<vsg::Object, GBufferSequence>{
+public:
+    // maps the file, returns null if it is not a valid sequence or its frame table points outside of the file
+    static vsg::ref_ptr<GBufferSequence> open(const std::string& filename);
+
+    uint32_t width() const { return header.width; }
+    uint32_t height() const { return header.height; }
+    uint32_t frameCount() const { return header.frameCount; }
+
+    // the returned buffers refer to the mapped file, no data is copied
+    vsg::ref_ptr<OfflineGBuffer> gBuffer(int frame) const;
+    vsg::ref_ptr<OfflineIllumination> illumination(int frame) const;
+    CameraMatricesVec matrices() const;
+    // touches the pages of a frame so that a later upload does not wait for the disk
+    void prefetch(int frame) const;
+
+    // streams for the render loop, the frames are prefetched by workerCount threads
+    vsg::ref_ptr<OfflineGBufferStream> streamGBuffer(int workerCount, int windowSize);
+    vsg::ref_ptr<OfflineIlluminationStream> streamIllumination(int workerCount, int windowSize);
+
+protected:
+    virtual ~GBufferSequence();
+
+private:
+    vsg::ref_ptr<vsg::Data> layerArray(int frame, GBufferSequenceFormat::Layer layer) const;
+
+    vsg::ref_ptr<MappedFile> mapping;
+    GBufferSequenceFormat::Header header;
+    const GBufferSequenceFormat::FrameEntry* frames = nullptr;
+};
+
+class GBufferSequenceIO{
+public:
+    // converts a set of per frame image files into a sequence file
+    static bool convert(const std::string& sequenceFilename, vsg::ref_ptr<OfflineGBufferStream> gBuffers, vsg::ref_ptr<OfflineIlluminationStream> illuminations, const CameraMatricesVec& matrices, int numFrames, int verbosity = 1);
+};
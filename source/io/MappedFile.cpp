@@ -0,0 +1,101 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace{
+    constexpr uint64_t pageSize = 4096;
+
+    class MappedRange: public vsg::Inherit<vsg::Data, MappedRange>{
+    public:
+        MappedRange(vsg::ref_ptr<MappedFile> owner, uint8_t* data, size_t size): owner(owner), data(data), size(size){}
+
+        std::size_t valueSize() const override { return 1; }
+        std::size_t valueCount() const override { return size; }
+        std::size_t dataSize() const override { return size; }
+        void* dataPointer() override { return data; }
+        const void* dataPointer() const override { return data; }
+        void* dataPointer(size_t index) override { return data + index; }
+        const void* dataPointer(size_t index) const override { return data + index; }
+        void* dataRelease() override { return nullptr; }
+        std::uint32_t dimensions() const override { return 1; }
+        std::uint32_t width() const override { return static_cast<uint32_t>(size); }
+        std::uint32_t height() const override { return 1; }
+        std::uint32_t depth() const override { return 1; }
+
+    private:
+        vsg::ref_ptr<MappedFile> owner;
+        uint8_t* data;
+        size_t size;
+    };
+}
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(fileHandle == INVALID_HANDLE_VALUE) return;
+    file = fileHandle;
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) return;
+    mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if(!mapping) return;
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if(!view) return;
+    data = static_cast<uint8_t*>(view);
+    size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return;
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0){
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(view != MAP_FAILED){
+            data = static_cast<uint8_t*>(view);
+            size = static_cast<uint64_t>(fileStat.st_size);
+        }
+    }
+    // the mapping stays valid after closing the file
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if(data) UnmapViewOfFile(data);
+    if(mapping) CloseHandle(mapping);
+    if(file) CloseHandle(file);
+#else
+    if(data) munmap(data, size);
+#endif
+}
+
+vsg::ref_ptr<vsg::Data> MappedFile::range(uint64_t offset, uint64_t length)
+{
+    if(!data || offset + length > size) return {};
+    return MappedRange::create(vsg::ref_ptr<MappedFile>(this), data + offset, static_cast<size_t>(length));
+}
+
+void MappedFile::willNeed(uint64_t offset, uint64_t length) const
+{
+    if(!data || offset >= size) return;
+    length = std::min(length, size - offset);
+    const uint8_t* begin = data + offset;
+#ifndef _WIN32
+    uintptr_t pageBegin = reinterpret_cast<uintptr_t>(begin) / pageSize * pageSize;
+    madvise(reinterpret_cast<void*>(pageBegin), reinterpret_cast<uintptr_t>(begin) + length - pageBegin, MADV_WILLNEED);
+#endif
+    // reading one byte per page faults the pages in on every platform
+    volatile uint8_t sink = 0;
+    for(uint64_t i = 0; i < length; i += pageSize) sink ^= begin[i];
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <string>
+
+// read only memory mapping of a whole file
+// pages are mapped copy on write, so users of the mapped data can't modify the file
+class MappedFile: public vsg::Inherit<vsg::Object, MappedFile>{
+public:
+    explicit MappedFile(const std::string& filename);
+
+    bool valid() const { return data != nullptr; }
+
+    // the range as vsg::Data, so that arrays can use it as storage. the data keeps the mapping alive
+    vsg::ref_ptr<vsg::Data> range(uint64_t offset, uint64_t length);
+    // hints that the range is needed soon and touches its pages, so later reads don't wait for the disk
+    void willNeed(uint64_t offset, uint64_t length) const;
+
+    uint8_t* data = nullptr;
+    uint64_t size = 0;
+
+protected:
+    virtual ~MappedFile();
+
+private:
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,83 @@
+#include "PipelineCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace{
+    // the header written by the driver, data of another driver or device is rejected instead of relying on the driver to do so
+    bool compatible(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties){
+        VkPipelineCacheHeaderVersionOne header;
+        if(data.size() < sizeof(header)) return false;
+        std::memcpy(&header, data.data(), sizeof(header));
+        return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+               header.deviceID == properties.deviceID && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
+
+PipelineCache::PipelineCache(vsg::ref_ptr<vsg::Device> device, const std::string& filename):
+    device(device),
+    filename(filename)
+{
+    std::vector<char> data;
+    std::ifstream file(filename, std::ios::binary);
+    if(file)
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if(!data.empty() && !compatible(data, device->getPhysicalDevice()->getProperties())){
+        std::cout << "Pipeline cache " << filename << " was written for another device or driver, starting an empty cache" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+    if(vkCreatePipelineCache(*device, &createInfo, device->getAllocationCallbacks(), &pipelineCache) != VK_SUCCESS){
+        throw vsg::Exception{"Error: PipelineCache::PipelineCache(...) failed to create pipeline cache."};
+    }
+    device->pipelineCache = pipelineCache;
+    if(!data.empty())
+        std::cout << "Pipeline cache loaded from " << filename << std::endl;
+}
+
+PipelineCache::~PipelineCache()
+{
+    if(device->pipelineCache == pipelineCache)
+        device->pipelineCache = VK_NULL_HANDLE;
+    vkDestroyPipelineCache(*device, pipelineCache, device->getAllocationCallbacks());
+}
+
+bool PipelineCache::save() const
+{
+    size_t size = 0;
+    std::vector<char> data;
+    VkResult result = vkGetPipelineCacheData(*device, pipelineCache, &size, nullptr);
+    if(result == VK_SUCCESS){
+        data.resize(size);
+        result = vkGetPipelineCacheData(*device, pipelineCache, &size, data.data());
+    }
+    if(result != VK_SUCCESS){
+        std::cout << "Failed to read back the pipeline cache" << std::endl;
+        return false;
+    }
+
+    // written to a temporary file first, so an interrupted write never leaves a truncated cache
+    auto tempFilename = filename + ".tmp";
+    {
+        std::ofstream file(tempFilename, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        if(!file){
+            std::cout << "Failed to write pipeline cache " << filename << std::endl;
+            return false;
+        }
+    }
+    std::remove(filename.c_str());
+    if(std::rename(tempFilename.c_str(), filename.c_str()) != 0){
+        std::remove(tempFilename.c_str());
+        std::cout << "Failed to write pipeline cache " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <string>
+
+// VkPipelineCache that is loaded from a file on start and written back on exit, so the driver does not rebuild the pipelines
+// on every launch. the cache is used for all pipelines compiled while it is assigned to the device
+class PipelineCache: public vsg::Inherit<vsg::Object, PipelineCache>{
+public:
+    // a missing file or a file written by another driver or device starts an empty cache
+    PipelineCache(vsg::ref_ptr<vsg::Device> device, const std::string& filename);
+
+    // writes the cache including all pipelines created since loading
+    bool save() const;
+
+protected:
+    virtual ~PipelineCache();
+
+private:
+    vsg::ref_ptr<vsg::Device> device;
+    std::string filename;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+};
@@ -0,0 +1,116 @@
+#include "ReadbackRing.hpp"
+
+#include <limits>
+
+void ReadbackRing::SlotCommands::compile(vsg::Context& context)
+{
+    for (auto& slot : slots) slot->compile(context);
+}
+
+void ReadbackRing::SlotCommands::record(vsg::CommandBuffer& commandBuffer) const
+{
+    if (activeSlot >= 0) slots[activeSlot]->record(commandBuffer);
+}
+
+ReadbackRing::ReadbackRing(uint32_t slotCount) :
+    slots(std::max(slotCount, 1u)),
+    slotCommands(SlotCommands::create())
+{
+}
+
+void ReadbackRing::addDownloadCommands(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, vsg::ref_ptr<vsg::Commands> commands, vsg::Context& context)
+{
+    slotCommands->slots.clear();
+    for (auto& slot : slots)
+    {
+        auto downloadCommands = vsg::Commands::create();
+        if (gBuffer)
+        {
+            slot.gBufferStager = OfflineGBuffer::create();
+            slot.gBufferStager->downloadFromGBufferCommand(gBuffer, downloadCommands, context);
+            gBufferWidth = gBuffer->width;
+            gBufferHeight = gBuffer->height;
+        }
+        if (illuminationBuffer)
+        {
+            slot.illuminationStager = OfflineIllumination::create();
+            slot.illuminationStager->downloadFromIlluminationBufferCommand(illuminationBuffer, downloadCommands, context);
+            illuminationWidth = illuminationBuffer->width;
+            illuminationHeight = illuminationBuffer->height;
+        }
+        slotCommands->slots.push_back(downloadCommands);
+    }
+    commands->addChild(slotCommands);
+}
+
+void ReadbackRing::beginFrame(int frame, bool download)
+{
+    // without download commands nothing is exported, so there is nothing to read back
+    if (slotCommands->slots.empty())
+        download = false;
+    recordedFrame = download ? frame : -1;
+    if (!download)
+    {
+        slotCommands->activeSlot = -1;
+        return;
+    }
+
+    // the gpu must not write into a staging buffer that has not been read back yet
+    auto& slot = slots[nextSlot];
+    if (slot.frame >= 0)
+    {
+        slot.fence->wait(std::numeric_limits<uint64_t>::max());
+        collect(false);
+    }
+    slotCommands->activeSlot = static_cast<int>(nextSlot);
+}
+
+void ReadbackRing::endFrame(vsg::Fence* fence)
+{
+    if (recordedFrame < 0) return;
+
+    auto& slot = slots[nextSlot];
+    slot.fence = fence;
+    slot.frame = recordedFrame;
+    nextSlot = (nextSlot + 1) % slots.size();
+    recordedFrame = -1;
+}
+
+void ReadbackRing::collect(bool wait)
+{
+    // nextSlot is the oldest slot, submissions on the same queue finish in order
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        auto& slot = slots[(nextSlot + i) % slots.size()];
+        if (slot.frame < 0) continue;
+        // vsg reuses its fences, a reused fence is only signaled after a later frame so waiting on it is still safe
+        if (wait)
+            slot.fence->wait(std::numeric_limits<uint64_t>::max());
+        else if (slot.fence->status() != VK_SUCCESS)
+            return;
+        readback(slot);
+    }
+}
+
+void ReadbackRing::readback(Slot& slot)
+{
+    if (slot.gBufferStager)
+    {
+        auto gBuffer = OfflineGBuffer::create();
+        gBuffer->depth = vsg::floatArray2D::create(gBufferWidth, gBufferHeight);
+        gBuffer->normal = vsg::vec2Array2D::create(gBufferWidth, gBufferHeight);
+        gBuffer->albedo = vsg::ubvec4Array2D::create(gBufferWidth, gBufferHeight);
+        gBuffer->material = vsg::ubvec4Array2D::create(gBufferWidth, gBufferHeight);
+        slot.gBufferStager->transferStagingDataTo(gBuffer);
+        if (gBufferReady) gBufferReady(slot.frame, gBuffer);
+    }
+    if (slot.illuminationStager)
+    {
+        auto illumination = OfflineIllumination::create();
+        illumination->noisy = vsg::vec4Array2D::create(illuminationWidth, illuminationHeight);
+        slot.illuminationStager->transferStagingDataTo(illumination);
+        if (illuminationReady) illuminationReady(slot.frame, illumination);
+    }
+    slot.frame = -1;
+    slot.fence = {};
+}
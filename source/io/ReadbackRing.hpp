@@ -0,0 +1,57 @@
+#pragma once
+
+#include <io/RenderIO.hpp>
+
+#include <functional>
+#include <vector>
+
+// ring of staging buffers for exporting rendered frames
+// every slot has its own download commands, only the slot of the current frame is recorded, so the readback of frame k
+// overlaps the rendering of frame k + 1. a slot is read back once the fence of the submission that recorded it is signaled
+class ReadbackRing : public vsg::Inherit<vsg::Object, ReadbackRing>
+{
+public:
+    using GBufferCallback = std::function<void(int frame, vsg::ref_ptr<OfflineGBuffer> gBuffer)>;
+    using IlluminationCallback = std::function<void(int frame, vsg::ref_ptr<OfflineIllumination> illumination)>;
+
+    explicit ReadbackRing(uint32_t slotCount);
+
+    // gBuffer or illuminationBuffer can be null if they are not exported
+    void addDownloadCommands(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, vsg::ref_ptr<vsg::Commands> commands, vsg::Context& context);
+    // has to be called before the frame is recorded, blocks if the slot for the frame is still waiting for its readback
+    void beginFrame(int frame, bool download);
+    // has to be called after the frame was submitted, fence is the fence of that submission
+    void endFrame(vsg::Fence* fence);
+    // reads back all slots with finished submissions in frame order, with wait all pending slots are read back
+    void collect(bool wait);
+
+    GBufferCallback gBufferReady;
+    IlluminationCallback illuminationReady;
+
+    // records the download commands of the active slot only
+    class SlotCommands : public vsg::Inherit<vsg::Command, SlotCommands>
+    {
+    public:
+        std::vector<vsg::ref_ptr<vsg::Commands>> slots;
+        int activeSlot = -1;
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+    };
+
+private:
+    struct Slot
+    {
+        vsg::ref_ptr<OfflineGBuffer> gBufferStager;
+        vsg::ref_ptr<OfflineIllumination> illuminationStager;
+        vsg::ref_ptr<vsg::Fence> fence;
+        int frame = -1; // -1 when no readback is pending
+    };
+    void readback(Slot& slot);
+
+    std::vector<Slot> slots;
+    vsg::ref_ptr<SlotCommands> slotCommands;
+    uint32_t nextSlot = 0;
+    int recordedFrame = -1;
+    uint32_t gBufferWidth = 0, gBufferHeight = 0;
+    uint32_t illuminationWidth = 0, illuminationHeight = 0;
+};
@@ -1,7 +1,70 @@
 #include <io/RenderIO.hpp>
 #include <future>
 #include <cctype>
+#include <atomic>
+#include <thread>
+#include <iterator>
+#include <cstring>
+#include <limits>
 #include <nlohmann/json.hpp>
+#include <io/SimdMath.hpp>
+#include <io/CameraPath.hpp>
+
+namespace{
+    // handles zero, denormals and inf/nan
+    float halfToFloat(uint16_t h){
+        uint32_t exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+        uint32_t bits;
+        if(exponent == 0){
+            float denormal = std::ldexp(static_cast<float>(mantissa), -24);
+            std::memcpy(&bits, &denormal, sizeof(bits));
+        }
+        else if(exponent == 31)
+            bits = 0x7f800000 | (mantissa << 13);
+        else
+            bits = ((exponent + 112) << 23) | (mantissa << 13);
+        bits |= uint32_t(h & 0x8000) << 16;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // reads a 4 component image stored with single or half precision
+    vsg::ref_ptr<vsg::vec4Array2D> readVec4Image(const std::string& filename, vsg::ref_ptr<vsg::Options> options){
+        auto data = vsg::read_cast<vsg::Data>(filename, options);
+        if(auto image = data.cast<vsg::vec4Array2D>()) return image;
+        auto halfImage = data.cast<vsg::usvec4Array2D>();
+        if(!halfImage) return {};
+        auto image = vsg::vec4Array2D::create(halfImage->width(), halfImage->height(), vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+        const uint16_t* in = reinterpret_cast<const uint16_t*>(halfImage->data());
+        float* out = reinterpret_cast<float*>(image->data());
+        for(size_t i = 0; i < size_t(image->valueCount()) * 4; ++i) out[i] = halfToFloat(in[i]);
+        return image;
+    }
+
+    // exr layout of an exported layer: the written channels, whether half precision is used and the part name in multi-part files
+    // without half the exr_half_float option of the writer decides
+    vsg::ref_ptr<vsg::Data> exrLayer(vsg::ref_ptr<vsg::Data> data, const char* channels, bool half, const char* name){
+        if(!data) return {};
+        data->setValue(vsgXchange::openexr::channel_names, channels);
+        if(half) data->setValue(vsgXchange::openexr::half_float, true);
+        data->setValue(vsgXchange::openexr::part_name, name);
+        return data;
+    }
+
+    // runs func(i) for all i in [0, count) on at most hardware_concurrency threads
+    void parallelFor(int count, const std::function<void(int)>& func){
+        int workerCount = std::max(1, std::min(int(std::thread::hardware_concurrency()), count));
+        std::atomic<int> next{0};
+        std::vector<std::future<void>> workers(workerCount);
+        for(auto& worker: workers)
+            worker = std::async(std::launch::async, [&](){
+                for(int i = next++; i < count; i = next++) func(i);
+            });
+        for(auto& worker: workers)
+            worker.get();
+    }
+}
 
 std::vector<vsg::ref_ptr<OfflineGBuffer>> GBufferIO::importGBufferDepth(const std::string &depthFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, int numFrames, int verbosity)
 {
@@ -9,150 +72,181 @@ std::vector<vsg::ref_ptr<OfflineGBuffer>> GBufferIO::importGBufferDepth(const st
         std::cout << "Start loading GBuffer" << std::endl;
     std::vector<vsg::ref_ptr<OfflineGBuffer>> gBuffers(numFrames);
     auto options = vsg::Options::create(vsgXchange::openexr::create());
-    auto execLoad = [&](int f){
-        if(verbosity > 1)
-            std::cout << "GBuffer: Loading frame " << f << std::endl << std::flush; 
-        gBuffers[f] = OfflineGBuffer::create();
-        char buff[200];
-        std::string filename;
-        // load depth image
-        snprintf(buff, sizeof(buff), depthFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        if (gBuffers[f]->depth = vsg::read_cast<vsg::Data>(filename, options); !gBuffers[f]->depth.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        // load normal image
-        snprintf(buff, sizeof(buff), normalFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        if (gBuffers[f]->normal = convertNormalToSpherical(vsg::read_cast<vsg::vec4Array2D>(filename, options)); !gBuffers[f]->normal.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        // load albedo image
-        snprintf(buff, sizeof(buff), albedoFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        if (gBuffers[f]->albedo = vsg::read_cast<vsg::Data>(filename, options); !gBuffers[f]->albedo.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        gBuffers[f]->albedo = compressAlbedo(gBuffers[f]->albedo);
-        if(verbosity > 1)
-            std::cout << "GBuffer: Loaded frame " << f << std::endl << std::flush;
-    };
-    {   //automatic join at the end of threads scope
-        std::vector<std::future<void>> threads(numFrames);
-        for (int f = 0; f < numFrames; ++f) threads[f] = std::async(std::launch::async, execLoad, f);
-    }
+    parallelFor(numFrames, [&](int f){
+        gBuffers[f] = loadGBufferDepth(depthFormat, normalFormat, materialFormat, albedoFormat, options, f, verbosity);
+    });
     if(verbosity > 0)
         std::cout << "Done loading GBuffer" << std::endl;
     return gBuffers;
 }
 
+vsg::ref_ptr<OfflineGBufferStream> GBufferIO::streamGBufferDepth(const std::string &depthFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, int numFrames, int workerCount, int windowSize, int verbosity)
+{
+    auto options = vsg::Options::create(vsgXchange::openexr::create());
+    auto load = [=](int f){
+        return loadGBufferDepth(depthFormat, normalFormat, materialFormat, albedoFormat, options, f, verbosity);
+    };
+    return OfflineGBufferStream::create(load, numFrames, workerCount, windowSize);
+}
+
+vsg::ref_ptr<OfflineGBuffer> GBufferIO::loadGBufferDepth(const std::string &depthFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, vsg::ref_ptr<vsg::Options> options, int f, int verbosity)
+{
+    if(verbosity > 1)
+        std::cout << "GBuffer: Loading frame " << f << std::endl << std::flush; 
+    auto gBuffer = OfflineGBuffer::create();
+    char buff[200];
+    std::string filename;
+    // load depth image
+    snprintf(buff, sizeof(buff), depthFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    if (gBuffer->depth = vsg::read_cast<vsg::Data>(filename, options); !gBuffer->depth.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    // load normal image
+    snprintf(buff, sizeof(buff), normalFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    if (gBuffer->normal = convertNormalToSpherical(readVec4Image(filename, options)); !gBuffer->normal.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    // load albedo image
+    snprintf(buff, sizeof(buff), albedoFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    if (gBuffer->albedo = vsg::read_cast<vsg::Data>(filename, options); !gBuffer->albedo.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    gBuffer->albedo = compressAlbedo(gBuffer->albedo);
+    if(verbosity > 1)
+        std::cout << "GBuffer: Loaded frame " << f << std::endl << std::flush;
+    return gBuffer;
+}
+
 std::vector<vsg::ref_ptr<OfflineGBuffer>> GBufferIO::importGBufferPosition(const std::string &positionFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, const std::vector<CameraMatrices> &matrices, int numFrames, int verbosity)
 {
     if(verbosity > 0)
         std::cout << "Start loading GBuffer" << std::endl;
     auto options = vsg::Options::create(vsgXchange::openexr::create());
     std::vector<vsg::ref_ptr<OfflineGBuffer>> gBuffers(numFrames);
-    auto execLoad = [&](int f){
-        if(verbosity > 1)
-            std::cout << "GBuffer: Loading frame " << f << std::endl << std::flush;
-        gBuffers[f] = OfflineGBuffer::create();
-        char buff[200];
-        std::string filename;
-        // position images
-        snprintf(buff, sizeof(buff), positionFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        vsg::ref_ptr<vsg::Data> pos;
-        if (pos = vsg::read_cast<vsg::Data>(filename, options); !pos.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        {// converting position to depth
-            vsg::ref_ptr<vsg::vec4Array2D> posArray = pos.cast<vsg::vec4Array2D>();
-            if(!posArray){
-                std::cerr << "Unexpected position format" << std::endl;
-                return;
-            }
-            float* depth = new float[posArray->valueCount()];
-            auto toVec3 = [&](vsg::vec4 v){return vsg::vec3(v.x, v.y, v.z);};
-            vsg::vec4 cameraPos = matrices[f].invView[2];
-            cameraPos /= cameraPos.w;
-            for(uint32_t i = 0; i < posArray->valueCount() ; ++i){
-                vsg::vec3 p = toVec3(posArray->data()[i]);
-                depth[i] = vsg::length(toVec3(cameraPos) - p);
-            }
-            gBuffers[f]->depth = vsg::floatArray2D::create(pos->width(), pos->height(), depth, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
-        }
-        // load normal image
-        snprintf(buff, sizeof(buff), normalFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        if (gBuffers[f]->normal = convertNormalToSpherical(vsg::read_cast<vsg::vec4Array2D>(filename, options)); !gBuffers[f]->normal.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        // load albedo image
-        snprintf(buff, sizeof(buff), albedoFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        if (gBuffers[f]->albedo = vsg::read_cast<vsg::Data>(filename, options); !gBuffers[f]->albedo.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        gBuffers[f]->albedo = compressAlbedo(gBuffers[f]->albedo);
-        if(verbosity > 1)
-            std::cout << "GBuffer: Loaded frame " << f << std::endl << std::flush; 
-    };
-    {   //automatic join at the end of threads scope
-        std::vector<std::future<void>> threads(numFrames);
-        for (int f = 0; f < numFrames; ++f) threads[f] = std::async(std::launch::async, execLoad, f); 
-    }
+    parallelFor(numFrames, [&](int f){
+        gBuffers[f] = loadGBufferPosition(positionFormat, normalFormat, materialFormat, albedoFormat, matrices, options, f, verbosity);
+    });
     if(verbosity > 0)
         std::cout << "Done loading GBuffer" << std::endl;
     return gBuffers;
 }
 
+vsg::ref_ptr<OfflineGBufferStream> GBufferIO::streamGBufferPosition(const std::string &positionFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, const std::vector<CameraMatrices> &matrices, int numFrames, int workerCount, int windowSize, int verbosity)
+{
+    auto options = vsg::Options::create(vsgXchange::openexr::create());
+    auto load = [=](int f){
+        return loadGBufferPosition(positionFormat, normalFormat, materialFormat, albedoFormat, matrices, options, f, verbosity);
+    };
+    return OfflineGBufferStream::create(load, numFrames, workerCount, windowSize);
+}
+
+vsg::ref_ptr<OfflineGBuffer> GBufferIO::loadGBufferPosition(const std::string &positionFormat, const std::string &normalFormat, const std::string &materialFormat, const std::string &albedoFormat, const std::vector<CameraMatrices> &matrices, vsg::ref_ptr<vsg::Options> options, int f, int verbosity)
+{
+    if(verbosity > 1)
+        std::cout << "GBuffer: Loading frame " << f << std::endl << std::flush;
+    auto gBuffer = OfflineGBuffer::create();
+    char buff[200];
+    std::string filename;
+    // position images
+    snprintf(buff, sizeof(buff), positionFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    vsg::ref_ptr<vsg::Data> pos;
+    if (pos = vsg::read_cast<vsg::Data>(filename, options); !pos.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    {// converting position to depth
+        vsg::ref_ptr<vsg::vec4Array2D> posArray = pos.cast<vsg::vec4Array2D>();
+        if(!posArray){
+            std::cerr << "Unexpected position format" << std::endl;
+            return gBuffer;
+        }
+        float* depth = new float[posArray->valueCount()];
+        auto toVec3 = [&](vsg::vec4 v){return vsg::vec3(v.x, v.y, v.z);};
+        vsg::vec4 cameraPos = matrices[f].invView[2];
+        cameraPos /= cameraPos.w;
+        for(uint32_t i = 0; i < posArray->valueCount() ; ++i){
+            vsg::vec3 p = toVec3(posArray->data()[i]);
+            depth[i] = vsg::length(toVec3(cameraPos) - p);
+        }
+        gBuffer->depth = vsg::floatArray2D::create(pos->width(), pos->height(), depth, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+    }
+    // load normal image
+    snprintf(buff, sizeof(buff), normalFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    if (gBuffer->normal = convertNormalToSpherical(readVec4Image(filename, options)); !gBuffer->normal.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    // load albedo image
+    snprintf(buff, sizeof(buff), albedoFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    if (gBuffer->albedo = vsg::read_cast<vsg::Data>(filename, options); !gBuffer->albedo.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return gBuffer;
+    }
+    gBuffer->albedo = compressAlbedo(gBuffer->albedo);
+    if(verbosity > 1)
+        std::cout << "GBuffer: Loaded frame " << f << std::endl << std::flush; 
+    return gBuffer;
+}
+
 vsg::ref_ptr<vsg::Data> GBufferIO::convertNormalToSpherical(vsg::ref_ptr<vsg::vec4Array2D> normals) 
 {
     if(!normals) return {};
-    vsg::vec2* res = new vsg::vec2[normals->valueCount()];
-    for(uint32_t i = 0; i < normals->valueCount(); ++i){
-        vsg::vec4 curNormal = normals->data()[i];
-        // the normals are generally stored in correct full format
-        //curNormal *= 2;  
-        //curNormal -= vsg::vec4(1, 1, 1, 0);
-        res[i].x = acos(curNormal.z);
-        res[i].y = atan2(curNormal.y, curNormal.x);
-    }
-    return vsg::vec2Array2D::create(normals->width(), normals->height(), res, vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+    // the normals are generally stored in correct full format, so no remapping from [0, 1] is done
+    auto res = vsg::vec2Array2D::create(normals->width(), normals->height(), vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+    const float* in = reinterpret_cast<const float*>(normals->data());
+    float* out = reinterpret_cast<float*>(res->data());
+    uint32_t count = normals->valueCount();
+    for(uint32_t i = 0; i < count; i += simd::FloatV::width){
+        int lanes = static_cast<int>(std::min<uint32_t>(simd::FloatV::width, count - i));
+        simd::FloatV x = simd::loadStrided(in + 4 * i, 4, lanes);
+        simd::FloatV y = simd::loadStrided(in + 4 * i + 1, 4, lanes);
+        simd::FloatV z = simd::loadStrided(in + 4 * i + 2, 4, lanes);
+        simd::storeStrided(simd::acos(z), out + 2 * i, 2, lanes);
+        simd::storeStrided(simd::atan2(y, x), out + 2 * i + 1, 2, lanes);
+    }
+    return res;
 }
 
 vsg::ref_ptr<vsg::Data> GBufferIO::compressAlbedo(vsg::ref_ptr<vsg::Data> in){
-    vsg::ubvec4* albedo = new vsg::ubvec4[in->valueCount()];
+    auto albedo = vsg::ubvec4Array2D::create(in->width(), in->height(), vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    uint8_t* out = reinterpret_cast<uint8_t*>(albedo->data());
+    size_t count = size_t(in->valueCount()) * 4;
     if(vsg::ref_ptr<vsg::vec4Array2D> largeAlbedo = in.cast<vsg::vec4Array2D>())
-        for(uint32_t i = 0; i < in->valueCount(); ++i) albedo[i] = largeAlbedo->data()[i] * 255.0f;
+        simd::floatToUnorm(reinterpret_cast<const float*>(largeAlbedo->data()), out, count);
     else if(vsg::ref_ptr<vsg::uivec4Array2D> largeAlbedo = in.cast<vsg::uivec4Array2D>())
-        for(uint32_t i = 0; i < in->valueCount(); ++i) albedo[i] = largeAlbedo->data()[i];
+        for(uint32_t i = 0; i < in->valueCount(); ++i) albedo->data()[i] = largeAlbedo->data()[i];
     else if(vsg::ref_ptr<vsg::usvec4Array2D> largeAlbedo = in.cast<vsg::usvec4Array2D>()){
-        auto toFloat = [](uint16_t h){uint32_t t = ((h&0x8000)<<16) | (((h&0x7c00)+0x1C000)<<13) | ((h&0x03FF)<<13); return *reinterpret_cast<float*>(&t);};
-        for(uint32_t i = 0; i < in->valueCount(); ++i){
-            vsg::usvec4& cur = largeAlbedo->data()[i];
-            albedo[i] = vsg::vec4(toFloat(cur.x), toFloat(cur.y), toFloat(cur.z), toFloat(cur.w)) * 255.0f;
-        }    
+        // half floats are expanded block wise so no full size float copy is needed
+        const uint16_t* halfs = reinterpret_cast<const uint16_t*>(largeAlbedo->data());
+        float block[1024];
+        for(size_t i = 0; i < count; i += std::size(block)){
+            size_t blockCount = std::min(std::size(block), count - i);
+            for(size_t j = 0; j < blockCount; ++j) block[j] = halfToFloat(halfs[i + j]);
+            simd::floatToUnorm(block, out + i, blockCount);
+        }
     }
-    return vsg::ubvec4Array2D::create(in->width(), in->height(), albedo, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    return albedo;
 }
 
 bool GBufferIO::exportGBuffer(const std::string& positionFormat, const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int numFrames, const OfflineGBuffers& gBuffers, const CameraMatricesVec& matrices, int verbosity) 
@@ -160,98 +254,111 @@ bool GBufferIO::exportGBuffer(const std::string& positionFormat, const std::stri
     if(verbosity > 0)
         std::cout << "Start exporting GBuffer" << std::endl;
     auto options = vsg::Options::create(vsgXchange::openexr::create());
-    bool fine = true;
-    auto execStore = [&](int f){
-        if(verbosity > 1)
-            std::cout << "GBuffer: Storing frame " << f << std::endl << std::flush;
+    std::atomic<bool> fine = true;
+    parallelFor(numFrames, [&](int f){
+        if(!exportGBufferFrame(positionFormat, depthFormat, normalFormat, materialFormat, albedoFormat, f, gBuffers[f], matrices[f], options, verbosity))
+            fine = false;
+    });
+    if(verbosity > 0)
+        std::cout << "Done exporting GBuffer" << std::endl;
+    return fine;
+}
+
+vsg::ref_ptr<vsg::Options> GBufferIO::exportOptions()
+{
+    return vsg::Options::create(vsgXchange::openexr::create());
+}
+
+bool GBufferIO::exportGBufferFrame(const std::string& positionFormat, const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int f, vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, vsg::ref_ptr<vsg::Options> options, int verbosity)
+{
+    if(verbosity > 1)
+        std::cout << "GBuffer: Storing frame " << f << std::endl << std::flush;
+    auto write = [&](const std::string& format, const char* layer){
+        if(format.empty()) return true;
         char buff[200];
-        std::string filename;
-        // depth images
-        if(depthFormat.size()){
-            snprintf(buff, sizeof(buff), depthFormat.c_str(), f);
-            filename = buff;
-            if(!vsg::write(gBuffers[f]->depth, filename, options)){
-                std::cerr << "Failed to store image: " << filename << std::endl;
-                fine = false;
-                return;
-            }
-        }
-        // position images
-        if(positionFormat.size()){
-            snprintf(buff, sizeof(buff), positionFormat.c_str(), f);
-            vsg::ref_ptr<vsg::Data> position = depthToPosition(gBuffers[f]->depth.cast<vsg::floatArray2D>(), matrices[f]);
-            filename = buff;
-            if(!vsg::write(position, filename, options)){
-                std::cerr << "Failed to store image: " << filename << std::endl;
-                fine = false;
-                return;
-            }
+        snprintf(buff, sizeof(buff), format.c_str(), f);
+        std::string filename = buff;
+        if(!vsg::write(exportLayer(gBuffer, matrix, layer), filename, options)){
+            std::cerr << "Failed to store image: " << filename << std::endl;
+            return false;
         }
-        //normal images
-        if(normalFormat.size()){
-            snprintf(buff, sizeof(buff), normalFormat.c_str(), f);
-            filename = buff;
-            if(!vsg::write(sphericalToCartesian(gBuffers[f]->normal.cast<vsg::vec2Array2D>()), filename, options)){
-                std::cerr << "Failed to store image: " << filename << std::endl;
-                fine = false;
-                return;
-            }
-        }
-        //material images
-        if(materialFormat.size()){
-            snprintf(buff, sizeof(buff), materialFormat.c_str(), f);
-            filename = buff;
-            if(!vsg::write(unormToFloat(gBuffers[f]->material.cast<vsg::ubvec4Array2D>()), filename, options)){
-                std::cerr << "Failed to store image: " << filename << std::endl;
-                fine = false;
-                return;
-            }
-        }
-        //albedo images
-        if(albedoFormat.size())
-        {
-            snprintf(buff, sizeof(buff), albedoFormat.c_str(), f);
-            filename = buff;
-            if(!vsg::write(unormToFloat(gBuffers[f]->albedo.cast<vsg::ubvec4Array2D>()), filename, options)){
-                std::cerr << "Failed to store image: " << filename << std::endl;
-                fine = false;
-                return;
-            }
-        }
-        if(verbosity > 1)
-            std::cout << "GBuffer: Stored frame " << f << std::endl << std::flush;
+        return true;
     };
-    {
-        std::vector<std::future<void>> threads(numFrames);
-        for (int f = 0; f < numFrames; ++f) threads[f] = std::async(std::launch::async, execStore, f); 
+    if(!write(depthFormat, "depth") || !write(positionFormat, "position") || !write(normalFormat, "normal") || !write(materialFormat, "material") || !write(albedoFormat, "albedo"))
+        return false;
+    if(verbosity > 1)
+        std::cout << "GBuffer: Stored frame " << f << std::endl << std::flush;
+    return true;
+}
+
+bool GBufferIO::exportGBufferFrameMultipart(const std::string& format, int f, vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, vsg::ref_ptr<vsg::Options> options, int verbosity)
+{
+    if(verbosity > 1)
+        std::cout << "GBuffer: Storing multi-part frame " << f << std::endl << std::flush;
+    auto parts = vsg::Objects::create();
+    for(auto layer: {"depth", "position", "normal", "material", "albedo"})
+        parts->children.push_back(exportLayer(gBuffer, matrix, layer));
+    char buff[200];
+    snprintf(buff, sizeof(buff), format.c_str(), f);
+    std::string filename = buff;
+    if(!vsg::write(parts, filename, options)){
+        std::cerr << "Failed to store image: " << filename << std::endl;
+        return false;
     }
-    if(verbosity > 0)
-        std::cout << "Done exporting GBuffer" << std::endl;
-    return fine;
+    if(verbosity > 1)
+        std::cout << "GBuffer: Stored multi-part frame " << f << std::endl << std::flush;
+    return true;
+}
+
+vsg::ref_ptr<vsg::Data> GBufferIO::exportLayer(vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, const std::string& layer)
+{
+    // only the meaningful channels are written, unit normals are exact enough with half precision and 8 bit values are
+    // restored exactly on import as compressAlbedo() rounds to the nearest byte
+    if(layer == "depth")
+        return exrLayer(gBuffer->depth, "Y", false, "depth");
+    if(layer == "position")
+        return exrLayer(depthToPosition(gBuffer->depth.cast<vsg::floatArray2D>(), matrix), "R,G,B", false, "position");
+    if(layer == "normal")
+        return exrLayer(sphericalToCartesian(gBuffer->normal.cast<vsg::vec2Array2D>()), "R,G,B", true, "normal");
+    if(layer == "material")
+        return exrLayer(unormToFloat(gBuffer->material.cast<vsg::ubvec4Array2D>()), "R,G,B,A", true, "material");
+    if(layer == "albedo")
+        return exrLayer(unormToFloat(gBuffer->albedo.cast<vsg::ubvec4Array2D>()), "R,G,B,A", true, "albedo");
+    return {};
 }
 
 vsg::ref_ptr<vsg::Data> GBufferIO::sphericalToCartesian(vsg::ref_ptr<vsg::vec2Array2D> normals)
 {
     if(!normals) return {};
-    vsg::vec4* res = new vsg::vec4[normals->valueCount()];
-    for(uint32_t i = 0; i < normals->valueCount(); ++i){
-        vsg::vec2 curNormal = normals->data()[i];
-        res[i].x = cos(curNormal.y) * sin(curNormal.x);
-        res[i].y = sin(curNormal.y) * sin(curNormal.x);
-        res[i].z = cos(curNormal.x);
-        res[i].w = 1;
-    }
-    return vsg::vec4Array2D::create(normals->width(), normals->height(), res, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    auto res = vsg::vec4Array2D::create(normals->width(), normals->height(), vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    const float* in = reinterpret_cast<const float*>(normals->data());
+    float* out = reinterpret_cast<float*>(res->data());
+    uint32_t count = normals->valueCount();
+    for(uint32_t i = 0; i < count; i += simd::FloatV::width){
+        int lanes = static_cast<int>(std::min<uint32_t>(simd::FloatV::width, count - i));
+        simd::FloatV sinTheta, cosTheta, sinPhi, cosPhi;
+        simd::sincos(simd::loadStrided(in + 2 * i, 2, lanes), sinTheta, cosTheta);
+        simd::sincos(simd::loadStrided(in + 2 * i + 1, 2, lanes), sinPhi, cosPhi);
+        simd::storeStrided(cosPhi * sinTheta, out + 4 * i, 4, lanes);
+        simd::storeStrided(sinPhi * sinTheta, out + 4 * i + 1, 4, lanes);
+        simd::storeStrided(cosTheta, out + 4 * i + 2, 4, lanes);
+        simd::storeStrided(1.0f, out + 4 * i + 3, 4, lanes);
+    }
+    return res;
 }
 
 vsg::ref_ptr<vsg::Data> GBufferIO::unormToFloat(vsg::ref_ptr<vsg::ubvec4Array2D> array){
     if(!array) return {};
-    vsg::vec4* res = new vsg::vec4[array->valueCount()];
-    for(uint32_t i = 0; i < array->valueCount(); ++i){
-        vsg::ubvec4 col = array->data()[i];
-        res[i] = {static_cast<float>(col.x) / 255.f, static_cast<float>(col.y) / 255.f, static_cast<float>(col.z) / 255.f, static_cast<float>(col.w) / 255.f};
-    }
-    return vsg::vec4Array2D::create(array->width(), array->height(), res, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    auto res = vsg::vec4Array2D::create(array->width(), array->height(), vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(array->data());
+    float* out = reinterpret_cast<float*>(res->data());
+    size_t count = size_t(array->valueCount()) * 4;
+    size_t i = 0;
+    for(; i + simd::FloatV::width <= count; i += simd::FloatV::width)
+        (simd::FloatV::loadBytes(in + i) * (1.0f / 255.0f)).store(out + i);
+    for(; i < count; ++i)
+        out[i] = static_cast<float>(in[i]) * (1.0f / 255.0f);
+    return res;
 }
 
 vsg::ref_ptr<vsg::Data> GBufferIO::depthToPosition(vsg::ref_ptr<vsg::floatArray2D> depths, const CameraMatrices& matrix)
@@ -261,24 +368,39 @@ vsg::ref_ptr<vsg::Data> GBufferIO::depthToPosition(vsg::ref_ptr<vsg::floatArray2
         std::cout << "GBufferIO::depthToPosition: Camera matrix in wrong layout. Expected camera matrix with separate projection matrix" << std::endl;
         return {};
     }
-    vsg::vec4* res = new vsg::vec4[depths->valueCount()];
-    auto toVec3 = [&](vsg::vec4 v){return vsg::vec3(v.x, v.y, v.z);};
-    vsg::vec4 cameraPos = matrix.invView[3];
-    for(uint32_t i = 0; i < depths->valueCount(); ++i){
-        uint32_t x = i % depths->width();
-        uint32_t y = i / depths->width();
-        vsg::vec2 p{(x + .5f) / depths->width() * 2 - 1, (y + .5f) / depths->height() * 2 - 1};
-        vsg::vec4 dir = matrix.invProj.value() * vsg::vec4{p.x, p.y, 1, 1};
-        dir.w = 0;
-        vsg::vec3 direction = toVec3(matrix.invView * vsg::normalize(dir));
-        direction *= depths->data()[i];
-        vsg::vec3 pos = toVec3(cameraPos) + direction;
-        res[i].x = pos.x;
-        res[i].y = pos.y;
-        res[i].z = pos.z;
-        res[i].w = 1;
-    }
-    return vsg::vec4Array2D::create(depths->width(), depths->height(), res, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    auto res = vsg::vec4Array2D::create(depths->width(), depths->height(), vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    float* out = reinterpret_cast<float*>(res->data());
+    const vsg::mat4& invProj = matrix.invProj.value();
+    const vsg::mat4& invView = matrix.invView;
+    vsg::vec4 cameraPos = invView[3];
+    // invProj * (x, y, 1, 1) is affine in the pixel position, so the view direction of a row is base + invProj[0] * x
+    // the direction is normalized in view space and rotated to world space by the upper 3x3 of invView
+    alignas(32) static const float laneOffsets[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    simd::FloatV offsets = simd::FloatV::load(laneOffsets);
+    uint32_t width = depths->width(), height = depths->height();
+    for(uint32_t y = 0; y < height; ++y){
+        float py = (y + .5f) / height * 2 - 1;
+        vsg::vec4 base = invProj[1] * py + invProj[2] + invProj[3];
+        const float* depthRow = depths->data() + size_t(y) * width;
+        float* outRow = out + size_t(y) * width * 4;
+        for(uint32_t x = 0; x < width; x += simd::FloatV::width){
+            int lanes = static_cast<int>(std::min<uint32_t>(simd::FloatV::width, width - x));
+            simd::FloatV px = (offsets + (x + .5f)) * (2.0f / width) - 1.0f;
+            simd::FloatV dx = px * invProj[0].x + base.x;
+            simd::FloatV dy = px * invProj[0].y + base.y;
+            simd::FloatV dz = px * invProj[0].z + base.z;
+            simd::FloatV scale = simd::loadStrided(depthRow + x, 1, lanes) / simd::sqrt(dx * dx + dy * dy + dz * dz);
+            dx = dx * scale;
+            dy = dy * scale;
+            dz = dz * scale;
+            for(int c = 0; c < 3; ++c){
+                simd::FloatV p = dx * invView[0][c] + dy * invView[1][c] + dz * invView[2][c] + cameraPos[c];
+                simd::storeStrided(p, outRow + 4 * x + c, 4, lanes);
+            }
+            simd::storeStrided(1.0f, outRow + 4 * x + 3, 4, lanes);
+        }
+    }
+    return res;
 }
 
 void OfflineIllumination::uploadToIlluminationBufferCommand(vsg::ref_ptr<IlluminationBuffer>& illuBuffer, vsg::ref_ptr<vsg::Commands>& commands, vsg::Context& context)
@@ -377,65 +499,83 @@ std::vector<vsg::ref_ptr<OfflineIllumination>> IlluminationBufferIO::importIllum
         std::cout << "Start loading Illumination" << std::endl;
     auto options = vsg::Options::create(vsgXchange::openexr::create());
     std::vector<vsg::ref_ptr<OfflineIllumination>> illuminations(numFrames);
-    auto execLoad = [&](int f){
-        if(verbosity > 1)
-            std::cout << "Illumination: Loading frame " << f << std::endl << std::flush;
-        char buff[100];
-        std::string filename;
-        // position images
-        snprintf(buff, sizeof(buff), illuminationFormat.c_str(), f);
-        filename = vsg::findFile(buff, options);
-
-        illuminations[f] = OfflineIllumination::create();
-
-        if (illuminations[f]->noisy = vsg::read_cast<vsg::Data>(filename, options); !illuminations[f]->noisy.valid())
-        {
-            std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
-            return;
-        }
-        if(verbosity > 1)
-            std::cout << "Illumination: Loaded frame " << f << std::endl << std::flush;
-    };
-    {
-        std::vector<std::future<void>> threads(numFrames);
-        for (int f = 0; f < numFrames; ++f) threads[f] = std::async(std::launch::async, execLoad, f); 
-    }
+    parallelFor(numFrames, [&](int f){
+        illuminations[f] = loadIllumination(illuminationFormat, options, f, verbosity);
+    });
     if(verbosity > 0)
         std::cout << "Done loading Illumination" << std::endl;
     return illuminations;
 }
 
+vsg::ref_ptr<OfflineIlluminationStream> IlluminationBufferIO::streamIllumination(const std::string &illuminationFormat, int numFrames, int workerCount, int windowSize, int verbosity)
+{
+    auto options = vsg::Options::create(vsgXchange::openexr::create());
+    auto load = [=](int f){
+        return loadIllumination(illuminationFormat, options, f, verbosity);
+    };
+    return OfflineIlluminationStream::create(load, numFrames, workerCount, windowSize);
+}
+
+vsg::ref_ptr<OfflineIllumination> IlluminationBufferIO::loadIllumination(const std::string &illuminationFormat, vsg::ref_ptr<vsg::Options> options, int f, int verbosity)
+{
+    if(verbosity > 1)
+        std::cout << "Illumination: Loading frame " << f << std::endl << std::flush;
+    char buff[100];
+    std::string filename;
+    // position images
+    snprintf(buff, sizeof(buff), illuminationFormat.c_str(), f);
+    filename = vsg::findFile(buff, options);
+
+    auto illumination = OfflineIllumination::create();
+
+    if (illumination->noisy = vsg::read_cast<vsg::Data>(filename, options); !illumination->noisy.valid())
+    {
+        std::cerr << "Failed to load image: " << filename << " texPath = " << buff << std::endl;
+        return illumination;
+    }
+    if(verbosity > 1)
+        std::cout << "Illumination: Loaded frame " << f << std::endl << std::flush;
+    return illumination;
+}
+
 bool IlluminationBufferIO::exportIllumination(const std::string& illuminationFormat, int numFrames, const OfflineIlluminations& illus, int verbosity){
     if(verbosity > 0)
         std::cout << "Start exporting Illumination" << std::endl;
     auto options = vsg::Options::create(vsgXchange::openexr::create());
-    bool fine = true;
-    auto execStore = [&](int f){
-        if(verbosity > 1)
-            std::cout << "IlluminationBuffer: Storing frame" << f << std::endl << std::flush;
-        char buff[200];
-        std::string filename;
-        snprintf(buff, sizeof(buff), illuminationFormat.c_str(), f);
-        filename = buff;
-        if(!vsg::write(illus[f]->noisy, filename, options)){
-            std::cout << "Faled to store image: " << filename << std::endl;
+    std::atomic<bool> fine = true;
+    parallelFor(numFrames, [&](int f){
+        if(!exportIlluminationFrame(illuminationFormat, f, illus[f], options, verbosity))
             fine = false;
-            return;
-        }
-        if(verbosity > 1)
-            std::cout << "IlluminationBuffer: Stored frame" << f << std::endl << std::flush;
-    };
-    {   //automatic join at the end of threads scope
-        std::vector<std::future<void>> threads(numFrames);
-        for (int f = 0; f < numFrames; ++f) threads[f] = std::async(std::launch::async, execStore, f); 
-    }
+    });
     if(verbosity > 0)
         std::cout << "Done exporting Illumination" << std::endl;
     return fine;
 }
 
+bool IlluminationBufferIO::exportIlluminationFrame(const std::string& illuminationFormat, int f, vsg::ref_ptr<OfflineIllumination> illumination, vsg::ref_ptr<vsg::Options> options, int verbosity){
+    if(verbosity > 1)
+        std::cout << "IlluminationBuffer: Storing frame" << f << std::endl << std::flush;
+    char buff[200];
+    std::string filename;
+    snprintf(buff, sizeof(buff), illuminationFormat.c_str(), f);
+    filename = buff;
+    if(!vsg::write(illumination->noisy, filename, options)){
+        std::cout << "Faled to store image: " << filename << std::endl;
+        return false;
+    }
+    if(verbosity > 1)
+        std::cout << "IlluminationBuffer: Stored frame" << f << std::endl << std::flush;
+    return true;
+}
+
 CameraMatricesVec MatrixIO::importMatrices(const std::string &matrixPath)
 {
+    // the binary camera path is read directly, without parsing or inverting matrices
+    if(vsg::lowerCaseFileExtension(matrixPath) == CameraPathFormat::extension){
+        auto cameraPath = CameraPath::open(matrixPath);
+        return cameraPath ? cameraPath->allMatrices() : CameraMatricesVec{};
+    }
+
     //TODO: temporary implementation to parse matrices from BMFRs dataset
     std::ifstream f(matrixPath);
     if (!f) {
@@ -494,6 +634,9 @@ CameraMatricesVec MatrixIO::importMatrices(const std::string &matrixPath)
 
 bool MatrixIO::exportMatrices(const std::string &matrixPath, const CameraMatricesVec& matrices)
 {
+    if(vsg::lowerCaseFileExtension(matrixPath) == CameraPathFormat::extension)
+        return CameraPath::write(matrixPath, matrices);
+
     std::ofstream f(matrixPath, std::ofstream::out);
     if (!f) {
         std::cout << "Matrix file " << matrixPath << " unable to open." << std::endl;
@@ -7,6 +7,7 @@
 #include <string>
 #include <buffers/GBuffer.hpp>
 #include <buffers/IlluminationBuffer.hpp>
+#include <io/FrameStream.hpp>
 
 // vk copy Buffer to image wrapper class
 class CopyBufferToImage: public vsg::Inherit<vsg::Command, CopyBufferToImage>{
@@ -27,6 +28,8 @@ public:
 };
 using CameraMatricesVec = std::vector<CameraMatrices>;
 
+// files with the .campath extension use the binary CameraPath format, .json files the json format, others the text format
+// importMatrices() reads every frame, long .campath trajectories are better read per frame with CameraPath::open()
 class MatrixIO{
 public:
     static std::vector<CameraMatrices> importMatrices(const std::string& matrixPath);
@@ -49,18 +52,33 @@ private:
     void setupStagingBuffer(uint32_t width, uint32_t height);
 };
 using OfflineGBuffers = std::vector<vsg::ref_ptr<OfflineGBuffer>>;
+using OfflineGBufferStream = FrameStream<vsg::ref_ptr<OfflineGBuffer>>;
 
 class GBufferIO{
 public:
     static OfflineGBuffers importGBufferDepth(const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int numFrames, int verbosity = 1);
     static OfflineGBuffers importGBufferPosition(const std::string& positionFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, const std::vector<CameraMatrices>& matrices, int numFrames, int verbosity = 1);
+    // streaming variants, frames are loaded by workerCount threads and at most windowSize frames are kept in memory
+    static vsg::ref_ptr<OfflineGBufferStream> streamGBufferDepth(const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int numFrames, int workerCount, int windowSize, int verbosity = 1);
+    static vsg::ref_ptr<OfflineGBufferStream> streamGBufferPosition(const std::string& positionFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, const std::vector<CameraMatrices>& matrices, int numFrames, int workerCount, int windowSize, int verbosity = 1);
     static bool exportGBuffer(const std::string& positionFormat, const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int numFrames, const OfflineGBuffers& gBuffers, const CameraMatricesVec& matrices, int verbosity = 1);
+    // exports a single frame, options have to contain the openexr reader writer (see exportOptions())
+    static bool exportGBufferFrame(const std::string& positionFormat, const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, int frame, vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, vsg::ref_ptr<vsg::Options> options, int verbosity = 1);
+    // exports all layers of a frame into one multi-part exr file
+    static bool exportGBufferFrameMultipart(const std::string& format, int frame, vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, vsg::ref_ptr<vsg::Options> options, int verbosity = 1);
+    // the exr compression and precision can be changed with the vsgXchange::openexr options
+    static vsg::ref_ptr<vsg::Options> exportOptions();
 private:
+    static vsg::ref_ptr<OfflineGBuffer> loadGBufferDepth(const std::string& depthFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, vsg::ref_ptr<vsg::Options> options, int frame, int verbosity);
+    static vsg::ref_ptr<OfflineGBuffer> loadGBufferPosition(const std::string& positionFormat, const std::string& normalFormat, const std::string& materialFormat, const std::string& albedoFormat, const std::vector<CameraMatrices>& matrices, vsg::ref_ptr<vsg::Options> options, int frame, int verbosity);
     static vsg::ref_ptr<vsg::Data> convertNormalToSpherical(vsg::ref_ptr<vsg::vec4Array2D> normals);
+    // float albedo is clamped to [0, 1] and rounded to the nearest byte (simd::floatToUnorm()), earlier versions
+    // truncated without clamping, which left the bytes of values outside of [0, 1] undefined
     static vsg::ref_ptr<vsg::Data> compressAlbedo(vsg::ref_ptr<vsg::Data> in);
     static vsg::ref_ptr<vsg::Data> sphericalToCartesian(vsg::ref_ptr<vsg::vec2Array2D> normals);
     static vsg::ref_ptr<vsg::Data> unormToFloat(vsg::ref_ptr<vsg::ubvec4Array2D> array);
     static vsg::ref_ptr<vsg::Data> depthToPosition(vsg::ref_ptr<vsg::floatArray2D> depths, const CameraMatrices& matrix);
+    static vsg::ref_ptr<vsg::Data> exportLayer(vsg::ref_ptr<OfflineGBuffer> gBuffer, const CameraMatrices& matrix, const std::string& layer);
 };
 
 // IlluminationBuffer ---------------------------------------------------------------
@@ -77,9 +95,14 @@ private:
     void setupStagingBuffer(uint32_t widht, uint32_t height);
 };
 using OfflineIlluminations = std::vector<vsg::ref_ptr<OfflineIllumination>>;
+using OfflineIlluminationStream = FrameStream<vsg::ref_ptr<OfflineIllumination>>;
 
 class IlluminationBufferIO{
 public:
     static OfflineIlluminations importIllumination(const std::string& illuminationFormat, int numFrames, int verbosity = 1);
+    static vsg::ref_ptr<OfflineIlluminationStream> streamIllumination(const std::string& illuminationFormat, int numFrames, int workerCount, int windowSize, int verbosity = 1);
     static bool exportIllumination(const std::string& illuminationFormat, int numFrames, const OfflineIlluminations& illus, int verbosity = 1);
+    static bool exportIlluminationFrame(const std::string& illuminationFormat, int frame, vsg::ref_ptr<OfflineIllumination> illumination, vsg::ref_ptr<vsg::Options> options, int verbosity = 1);
+private:
+    static vsg::ref_ptr<OfflineIllumination> loadIllumination(const std::string& illuminationFormat, vsg::ref_ptr<vsg::Options> options, int frame, int verbosity);
 };
@@ -0,0 +1,95 @@
+#include "SceneCache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace{
+    // 64 bit FNV-1a, only used to detect changed inputs
+    class Fnv1a{
+    public:
+        void add(const void* data, size_t size){
+            auto bytes = static_cast<const uint8_t*>(data);
+            for(size_t i = 0; i < size; ++i){
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        }
+        void add(const std::string& s){
+            add(s.data(), s.size());
+            // separator, so that consecutive strings can't shift into each other
+            add("\0", 1);
+        }
+        uint64_t hash = 14695981039346656037ull;
+    };
+}
+
+std::string SceneCache::cacheKey(const std::string& sceneFilename, const nlohmann::json& config)
+{
+    Fnv1a fnv;
+    fnv.add(std::string(importerVersion));
+    fnv.add(std::string(VSG_VERSION_STRING));
+    fnv.add(config.empty() ? std::string() : config.dump());
+
+    std::ifstream file(sceneFilename, std::ios::in | std::ios::binary);
+    if(!file)
+        return {};
+    std::vector<char> buffer(1 << 20);
+    while(file){
+        file.read(buffer.data(), buffer.size());
+        fnv.add(buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+
+    std::stringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << fnv.hash;
+    return key.str();
+}
+
+std::string SceneCache::cacheFilename(const std::string& sceneFilename, const std::string& key) const
+{
+    return cacheDirectory + "/" + vsg::simpleFilename(sceneFilename) + "_" + key + ".vsgb";
+}
+
+vsg::ref_ptr<vsg::Node> SceneCache::load(const std::string& sceneFilename, const nlohmann::json& config, vsg::ref_ptr<vsg::Options> options)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start](){
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto key = cacheKey(sceneFilename, config);
+    if(key.empty())
+        return {};
+    auto cachedFilename = cacheFilename(sceneFilename, key);
+
+    if(vsg::fileExists(cachedFilename)){
+        // no options, the native vsg reader is used for the cached file
+        auto scene = vsg::read_cast<vsg::Node>(cachedFilename);
+        if(scene){
+            std::cout << "Scene loaded from cache " << cachedFilename << " in " << elapsedMs() << " ms" << std::endl;
+            return scene;
+        }
+        std::cout << "Failed to read cached scene " << cachedFilename << ", importing again" << std::endl;
+    }
+
+    auto scene = vsg::read_cast<vsg::Node>(sceneFilename, options);
+    if(!scene)
+        return {};
+    std::cout << "Scene imported in " << elapsedMs() << " ms" << std::endl;
+
+    // written to a temporary file first, so an interrupted write never leaves a truncated cache entry
+    vsg::makeDirectory(cacheDirectory);
+    auto tempFilename = cachedFilename + ".tmp.vsgb";
+    std::remove(cachedFilename.c_str());
+    if(vsg::write(scene, tempFilename) && std::rename(tempFilename.c_str(), cachedFilename.c_str()) == 0)
+        std::cout << "Scene cached at " << cachedFilename << std::endl;
+    else{
+        std::remove(tempFilename.c_str());
+        std::cout << "Failed to write scene cache " << cachedFilename << std::endl;
+    }
+    return scene;
+}
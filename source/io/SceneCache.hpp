@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vsg/all.h>
+#include <nlohmann/json.hpp>
+#include <string>
+
+// on disk cache of imported scenes in vsg's native binary format
+// entries are keyed on the content of the scene file, the config and the importer version,
+// so a changed input never returns a stale scene
+class SceneCache{
+public:
+    // bump when the assimp / 3D-FRONT import changes the produced scene graph
+    static constexpr const char* importerVersion = "2";
+
+    SceneCache(const std::string& cacheDirectory): cacheDirectory(cacheDirectory){}
+
+    // returns the cached scene or imports it with the given options and adds it to the cache
+    vsg::ref_ptr<vsg::Node> load(const std::string& sceneFilename, const nlohmann::json& config, vsg::ref_ptr<vsg::Options> options);
+
+    static std::string cacheKey(const std::string& sceneFilename, const nlohmann::json& config);
+    std::string cacheFilename(const std::string& sceneFilename, const std::string& key) const;
+private:
+    std::string cacheDirectory;
+};
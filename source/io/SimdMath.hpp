@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VULKANPBRT_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VULKANPBRT_SIMD_SSE2
+#endif
+
+// small float vector abstraction for the cpu side image conversions
+// uses avx2 (8 lanes) when compiled with avx2 support (see VULKANPBRT_AVX2), sse2 (4 lanes) on x86 and a single lane otherwise
+// the math functions below are written once against this interface
+namespace simd{
+#if defined(VULKANPBRT_SIMD_AVX2)
+    struct FloatV{
+        static constexpr int width = 8;
+        __m256 v;
+        FloatV() = default;
+        FloatV(__m256 v): v(v){}
+        FloatV(float f): v(_mm256_set1_ps(f)){}
+        static FloatV load(const float* p){return _mm256_loadu_ps(p);}
+        void store(float* p) const {_mm256_storeu_ps(p, v);}
+        // converts 8 unorm bytes to floats in [0, 255]
+        static FloatV loadBytes(const uint8_t* p){return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));}
+        // truncates to bytes, the values have to be in [0, 255]
+        void storeBytes(uint8_t* p) const {
+            __m256i i = _mm256_cvttps_epi32(v);
+            __m128i s = _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(s, s));
+        }
+    };
+    using MaskV = FloatV;
+    inline FloatV operator+(FloatV a, FloatV b){return _mm256_add_ps(a.v, b.v);}
+    inline FloatV operator-(FloatV a, FloatV b){return _mm256_sub_ps(a.v, b.v);}
+    inline FloatV operator*(FloatV a, FloatV b){return _mm256_mul_ps(a.v, b.v);}
+    inline FloatV operator/(FloatV a, FloatV b){return _mm256_div_ps(a.v, b.v);}
+    inline FloatV operator-(FloatV a){return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f));}
+    inline FloatV sqrt(FloatV a){return _mm256_sqrt_ps(a.v);}
+    inline FloatV abs(FloatV a){return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v);}
+    inline FloatV min(FloatV a, FloatV b){return _mm256_min_ps(a.v, b.v);}
+    inline FloatV max(FloatV a, FloatV b){return _mm256_max_ps(a.v, b.v);}
+    inline FloatV round(FloatV a){return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);}
+    inline MaskV operator<(FloatV a, FloatV b){return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);}
+    inline MaskV operator>(FloatV a, FloatV b){return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ);}
+    inline MaskV operator==(FloatV a, FloatV b){return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ);}
+    inline MaskV operator|(MaskV a, MaskV b){return _mm256_or_ps(a.v, b.v);}
+    inline FloatV select(MaskV m, FloatV a, FloatV b){return _mm256_blendv_ps(b.v, a.v, m.v);}
+#elif defined(VULKANPBRT_SIMD_SSE2)
+    struct FloatV{
+        static constexpr int width = 4;
+        __m128 v;
+        FloatV() = default;
+        FloatV(__m128 v): v(v){}
+        FloatV(float f): v(_mm_set1_ps(f)){}
+        static FloatV load(const float* p){return _mm_loadu_ps(p);}
+        void store(float* p) const {_mm_storeu_ps(p, v);}
+        // converts 4 unorm bytes to floats in [0, 255]
+        static FloatV loadBytes(const uint8_t* p){
+            int32_t bytes;
+            std::memcpy(&bytes, p, sizeof(bytes));
+            __m128i zero = _mm_setzero_si128();
+            __m128i i = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+            return _mm_cvtepi32_ps(i);
+        }
+        // truncates to bytes, the values have to be in [0, 255]
+        void storeBytes(uint8_t* p) const {
+            __m128i i = _mm_cvttps_epi32(v);
+            __m128i s = _mm_packs_epi32(i, i);
+            int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(s, s));
+            std::memcpy(p, &bytes, sizeof(bytes));
+        }
+    };
+    using MaskV = FloatV;
+    inline FloatV operator+(FloatV a, FloatV b){return _mm_add_ps(a.v, b.v);}
+    inline FloatV operator-(FloatV a, FloatV b){return _mm_sub_ps(a.v, b.v);}
+    inline FloatV operator*(FloatV a, FloatV b){return _mm_mul_ps(a.v, b.v);}
+    inline FloatV operator/(FloatV a, FloatV b){return _mm_div_ps(a.v, b.v);}
+    inline FloatV operator-(FloatV a){return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f));}
+    inline FloatV sqrt(FloatV a){return _mm_sqrt_ps(a.v);}
+    inline FloatV abs(FloatV a){return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v);}
+    inline FloatV min(FloatV a, FloatV b){return _mm_min_ps(a.v, b.v);}
+    inline FloatV max(FloatV a, FloatV b){return _mm_max_ps(a.v, b.v);}
+    // round to nearest, only valid for |a| < 2^31
+    inline FloatV round(FloatV a){return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v));}
+    inline MaskV operator<(FloatV a, FloatV b){return _mm_cmplt_ps(a.v, b.v);}
+    inline MaskV operator>(FloatV a, FloatV b){return _mm_cmpgt_ps(a.v, b.v);}
+    inline MaskV operator==(FloatV a, FloatV b){return _mm_cmpeq_ps(a.v, b.v);}
+    inline MaskV operator|(MaskV a, MaskV b){return _mm_or_ps(a.v, b.v);}
+    inline FloatV select(MaskV m, FloatV a, FloatV b){return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));}
+#else
+    struct FloatV{
+        static constexpr int width = 1;
+        float v;
+        FloatV() = default;
+        FloatV(float f): v(f){}
+        static FloatV load(const float* p){return *p;}
+        void store(float* p) const {*p = v;}
+        static FloatV loadBytes(const uint8_t* p){return static_cast<float>(*p);}
+        void storeBytes(uint8_t* p) const {*p = static_cast<uint8_t>(v);}
+    };
+    struct MaskV{
+        bool v;
+    };
+    inline FloatV operator+(FloatV a, FloatV b){return a.v + b.v;}
+    inline FloatV operator-(FloatV a, FloatV b){return a.v - b.v;}
+    inline FloatV operator*(FloatV a, FloatV b){return a.v * b.v;}
+    inline FloatV operator/(FloatV a, FloatV b){return a.v / b.v;}
+    inline FloatV operator-(FloatV a){return -a.v;}
+    inline FloatV sqrt(FloatV a){return std::sqrt(a.v);}
+    inline FloatV abs(FloatV a){return std::abs(a.v);}
+    inline FloatV min(FloatV a, FloatV b){return std::min(a.v, b.v);}
+    inline FloatV max(FloatV a, FloatV b){return std::max(a.v, b.v);}
+    inline FloatV round(FloatV a){return std::nearbyint(a.v);}
+    inline MaskV operator<(FloatV a, FloatV b){return {a.v < b.v};}
+    inline MaskV operator>(FloatV a, FloatV b){return {a.v > b.v};}
+    inline MaskV operator==(FloatV a, FloatV b){return {a.v == b.v};}
+    inline MaskV operator|(MaskV a, MaskV b){return {a.v || b.v};}
+    inline FloatV select(MaskV m, FloatV a, FloatV b){return m.v ? a : b;}
+#endif
+
+    // loads/stores count (<= width) values which are stride floats apart, missing lanes are zero
+    inline FloatV loadStrided(const float* p, int stride, int count = FloatV::width){
+        alignas(32) float lanes[FloatV::width] = {};
+        for(int i = 0; i < count; ++i) lanes[i] = p[i * stride];
+        return FloatV::load(lanes);
+    }
+    inline void storeStrided(FloatV a, float* p, int stride, int count = FloatV::width){
+        alignas(32) float lanes[FloatV::width];
+        a.store(lanes);
+        for(int i = 0; i < count; ++i) p[i * stride] = lanes[i];
+    }
+
+    // out = clamp(in * 255, 0, 255) rounded to the nearest byte, so 8 bit values stored as half are read back unchanged
+    // the simd lanes and the scalar tail give the same bytes
+    inline void floatToUnorm(const float* in, uint8_t* out, size_t count){
+        size_t i = 0;
+        for(; i + FloatV::width <= count; i += FloatV::width)
+            (min(max(FloatV::load(in + i) * 255.0f, 0.0f), 255.0f) + 0.5f).storeBytes(out + i);
+        for(; i < count; ++i)
+            out[i] = static_cast<uint8_t>(std::clamp(in[i] * 255.0f, 0.0f, 255.0f) + 0.5f);
+    }
+
+    constexpr float pi = 3.14159265358979f;
+
+    // Abramowitz and Stegun 4.4.46, absolute error below 5e-7 on [-1, 1]
+    inline FloatV acos(FloatV x){
+        FloatV a = min(abs(x), 1.0f);
+        FloatV p = -0.0012624911f;
+        p = p * a + 0.0066700901f;
+        p = p * a - 0.0170881256f;
+        p = p * a + 0.0308918810f;
+        p = p * a - 0.0501743046f;
+        p = p * a + 0.0889789874f;
+        p = p * a - 0.2145988016f;
+        p = p * a + 1.5707963050f;
+        FloatV r = sqrt(FloatV(1.0f) - a) * p;
+        return select(x < 0.0f, FloatV(pi) - r, r);
+    }
+
+    // minimax polynomial for atan on [0, 1] with octant reduction, absolute error below 2e-6
+    inline FloatV atan2(FloatV y, FloatV x){
+        FloatV ax = abs(x), ay = abs(y);
+        FloatV hi = max(ax, ay), lo = min(ax, ay);
+        FloatV a = select(hi == 0.0f, FloatV(0.0f), lo / hi);
+        FloatV s = a * a;
+        FloatV p = -0.01172120f;
+        p = p * s + 0.05265332f;
+        p = p * s - 0.11643287f;
+        p = p * s + 0.19354346f;
+        p = p * s - 0.33262347f;
+        p = p * s + 0.99997726f;
+        FloatV r = p * a;
+        r = select(ay > ax, FloatV(pi * 0.5f) - r, r);
+        r = select(x < 0.0f, FloatV(pi) - r, r);
+        return select(y < 0.0f, -r, r);
+    }
+
+    // cephes style sin and cos with quadrant reduction, absolute error below 1e-7 for |x| <= 2 pi
+    inline void sincos(FloatV x, FloatV& sinOut, FloatV& cosOut){
+        FloatV j = round(x * (2.0f / pi));
+        // pi / 2 split in two parts so that the reduction stays exact for small quadrant counts
+        FloatV r = (x - j * 1.5703125f) - j * 4.83826794897e-4f;
+        FloatV r2 = r * r;
+
+        FloatV s = -1.9515295891e-4f;
+        s = s * r2 + 8.3321608736e-3f;
+        s = s * r2 - 1.6666654611e-1f;
+        s = s * r2 * r + r;
+
+        FloatV c = 2.443315711809948e-5f;
+        c = c * r2 - 1.388731625493765e-3f;
+        c = c * r2 + 4.166664568298827e-2f;
+        c = c * r2 * r2 - r2 * 0.5f + 1.0f;
+
+        // quadrant j mod 4 decides which polynomial and sign is used
+        FloatV q = j - FloatV(4.0f) * round((j - 1.5f) * 0.25f);
+        MaskV odd = (q == 1.0f) | (q == 3.0f);
+        sinOut = select(odd, c, s);
+        cosOut = select(odd, s, c);
+        sinOut = select(q > 1.5f, -sinOut, sinOut);
+        cosOut = select((q == 1.0f) | (q == 2.0f), -cosOut, cosOut);
+    }
+}
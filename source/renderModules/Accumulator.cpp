@@ -1,5 +1,5 @@
 #include <renderModules/Accumulator.hpp>
-#include <vsgXchange/glsl.h>
+#include <renderModules/ShaderPermutations.hpp>
 
 Accumulator::Accumulator(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool separateMatrices, int workWidth, int workHeight):
     width(gBuffer->depth->imageInfoList[0]->imageView->image->extent.width),
@@ -11,8 +11,10 @@ Accumulator::Accumulator(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<Illuminatio
     originalIllumination(illuminationBuffer),
     _separateMatrices(separateMatrices)
 {
-    auto options = vsg::Options::create(vsgXchange::glsl::create());
-    auto computeStage = vsg::ShaderStage::read(VK_SHADER_STAGE_COMPUTE_BIT, "main", shaderPath, options);
+    std::vector<std::string> defines;
+    if(separateMatrices)
+        defines.push_back("SEPARATE_MATRICES");
+    auto computeStage = ShaderPermutations::read(VK_SHADER_STAGE_COMPUTE_BIT, shaderPath, defines);
     if(!computeStage){
         throw vsg::Exception{"Accumulator::create() could not open compute shader stage"};
     }
@@ -20,11 +22,6 @@ Accumulator::Accumulator(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<Illuminatio
         {0, vsg::intValue::create(workWidth)}, 
         {1, vsg::intValue::create(workHeight)}
     };
-    if(separateMatrices){
-        auto compileHints = vsg::ShaderCompileSettings::create();
-        compileHints->defines = {"SEPARATE_MATRICES"};
-        computeStage->module->hints = compileHints;
-    }
 
     auto bindingMap = computeStage->getDescriptorSetLayoutBindingsMap();
     auto descriptorSetLayout = vsg::DescriptorSetLayout::create(bindingMap.begin()->second.bindings);
@@ -62,15 +59,17 @@ void Accumulator::updateImageLayouts(vsg::Context& context)
     accumulatedIllumination->updateImageLayouts(context);
 }
 
-void Accumulator::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph) 
+void Accumulator::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler)
 {
     auto pipelineBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
         0);
+    if (profiler) profiler->beginRange(commandGraph, "accumulator");
     commandGraph->addChild(bindPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(pushConstants);
     commandGraph->addChild(vsg::Dispatch::create(uint32_t(ceil(float(width) / float(workWidth))), uint32_t(ceil(float(height) / float(workHeight))),
                                                  1));
+    if (profiler) profiler->endRange(commandGraph, "accumulator");
     commandGraph->addChild(pipelineBarrier);
 }
 
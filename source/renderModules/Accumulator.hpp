@@ -4,6 +4,7 @@
 #include <buffers/GBuffer.hpp>
 #include <buffers/IlluminationBuffer.hpp>
 #include <buffers/AccumulationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
 
 class Accumulator : public vsg::Inherit<vsg::Object, Accumulator>
 {
@@ -15,7 +16,7 @@ public:
 
     void compileImages(vsg::Context &context);
     void updateImageLayouts(vsg::Context &context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler = {});
     // Frameindex is needed to upload the correct matrix
     void setCameraMatrices(int frameIndex, const CameraMatrices& cur, const CameraMatrices& prev);
 
@@ -34,7 +35,7 @@ private:
     public:
         PCValue(){}
     };
-    std::string shaderPath = "shaders/accumulator.comp";    //normal glsl file has to be loaded as the shader has to be adopted to separateMatrices style
+    std::string shaderPath = "shaders/accumulator.comp";    //precompiled with and without SEPARATE_MATRICES, see ShaderPermutations
     int workWidth, workHeight;
     vsg::ref_ptr<GBuffer> gBuffer;
     vsg::ref_ptr<IlluminationBuffer> originalIllumination;
@@ -0,0 +1,169 @@
+#include <renderModules/AdaptiveSampler.hpp>
+#include <renderModules/ShaderPermutations.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    vsg::ref_ptr<vsg::ImageInfo> createStorageImage(uint32_t width, uint32_t height, VkFormat format)
+    {
+        auto image = vsg::Image::create();
+        image->imageType = VK_IMAGE_TYPE_2D;
+        image->format = format;
+        image->extent = {width, height, 1};
+        image->mipLevels = 1;
+        image->arrayLayers = 1;
+        image->samples = VK_SAMPLE_COUNT_1_BIT;
+        image->tiling = VK_IMAGE_TILING_OPTIMAL;
+        image->usage = VK_IMAGE_USAGE_STORAGE_BIT;
+        image->initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        auto imageView = vsg::ImageView::create(image, VK_IMAGE_ASPECT_COLOR_BIT);
+        return vsg::ImageInfo::create(vsg::ref_ptr<vsg::Sampler>{}, imageView, VK_IMAGE_LAYOUT_GENERAL);
+    }
+}
+
+AdaptiveSampler::AdaptiveSampler(uint32_t width, uint32_t height, float targetError, uint32_t minSamples, uint32_t framesInFlight) :
+    width(width),
+    height(height),
+    tilesX((width + tileSize - 1) / tileSize),
+    tilesY((height + tileSize - 1) / tileSize),
+    framesInFlight(framesInFlight),
+    slots(framesInFlight + 1)
+{
+    auto computeStage = ShaderPermutations::read(VK_SHADER_STAGE_COMPUTE_BIT, shaderPath, {});
+    if (!computeStage)
+    {
+        throw vsg::Exception{"AdaptiveSampler::create() could not open compute shader stage"};
+    }
+    computeStage->specializationConstants = vsg::ShaderStage::SpecializationConstants{
+        {0, vsg::intValue::create(tileSize)},
+        {1, vsg::intValue::create(tileSize)},
+        {2, vsg::floatValue::create(targetError)},
+        {3, vsg::uintValue::create(minSamples)}
+    };
+
+    auto bindingMap = computeStage->getDescriptorSetLayoutBindingsMap();
+    auto descriptorSetLayout = vsg::DescriptorSetLayout::create(bindingMap.begin()->second.bindings);
+    auto pipelineLayout = vsg::PipelineLayout::create(vsg::DescriptorSetLayouts{descriptorSetLayout}, computeStage->getPushConstantRanges());
+    auto pipeline = vsg::ComputePipeline::create(pipelineLayout, computeStage);
+    bindPipeline = vsg::BindComputePipeline::create(pipeline);
+
+    // the images are shared with the ray tracing pipeline, which gets its own descriptors in updateDescriptor()
+    statisticsInfo = createStorageImage(width, height, VK_FORMAT_R32G32B32A32_SFLOAT);
+    maskInfo = createStorageImage(tilesX, tilesY, VK_FORMAT_R8_UNORM);
+    counterBuffer = vsg::Buffer::create(sizeof(uint32_t) * slots.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE);
+    vsg::Descriptors descriptors{
+        vsg::DescriptorImage::create(statisticsInfo, vsg::ShaderStage::getSetBindingIndex(bindingMap, "sampleStatistics").second, 0,
+                                     VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+        vsg::DescriptorImage::create(maskInfo, vsg::ShaderStage::getSetBindingIndex(bindingMap, "convergenceMask").second, 0,
+                                     VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+        vsg::DescriptorBuffer::create(vsg::BufferInfoList{vsg::BufferInfo::create(counterBuffer, 0, counterBuffer->size)},
+                                      vsg::ShaderStage::getSetBindingIndex(bindingMap, "UnconvergedTiles").second, 0,
+                                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)};
+    auto descriptorSet = vsg::DescriptorSet::create(descriptorSetLayout, descriptors);
+    bindDescriptorSet = vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, descriptorSet);
+
+    statistics = vsg::DescriptorImage::create(statisticsInfo, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    mask = vsg::DescriptorImage::create(maskInfo, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+    slotValue = vsg::uintValue::create(0);
+    pushConstants = vsg::PushConstants::create(VK_SHADER_STAGE_COMPUTE_BIT, 0, slotValue);
+}
+
+void AdaptiveSampler::compile(vsg::Context& context)
+{
+    if (device) return;
+    device = context.device;
+    auto deviceID = device->deviceID;
+    statistics->compile(context);
+    mask->compile(context);
+    // bound before the descriptor is compiled, so the counters stay in host visible memory that is mapped once
+    counterBuffer->compile(device);
+    counterMemory = vsg::DeviceMemory::create(device, counterBuffer->getMemoryRequirements(deviceID),
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    counterBuffer->bind(counterMemory, 0);
+    void* mapped;
+    if (counterMemory->map(0, counterBuffer->size, 0, &mapped) != VK_SUCCESS)
+        throw vsg::Exception{"Error: AdaptiveSampler::compile(...) could not map the tile counters."};
+    counters = static_cast<uint32_t*>(mapped);
+    std::fill(counters, counters + slots.size(), 0u);
+}
+
+void AdaptiveSampler::updateImageLayouts(vsg::Context& context)
+{
+    VkImageSubresourceRange resourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    auto statisticsLayout = vsg::ImageMemoryBarrier::create(VK_ACCESS_NONE_KHR, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                            VK_IMAGE_LAYOUT_GENERAL, 0, 0, statisticsInfo->imageView->image, resourceRange);
+    auto maskLayout = vsg::ImageMemoryBarrier::create(VK_ACCESS_NONE_KHR, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                      VK_IMAGE_LAYOUT_GENERAL, 0, 0, maskInfo->imageView->image, resourceRange);
+    auto pipelineBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+                                                        VK_DEPENDENCY_BY_REGION_BIT, statisticsLayout, maskLayout);
+    context.commands.push_back(pipelineBarrier);
+}
+
+void AdaptiveSampler::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    statistics->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "sampleStatistics").second;
+    mask->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "convergenceMask").second;
+    descSet->descriptorSet->descriptors.push_back(statistics);
+    descSet->descriptorSet->descriptors.push_back(mask);
+}
+
+void AdaptiveSampler::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler)
+{
+    // the statistics of this frame are read, the mask is read by the next frame and the counter by the host
+    auto statisticsBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                                          vsg::MemoryBarrier::create(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+    auto maskBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_HOST_BIT, 0,
+                                                    vsg::MemoryBarrier::create(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT));
+    commandGraph->addChild(statisticsBarrier);
+    if (profiler) profiler->beginRange(commandGraph, "adaptive sampling");
+    commandGraph->addChild(bindPipeline);
+    commandGraph->addChild(bindDescriptorSet);
+    commandGraph->addChild(pushConstants);
+    commandGraph->addChild(vsg::Dispatch::create(tilesX, tilesY, 1));
+    if (profiler) profiler->endRange(commandGraph, "adaptive sampling");
+    commandGraph->addChild(maskBarrier);
+}
+
+void AdaptiveSampler::beginFrame(uint32_t sampleIndex)
+{
+    if (sampleIndex == 0)
+    {
+        ++imageCount;
+        unconverged = -1;
+        unconvergedFrame = -1;
+    }
+    if (!counters) return;
+    // the last frame of the slot was submitted framesInFlight + 1 frames before, the last endFrame() has read it
+    counters[currentSlot] = 0;
+    slotValue->value() = currentSlot;
+}
+
+void AdaptiveSampler::endFrame()
+{
+    if (!counters) return;
+    slots[currentSlot].frame = static_cast<int64_t>(frameCount);
+    slots[currentSlot].image = imageCount;
+    currentSlot = (currentSlot + 1) % slots.size();
+
+    // before the submission vsg waited for the fence of the frame framesInFlight frames back, so it and all earlier frames are done
+    int64_t finishedFrame = static_cast<int64_t>(frameCount++) - framesInFlight;
+    for (uint32_t i = 0; i < slots.size(); ++i)
+    {
+        if (slots[i].frame >= 0 && slots[i].frame <= finishedFrame)
+            readSlot(i);
+    }
+}
+
+void AdaptiveSampler::readSlot(uint32_t index)
+{
+    auto& slot = slots[index];
+    if (slot.image == imageCount && slot.frame > unconvergedFrame)
+    {
+        unconverged = counters[index];
+        unconvergedFrame = slot.frame;
+    }
+    slot.frame = -1;
+}
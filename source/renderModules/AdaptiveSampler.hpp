@@ -0,0 +1,71 @@
+#pragma once
+#include <renderModules/GpuProfiler.hpp>
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// variance driven adaptive sampling of the progressively accumulated final image (FINAL_IMAGE)
+// a pipeline that gets an AdaptiveSampler compiles its raygen shader with ADAPTIVE_SAMPLING, the shader then keeps the mean and
+// second moment of the luminance and the sample count of every pixel. after every pass adaptiveSampling.comp marks the tiles whose
+// relative standard error is below targetError as converged, the raygen shader skips the pixels of converged tiles until the
+// samples are reset. the number of unconverged tiles of a frame is written to a ring of counters in host visible memory, which is
+// read back once vsg has waited for the fence of its frame, so the host never waits for the counters itself
+class AdaptiveSampler : public vsg::Inherit<vsg::Object, AdaptiveSampler>
+{
+public:
+    // has to match ADAPTIVE_TILE_SIZE in layoutPTAdaptive.glsl
+    static constexpr uint32_t tileSize = 8;
+
+    // tiles are only converged after minSamples samples, so the variance estimate of a few samples does not stop them early.
+    // framesInFlight has to be the number of buffers of the vsg::RecordAndSubmitTask, which waits for the fence of a frame before
+    // it submits the frame framesInFlight frames later
+    AdaptiveSampler(uint32_t width, uint32_t height, float targetError, uint32_t minSamples = 16, uint32_t framesInFlight = 3);
+
+    void compile(vsg::Context& context);
+    void updateImageLayouts(vsg::Context& context);
+    // adds the statistics and the convergence mask to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+    // evaluates the convergence of the tiles, has to be added after the trace rays command
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler = {});
+
+    // has to be called before the frame is submitted, sampleIndex 0 starts the samples of a new image
+    void beginFrame(uint32_t sampleIndex);
+    // has to be called after the frame was submitted, reads back the frames vsg has waited for during the submission
+    void endFrame();
+
+    // unconverged tiles of the last read back frame of the current image, -1 before its first readback
+    int64_t unconvergedTiles() const { return unconverged; }
+    bool converged() const { return unconverged == 0; }
+    uint32_t tileCount() const { return tilesX * tilesY; }
+
+private:
+    struct Slot
+    {
+        int64_t frame = -1;     // -1 when nothing is pending
+        uint64_t image = 0;
+    };
+    void readSlot(uint32_t index);
+
+    std::string shaderPath = "shaders/adaptiveSampling.comp";
+    uint32_t width, height, tilesX, tilesY;
+    vsg::ref_ptr<vsg::ImageInfo> statisticsInfo, maskInfo;
+    vsg::ref_ptr<vsg::DescriptorImage> statistics, mask;
+    vsg::ref_ptr<vsg::Buffer> counterBuffer;
+    vsg::ref_ptr<vsg::BindComputePipeline> bindPipeline;
+    vsg::ref_ptr<vsg::BindDescriptorSet> bindDescriptorSet;
+    vsg::ref_ptr<vsg::PushConstants> pushConstants;
+    vsg::ref_ptr<vsg::uintValue> slotValue;
+    vsg::ref_ptr<vsg::Device> device;
+    vsg::ref_ptr<vsg::DeviceMemory> counterMemory;
+    uint32_t* counters = nullptr;   // persistently mapped, one counter per slot
+
+    uint32_t framesInFlight;
+    uint32_t currentSlot = 0;
+    uint64_t frameCount = 0;
+    uint64_t imageCount = 0;        // counts the resets, readbacks of earlier images are dropped
+    std::vector<Slot> slots;
+    int64_t unconverged = -1;
+    int64_t unconvergedFrame = -1;
+};
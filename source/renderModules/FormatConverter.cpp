@@ -1,5 +1,5 @@
 #include <renderModules/FormatConverter.hpp>
-#include <vsgXchange/glsl.h>
+#include <renderModules/ShaderPermutations.hpp>
 
 FormatConverter::FormatConverter(vsg::ref_ptr<vsg::ImageView> srcImage, VkFormat dstFormat, int workWidth, int workHeight):
     width(srcImage->image->extent.width),
@@ -16,17 +16,11 @@ FormatConverter::FormatConverter(vsg::ref_ptr<vsg::ImageView> srcImage, VkFormat
     default:
         throw vsg::Exception{"FormatConverter::Unknown format"};
     }
-    auto options = vsg::Options::create(vsgXchange::glsl::create());
-    auto computeStage = vsg::ShaderStage::read(VK_SHADER_STAGE_COMPUTE_BIT, "main", shaderPath, options);
+    auto computeStage = ShaderPermutations::read(VK_SHADER_STAGE_COMPUTE_BIT, shaderPath, defines);
     computeStage->specializationConstants = vsg::ShaderStage::SpecializationConstants{
         {0, vsg::intValue::create(workWidth)}, 
         {1, vsg::intValue::create(workHeight)}
     };
-    auto compileHints = vsg::ShaderCompileSettings::create();
-    compileHints->vulkanVersion = VK_API_VERSION_1_2;
-    compileHints->target = vsg::ShaderCompileSettings::SPIRV_1_4;
-    compileHints->defines = defines;
-    computeStage->module->hints = compileHints;
 
     auto bindingMap = computeStage->getDescriptorSetLayoutBindingsMap();
     auto descriptorSetLayout = vsg::DescriptorSetLayout::create(bindingMap.begin()->second.bindings);
@@ -72,10 +66,12 @@ void FormatConverter::updateImageLayouts(vsg::Context &context)
     context.commands.push_back(pipelineBarrier);
 }
 
-void FormatConverter::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+void FormatConverter::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler)
 {
+    if (profiler) profiler->beginRange(commandGraph, "format converter");
     commandGraph->addChild(bindPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(vsg::Dispatch::create(uint32_t(ceil(float(width) / float(workWidth))), uint32_t(ceil(float(height) / float(workHeight))),
                                                  1));
+    if (profiler) profiler->endRange(commandGraph, "format converter");
 }
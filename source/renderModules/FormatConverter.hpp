@@ -1,4 +1,5 @@
 #pragma once
+#include <renderModules/GpuProfiler.hpp>
 #include <vsg/all.h>
 
 class FormatConverter: public vsg::Inherit<vsg::Object, FormatConverter>
@@ -8,7 +9,7 @@ public:
 
     void compileImages(vsg::Context& context);
     void updateImageLayouts(vsg::Context& context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler = {});
     vsg::ref_ptr<vsg::DescriptorImage> finalImage;
 private:
     std::string shaderPath = "shaders/formatConverter.comp";
@@ -0,0 +1,219 @@
+#include <renderModules/GpuProfiler.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+GpuProfiler::GpuProfiler(uint32_t maxRanges, uint32_t framesInFlight, uint32_t historySize) :
+    maxRanges(maxRanges),
+    framesInFlight(std::max(framesInFlight, 2u)),
+    historySize(std::max(historySize, 1u)),
+    slots(this->framesInFlight),
+    results(maxRanges * 2)
+{
+    queryPool = vsg::QueryPool::create();
+    queryPool->queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPool->queryCount = this->framesInFlight * maxRanges * 2;
+}
+
+void GpuProfiler::addFrameBeginToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+{
+    commandGraph->addChild(ResetCommand::create(vsg::ref_ptr<GpuProfiler>(this)));
+}
+
+void GpuProfiler::beginRange(vsg::ref_ptr<vsg::Commands> commandGraph, const std::string& name, VkPipelineStageFlagBits stage)
+{
+    if (ranges.size() >= maxRanges)
+    {
+        std::cout << "GpuProfiler: more than " << maxRanges << " ranges, range " << name << " is not timed" << std::endl;
+        return;
+    }
+    uint32_t range = static_cast<uint32_t>(ranges.size());
+    ranges.push_back({name});
+    commandGraph->addChild(TimestampCommand::create(vsg::ref_ptr<GpuProfiler>(this), range * 2, stage));
+}
+
+void GpuProfiler::endRange(vsg::ref_ptr<vsg::Commands> commandGraph, const std::string& name, VkPipelineStageFlagBits stage)
+{
+    auto range = std::find_if(ranges.rbegin(), ranges.rend(), [&](const Range& r) { return r.open && r.name == name; });
+    if (range == ranges.rend()) return;
+    range->open = false;
+    uint32_t index = static_cast<uint32_t>(std::distance(range, ranges.rend()) - 1);
+    commandGraph->addChild(TimestampCommand::create(vsg::ref_ptr<GpuProfiler>(this), index * 2 + 1, stage));
+}
+
+void GpuProfiler::compile(vsg::Context& context)
+{
+    if (device) return;
+    device = context.device;
+    auto& limits = device->getPhysicalDevice()->getProperties().limits;
+    supported = limits.timestampComputeAndGraphics == VK_TRUE;
+    timestampPeriod = limits.timestampPeriod;
+    if (!supported)
+        std::cout << "GpuProfiler: timestamps are not supported by the device, no passes are timed" << std::endl;
+    else
+        queryPool->compile(context);
+}
+
+void GpuProfiler::advanceFrame(vsg::Fence* fence)
+{
+    if (!device || !supported || ranges.empty()) return;
+    slots[currentSlot].fence = fence;
+    slots[currentSlot].frame = static_cast<int64_t>(frameCount++);
+
+    // the slots are read back in submission order, a slot that is not finished blocks the later ones
+    for (uint32_t i = 1; i <= framesInFlight; ++i)
+    {
+        uint32_t index = (currentSlot + i) % framesInFlight;
+        auto& slot = slots[index];
+        if (slot.frame < 0) continue;
+        if (slot.fence->status() != VK_SUCCESS) break;
+        readSlot(slot, index, false);
+    }
+
+    // the next slot is reset by the next frame, so its results have to be read back before
+    currentSlot = (currentSlot + 1) % framesInFlight;
+    if (slots[currentSlot].frame >= 0)
+        readSlot(slots[currentSlot], currentSlot, true);
+}
+
+void GpuProfiler::flush()
+{
+    if (!device || !supported) return;
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        uint32_t index = (currentSlot + i) % framesInFlight;
+        if (slots[index].frame >= 0)
+            readSlot(slots[index], index, true);
+    }
+}
+
+void GpuProfiler::readSlot(Slot& slot, uint32_t index, bool wait)
+{
+    // vsg reuses its fences, a reused fence is only signaled after a later frame so waiting on it is still safe.
+    // once the fence is signaled all timestamps of the slot are written, so the results are read without VK_QUERY_RESULT_WAIT_BIT
+    if (wait)
+        slot.fence->wait(std::numeric_limits<uint64_t>::max());
+
+    uint32_t queryCount = static_cast<uint32_t>(ranges.size()) * 2;
+    VkResult result = vkGetQueryPoolResults(*device, *queryPool, firstQuery(index), queryCount, queryCount * sizeof(uint64_t), results.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    int64_t frame = slot.frame;
+    slot.frame = -1;
+    slot.fence = {};
+    if (result != VK_SUCCESS)
+    {
+        std::cout << "GpuProfiler: failed to read timestamps of frame " << frame << std::endl;
+        return;
+    }
+
+    double msPerTick = timestampPeriod * 1e-6;
+    if (recordTimeline && !timelineStarted)
+    {
+        timelineOrigin = results[0];
+        timelineStarted = true;
+    }
+    for (uint32_t r = 0; r < ranges.size(); ++r)
+    {
+        uint64_t begin = results[r * 2], end = results[r * 2 + 1];
+        double duration = end > begin ? (end - begin) * msPerTick : 0.0;
+        auto& history = ranges[r].history;
+        history.push_back(duration);
+        if (history.size() > historySize) history.pop_front();
+        if (recordTimeline)
+            timeline.push_back({r, static_cast<uint64_t>(frame), (static_cast<int64_t>(begin - timelineOrigin)) * msPerTick, duration});
+    }
+}
+
+std::vector<GpuProfiler::Statistics> GpuProfiler::statistics() const
+{
+    std::vector<Statistics> statistics;
+    std::vector<double> sorted;
+    for (const auto& range : ranges)
+    {
+        if (range.history.empty()) continue;
+        sorted.assign(range.history.begin(), range.history.end());
+        std::sort(sorted.begin(), sorted.end());
+        double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+        auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))]; };
+        statistics.push_back({range.name, mean, percentile(0.5), percentile(0.99)});
+    }
+    return statistics;
+}
+
+std::vector<double> GpuProfiler::cpuTimes() const
+{
+    std::vector<double> times;
+    for (const auto& range : ranges)
+        times.push_back(range.cpuMs);
+    return times;
+}
+
+std::vector<std::string> GpuProfiler::getRangeNames() const
+{
+    std::vector<std::string> names;
+    for (const auto& range : ranges)
+        names.push_back(range.name);
+    return names;
+}
+
+bool GpuProfiler::writeChromeTrace(const std::string& filename) const
+{
+    // complete events with microsecond timestamps, every frame is marked with an instant event at its first range
+    nlohmann::json events = nlohmann::json::array();
+    int64_t lastFrame = -1;
+    for (const auto& event : timeline)
+    {
+        if (static_cast<int64_t>(event.frame) != lastFrame)
+        {
+            lastFrame = event.frame;
+            events.push_back({{"name", "frame " + std::to_string(event.frame)}, {"ph", "i"}, {"s", "g"}, {"ts", event.begin * 1000.0}, {"pid", 0}, {"tid", 0}});
+        }
+        events.push_back({{"name", ranges[event.range].name}, {"cat", "gpu"}, {"ph", "X"}, {"ts", event.begin * 1000.0}, {"dur", event.duration * 1000.0},
+                          {"pid", 0}, {"tid", 0}, {"args", {{"frame", event.frame}}}});
+    }
+    nlohmann::json trace = {{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+
+    std::ofstream file(filename);
+    if (!file)
+    {
+        std::cout << "GpuProfiler: unable to open " << filename << std::endl;
+        return false;
+    }
+    file << trace.dump();
+    return file.good();
+}
+
+void GpuProfiler::ResetCommand::compile(vsg::Context& context)
+{
+    profiler->compile(context);
+}
+
+void GpuProfiler::ResetCommand::record(vsg::CommandBuffer& commandBuffer) const
+{
+    for (auto& range : profiler->ranges)
+        range.cpuMs = 0.0;
+    if (!profiler->supported || profiler->ranges.empty()) return;
+    vkCmdResetQueryPool(commandBuffer, *profiler->queryPool, profiler->firstQuery(profiler->currentSlot), static_cast<uint32_t>(profiler->ranges.size()) * 2);
+}
+
+void GpuProfiler::TimestampCommand::compile(vsg::Context& context)
+{
+    profiler->compile(context);
+}
+
+void GpuProfiler::TimestampCommand::record(vsg::CommandBuffer& commandBuffer) const
+{
+    // even queries begin a range, odd queries end it
+    auto& range = profiler->ranges[query / 2];
+    auto now = std::chrono::steady_clock::now();
+    if (query % 2 == 0)
+        range.cpuBegin = now;
+    else
+        range.cpuMs += std::chrono::duration<double, std::milli>(now - range.cpuBegin).count();
+    if (!profiler->supported) return;
+    vkCmdWriteTimestamp(commandBuffer, stage, *profiler->queryPool, profiler->firstQuery(profiler->currentSlot) + query);
+}
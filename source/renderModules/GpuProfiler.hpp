@@ -0,0 +1,110 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// gpu timings of named ranges in the command graph
+// every range writes a timestamp before and after its commands. the queries of a frame live in one slot of a ring of
+// framesInFlight slots, the slot of a frame is read back without waiting once the fence of its submission is signaled,
+// so the results of a frame are available a few frames later. the cpu time spent recording the commands of a range is
+// measured as well and is available right after the frame was recorded
+class GpuProfiler : public vsg::Inherit<vsg::Object, GpuProfiler>
+{
+public:
+    struct Statistics
+    {
+        std::string name;
+        double mean, p50, p99;  // milliseconds
+    };
+
+    GpuProfiler(uint32_t maxRanges = 32, uint32_t framesInFlight = 4, uint32_t historySize = 256);
+
+    // resets the queries of the current slot, has to be added before the first range
+    void addFrameBeginToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    // stage is the stage the timestamp waits for, every begun range has to be ended in the same frame.
+    // the begin timestamp defaults to the top of the pipe, so it does not wait for a stage the commands of the range might not use
+    void beginRange(vsg::ref_ptr<vsg::Commands> commandGraph, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void endRange(vsg::ref_ptr<vsg::Commands> commandGraph, const std::string& name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // has to be called after the frame was submitted, fence is the fence of that submission.
+    // reads back all finished frames and moves on to the next slot
+    void advanceFrame(vsg::Fence* fence);
+    // waits for all submitted frames and reads them back
+    void flush();
+
+    // cpu milliseconds spent recording the commands of every range in the last recorded frame, in range order
+    std::vector<double> cpuTimes() const;
+    // rolling statistics over the last historySize frames in range order
+    std::vector<Statistics> statistics() const;
+    // keeps the ranges of every frame for writeChromeTrace
+    bool recordTimeline = false;
+    // writes the recorded timeline in the chrome trace event format (chrome://tracing, perfetto)
+    bool writeChromeTrace(const std::string& filename) const;
+
+    struct TimelineEvent
+    {
+        uint32_t range;
+        uint64_t frame;             // submission index, counted by advanceFrame
+        double begin, duration;     // milliseconds
+    };
+    const std::vector<TimelineEvent>& getTimeline() const { return timeline; }
+    std::vector<std::string> getRangeNames() const;
+    // number of frames passed to advanceFrame that contain timestamps
+    uint64_t submittedFrames() const { return frameCount; }
+
+    // timestamp commands that use the slot of the frame that is recorded
+    class ResetCommand : public vsg::Inherit<vsg::Command, ResetCommand>
+    {
+    public:
+        explicit ResetCommand(vsg::ref_ptr<GpuProfiler> profiler) : profiler(profiler) {}
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+        vsg::ref_ptr<GpuProfiler> profiler;
+    };
+    class TimestampCommand : public vsg::Inherit<vsg::Command, TimestampCommand>
+    {
+    public:
+        TimestampCommand(vsg::ref_ptr<GpuProfiler> profiler, uint32_t query, VkPipelineStageFlagBits stage) : profiler(profiler), query(query), stage(stage) {}
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+        vsg::ref_ptr<GpuProfiler> profiler;
+        uint32_t query;
+        VkPipelineStageFlagBits stage;
+    };
+
+private:
+    struct Range
+    {
+        std::string name;
+        bool open = true;
+        std::deque<double> history;
+        std::chrono::steady_clock::time_point cpuBegin;
+        double cpuMs = 0.0;
+    };
+    struct Slot
+    {
+        vsg::ref_ptr<vsg::Fence> fence;
+        int64_t frame = -1;     // -1 when nothing is pending
+    };
+    void compile(vsg::Context& context);
+    void readSlot(Slot& slot, uint32_t index, bool wait);
+    uint32_t firstQuery(uint32_t slot) const { return slot * maxRanges * 2; }
+
+    uint32_t maxRanges, framesInFlight, historySize;
+    std::vector<Range> ranges;
+    vsg::ref_ptr<vsg::QueryPool> queryPool;
+    vsg::ref_ptr<vsg::Device> device;
+    double timestampPeriod = 1.0;   // nanoseconds per tick
+    bool supported = true;
+
+    uint32_t currentSlot = 0;
+    uint64_t frameCount = 0;
+    std::vector<Slot> slots;
+    std::vector<uint64_t> results;
+    uint64_t timelineOrigin = 0;
+    bool timelineStarted = false;
+    std::vector<TimelineEvent> timeline;
+};
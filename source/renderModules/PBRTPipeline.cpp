@@ -1,4 +1,5 @@
 #include <renderModules/PBRTPipeline.hpp>
+#include <renderModules/ShaderPermutations.hpp>
 
 #include <cassert>
 
@@ -32,9 +33,15 @@ PBRTPipeline::PBRTPipeline(vsg::ref_ptr<GBuffer> gBuffer,
 }
 
 PBRTPipeline::PBRTPipeline(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<GBuffer> gBuffer,
-    vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin) :
+    vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin,
+    vsg::ref_ptr<RayCounters> rayCounters, vsg::ref_ptr<EnvironmentMap> environmentMap,
+    vsg::ref_ptr<SobolSampler> sampler, vsg::ref_ptr<AdaptiveSampler> adaptiveSampler) :
     PBRTPipeline(gBuffer, illuminationBuffer)
 {
+    this->rayCounters = rayCounters;
+    this->environmentMap = environmentMap;
+    this->sampler = sampler;
+    this->adaptiveSampler = adaptiveSampler;
     if (writeGBuffer) assert(gBuffer);
     bool useExternalGBuffer = rayTracingRayOrigin == RayTracingRayOrigin::GBUFFER;
     setupPipeline(scene, useExternalGBuffer);
@@ -62,10 +69,12 @@ void PBRTPipeline::updateImageLayouts(vsg::Context &context)
 {
     illuminationBuffer->updateImageLayouts(context);
 }
-void PBRTPipeline::addTraceRaysToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants)
+void PBRTPipeline::addTraceRaysToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler)
 {
     auto pipelineBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
         VK_DEPENDENCY_DEVICE_GROUP_BIT);
+    if (rayCounters) rayCounters->addResetToCommandGraph(commandGraph);
+    if (profiler) profiler->beginRange(commandGraph, "trace rays");
     commandGraph->addChild(bindRayTracingPipeline);
     commandGraph->addChild(bindRayTracingDescriptorSet);
     commandGraph->addChild(pushConstants);
@@ -75,6 +84,8 @@ void PBRTPipeline::addTraceRaysToCommandGraph(vsg::ref_ptr<vsg::Commands> comman
     traceRays->height = height;
     traceRays->depth = 1;
     commandGraph->addChild(traceRays);
+    if (profiler) profiler->endRange(commandGraph, "trace rays", VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+    if (rayCounters) rayCounters->addCopyToCommandGraph(commandGraph);
     commandGraph->addChild(pipelineBarrier);
 }
 vsg::ref_ptr<IlluminationBuffer> PBRTPipeline::getIlluminationBuffer() const
@@ -88,11 +99,12 @@ void PBRTPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     scene->accept(buildDescriptorBinding);
     opaqueGeometries = buildDescriptorBinding.isOpaque;
 
+    // looping over all lights per shading point gets too expensive for many lights, the light bvh picks one in O(log n)
     const int maxLights = 800;
-    if(buildDescriptorBinding.packedLights.size() > maxLights) lightSamplingMethod = LightSamplingMethod::SampleUniform;
+    if(buildDescriptorBinding.packedLights.size() > maxLights) lightSamplingMethod = LightSamplingMethod::SampleLightBVH;
 
     //creating the shader stages and shader binding table
-    std::string raygenPath = "shaders/ptRaygen.rgen"; //raygen shader not yet precompiled
+    std::string raygenPath = "shaders/ptRaygen.rgen"; //precompiled per define set, see ShaderPermutations
     std::string raymissPath = "shaders/ptMiss.rmiss.spv";
     std::string shadowMissPath = "shaders/shadow.rmiss.spv";
     std::string closesthitPath = "shaders/ptClosesthit.rchit.spv";
@@ -102,7 +114,7 @@ void PBRTPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     auto raymissShader = vsg::ShaderStage::read(VK_SHADER_STAGE_MISS_BIT_KHR, "main", raymissPath);
     auto shadowMissShader = vsg::ShaderStage::read(VK_SHADER_STAGE_MISS_BIT_KHR, "main", shadowMissPath);
     auto closesthitShader = vsg::ShaderStage::read(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, "main", closesthitPath);
-    auto anyHitShader = vsg::ShaderStage::read(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, "main", anyHitPath);
+    auto anyHitShader = setupAnyHitShader(anyHitPath);
     if (!raygenShader || !raymissShader || !closesthitShader || !shadowMissShader || !anyHitShader)
     {
         throw vsg::Exception{"Error: PBRTPipeline::PBRTPipeline(...) failed to create shader stages."};
@@ -160,6 +172,24 @@ void PBRTPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     illuminationBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
     if (gBuffer)
         gBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (rayCounters)
+        rayCounters->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (environmentMap)
+        environmentMap->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (sampler)
+        sampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (adaptiveSampler)
+        adaptiveSampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightBVH)
+    {
+        lightTree = LightBVH::create(buildDescriptorBinding.packedLights);
+        lightTree->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightStrength)
+    {
+        lightAliasTable = LightAliasTable::create(buildDescriptorBinding.packedLights);
+        lightAliasTable->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
 }
 vsg::ref_ptr<vsg::ShaderStage> PBRTPipeline::setupRaygenShader(std::string raygenPath, bool useExternalGBuffer)
 {
@@ -192,6 +222,19 @@ vsg::ref_ptr<vsg::ShaderStage> PBRTPipeline::setupRaygenShader(std::string rayge
     if (gBuffer)
         defines.push_back("GBUFFER");
 
+    if (rayCounters)
+        defines.push_back("RAY_COUNTERS");
+    if (environmentMap)
+        defines.push_back("ENVIRONMENT_MAP");
+    if (sampler)
+        defines.push_back("SAMPLER_SOBOL");
+    if (adaptiveSampler)
+    {
+        if (!illuminationBuffer.cast<IlluminationBufferFinalFloat>())
+            throw vsg::Exception{"Error: PBRTPipeline::setupRaygenShader(...) adaptive sampling needs the final image illumination buffer."};
+        defines.push_back("ADAPTIVE_SAMPLING");
+    }
+
     switch(lightSamplingMethod){
         case LightSamplingMethod::SampleSurfaceStrength:
             defines.push_back("LIGHT_SAMPLE_SURFACE_STRENGTH");
@@ -199,19 +242,28 @@ vsg::ref_ptr<vsg::ShaderStage> PBRTPipeline::setupRaygenShader(std::string rayge
         case LightSamplingMethod::SampleLightStrength:
             defines.push_back("LIGHT_SAMPLE_LIGHT_STRENGTH");
             break;
+        case LightSamplingMethod::SampleLightBVH:
+            defines.push_back("LIGHT_SAMPLE_BVH");
+            break;
         default:
             break;
     }
 
-    auto options = vsg::Options::create(vsgXchange::glsl::create());
-    auto raygenShader = vsg::ShaderStage::read(VK_SHADER_STAGE_RAYGEN_BIT_KHR, "main", raygenPath, options);
+    auto raygenShader = ShaderPermutations::read(VK_SHADER_STAGE_RAYGEN_BIT_KHR, raygenPath, defines);
     if(!raygenShader)
         throw vsg::Exception{"Error: PBRTPipeline::setupRaygenShader() Could not load ray generation shader."};
-    auto compileHints = vsg::ShaderCompileSettings::create();
-    compileHints->vulkanVersion = VK_API_VERSION_1_2;
-    compileHints->target = vsg::ShaderCompileSettings::SPIRV_1_4;
-    compileHints->defines = defines;
-    raygenShader->module->hints = compileHints;
 
     return raygenShader;
 }
+vsg::ref_ptr<vsg::ShaderStage> PBRTPipeline::setupAnyHitShader(std::string anyHitPath)
+{
+    if (!rayCounters)
+        return vsg::ShaderStage::read(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, "main", anyHitPath);
+
+    anyHitPath = "shaders/ptAlphaHit.rahit";
+    auto anyHitShader = ShaderPermutations::read(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, anyHitPath, {"RAY_COUNTERS"});
+    if(!anyHitShader)
+        throw vsg::Exception{"Error: PBRTPipeline::setupAnyHitShader() Could not load any hit shader."};
+
+    return anyHitShader;
+}
\ No newline at end of file
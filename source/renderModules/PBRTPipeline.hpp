@@ -3,7 +3,14 @@
 #include <buffers/GBuffer.hpp>
 #include <buffers/IlluminationBuffer.hpp>
 #include <scene/RayTracingVisitor.hpp>
+#include <scene/LightAliasTable.hpp>
+#include <scene/LightBVH.hpp>
+#include <scene/EnvironmentMap.hpp>
 #include <buffers/AccumulationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
+#include <renderModules/RayCounters.hpp>
+#include <renderModules/SobolSampler.hpp>
+#include <renderModules/AdaptiveSampler.hpp>
 
 #include <vsg/all.h>
 #include <vsgXchange/glsl.h>
@@ -21,21 +28,26 @@ class PBRTPipeline : public vsg::Inherit<vsg::Object, PBRTPipeline>
 public:
     PBRTPipeline(vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuminationBuffer);
     PBRTPipeline(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<GBuffer> gBuffer,
-                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin);
+                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin,
+                 vsg::ref_ptr<RayCounters> rayCounters = {}, vsg::ref_ptr<EnvironmentMap> environmentMap = {},
+                 vsg::ref_ptr<SobolSampler> sampler = {}, vsg::ref_ptr<AdaptiveSampler> adaptiveSampler = {});
 
     void setTlas(vsg::ref_ptr<vsg::AccelerationStructure> as);
     void compile(vsg::Context& context);
     void updateImageLayouts(vsg::Context& context);
-    void addTraceRaysToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants);
+    void addTraceRaysToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler = {});
     vsg::ref_ptr<IlluminationBuffer> getIlluminationBuffer() const;
     enum class LightSamplingMethod{
         SampleSurfaceStrength,
         SampleLightStrength,
+        SampleLightBVH,
         SampleUniform
     }lightSamplingMethod = LightSamplingMethod::SampleSurfaceStrength;
 protected:
     void setupPipeline(vsg::Node* scene, bool useExternalGBuffer);
     vsg::ref_ptr<vsg::ShaderStage> setupRaygenShader(std::string raygenPath, bool useExternalGBuffer);
+    // the precompiled any hit shader is only replaced by an instrumented build when rays are counted
+    vsg::ref_ptr<vsg::ShaderStage> setupAnyHitShader(std::string anyHitPath);
 
     std::vector<bool> opaqueGeometries;
     uint32_t width, height, maxRecursionDepth, samplePerPixel;
@@ -43,6 +55,17 @@ protected:
     // TODO: add buffers here
     vsg::ref_ptr<GBuffer> gBuffer;
     vsg::ref_ptr<IlluminationBuffer> illuminationBuffer;
+    // null if the shaders are not instrumented
+    vsg::ref_ptr<RayCounters> rayCounters;
+    // only built for LightSamplingMethod::SampleLightBVH and SampleLightStrength
+    vsg::ref_ptr<LightBVH> lightTree;
+    vsg::ref_ptr<LightAliasTable> lightAliasTable;
+    // lights the scene instead of the sky color if set
+    vsg::ref_ptr<EnvironmentMap> environmentMap;
+    // draws low discrepancy samples instead of white noise if set
+    vsg::ref_ptr<SobolSampler> sampler;
+    // skips the pixels of converged tiles if set
+    vsg::ref_ptr<AdaptiveSampler> adaptiveSampler;
 
     //resources which have to be added as childs to a scenegraph for rendering
     vsg::ref_ptr<vsg::BindRayTracingPipeline> bindRayTracingPipeline;
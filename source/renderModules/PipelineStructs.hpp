@@ -9,4 +9,5 @@ struct RayTracingPushConstants{
     vsg::mat4 prevView;
     uint32_t frameNumber;
     uint32_t sampleNumber;
+    uint32_t sequenceNumber;    // frame number of the first accumulated sample, seeds the random numbers of the path tracer
 };
\ No newline at end of file
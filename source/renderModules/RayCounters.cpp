@@ -0,0 +1,163 @@
+#include <renderModules/RayCounters.hpp>
+#include <vsgXchange/images.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+RayCounters::RayCounters(uint32_t width, uint32_t height, bool recordPathLengths, uint32_t framesInFlight) :
+    width(width),
+    height(height),
+    recordPathLengths(recordPathLengths),
+    slots(std::max(framesInFlight, 2u))
+{
+    VkDeviceSize size = headerSize + sizeof(uint32_t) * width * height;
+    // without path lengths only the counts are copied, the shaders still write the path lengths
+    copySize = recordPathLengths ? size : headerSize;
+    counterBuffer = vsg::Buffer::create(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_SHARING_MODE_EXCLUSIVE);
+    auto bufferInfo = vsg::BufferInfo::create(counterBuffer, 0, size);
+    descriptor = vsg::DescriptorBuffer::create(vsg::BufferInfoList{bufferInfo}, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+void RayCounters::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    descriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "RayCounters").second;
+    descSet->descriptorSet->descriptors.push_back(descriptor);
+}
+
+void RayCounters::addResetToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+{
+    commandGraph->addChild(ResetCommand::create(vsg::ref_ptr<RayCounters>(this)));
+}
+
+void RayCounters::addCopyToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+{
+    commandGraph->addChild(CopyCommand::create(vsg::ref_ptr<RayCounters>(this)));
+}
+
+void RayCounters::compile(vsg::Context& context)
+{
+    if (device) return;
+    device = context.device;
+    auto deviceID = device->deviceID;
+    // the descriptor binds host visible memory if it is compiled first, otherwise the counters live in device local memory
+    counterBuffer->compile(device);
+    if (!counterBuffer->getDeviceMemory(deviceID))
+    {
+        auto memory = vsg::DeviceMemory::create(device, counterBuffer->getMemoryRequirements(deviceID), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        counterBuffer->bind(memory, 0);
+    }
+    for (auto& slot : slots)
+        slot.staging = vsg::createBufferAndMemory(device, copySize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void RayCounters::advanceFrame(vsg::Fence* fence)
+{
+    if (!device) return;
+    slots[currentSlot].fence = fence;
+    slots[currentSlot].frame = static_cast<int64_t>(frameCount++);
+
+    // the slots are read back in submission order, a slot that is not finished blocks the later ones
+    for (uint32_t i = 1; i <= slots.size(); ++i)
+    {
+        auto& slot = slots[(currentSlot + i) % slots.size()];
+        if (slot.frame < 0) continue;
+        if (slot.fence->status() != VK_SUCCESS) break;
+        readSlot(slot, false);
+    }
+
+    // the next frame copies into the next slot, so its counters have to be read back before
+    currentSlot = (currentSlot + 1) % slots.size();
+    if (slots[currentSlot].frame >= 0)
+        readSlot(slots[currentSlot], true);
+}
+
+void RayCounters::flush()
+{
+    if (!device) return;
+    for (uint32_t i = 0; i < slots.size(); ++i)
+    {
+        auto& slot = slots[(currentSlot + i) % slots.size()];
+        if (slot.frame >= 0)
+            readSlot(slot, true);
+    }
+}
+
+void RayCounters::readSlot(Slot& slot, bool wait)
+{
+    // vsg reuses its fences, a reused fence is only signaled after a later frame so waiting on it is still safe
+    if (wait)
+        slot.fence->wait(std::numeric_limits<uint64_t>::max());
+
+    auto deviceID = device->deviceID;
+    auto memory = slot.staging->getDeviceMemory(deviceID);
+    int64_t frame = slot.frame;
+    slot.frame = -1;
+    slot.fence = {};
+    void* mapped;
+    if (memory->map(slot.staging->getMemoryOffset(deviceID), copySize, 0, &mapped) != VK_SUCCESS)
+    {
+        std::cout << "RayCounters: failed to read the counters of frame " << frame << std::endl;
+        return;
+    }
+    std::memcpy(&counts, mapped, headerSize);
+    if (recordPathLengths)
+    {
+        pathLengths.resize(size_t(width) * height);
+        std::memcpy(pathLengths.data(), static_cast<const uint8_t*>(mapped) + headerSize, pathLengths.size() * sizeof(uint32_t));
+    }
+    memory->unmap();
+    countsFrame = frame;
+}
+
+bool RayCounters::writePathLengths(const std::string& filename) const
+{
+    if (pathLengths.empty())
+    {
+        std::cout << "RayCounters: no path lengths were read back, " << filename << " is not written" << std::endl;
+        return false;
+    }
+    auto image = vsg::floatArray2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+    std::transform(pathLengths.begin(), pathLengths.end(), image->data(), [](uint32_t length) { return static_cast<float>(length); });
+    auto options = vsg::Options::create(vsgXchange::openexr::create());
+    if (!vsg::write(image, filename, options))
+    {
+        std::cout << "RayCounters: unable to write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RayCounters::ResetCommand::compile(vsg::Context& context)
+{
+    counters->compile(context);
+}
+
+void RayCounters::ResetCommand::record(vsg::CommandBuffer& commandBuffer) const
+{
+    // the previous frame may still read the counters in its copy
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                            VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+    vkCmdFillBuffer(commandBuffer, counters->counterBuffer->vk(commandBuffer.deviceID), 0, counters->headerSize, 0);
+    barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void RayCounters::CopyCommand::compile(vsg::Context& context)
+{
+    counters->compile(context);
+}
+
+void RayCounters::CopyCommand::record(vsg::CommandBuffer& commandBuffer) const
+{
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    VkBufferCopy region{0, 0, counters->copySize};
+    auto deviceID = commandBuffer.deviceID;
+    vkCmdCopyBuffer(commandBuffer, counters->counterBuffer->vk(deviceID), counters->slots[counters->currentSlot].staging->vk(deviceID), 1, &region);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// counts the rays that are actually traced by the path tracer
+// a pipeline that gets RayCounters compiles its ray tracing shaders with RAY_COUNTERS, the shaders then count primary, bounce
+// and shadow rays and any hit invocations with one atomic per subgroup and store the traced path length of every pixel.
+// like the GpuProfiler timestamps the counters of a frame are copied into one staging buffer of a ring of framesInFlight
+// buffers, which is read back without waiting once the fence of its submission is signaled
+class RayCounters : public vsg::Inherit<vsg::Object, RayCounters>
+{
+public:
+    struct Counts
+    {
+        uint32_t primary = 0, bounce = 0, shadow = 0, anyHit = 0;
+        uint64_t rays() const { return uint64_t(primary) + bounce + shadow; }
+    };
+
+    // with recordPathLengths the per pixel path lengths are read back as well, see writePathLengths()
+    RayCounters(uint32_t width, uint32_t height, bool recordPathLengths = false, uint32_t framesInFlight = 4);
+
+    // adds the counter buffer to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+    // clears the counters before and copies them to the current slot after the trace rays command
+    void addResetToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    void addCopyToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    // has to be called after the frame was submitted, fence is the fence of that submission.
+    // reads back all finished frames and moves on to the next slot
+    void advanceFrame(vsg::Fence* fence);
+    // waits for all submitted frames and reads them back
+    void flush();
+
+    // counts of the last frame that was read back, frame is -1 before the first readback
+    const Counts& latest() const { return counts; }
+    int64_t latestFrame() const { return countsFrame; }
+    // writes the path lengths (primary and bounce rays) of the last read back frame as single channel exr
+    bool writePathLengths(const std::string& filename) const;
+
+    class ResetCommand : public vsg::Inherit<vsg::Command, ResetCommand>
+    {
+    public:
+        explicit ResetCommand(vsg::ref_ptr<RayCounters> counters) : counters(counters) {}
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+        vsg::ref_ptr<RayCounters> counters;
+    };
+    class CopyCommand : public vsg::Inherit<vsg::Command, CopyCommand>
+    {
+    public:
+        explicit CopyCommand(vsg::ref_ptr<RayCounters> counters) : counters(counters) {}
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+        vsg::ref_ptr<RayCounters> counters;
+    };
+
+private:
+    struct Slot
+    {
+        vsg::ref_ptr<vsg::Buffer> staging;
+        vsg::ref_ptr<vsg::Fence> fence;
+        int64_t frame = -1;     // -1 when nothing is pending
+    };
+    void compile(vsg::Context& context);
+    void readSlot(Slot& slot, bool wait);
+
+    // header of the RayCounters buffer in layoutPTCounters.glsl, the path lengths follow
+    static constexpr VkDeviceSize headerSize = sizeof(uint32_t) * 4;
+
+    uint32_t width, height;
+    bool recordPathLengths;
+    VkDeviceSize copySize;
+    vsg::ref_ptr<vsg::Buffer> counterBuffer;
+    vsg::ref_ptr<vsg::DescriptorBuffer> descriptor;
+    vsg::ref_ptr<vsg::Device> device;
+
+    uint32_t currentSlot = 0;
+    uint64_t frameCount = 0;
+    std::vector<Slot> slots;
+    Counts counts;
+    int64_t countsFrame = -1;
+    std::vector<uint32_t> pathLengths;
+};
@@ -0,0 +1,40 @@
+#include <renderModules/ShaderPermutations.hpp>
+#include <vsgXchange/glsl.h>
+
+#include <algorithm>
+#include <iostream>
+
+std::string ShaderPermutations::permutationPath(const std::string& sourcePath, const std::vector<std::string>& defines)
+{
+    std::vector<std::string> names;
+    for (auto define : defines)
+    {
+        std::replace(define.begin(), define.end(), ' ', '=');
+        names.push_back(define);
+    }
+    std::sort(names.begin(), names.end());
+    std::string path = sourcePath;
+    for (const auto& name : names)
+        path += "." + name;
+    return path + ".spv";
+}
+
+vsg::ref_ptr<vsg::ShaderStage> ShaderPermutations::read(VkShaderStageFlagBits stage, const std::string& sourcePath, const std::vector<std::string>& defines)
+{
+    auto spirvPath = permutationPath(sourcePath, defines);
+    if (vsg::fileExists(spirvPath))
+        return vsg::ShaderStage::read(stage, "main", spirvPath);
+
+    // a define set that is not listed in CMakeLists.txt is compiled with glslang, which takes noticeably longer
+    std::cout << "Shader permutation " << spirvPath << " is not precompiled, compiling " << sourcePath << " at runtime" << std::endl;
+    auto options = vsg::Options::create(vsgXchange::glsl::create());
+    auto shaderStage = vsg::ShaderStage::read(stage, "main", sourcePath, options);
+    if (!shaderStage)
+        return {};
+    auto compileHints = vsg::ShaderCompileSettings::create();
+    compileHints->vulkanVersion = VK_API_VERSION_1_2;
+    compileHints->target = vsg::ShaderCompileSettings::SPIRV_1_4;
+    compileHints->defines = defines;
+    shaderStage->module->hints = compileHints;
+    return shaderStage;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <string>
+#include <vector>
+
+// shaders that are compiled with defines are precompiled for every define set in CMakeLists.txt (add_shader_permutation)
+// read() loads the precompiled permutation and only compiles the glsl source at runtime if the permutation is missing
+class ShaderPermutations
+{
+public:
+    // defines are given as "NAME" or "NAME VALUE" in any order
+    static vsg::ref_ptr<vsg::ShaderStage> read(VkShaderStageFlagBits stage, const std::string& sourcePath, const std::vector<std::string>& defines);
+    // <sourcePath>.<DEFINE>...<DEFINE>.spv with the defines sorted and "NAME VALUE" written as NAME=VALUE, has to match CMakeLists.txt
+    static std::string permutationPath(const std::string& sourcePath, const std::vector<std::string>& defines);
+};
@@ -0,0 +1,106 @@
+#include <renderModules/SobolSampler.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    // primitive polynomial (degree and inner coefficients) and initial direction numbers of the dimensions 2 to 16 of
+    // new-joe-kuo-6.21201 (Joe and Kuo 2008), the first dimension is the van der Corput sequence
+    struct DirectionNumbers
+    {
+        uint32_t degree, coefficients;
+        uint32_t m[6];
+    };
+    constexpr DirectionNumbers joeKuo[SobolSampler::maxDimensions - 1] = {
+        {1, 0, {1}},
+        {2, 1, {1, 3}},
+        {3, 1, {1, 3, 1}},
+        {3, 2, {1, 1, 1}},
+        {4, 1, {1, 1, 3, 3}},
+        {4, 4, {1, 3, 5, 13}},
+        {5, 2, {1, 1, 5, 5, 17}},
+        {5, 4, {1, 1, 5, 5, 5}},
+        {5, 7, {1, 1, 7, 11, 19}},
+        {5, 11, {1, 1, 5, 1, 1}},
+        {5, 13, {1, 1, 1, 3, 11}},
+        {5, 14, {1, 3, 5, 5, 31}},
+        {6, 1, {1, 3, 3, 9, 7, 49}},
+        {6, 13, {1, 1, 1, 15, 21, 21}},
+        {6, 16, {1, 3, 1, 13, 27, 49}},
+    };
+
+    uint32_t reverseBits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+}
+
+SobolSampler::SobolSampler(uint32_t dimensionCount) :
+    dimensionCount(dimensionCount),
+    matrices(size_t(dimensionCount) * 32)
+{
+    if (dimensionCount == 0 || dimensionCount > maxDimensions)
+        throw vsg::Exception{"Error: SobolSampler::SobolSampler(...) dimensionCount has to be in [1, 16]."};
+
+    for (uint32_t i = 0; i < 32; ++i)
+        matrices[i] = 1u << (31 - i);
+    for (uint32_t d = 1; d < dimensionCount; ++d)
+    {
+        const auto& numbers = joeKuo[d - 1];
+        uint32_t s = numbers.degree;
+        uint32_t* v = matrices.data() + size_t(d) * 32;
+        for (uint32_t i = 0; i < std::min(s, 32u); ++i)
+            v[i] = numbers.m[i] << (31 - i);
+        // recurrence of the direction numbers defined by the primitive polynomial
+        for (uint32_t i = s; i < 32; ++i)
+        {
+            v[i] = v[i - s] ^ (v[i - s] >> s);
+            for (uint32_t k = 1; k < s; ++k)
+                v[i] ^= ((numbers.coefficients >> (s - 1 - k)) & 1) * v[i - k];
+        }
+    }
+}
+
+void SobolSampler::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    if (!descriptor)
+    {
+        auto buffer = vsg::uintArray::create(static_cast<uint32_t>(matrices.size()));
+        std::copy(matrices.begin(), matrices.end(), buffer->data());
+        descriptor = vsg::DescriptorBuffer::create(buffer, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+    descriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "SobolMatrices").second;
+    descSet->descriptorSet->descriptors.push_back(descriptor);
+}
+
+uint32_t SobolSampler::sample(uint32_t index, uint32_t dimension) const
+{
+    const uint32_t* v = matrices.data() + size_t(dimension) * 32;
+    uint32_t x = 0;
+    for (; index; index >>= 1, ++v)
+        if (index & 1)
+            x ^= *v;
+    return x;
+}
+
+float SobolSampler::sample(uint32_t index, uint32_t dimension, uint32_t seed) const
+{
+    // 24 bits, so the point does not round up to 1
+    return static_cast<float>(scramble(sample(index, dimension), seed) >> 8) * (1.0f / 16777216.0f);
+}
+
+uint32_t SobolSampler::scramble(uint32_t x, uint32_t seed)
+{
+    // the Laine-Karras permutation only propagates bits upwards, reversed it flips every bit depending on the more significant bits
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
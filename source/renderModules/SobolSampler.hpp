@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <vector>
+
+// direction matrices of the Sobol sequence drawn by the path tracer when it is compiled with SAMPLER_SOBOL, see random.glsl.
+// the shaders use Owen scrambled Sobol points as in Burley 2020, "Practical Hash-based Owen Scrambling": every pixel shuffles
+// the sample index and scrambles each dimension with its own seed. every bounce starts a new group of dimensions, dimensions
+// beyond getDimensionCount() are padded with further groups whose sample indices are shuffled independently
+class SobolSampler : public vsg::Inherit<vsg::Object, SobolSampler>
+{
+public:
+    static constexpr uint32_t maxDimensions = 16;
+
+    explicit SobolSampler(uint32_t dimensionCount = maxDimensions);
+
+    // adds the direction matrices to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+
+    // cpu reference of the shaders, the unscrambled point as 0.32 fixed point number
+    uint32_t sample(uint32_t index, uint32_t dimension) const;
+    // the point scrambled with seed, in [0, 1)
+    float sample(uint32_t index, uint32_t dimension, uint32_t seed) const;
+    // nested uniform scramble of the bits of x, also used to shuffle the sample indices
+    static uint32_t scramble(uint32_t x, uint32_t seed);
+
+    uint32_t getDimensionCount() const { return dimensionCount; }
+    // 32 direction numbers per dimension, bit 31 is the most significant bit of the point
+    const std::vector<uint32_t>& getMatrices() const { return matrices; }
+
+private:
+    uint32_t dimensionCount;
+    std::vector<uint32_t> matrices;
+    vsg::ref_ptr<vsg::DescriptorBuffer> descriptor;
+};
@@ -102,13 +102,15 @@ void Taa::updateImageLayouts(vsg::Context& context)
         accumulationLayout, finalLayout);
     context.commands.push_back(pipelineBarrier);
 }
-void Taa::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+void Taa::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler)
 {
+    if (profiler) profiler->beginRange(commandGraph, "taa");
     commandGraph->addChild(bindPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(vsg::Dispatch::create(uint32_t(ceil(float(width) / float(workWidth))), uint32_t(ceil(float(height) / float(workHeight))),
                                                  1));
     copyFinalImage(commandGraph, accumulationImage->imageInfoList[0]->imageView->image);
+    if (profiler) profiler->endRange(commandGraph, "taa", VK_PIPELINE_STAGE_TRANSFER_BIT);
 }
 void Taa::copyFinalImage(vsg::ref_ptr<vsg::Commands> commands, vsg::ref_ptr<vsg::Image> dstImage)
 {
@@ -1,6 +1,7 @@
 #pragma once
 #include <buffers/GBuffer.hpp>
 #include <buffers/AccumulationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
 
 #include <vsg/all.h>
 
@@ -16,7 +17,7 @@ public:
 
     void compile(vsg::Context& context);
     void updateImageLayouts(vsg::Context& context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler = {});
     vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const;
 private:
     void copyFinalImage(vsg::ref_ptr<vsg::Commands> commands, vsg::ref_ptr<vsg::Image> dstImage);
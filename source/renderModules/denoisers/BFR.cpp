@@ -119,12 +119,15 @@ void BFR::updateImageLayouts(vsg::Context& context)
                                                         accIlluLayout, finalIluLayout);
     context.commands.push_back(pipelineBarrier);
 }
-void BFR::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants)
+void BFR::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler)
 {
+    std::string rangeName = "bfr" + std::to_string(workWidth);
+    if (profiler) profiler->beginRange(commandGraph, rangeName);
     commandGraph->addChild(bindBfrPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(pushConstants);
     commandGraph->addChild(vsg::Dispatch::create((width / workWidth + 2), (height / workHeight + 2), 1));
+    if (profiler) profiler->endRange(commandGraph, rangeName);
     auto pipelineBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
         VK_DEPENDENCY_BY_REGION_BIT);
     commandGraph->addChild(pipelineBarrier); //barrier to wait for completion of denoising before taa is applied
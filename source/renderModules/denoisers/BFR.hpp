@@ -2,18 +2,20 @@
 #include <buffers/AccumulationBuffer.hpp>
 #include <buffers/GBuffer.hpp>
 #include <buffers/IlluminationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
+#include <renderModules/denoisers/Denoiser.hpp>
 
 #include <vsg/all.h>
 
-class BFR: public vsg::Inherit<vsg::Object, BFR>{
+class BFR: public vsg::Inherit<Denoiser, BFR>{
 public:
     BFR(uint32_t width, uint32_t height, uint32_t workWidth, uint32_t workHeight, vsg::ref_ptr<GBuffer> gBuffer,
         vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<AccumulationBuffer> accBuffer);
 
-    void compile(vsg::Context& context);
-    void updateImageLayouts(vsg::Context& context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants);
-    vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const;
+    void compile(vsg::Context& context) override;
+    void updateImageLayouts(vsg::Context& context) override;
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler = {}) override;
+    vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const override;
 private:
     uint32_t width, height, workWidth, workHeight;
     vsg::ref_ptr<GBuffer> gBuffer;
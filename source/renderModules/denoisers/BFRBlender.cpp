@@ -88,12 +88,14 @@ void BFRBlender::updateImageLayouts(vsg::Context& context)
                                                         finalLayout);
     context.commands.push_back(pipelineBarrier);
 }
-void BFRBlender::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph)
+void BFRBlender::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler)
 {
+    if (profiler) profiler->beginRange(commandGraph, "blender");
     commandGraph->addChild(bindPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(vsg::Dispatch::create(uint32_t(ceil(float(width) / float(workWidth))),
         uint32_t(ceil(float(height) / float(workHeight))), 1));
+    if (profiler) profiler->endRange(commandGraph, "blender");
 }
 void BFRBlender::copyFinalImage(vsg::ref_ptr<vsg::Commands> commands, vsg::ref_ptr<vsg::Image> dstImage)
 {
@@ -1,4 +1,5 @@
 #pragma once
+#include <renderModules/GpuProfiler.hpp>
 #include <vsg/all.h>
 
 #include <cstdint>
@@ -13,7 +14,7 @@ public:
 
     void compile(vsg::Context& context);
     void updateImageLayouts(vsg::Context& context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph);
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<GpuProfiler> profiler = {});
     void copyFinalImage(vsg::ref_ptr<vsg::Commands> commands, vsg::ref_ptr<vsg::Image> dstImage);
     vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const;
 private:
@@ -193,30 +193,37 @@ void BMFR::updateImageLayouts(vsg::Context& context)
                                                         accIlluLayout, finalIluLayout, featureBufferLayout, weightsLayout);
     context.commands.push_back(pipelineBarrier);
 }
-void BMFR::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants)
+void BMFR::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler)
 {
     auto pipelineBarrier = vsg::PipelineBarrier::create(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
         0);
     uint32_t dispatchX = widthPadded / workWidth, dispatchY = heightPadded / workHeight;
+    std::string rangeName = "bmfr" + std::to_string(workWidth);
     // pre pipeline
+    if (profiler) profiler->beginRange(commandGraph, rangeName + " pre");
     commandGraph->addChild(bindPrePipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(pushConstants);
     commandGraph->addChild(vsg::Dispatch::create(dispatchX, dispatchY, 1));
+    if (profiler) profiler->endRange(commandGraph, rangeName + " pre");
     commandGraph->addChild(pipelineBarrier);
 
     // fit pipeline
+    if (profiler) profiler->beginRange(commandGraph, rangeName + " fit");
     commandGraph->addChild(bindFitPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(pushConstants);
     commandGraph->addChild(vsg::Dispatch::create(dispatchX, dispatchY, 1));
+    if (profiler) profiler->endRange(commandGraph, rangeName + " fit");
     commandGraph->addChild(pipelineBarrier);
 
     // post pipeline
+    if (profiler) profiler->beginRange(commandGraph, rangeName + " post");
     commandGraph->addChild(bindPostPipeline);
     commandGraph->addChild(bindDescriptorSet);
     commandGraph->addChild(pushConstants);
     commandGraph->addChild(vsg::Dispatch::create(dispatchX, dispatchY, 1));
+    if (profiler) profiler->endRange(commandGraph, rangeName + " post");
     commandGraph->addChild(pipelineBarrier);
 }
 vsg::ref_ptr<vsg::DescriptorImage> BMFR::getFinalDescriptorImage() const
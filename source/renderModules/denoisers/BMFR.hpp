@@ -2,6 +2,8 @@
 
 #include <renderModules/Taa.hpp>
 #include <buffers/IlluminationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
+#include <renderModules/denoisers/Denoiser.hpp>
 
 #include <vsg/all.h>
 
@@ -10,15 +12,15 @@
 // Further the spacial features used for feature fitting are in screen space to reduce calculation efforts.
 
 
-class BMFR: public vsg::Inherit<vsg::Object, BMFR>{
+class BMFR: public vsg::Inherit<Denoiser, BMFR>{
 public:
     BMFR(uint32_t width, uint32_t height, uint32_t workWidth, uint32_t workHeight, vsg::ref_ptr<GBuffer> gBuffer,
          vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<AccumulationBuffer> accBuffer, uint32_t fittingKernel = 256);
 
-    void compile(vsg::Context& context);
-    void updateImageLayouts(vsg::Context& context);
-    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants);
-    vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const;
+    void compile(vsg::Context& context) override;
+    void updateImageLayouts(vsg::Context& context) override;
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler = {}) override;
+    vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const override;
 private:
     uint32_t depthBinding = 0, normalBinding = 1, materialBinding = 2, albedoBinding = 3, motionBinding = 4, sampleBinding = 5, sampledDenIlluBinding = 6, finalBinding = 7, noisyBinding = 8, denoisedBinding = 9, featureBufferBinding = 10, weightsBinding = 11;
     uint32_t amtOfFeatures = 13;
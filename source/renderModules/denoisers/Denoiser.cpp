@@ -0,0 +1,183 @@
+#include <renderModules/denoisers/Denoiser.hpp>
+#include <renderModules/denoisers/BFR.hpp>
+#include <renderModules/denoisers/BMFR.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+MultiScaleDenoiser::MultiScaleDenoiser(uint32_t width, uint32_t height, vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<Denoiser> denoiser0,
+                                       vsg::ref_ptr<Denoiser> denoiser1, vsg::ref_ptr<Denoiser> denoiser2) :
+    denoisers{denoiser0, denoiser1, denoiser2}
+{
+    // the blender estimates the variance from the accumulated illumination and its square
+    blender = BFRBlender::create(width, height, illuBuffer->illuminationImages[0], illuBuffer->illuminationImages[1],
+                                 denoiser0->getFinalDescriptorImage(), denoiser1->getFinalDescriptorImage(), denoiser2->getFinalDescriptorImage());
+}
+
+void MultiScaleDenoiser::compile(vsg::Context& context)
+{
+    for (auto& denoiser : denoisers)
+        denoiser->compile(context);
+    blender->compile(context);
+}
+
+void MultiScaleDenoiser::updateImageLayouts(vsg::Context& context)
+{
+    for (auto& denoiser : denoisers)
+        denoiser->updateImageLayouts(context);
+    blender->updateImageLayouts(context);
+}
+
+void MultiScaleDenoiser::addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants,
+                                                   vsg::ref_ptr<GpuProfiler> profiler)
+{
+    for (auto& denoiser : denoisers)
+        denoiser->addDispatchToCommandGraph(commandGraph, pushConstants, profiler);
+    blender->addDispatchToCommandGraph(commandGraph, profiler);
+}
+
+vsg::ref_ptr<vsg::DescriptorImage> MultiScaleDenoiser::getFinalDescriptorImage() const
+{
+    return blender->getFinalDescriptorImage();
+}
+
+bool DenoiserSettings::parseBlockSizes(const std::string& list)
+{
+    std::vector<uint32_t> sizes;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        try
+        {
+            size_t end;
+            int size = std::stoi(item, &end);
+            if (end != item.size() || size <= 0)
+                return false;
+            sizes.push_back(static_cast<uint32_t>(size));
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    if (sizes.empty())
+        return false;
+    blockSizes = sizes;
+    return true;
+}
+
+bool DenoiserSettings::validate(const std::string& denoiser, const VkPhysicalDeviceLimits* limits) const
+{
+    for (auto blockSize : blockSizes)
+    {
+        // the subgroup reductions of the shaders need full subgroups of 32 and store at most 32 partial results, the default
+        // bmfr fitting kernel has to divide the block
+        if (blockSize != 8 && blockSize != 16 && blockSize != 32)
+        {
+            std::cout << "Block size " << blockSize << " is not supported, the block size has to be 8, 16 or 32" << std::endl;
+            return false;
+        }
+        if (limits && (blockSize * blockSize > limits->maxComputeWorkGroupInvocations || blockSize > limits->maxComputeWorkGroupSize[0] ||
+                       blockSize > limits->maxComputeWorkGroupSize[1]))
+        {
+            std::cout << "Block size " << blockSize << " exceeds the compute workgroup limits of the device, at most "
+                      << limits->maxComputeWorkGroupInvocations << " invocations and " << limits->maxComputeWorkGroupSize[0] << "x"
+                      << limits->maxComputeWorkGroupSize[1] << " are supported" << std::endl;
+            return false;
+        }
+        if (denoiser != "bmfr")
+            continue;
+
+        // every invocation of the fit fits blockSize * blockSize / fittingKernel pixels and the first ones hold the 13 features
+        uint32_t fittingKernel = bmfrFittingKernel(blockSize);
+        if (fittingKernel % 32 != 0 || fittingKernel > 1024 || (blockSize * blockSize) % fittingKernel != 0)
+        {
+            std::cout << "Fitting kernel " << fittingKernel << " is not supported for block size " << blockSize
+                      << ", it has to be a multiple of 32 that divides " << blockSize * blockSize << std::endl;
+            return false;
+        }
+        if (limits && (fittingKernel > limits->maxComputeWorkGroupInvocations || fittingKernel > limits->maxComputeWorkGroupSize[0]))
+        {
+            std::cout << "Fitting kernel " << fittingKernel << " exceeds the compute workgroup limits of the device, at most "
+                      << std::min(limits->maxComputeWorkGroupInvocations, limits->maxComputeWorkGroupSize[0]) << " are supported" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t DenoiserSettings::bmfrFittingKernel(uint32_t blockSize) const
+{
+    return fittingKernel ? fittingKernel : std::min(256u, blockSize * blockSize);
+}
+
+std::string DenoiserSettings::blockSizesString() const
+{
+    std::string str;
+    for (auto size : blockSizes)
+        str += (str.empty() ? "" : ",") + std::to_string(size);
+    return str;
+}
+
+void DenoiserRegistry::add(const std::string& name, Factory factory)
+{
+    factories()[name] = factory;
+}
+
+bool DenoiserRegistry::contains(const std::string& name)
+{
+    return factories().count(name);
+}
+
+std::vector<std::string> DenoiserRegistry::names()
+{
+    std::vector<std::string> names;
+    for (auto& [name, factory] : factories())
+        names.push_back(name);
+    return names;
+}
+
+vsg::ref_ptr<Denoiser> DenoiserRegistry::create(const std::string& name, const DenoiserSettings& settings, vsg::ref_ptr<GBuffer> gBuffer,
+                                                vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<AccumulationBuffer> accBuffer)
+{
+    auto factory = factories().find(name);
+    if (factory == factories().end())
+    {
+        std::cout << "Unknown denoiser: " << name << std::endl;
+        return {};
+    }
+    if (settings.blockSizes.size() != 1 && settings.blockSizes.size() != 3)
+    {
+        std::cout << "Denoising with " << settings.blockSizes.size() << " block sizes is not supported, use 1 or 3 block sizes to blend" << std::endl;
+        return {};
+    }
+
+    std::vector<vsg::ref_ptr<Denoiser>> denoisers;
+    for (auto blockSize : settings.blockSizes)
+    {
+        auto denoiser = factory->second(settings, blockSize, gBuffer, illuBuffer, accBuffer);
+        if (!denoiser)
+            return {};
+        denoisers.push_back(denoiser);
+    }
+    if (denoisers.size() == 1)
+        return denoisers[0];
+    return MultiScaleDenoiser::create(settings.width, settings.height, illuBuffer, denoisers[0], denoisers[1], denoisers[2]);
+}
+
+std::map<std::string, DenoiserRegistry::Factory>& DenoiserRegistry::factories()
+{
+    // the built in denoisers are registered on first use to not depend on static initialization order
+    static std::map<std::string, Factory> factories{
+        {"bfr", [](const DenoiserSettings& settings, uint32_t blockSize, vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuBuffer,
+                   vsg::ref_ptr<AccumulationBuffer> accBuffer) -> vsg::ref_ptr<Denoiser> {
+             return BFR::create(settings.width, settings.height, blockSize, blockSize, gBuffer, illuBuffer, accBuffer);
+         }},
+        {"bmfr", [](const DenoiserSettings& settings, uint32_t blockSize, vsg::ref_ptr<GBuffer> gBuffer, vsg::ref_ptr<IlluminationBuffer> illuBuffer,
+                    vsg::ref_ptr<AccumulationBuffer> accBuffer) -> vsg::ref_ptr<Denoiser> {
+             return BMFR::create(settings.width, settings.height, blockSize, blockSize, gBuffer, illuBuffer, accBuffer, settings.bmfrFittingKernel(blockSize));
+         }}};
+    return factories;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <buffers/AccumulationBuffer.hpp>
+#include <buffers/GBuffer.hpp>
+#include <buffers/IlluminationBuffer.hpp>
+#include <renderModules/GpuProfiler.hpp>
+#include <renderModules/denoisers/BFRBlender.hpp>
+
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// common interface of the denoisers, instances are created by name through DenoiserRegistry
+class Denoiser: public vsg::Inherit<vsg::Object, Denoiser>{
+public:
+    virtual void compile(vsg::Context& context) = 0;
+    virtual void updateImageLayouts(vsg::Context& context) = 0;
+    virtual void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler = {}) = 0;
+    virtual vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const = 0;
+};
+
+// denoises at three block sizes and blends the results with BFRBlender
+class MultiScaleDenoiser: public vsg::Inherit<Denoiser, MultiScaleDenoiser>{
+public:
+    MultiScaleDenoiser(uint32_t width, uint32_t height, vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<Denoiser> denoiser0,
+                       vsg::ref_ptr<Denoiser> denoiser1, vsg::ref_ptr<Denoiser> denoiser2);
+
+    void compile(vsg::Context& context) override;
+    void updateImageLayouts(vsg::Context& context) override;
+    void addDispatchToCommandGraph(vsg::ref_ptr<vsg::Commands> commandGraph, vsg::ref_ptr<vsg::PushConstants> pushConstants, vsg::ref_ptr<GpuProfiler> profiler = {}) override;
+    vsg::ref_ptr<vsg::DescriptorImage> getFinalDescriptorImage() const override;
+private:
+    std::vector<vsg::ref_ptr<Denoiser>> denoisers;
+    vsg::ref_ptr<BFRBlender> blender;
+};
+
+struct DenoiserSettings{
+    uint32_t width = 0, height = 0;
+    // one block size denoises at that size, three block sizes are denoised separately and blended by BFRBlender
+    std::vector<uint32_t> blockSizes{32};
+    // samples used for fitting a block, 0 uses min(256, blockSize * blockSize)
+    uint32_t fittingKernel = 0;
+
+    // parses a comma separated list like "8,16,32", returns false on invalid input
+    bool parseBlockSizes(const std::string& list);
+    std::string blockSizesString() const;
+    // the block size is the edge length of the compute workgroups of the denoiser, the bmfr fitting kernel the size of its fit
+    // workgroup. checks both against the sizes the shaders support and, if given, the compute limits of the device, prints the
+    // error and returns false if they can not be used
+    bool validate(const std::string& denoiser, const VkPhysicalDeviceLimits* limits = nullptr) const;
+    uint32_t bmfrFittingKernel(uint32_t blockSize) const;
+};
+
+// the denoisers selectable with --denoiser, new methods register a factory for a single block size
+class DenoiserRegistry{
+public:
+    using Factory = std::function<vsg::ref_ptr<Denoiser>(const DenoiserSettings& settings, uint32_t blockSize, vsg::ref_ptr<GBuffer> gBuffer,
+                                                         vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<AccumulationBuffer> accBuffer)>;
+
+    static void add(const std::string& name, Factory factory);
+    static bool contains(const std::string& name);
+    static std::vector<std::string> names();
+    // returns null if the name is unknown or the number of block sizes can not be denoised
+    static vsg::ref_ptr<Denoiser> create(const std::string& name, const DenoiserSettings& settings, vsg::ref_ptr<GBuffer> gBuffer,
+                                         vsg::ref_ptr<IlluminationBuffer> illuBuffer, vsg::ref_ptr<AccumulationBuffer> accBuffer);
+private:
+    static std::map<std::string, Factory>& factories();
+};
@@ -0,0 +1,185 @@
+#include <scene/EnvironmentMap.hpp>
+#include <vsgXchange/images.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    constexpr float pi = 3.14159265358979f;
+
+    float halfToFloat(uint16_t half)
+    {
+        uint32_t sign = uint32_t(half & 0x8000) << 16, exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+        uint32_t bits;
+        if (exponent == 0x1f)
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        else if (exponent)
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        else if (mantissa)
+        {
+            // denormals are normalized for the float exponent
+            exponent = 113;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        else
+            bits = sign;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+}
+
+EnvironmentMap::EnvironmentMap(vsg::ref_ptr<vsg::Data> image) :
+    width(image->width()),
+    height(image->height()),
+    image(image)
+{
+    std::vector<float> luminance(size_t(width) * height);
+    auto rgbLuminance = [](float r, float g, float b) { return std::max(.2126f * r + .7152f * g + .0722f * b, 0.f); };
+    if (auto floatImage = image.cast<vsg::vec4Array2D>())
+    {
+        for (size_t i = 0; i < luminance.size(); ++i)
+        {
+            auto& texel = floatImage->data()[i];
+            luminance[i] = rgbLuminance(texel.r, texel.g, texel.b);
+        }
+    }
+    else if (auto halfImage = image.cast<vsg::usvec4Array2D>())
+    {
+        for (size_t i = 0; i < luminance.size(); ++i)
+        {
+            auto& texel = halfImage->data()[i];
+            luminance[i] = rgbLuminance(halfToFloat(texel.r), halfToFloat(texel.g), halfToFloat(texel.b));
+        }
+    }
+    else
+        throw vsg::Exception{"Error: EnvironmentMap::EnvironmentMap(...) the image has to be a float or half float rgba image."};
+    buildCdfs(luminance);
+}
+
+vsg::ref_ptr<EnvironmentMap> EnvironmentMap::read(const std::string& filename)
+{
+    auto options = vsg::Options::create(vsgXchange::openexr::create());
+    auto image = vsg::read_cast<vsg::Data>(filename, options);
+    if (!image || (!image.cast<vsg::vec4Array2D>() && !image.cast<vsg::usvec4Array2D>()))
+    {
+        std::cout << "Unable to read environment map " << filename << ", an rgba exr image is required" << std::endl;
+        return {};
+    }
+    return EnvironmentMap::create(image);
+}
+
+void EnvironmentMap::buildCdfs(const std::vector<float>& luminance)
+{
+    cdfs.resize(height + 1 + size_t(height) * (width + 1));
+    std::vector<float> rowIntegrals(height);
+
+    // rows are independent of each other, so they are distributed over worker threads which fetch the next free row
+    uint32_t workerCount = std::max(1u, std::min(std::thread::hardware_concurrency(), height));
+    std::atomic<uint32_t> nextRow{0};
+    std::vector<std::future<void>> workers;
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        workers.push_back(std::async(std::launch::async, [&]() {
+            for (uint32_t row = nextRow++; row < height; row = nextRow++)
+            {
+                // texels near the poles cover less solid angle
+                float sinTheta = std::sin(pi * (row + .5f) / height);
+                float* cdf = cdfs.data() + height + 1 + size_t(row) * (width + 1);
+                double sum = 0;
+                cdf[0] = 0;
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    sum += luminance[size_t(row) * width + x] * sinTheta;
+                    cdf[x + 1] = static_cast<float>(sum);
+                }
+                rowIntegrals[row] = static_cast<float>(sum / width);
+                for (uint32_t x = 1; x <= width; ++x)
+                    cdf[x] = sum > 0 ? static_cast<float>(cdf[x] / sum) : float(x) / width;
+            }
+        }));
+    }
+    for (auto& worker : workers)
+        worker.get();
+
+    double sum = 0;
+    cdfs[0] = 0;
+    for (uint32_t row = 0; row < height; ++row)
+    {
+        sum += rowIntegrals[row];
+        cdfs[row + 1] = static_cast<float>(sum);
+    }
+    for (uint32_t row = 1; row <= height; ++row)
+        cdfs[row] = sum > 0 ? static_cast<float>(cdfs[row] / sum) : float(row) / height;
+}
+
+void EnvironmentMap::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    if (!imageDescriptor)
+    {
+        // wraps around horizontally, the poles are clamped
+        auto sampler = vsg::Sampler::create();
+        sampler->addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        imageDescriptor = vsg::DescriptorImage::create(sampler, image, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        auto cdfData = vsg::floatArray::create(static_cast<uint32_t>(cdfs.size()));
+        std::copy(cdfs.begin(), cdfs.end(), cdfData->data());
+        cdfDescriptor = vsg::DescriptorBuffer::create(cdfData, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+    imageDescriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "environmentMap").second;
+    cdfDescriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "EnvironmentCdf").second;
+    descSet->descriptorSet->descriptors.push_back(imageDescriptor);
+    descSet->descriptorSet->descriptors.push_back(cdfDescriptor);
+}
+
+uint32_t EnvironmentMap::findInterval(const float* cdf, uint32_t count, float u)
+{
+    // last entry not above u, bins without probability are never returned for u < 1
+    uint32_t bin = static_cast<uint32_t>(std::upper_bound(cdf, cdf + count + 1, u) - cdf);
+    return std::clamp(bin, 1u, count) - 1;
+}
+
+vsg::vec3 EnvironmentMap::sample(const vsg::vec2& u, float& pdf) const
+{
+    const float* marginal = cdfs.data();
+    uint32_t row = findInterval(marginal, height, u.y);
+    float rowPdf = (marginal[row + 1] - marginal[row]) * height;
+    float v = (row + (u.y - marginal[row]) / (marginal[row + 1] - marginal[row])) / height;
+
+    const float* conditional = cdfs.data() + height + 1 + size_t(row) * (width + 1);
+    uint32_t column = findInterval(conditional, width, u.x);
+    float columnPdf = (conditional[column + 1] - conditional[column]) * width;
+    float s = (column + (u.x - conditional[column]) / (conditional[column + 1] - conditional[column])) / width;
+
+    float theta = v * pi, phi = s * 2 * pi;
+    float sinTheta = std::sin(theta);
+    pdf = sinTheta > 0 ? rowPdf * columnPdf / (2 * pi * pi * sinTheta) : 0;
+    return vsg::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), std::cos(theta));
+}
+
+float EnvironmentMap::pdf(const vsg::vec3& direction) const
+{
+    float theta = std::acos(std::clamp(direction.z, -1.f, 1.f));
+    float phi = std::atan2(direction.y, direction.x);
+    if (phi < 0) phi += 2 * pi;
+    float sinTheta = std::sin(theta);
+    if (sinTheta == 0) return 0;
+
+    uint32_t row = std::min(static_cast<uint32_t>(theta / pi * height), height - 1);
+    uint32_t column = std::min(static_cast<uint32_t>(phi / (2 * pi) * width), width - 1);
+    const float* marginal = cdfs.data();
+    const float* conditional = cdfs.data() + height + 1 + size_t(row) * (width + 1);
+    float rowPdf = (marginal[row + 1] - marginal[row]) * height;
+    float columnPdf = (conditional[column + 1] - conditional[column]) * width;
+    return rowPdf * columnPdf / (2 * pi * pi * sinTheta);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// hdr environment map used as light source by the path tracer, see ENVIRONMENT_MAP in lighting.glsl.
+// the map is a latitude longitude image with +z up. directions are importance sampled with a marginal cdf over the rows and a
+// conditional cdf per row, both built from the luminance weighted by the solid angle of the texels
+class EnvironmentMap : public vsg::Inherit<vsg::Object, EnvironmentMap>
+{
+public:
+    // image has to be a float or half float rgba image
+    explicit EnvironmentMap(vsg::ref_ptr<vsg::Data> image);
+    // reads the map with the openexr reader, returns null if the file can not be read or has an unsupported format
+    static vsg::ref_ptr<EnvironmentMap> read(const std::string& filename);
+
+    // adds the map and its cdfs to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+
+    // cpu reference of the shader sampling, u is uniform in [0, 1)^2. pdf is with respect to solid angle
+    vsg::vec3 sample(const vsg::vec2& u, float& pdf) const;
+    float pdf(const vsg::vec3& direction) const;
+
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+
+private:
+    // builds the cdfs of all rows in parallel, the marginal cdf afterwards
+    void buildCdfs(const std::vector<float>& luminance);
+    // finds the bin of u in a cdf with count bins
+    static uint32_t findInterval(const float* cdf, uint32_t count, float u);
+
+    uint32_t width, height;
+    // the marginal cdf with height + 1 entries followed by height conditional cdfs with width + 1 entries
+    std::vector<float> cdfs;
+    vsg::ref_ptr<vsg::Data> image;
+    vsg::ref_ptr<vsg::DescriptorImage> imageDescriptor;
+    vsg::ref_ptr<vsg::DescriptorBuffer> cdfDescriptor;
+};
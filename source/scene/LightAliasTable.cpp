@@ -0,0 +1,67 @@
+#include <scene/LightAliasTable.hpp>
+
+#include <algorithm>
+
+LightAliasTable::LightAliasTable(const std::vector<vsg::Light::PackedLight>& lights)
+{
+    std::vector<float> strengths(lights.size());
+    std::transform(lights.begin(), lights.end(), strengths.begin(), [](const vsg::Light::PackedLight& light) {
+        return light.colorAmbient.x + light.colorAmbient.y + light.colorAmbient.z + light.colorDiffuse.x + light.colorDiffuse.y +
+               light.colorDiffuse.z + light.colorSpecular.x + light.colorSpecular.y + light.colorSpecular.z;
+    });
+    entries = build(strengths);
+}
+
+void LightAliasTable::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    if (!descriptor)
+    {
+        auto table = vsg::Array<Entry>::create(static_cast<uint32_t>(entries.size()));
+        std::copy(entries.begin(), entries.end(), table->data());
+        descriptor = vsg::DescriptorBuffer::create(table, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+    descriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "LightAlias").second;
+    descSet->descriptorSet->descriptors.push_back(descriptor);
+}
+
+std::vector<LightAliasTable::Entry> LightAliasTable::build(const std::vector<float>& weights)
+{
+    size_t n = weights.size();
+    std::vector<Entry> table(n);
+    double sum = 0;
+    for (auto weight : weights)
+        sum += weight;
+
+    // weights scaled to an average of 1, slots below 1 are filled up by the excess of slots above 1
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        scaled[i] = sum > 0 ? weights[i] * n / sum : 1;
+        (scaled[i] < 1 ? small : large).push_back(i);
+    }
+    while (small.size() && large.size())
+    {
+        uint32_t s = small.back(), l = large.back();
+        small.pop_back();
+        table[s] = {static_cast<float>(scaled[s]), l};
+        scaled[l] += scaled[s] - 1;
+        if (scaled[l] < 1)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // the remaining slots are full up to rounding errors
+    for (auto i : large)
+        table[i] = {1, i};
+    for (auto i : small)
+        table[i] = {1, i};
+    return table;
+}
+
+uint32_t LightAliasTable::sample(float u0, float u1) const
+{
+    uint32_t i = std::min(static_cast<uint32_t>(u0 * entries.size()), static_cast<uint32_t>(entries.size()) - 1);
+    return u1 < entries[i].probability ? i : entries[i].alias;
+}
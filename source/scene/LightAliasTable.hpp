@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <vector>
+
+// alias table (Walker, built with Vose's method) for picking a light proportional to its strength in O(1),
+// see LIGHT_SAMPLE_LIGHT_STRENGTH in lighting.glsl
+class LightAliasTable : public vsg::Inherit<vsg::Object, LightAliasTable>
+{
+public:
+    // entry of the LightAlias buffer in layoutPTLights.glsl, slot i keeps light i with probability and picks alias otherwise
+    struct Entry
+    {
+        float probability;
+        uint32_t alias;
+    };
+
+    // the lights are weighted by the same strength as the inclusive strengths of the light buffer
+    explicit LightAliasTable(const std::vector<vsg::Light::PackedLight>& lights);
+
+    // adds the table buffer to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+
+    // builds the table for arbitrary non negative weights, all entries are equally likely if the weights sum to 0
+    static std::vector<Entry> build(const std::vector<float>& weights);
+    // cpu reference of the shader lookup, u0 and u1 are uniform in [0, 1)
+    uint32_t sample(float u0, float u1) const;
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+private:
+    std::vector<Entry> entries;
+    vsg::ref_ptr<vsg::DescriptorBuffer> descriptor;
+};
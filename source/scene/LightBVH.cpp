@@ -0,0 +1,356 @@
+#include <scene/LightBVH.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr float pi = 3.14159265358979f;
+    constexpr int bucketCount = 12;
+    // below this depth the tree is split at the median, which keeps the trails within 64 bits for up to 2^24 lights
+    constexpr uint32_t maxCostSplitDepth = 40;
+    constexpr float oneMinusEpsilon = 0x1.fffffep-1f;
+
+    float safeSqrt(float x) { return std::sqrt(std::max(x, 0.f)); }
+    float safeAcos(float x) { return std::acos(std::clamp(x, -1.f, 1.f)); }
+
+    // cos(a - b) for the angles a, b clamped to 1 if a < b
+    float cosSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        if (cosA > cosB) return 1;
+        return cosA * cosB + sinA * sinB;
+    }
+    // sin(a - b) for the angles a, b clamped to 0 if a < b
+    float sinSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        if (cosA > cosB) return 0;
+        return sinA * cosB - cosA * sinB;
+    }
+}
+
+LightBVH::LightBVH(const std::vector<vsg::Light::PackedLight>& lights) :
+    placements(lights.size())
+{
+    std::vector<std::pair<uint32_t, LightBounds>> boundedLights;
+    std::vector<uint32_t> infiniteLights;
+    for (uint32_t i = 0; i < lights.size(); ++i)
+    {
+        if (static_cast<vsg::LightSourceType>(static_cast<int>(lights[i].type)) == vsg::LightSourceType::Directional)
+        {
+            infiniteLights.push_back(i);
+            continue;
+        }
+        auto bounds = lightBounds(lights[i]);
+        if (bounds.power > 0)
+            boundedLights.emplace_back(i, bounds);
+    }
+
+    if (boundedLights.size())
+        build(boundedLights, 0, boundedLights.size(), 0, 0);
+    treeNodeCount = static_cast<uint32_t>(nodes.size());
+    for (auto light : infiniteLights)
+    {
+        nodes.push_back(packNode({}, light, true));
+        placements[light].type = Placement::Infinite;
+    }
+}
+
+void LightBVH::updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap)
+{
+    if (!descriptor)
+    {
+        // header with the node counts, padded to the alignment of the nodes
+        uint32_t header[4] = {treeNodeCount, getInfiniteLightCount(), 0, 0};
+        auto data = vsg::ubyteArray::create(sizeof(header) + std::max<size_t>(nodes.size(), 1) * sizeof(Node));
+        std::memcpy(data->dataPointer(), header, sizeof(header));
+        std::memcpy(data->data() + sizeof(header), nodes.data(), nodes.size() * sizeof(Node));
+        descriptor = vsg::DescriptorBuffer::create(data, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+    descriptor->dstBinding = vsg::ShaderStage::getSetBindingIndex(bindingMap, "LightTree").second;
+    descSet->descriptorSet->descriptors.push_back(descriptor);
+}
+
+int LightBVH::sample(const vsg::vec3& p, const vsg::vec3& n, float u, float& pdf) const
+{
+    pdf = 0;
+    uint32_t infiniteCount = getInfiniteLightCount();
+    if (!infiniteCount && !treeNodeCount) return -1;
+    float pInfinite = float(infiniteCount) / float(infiniteCount + (treeNodeCount ? 1 : 0));
+    if (u < pInfinite)
+    {
+        uint32_t k = std::min(static_cast<uint32_t>(u / pInfinite * infiniteCount), infiniteCount - 1);
+        pdf = pInfinite / infiniteCount;
+        return static_cast<int>(nodes[treeNodeCount + k].index);
+    }
+    if (!treeNodeCount || importance(nodes[0], p, n) == 0) return -1;
+
+    u = std::min((u - pInfinite) / (1 - pInfinite), oneMinusEpsilon);
+    pdf = 1 - pInfinite;
+    uint32_t nodeIndex = 0;
+    while (!nodes[nodeIndex].leaf)
+    {
+        uint32_t child0 = nodeIndex + 1, child1 = nodes[nodeIndex].index;
+        float importance0 = importance(nodes[child0], p, n), importance1 = importance(nodes[child1], p, n);
+        if (importance0 == 0 && importance1 == 0)
+        {
+            pdf = 0;
+            return -1;
+        }
+        // the random number is rescaled to the chosen interval and reused for the next level
+        float p0 = importance0 / (importance0 + importance1);
+        if (u < p0)
+        {
+            nodeIndex = child0;
+            u = std::min(u / p0, oneMinusEpsilon);
+            pdf *= p0;
+        }
+        else
+        {
+            nodeIndex = child1;
+            u = std::min((u - p0) / (1 - p0), oneMinusEpsilon);
+            pdf *= 1 - p0;
+        }
+    }
+    return static_cast<int>(nodes[nodeIndex].index);
+}
+
+float LightBVH::pdf(uint32_t light, const vsg::vec3& p, const vsg::vec3& n) const
+{
+    const auto& placement = placements[light];
+    uint32_t infiniteCount = getInfiniteLightCount();
+    float pInfinite = float(infiniteCount) / float(infiniteCount + (treeNodeCount ? 1 : 0));
+    if (placement.type == Placement::Infinite) return pInfinite / infiniteCount;
+    if (placement.type == Placement::None || importance(nodes[0], p, n) == 0) return 0;
+
+    float pdf = 1 - pInfinite;
+    uint32_t nodeIndex = 0;
+    for (uint32_t depth = 0; !nodes[nodeIndex].leaf; ++depth)
+    {
+        uint32_t child0 = nodeIndex + 1, child1 = nodes[nodeIndex].index;
+        float importance0 = importance(nodes[child0], p, n), importance1 = importance(nodes[child1], p, n);
+        if (importance0 == 0 && importance1 == 0) return 0;
+        bool second = (placement.trail >> depth) & 1;
+        pdf *= (second ? importance1 : importance0) / (importance0 + importance1);
+        nodeIndex = second ? child1 : child0;
+    }
+    return pdf;
+}
+
+float LightBVH::importance(const Node& node, const vsg::vec3& p, const vsg::vec3& n)
+{
+    vsg::vec3 boundsMin(node.boundsMinPower.x, node.boundsMinPower.y, node.boundsMinPower.z);
+    vsg::vec3 boundsMax(node.boundsMaxCosTheta.x, node.boundsMaxCosTheta.y, node.boundsMaxCosTheta.z);
+    float power = node.boundsMinPower.w, cosThetaO = node.boundsMaxCosTheta.w;
+
+    // the distance is clamped to the bounds to not overestimate lights close to p
+    vsg::vec3 center = (boundsMin + boundsMax) * .5f;
+    vsg::vec3 wi = p - center;
+    float d2 = std::max(vsg::length2(wi), vsg::length(boundsMax - boundsMin) * .5f);
+    float wiLength = vsg::length(wi);
+    wi = wiLength > 0 ? wi / wiLength : vsg::vec3(0, 0, 1);
+
+    float cosThetaW = vsg::dot(node.axis, wi);
+    float sinThetaW = safeSqrt(1 - cosThetaW * cosThetaW);
+    // cone around wi containing the bounds as seen from p
+    float cosThetaB = -1;
+    bool inside = p.x >= boundsMin.x && p.y >= boundsMin.y && p.z >= boundsMin.z && p.x <= boundsMax.x && p.y <= boundsMax.y && p.z <= boundsMax.z;
+    float radius2 = vsg::length2(boundsMax - center);
+    if (!inside && wiLength * wiLength > radius2)
+        cosThetaB = safeSqrt(1 - radius2 / (wiLength * wiLength));
+    float sinThetaB = safeSqrt(1 - cosThetaB * cosThetaB);
+    float sinThetaO = safeSqrt(1 - cosThetaO * cosThetaO);
+
+    // smallest angle between the emission normals and p, the lights emit into the hemisphere around their normal
+    float cosThetaX = cosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+    float sinThetaX = sinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+    float cosThetaP = cosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    if (cosThetaP <= 0) return 0;
+
+    float cosThetaI = std::abs(vsg::dot(wi, n));
+    float sinThetaI = safeSqrt(1 - cosThetaI * cosThetaI);
+    float cosThetaPI = cosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+    return std::max(power * cosThetaP * cosThetaPI / d2, 0.f);
+}
+
+LightBVH::LightBounds LightBVH::lightBounds(const vsg::Light::PackedLight& light)
+{
+    // same light power as the light sampling in lighting.glsl
+    float power = light.colorAmbient.x + light.colorAmbient.y + light.colorAmbient.z + light.colorDiffuse.x + light.colorDiffuse.y +
+                  light.colorDiffuse.z + light.colorSpecular.x + light.colorSpecular.y + light.colorSpecular.z;
+    LightBounds bounds;
+    if (static_cast<vsg::LightSourceType>(static_cast<int>(light.type)) == vsg::LightSourceType::Area)
+    {
+        vsg::vec3 normal = vsg::cross(light.v1 - light.v0, light.v2 - light.v0);
+        float length = vsg::length(normal);
+        if (length == 0) return bounds;
+        bounds.min = vsg::vec3(std::min({light.v0.x, light.v1.x, light.v2.x}), std::min({light.v0.y, light.v1.y, light.v2.y}),
+                               std::min({light.v0.z, light.v1.z, light.v2.z}));
+        bounds.max = vsg::vec3(std::max({light.v0.x, light.v1.x, light.v2.x}), std::max({light.v0.y, light.v1.y, light.v2.y}),
+                               std::max({light.v0.z, light.v1.z, light.v2.z}));
+        bounds.power = power * .5f * length;
+        bounds.axis = normal / length;
+        bounds.cosTheta = 1;
+    }
+    else
+    {
+        // point like lights emit in all directions
+        bounds.min = light.v0;
+        bounds.max = light.v0;
+        bounds.power = power;
+        bounds.cosTheta = -1;
+    }
+    return bounds;
+}
+
+LightBVH::LightBounds LightBVH::unite(const LightBounds& a, const LightBounds& b)
+{
+    if (a.power == 0) return b;
+    if (b.power == 0) return a;
+
+    LightBounds bounds;
+    bounds.min = vsg::vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+    bounds.max = vsg::vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+    bounds.power = a.power + b.power;
+
+    // smallest cone containing both normal cones
+    float thetaA = safeAcos(a.cosTheta), thetaB = safeAcos(b.cosTheta);
+    float thetaD = safeAcos(vsg::dot(a.axis, b.axis));
+    if (std::min(thetaD + thetaB, pi) <= thetaA)
+    {
+        bounds.axis = a.axis;
+        bounds.cosTheta = a.cosTheta;
+        return bounds;
+    }
+    if (std::min(thetaD + thetaA, pi) <= thetaB)
+    {
+        bounds.axis = b.axis;
+        bounds.cosTheta = b.cosTheta;
+        return bounds;
+    }
+    float thetaO = (thetaA + thetaD + thetaB) * .5f;
+    vsg::vec3 rotationAxis = vsg::cross(a.axis, b.axis);
+    if (thetaO >= pi || vsg::length2(rotationAxis) == 0)
+    {
+        bounds.axis = a.axis;
+        bounds.cosTheta = -1;
+        return bounds;
+    }
+    // rotates the axis of a towards b
+    float thetaR = thetaO - thetaA;
+    rotationAxis = vsg::normalize(rotationAxis);
+    bounds.axis = vsg::normalize(a.axis * std::cos(thetaR) + vsg::cross(rotationAxis, a.axis) * std::sin(thetaR));
+    bounds.cosTheta = std::cos(thetaO);
+    return bounds;
+}
+
+float LightBVH::splitCost(const LightBounds& bounds, const LightBounds& nodeBounds, int dim)
+{
+    // surface area orientation heuristic, the emission of all lights is bounded by the hemisphere around their normal
+    float thetaO = safeAcos(bounds.cosTheta);
+    float thetaW = std::min(thetaO + pi * .5f, pi);
+    float sinThetaO = safeSqrt(1 - bounds.cosTheta * bounds.cosTheta);
+    float orientation = 2 * pi * (1 - bounds.cosTheta) +
+                        pi * .5f * (2 * thetaW * sinThetaO - std::cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + bounds.cosTheta);
+    vsg::vec3 diagonal = bounds.max - bounds.min;
+    float area = 2 * (diagonal.x * diagonal.y + diagonal.y * diagonal.z + diagonal.z * diagonal.x);
+    // long thin splits are penalized
+    vsg::vec3 nodeDiagonal = nodeBounds.max - nodeBounds.min;
+    float regularity = std::max({nodeDiagonal.x, nodeDiagonal.y, nodeDiagonal.z}) / nodeDiagonal[dim];
+    return bounds.power * orientation * regularity * area;
+}
+
+LightBVH::Node LightBVH::packNode(const LightBounds& bounds, uint32_t index, bool leaf)
+{
+    Node node{};
+    node.boundsMinPower = vsg::vec4(bounds.min.x, bounds.min.y, bounds.min.z, bounds.power);
+    node.boundsMaxCosTheta = vsg::vec4(bounds.max.x, bounds.max.y, bounds.max.z, bounds.cosTheta);
+    node.axis = bounds.axis;
+    node.index = index;
+    node.leaf = leaf ? 1 : 0;
+    return node;
+}
+
+LightBVH::LightBounds LightBVH::build(std::vector<std::pair<uint32_t, LightBounds>>& lights, size_t begin, size_t end, uint64_t trail, uint32_t depth)
+{
+    uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    if (end - begin == 1)
+    {
+        auto& [light, bounds] = lights[begin];
+        nodes[nodeIndex] = packNode(bounds, light, true);
+        placements[light] = {Placement::Tree, trail};
+        return bounds;
+    }
+
+    LightBounds nodeBounds;
+    vsg::vec3 centroidMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    vsg::vec3 centroidMax = -centroidMin;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const auto& bounds = lights[i].second;
+        nodeBounds = unite(nodeBounds, bounds);
+        vsg::vec3 centroid = (bounds.min + bounds.max) * .5f;
+        centroidMin = vsg::vec3(std::min(centroidMin.x, centroid.x), std::min(centroidMin.y, centroid.y), std::min(centroidMin.z, centroid.z));
+        centroidMax = vsg::vec3(std::max(centroidMax.x, centroid.x), std::max(centroidMax.y, centroid.y), std::max(centroidMax.z, centroid.z));
+    }
+
+    // binned split along the centroids with the lowest cost
+    float minCost = std::numeric_limits<float>::max();
+    int minDim = -1, minBucket = -1;
+    auto bucketOf = [&](const LightBounds& bounds, int dim) {
+        float centroid = (bounds.min[dim] + bounds.max[dim]) * .5f;
+        int bucket = static_cast<int>(bucketCount * (centroid - centroidMin[dim]) / (centroidMax[dim] - centroidMin[dim]));
+        return std::clamp(bucket, 0, bucketCount - 1);
+    };
+    for (int dim = 0; depth < maxCostSplitDepth && dim < 3; ++dim)
+    {
+        if (centroidMax[dim] == centroidMin[dim] || nodeBounds.max[dim] == nodeBounds.min[dim]) continue;
+        LightBounds buckets[bucketCount];
+        for (size_t i = begin; i < end; ++i)
+        {
+            auto& bucket = buckets[bucketOf(lights[i].second, dim)];
+            bucket = unite(bucket, lights[i].second);
+        }
+        for (int split = 1; split < bucketCount; ++split)
+        {
+            LightBounds below, above;
+            for (int b = 0; b < split; ++b)
+                below = unite(below, buckets[b]);
+            for (int b = split; b < bucketCount; ++b)
+                above = unite(above, buckets[b]);
+            if (below.power == 0 || above.power == 0) continue;
+            float cost = splitCost(below, nodeBounds, dim) + splitCost(above, nodeBounds, dim);
+            if (cost < minCost)
+            {
+                minCost = cost;
+                minDim = dim;
+                minBucket = split;
+            }
+        }
+    }
+
+    size_t mid;
+    if (minDim >= 0)
+        mid = std::partition(lights.begin() + begin, lights.begin() + end,
+                             [&](const std::pair<uint32_t, LightBounds>& light) { return bucketOf(light.second, minDim) < minBucket; }) -
+              lights.begin();
+    else
+    {
+        // no useful split, the lights are halved along the widest centroid extent
+        vsg::vec3 extent = centroidMax - centroidMin;
+        int dim = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        mid = (begin + end) / 2;
+        std::nth_element(lights.begin() + begin, lights.begin() + mid, lights.begin() + end,
+                         [dim](const std::pair<uint32_t, LightBounds>& a, const std::pair<uint32_t, LightBounds>& b) {
+                             return a.second.min[dim] + a.second.max[dim] < b.second.min[dim] + b.second.max[dim];
+                         });
+    }
+
+    build(lights, begin, mid, trail, depth + 1);
+    uint32_t secondChild = static_cast<uint32_t>(nodes.size());
+    build(lights, mid, end, trail | (uint64_t(1) << depth), depth + 1);
+    nodes[nodeIndex] = packNode(nodeBounds, secondChild, false);
+    return nodeBounds;
+}
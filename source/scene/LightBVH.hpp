@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <vector>
+
+// bounding volume hierarchy over the lights for importance sampling of scenes with many lights (Conty and Kulla 2018, as in pbrt-v4).
+// every node stores the bounds, the emitted power and a cone bounding the emission normals of its lights. the shader descends
+// from the root by picking a child proportional to its importance for the shading point, see LIGHT_SAMPLE_BVH in lighting.glsl.
+// directional lights have no bounds, they follow the tree nodes and are picked uniformly against the whole tree
+class LightBVH : public vsg::Inherit<vsg::Object, LightBVH>
+{
+public:
+    // node of the LightTree buffer in layoutPTLightTree.glsl
+    struct Node
+    {
+        vsg::vec4 boundsMinPower;       // w is the summed power of the lights
+        vsg::vec4 boundsMaxCosTheta;    // w is the cosine of the normal cone half angle, -1 if the lights emit in all directions
+        vsg::vec3 axis;                 // normal cone axis
+        uint32_t index;                 // light index of leaves, index of the second child of inner nodes (the first child follows the node)
+        uint32_t leaf;
+        uint32_t padding[3];
+    };
+
+    explicit LightBVH(const std::vector<vsg::Light::PackedLight>& lights);
+
+    // adds the tree buffer to the descriptor set of the ray tracing pipeline
+    void updateDescriptor(vsg::BindDescriptorSet* descSet, const vsg::BindingMap& bindingMap);
+
+    // cpu reference of the shader traversal for the shading point p with normal n, u is uniform in [0, 1).
+    // returns the picked light index and its probability, -1 if no light can illuminate p
+    int sample(const vsg::vec3& p, const vsg::vec3& n, float u, float& pdf) const;
+    // probability of sample() picking the light at p
+    float pdf(uint32_t light, const vsg::vec3& p, const vsg::vec3& n) const;
+    // importance of a node for the shading point, 0 if none of its lights can illuminate p
+    static float importance(const Node& node, const vsg::vec3& p, const vsg::vec3& n);
+
+    const std::vector<Node>& getNodes() const { return nodes; }
+    uint32_t getTreeNodeCount() const { return treeNodeCount; }
+    uint32_t getInfiniteLightCount() const { return static_cast<uint32_t>(nodes.size()) - treeNodeCount; }
+
+private:
+    struct LightBounds
+    {
+        vsg::vec3 min, max;
+        float power = 0;    // 0 marks empty bounds
+        vsg::vec3 axis{0, 0, 1};
+        float cosTheta = 1;
+    };
+    // where a light ended up, the trail has a bit for every level of the tree which is set if the second child was taken
+    struct Placement
+    {
+        enum Type : uint8_t
+        {
+            None,   // lights without power are never sampled
+            Tree,
+            Infinite
+        } type = None;
+        uint64_t trail = 0;
+    };
+
+    static LightBounds lightBounds(const vsg::Light::PackedLight& light);
+    static LightBounds unite(const LightBounds& a, const LightBounds& b);
+    static float splitCost(const LightBounds& bounds, const LightBounds& nodeBounds, int dim);
+    static Node packNode(const LightBounds& bounds, uint32_t index, bool leaf);
+    LightBounds build(std::vector<std::pair<uint32_t, LightBounds>>& lights, size_t begin, size_t end, uint64_t trail, uint32_t depth);
+
+    std::vector<Node> nodes;
+    uint32_t treeNodeCount = 0;
+    std::vector<Placement> placements;
+    vsg::ref_ptr<vsg::DescriptorBuffer> descriptor;
+};
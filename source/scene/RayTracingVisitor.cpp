@@ -38,10 +38,16 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::VertexIndexDraw& vid)
     {
         instance.meshId = _vertexIndexDrawMap[&vid].meshId;
         instance.indexStride = _vertexIndexDrawMap[&vid].indexStride;
+        instance.gridWidth = _vertexIndexDrawMap[&vid].gridWidth;
+        instance.gridHeight = _vertexIndexDrawMap[&vid].gridHeight;
     }
     else
     {
         instance.meshId = _positions.size();
+        instance.gridWidth = 0;
+        instance.gridHeight = 0;
+        vid.getValue("gridWidth", instance.gridWidth);
+        vid.getValue("gridHeight", instance.gridHeight);
         _vertexIndexDrawMap[&vid] = instance;
         auto positions = vsg::DescriptorBuffer::create(vid.arrays[0]->data, 2, _positions.size(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
         _positions.push_back(positions);
@@ -104,7 +110,7 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::VertexIndexDraw& vid)
             //for(auto& normal: nors) normal = vsg::normalize(normal);
             std::memcpy(vid.arrays[1]->data->dataPointer(), nors.data(), vid.arrays[1]->data->dataSize());
         }
-        auto normals = vsg::DescriptorBuffer::create(vid.arrays[1]->data, 3, _normals.size(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        auto normals = createSharedDescriptorBuffer(vid.arrays[1]->data, 3, _normals.size());
         _normals.push_back(normals);
         // auto fill up tex coords if not provided
         vsg::ref_ptr<vsg::DescriptorBuffer> texCoords;
@@ -128,9 +134,10 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::VertexIndexDraw& vid)
         }
         texCoords = vsg::DescriptorBuffer::create(vid.arrays[2]->data, 4, _texCoords.size(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
         _texCoords.push_back(texCoords);
-        auto indices = vsg::DescriptorBuffer::create(vid.indices->data, 5, _indices.size(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        auto indices = createSharedDescriptorBuffer(vid.indices->data, 5, _indices.size());
         _indices.push_back(indices);
         instance.indexStride = vid.indices->data->stride();
+        _vertexIndexDrawMap[&vid] = instance;
     }
     _instancesArray.push_back(instance);
 
@@ -142,10 +149,8 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::VertexIndexDraw& vid)
             vsg::Light l{};
             l.radius = 0;
             l.type = vsg::LightSourceType::Area;
-            l.colorAmbient = {
-                _materialArray.back().emissionTextureId.r, _materialArray.back().emissionTextureId.g,
-                _materialArray.back().emissionTextureId.b
-            };
+            const auto& emission = _materialArray[currentMaterial].emissionTextureId;
+            l.colorAmbient = {emission.r, emission.g, emission.b};
             l.colorDiffuse = l.colorAmbient;
             l.colorSpecular = l.colorAmbient;
             l.strengths = vsg::vec3(0, 0, 1);
@@ -171,10 +176,22 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::VertexIndexDraw& vid)
         }
     }
 }
+vsg::ref_ptr<vsg::DescriptorBuffer> RayTracingSceneDescriptorCreationVisitor::createSharedDescriptorBuffer(vsg::ref_ptr<vsg::Data> data, uint32_t binding, uint32_t arrayElement)
+{
+    auto& bufferInfo = _sharedBufferInfos[data.get()];
+    if (!bufferInfo) bufferInfo = vsg::BufferInfo::create(nullptr, 0, 0, data);
+    return vsg::DescriptorBuffer::create(vsg::BufferInfoList{bufferInfo}, binding, arrayElement, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
 void RayTracingSceneDescriptorCreationVisitor::apply(vsg::StateGroup& sg)
 {
     if (firstStageGroup) //skip default state grop(the first in the tree) TODO::change to detect default state
         firstStageGroup = false;
+    else if (auto visited = _stateGroupMaterials.find(&sg); visited != _stateGroupMaterials.end())
+    {
+        //the mesh below was already added, its instances use the material of the first visit
+        currentMaterial = visited->second.materialIndex;
+        meshEmissive = visited->second.emissive;
+    }
     else
     {
         vsg::StateGroup::StateCommands& sc = sg.stateCommands;
@@ -186,6 +203,7 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::StateGroup& sg)
                 apply(*bds);
             }
         }
+        _stateGroupMaterials[&sg] = {currentMaterial, meshEmissive};
     }
     sg.traverse(*this);
 }
@@ -221,6 +239,7 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::BindDescriptorSet& bds
                 if(vsgMat.transmissionFactor.x != 1 || vsgMat.transmissionFactor.y != 1 || vsgMat.transmissionFactor.z != 1)
                     mat.transmittanceIllum.w = 7;   // means that refraction and reflection should be active
                 _materialArray.push_back(mat);
+                currentMaterial = static_cast<int>(_materialArray.size()) - 1;
             }
             else
             {
@@ -245,6 +264,7 @@ void RayTracingSceneDescriptorCreationVisitor::apply(vsg::BindDescriptorSet& bds
                 if(vsgMat.transmissive.x != 1 || vsgMat.transmissive.y != 1 || vsgMat.transmissive.z != 1)
                     mat.transmittanceIllum.w = 7;   // means that refraction and reflection should be active
                 _materialArray.push_back(mat);
+                currentMaterial = static_cast<int>(_materialArray.size()) - 1;
             }
             continue;
         }
@@ -37,7 +37,8 @@ protected:
         vsg::mat4 objectMat;
         int meshId;         //index of the corresponding textuers, vertices etc.
         uint32_t indexStride;
-        int pad[2];
+        uint32_t gridWidth; //vertices per row if the mesh is a regular grid of heights with derived positions, normals and texture coordinates, 0 otherwise
+        uint32_t gridHeight;//rows of the grid, vertices after the grid are skirt vertices along the grid border
     };
     struct WaveFrontMaterialPacked
     {
@@ -67,10 +68,21 @@ protected:
     vsg::ref_ptr<vsg::DescriptorBuffer> _lights;
 
     std::map<vsg::VertexIndexDraw*, ObjectInstance> _vertexIndexDrawMap;
+    //state groups shared between nodes (e.g. instanced furniture) only add their material once, it has the index of the mesh
+    //below the state group
+    struct StateGroupMaterial{
+        int materialIndex;
+        bool emissive;
+    };
+    std::map<const vsg::StateGroup*, StateGroupMaterial> _stateGroupMaterials;
+    //data shared between meshes (e.g. terrain tile indices) is only uploaded once
+    std::map<const vsg::Data*, vsg::ref_ptr<vsg::BufferInfo>> _sharedBufferInfos;
+    vsg::ref_ptr<vsg::DescriptorBuffer> createSharedDescriptorBuffer(vsg::ref_ptr<vsg::Data> data, uint32_t binding, uint32_t arrayElement);
     vsg::MatrixStack _transformStack;
 
     vsg::ref_ptr<vsg::DescriptorImage> _defaultTexture;   //the default image is used for each texture that is not available
     bool firstStageGroup = true;                        //the first state group contains the default state which should be skipped
     bool meshEmissive = false;                          //set to true by a descriptor set that has emission
+    int currentMaterial = -1;                           //material of the meshes below the current state group
 };
 
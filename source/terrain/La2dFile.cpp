@@ -0,0 +1,146 @@
+#include "La2dFile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+La2dFile::La2dFile(const vsg::Path& path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                fileData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if (fileData) {
+                    fileSize = static_cast<size_t>(size.QuadPart);
+                    mappingHandle = mapping;
+                } else {
+                    CloseHandle(mapping);
+                }
+            }
+        }
+        if (fileData) {
+            fileHandle = file;
+        } else {
+            CloseHandle(file);
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+                fileData = static_cast<const uint8_t*>(mapped);
+                fileSize = static_cast<size_t>(fileStat.st_size);
+            }
+        }
+        // the mapping stays valid after closing the descriptor
+        close(fd);
+    }
+#endif
+
+    if (!fileData) {
+        // mapping not possible, read the whole file in one go instead
+        std::ifstream ifs(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!ifs) {
+            std::cout << "Error: La2dFile: could not open " << path << std::endl;
+            return;
+        }
+        fallbackBuffer.resize(static_cast<size_t>(ifs.tellg()));
+        ifs.seekg(0);
+        if (!ifs.read(reinterpret_cast<char*>(fallbackBuffer.data()), fallbackBuffer.size())) {
+            std::cout << "Error: La2dFile: could not read " << path << std::endl;
+            fallbackBuffer.clear();
+            return;
+        }
+        fileData = fallbackBuffer.data();
+        fileSize = fallbackBuffer.size();
+    }
+
+    if (fileSize < headerSize) {
+        std::cout << "Error: La2dFile: " << path << " is smaller than the la2d header" << std::endl;
+        return;
+    }
+
+    std::memcpy(&actualWidth, fileData + 24, sizeof(actualWidth));
+    std::memcpy(&actualHeight, fileData + 28, sizeof(actualHeight));
+    std::memcpy(&tileWidth, fileData + 32, sizeof(tileWidth));
+    std::memcpy(&tileHeight, fileData + 36, sizeof(tileHeight));
+
+    if (tileWidth == 0 || tileHeight == 0) {
+        std::cout << "Error: La2dFile: invalid tile size in " << path << std::endl;
+        return;
+    }
+
+    fullWidth = ((actualWidth / tileWidth) + 1) * tileWidth;
+    fullHeight = ((actualHeight / tileHeight) + 1) * tileHeight;
+    payloadData = fileData + headerSize;
+}
+
+La2dFile::~La2dFile() {
+    unmap();
+}
+
+void La2dFile::unmap() {
+    if (fileData && fileData != fallbackBuffer.data()) {
+#if defined(_WIN32)
+        UnmapViewOfFile(fileData);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(fileData), fileSize);
+#endif
+    }
+    fileData = nullptr;
+    payloadData = nullptr;
+    fileSize = 0;
+    fallbackBuffer.clear();
+}
+
+bool La2dFile::detile(void* dst, size_t elementSize) const {
+    size_t requiredSize = size_t(fullWidth) * fullHeight * elementSize;
+    if (!valid()) {
+        std::memset(dst, 0, requiredSize);
+        return false;
+    }
+
+    size_t tileRowSize = size_t(tileWidth) * elementSize;
+    if (payloadSize() < requiredSize) {
+        std::cout << "Error: La2dFile: the payload has " << payloadSize() << " bytes, " << requiredSize << " are required" << std::endl;
+        std::memset(dst, 0, requiredSize);
+        return false;
+    }
+    if (payloadSize() > requiredSize) {
+        std::cout << "error: end of file not yet reached?" << std::endl;
+    }
+
+    const uint8_t* src = payloadData;
+    uint8_t* dstBytes = static_cast<uint8_t*>(dst);
+    for (uint32_t yOffset = 0; yOffset < fullHeight; yOffset += tileHeight) {
+        for (uint32_t xOffset = 0; xOffset < fullWidth; xOffset += tileWidth) {
+            for (uint32_t y = 0; y < tileHeight; y++) {
+                std::memcpy(dstBytes + (size_t(fullWidth) * (yOffset + y) + xOffset) * elementSize, src, tileRowSize);
+                src += tileRowSize;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vsg/all.h>
+#include <vector>
+
+// read only, memory mapped view of a la2d file
+// the payload is stored tile by tile, detile() converts it into a row major image of fullWidth x fullHeight elements
+class La2dFile : public vsg::Inherit<vsg::Object, La2dFile>
+{
+public:
+    static constexpr size_t headerSize = 8192;
+
+    La2dFile(const vsg::Path& path);
+    ~La2dFile();
+
+    bool valid() const { return payloadData != nullptr; }
+    const uint8_t* payload() const { return payloadData; }
+    size_t payloadSize() const { return fileSize > headerSize ? fileSize - headerSize : 0; }
+
+    // copies the tiled payload into dst, which has to hold fullWidth * fullHeight elements of elementSize bytes
+    // returns false and zero fills dst if the file could not be read or its payload is too short
+    bool detile(void* dst, size_t elementSize) const;
+
+    uint32_t actualWidth = 0;
+    uint32_t actualHeight = 0;
+    uint32_t tileWidth = 0;
+    uint32_t tileHeight = 0;
+    uint32_t fullWidth = 0;
+    uint32_t fullHeight = 0;
+
+private:
+    void unmap();
+
+    const uint8_t* fileData = nullptr;
+    const uint8_t* payloadData = nullptr;
+    size_t fileSize = 0;
+    // used if the file could not be mapped
+    std::vector<uint8_t> fallbackBuffer;
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
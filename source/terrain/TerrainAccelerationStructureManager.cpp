@@ -1,4 +1,52 @@
 #include "TerrainAccelerationStructureManager.hpp"
+#include "TerrainBuildAccelerationStructureTraversal.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+// imports a single tile and creates its bottom level acceleration structure on a streaming thread
+class LoadTerrainTileOperation : public vsg::Inherit<vsg::Operation, LoadTerrainTileOperation>
+{
+public:
+    LoadTerrainTileOperation(TerrainAccelerationStructureManager* manager, vsg::ref_ptr<TerrainImporter> terrainImporter, TerrainTileKey key) :
+        manager(manager),
+        terrainImporter(terrainImporter),
+        key(key)
+    {
+    }
+
+    void run() override
+    {
+        TerrainTile tile;
+        try {
+            tile.node = terrainImporter->importTile(std::get<0>(key), std::get<1>(key));
+        }
+        catch (const vsg::Exception& exception) {
+            // an exception would terminate the streaming thread, the failed tile is passed on without a node instead
+            std::cout << exception.message << std::endl;
+            std::scoped_lock lock(manager->finishedTilesMutex);
+            manager->finishedTiles.emplace_back(key, tile);
+            return;
+        }
+
+        // only creates the blas objects, they are built on the gpu when the tlas using them is compiled
+        TerrainBuildAccelerationStructureTraversal buildAccelStruct(manager->device());
+        tile.node->accept(buildAccelStruct);
+        tile.geometryInstance = buildAccelStruct.tlas->geometryInstances.front();
+        // the traversal only saw this tile, like the tiles of loadLodLevel() the id is the slot index until a selection
+        // assigns the index of the tile in its scene
+        tile.geometryInstance->id = std::get<1>(key) * manager->tileCountX + std::get<0>(key);
+
+        std::scoped_lock lock(manager->finishedTilesMutex);
+        manager->finishedTiles.emplace_back(key, tile);
+    }
+
+private:
+    TerrainAccelerationStructureManager* manager;
+    vsg::ref_ptr<TerrainImporter> terrainImporter;
+    TerrainTileKey key;
+};
 
 TerrainAccelerationStructureManager::TerrainAccelerationStructureManager(uint32_t tileCountX, uint32_t tileCountY, uint32_t lodLevelCount, vsg::ref_ptr<vsg::Context> context) :
     tileCountX(tileCountX),
@@ -6,46 +54,39 @@ TerrainAccelerationStructureManager::TerrainAccelerationStructureManager(uint32_
     lodLevelCount(lodLevelCount),
     context(context)
 {
+}
 
-    blasTiles = BlasTiles::create(tileCountX, tileCountY, lodLevelCount);
-    tileNodes = TileNodes::create(lodLevelCount);
-
+TerrainAccelerationStructureManager::~TerrainAccelerationStructureManager()
+{
+    stopStreaming();
 }
 
 void TerrainAccelerationStructureManager::loadLodLevel(vsg::ref_ptr<TerrainImporter> terrainImporter, int lodLevel)
 {
     auto loaded_scene = terrainImporter->importTerrain();
-    tileNodes->set(lodLevel, terrainImporter->loadedTileNodes);
 
-    vsg::BuildAccelerationStructureTraversal buildAccelStruct(context->device);
+    TerrainBuildAccelerationStructureTraversal buildAccelStruct(device());
     loaded_scene->accept(buildAccelStruct);
     auto tlas = buildAccelStruct.tlas;
 
     for (uint32_t i = 0; i < tlas->geometryInstances.size(); ++i) {
-        auto geometryInstance = tlas->geometryInstances[i];
-        blasTiles->at(i % tileCountX, i / tileCountX, lodLevel) = geometryInstance;
+        uint32_t x = i % tileCountX;
+        uint32_t y = i / tileCountX;
+        auto& tile = residentTiles[{ x, y, lodLevel }];
+        tile.node = terrainImporter->loadedTileNodes->at(x, y);
+        tile.geometryInstance = tlas->geometryInstances[i];
+        tile.pinned = true;
     }
+    ++residentTilesVersion;
 
 
 }
 
 vsg::ref_ptr<vsg::TopLevelAccelerationStructure> TerrainAccelerationStructureManager::createTlas(int lodLevel, bool test)
 {
-    auto tlas = vsg::TopLevelAccelerationStructure::create(context->device);
-
-    //for (uint32_t y = 0; y < tileCountY; ++y) {
-    //    for (uint32_t x = 0; x < tileCountX; ++x) {
-    //        if (x % 2 == y % 2) {
-    //            auto geometryInstance = blasTiles->at(x, y, lodLevel);
-    //            tlas->geometryInstances.push_back(geometryInstance);
-    //        }
-    //        else {
-    //            auto geometryInstance = blasTiles->at(x, y, lodLevel + 1);
-    //            tlas->geometryInstances.push_back(geometryInstance);
-    //        }
-    //    }
-    //}
+    auto tlas = vsg::TopLevelAccelerationStructure::create(device());
 
+    uint32_t instanceId = 0;
     for (uint32_t y = 0; y < tileCountY; ++y) {
         for (uint32_t x = 0; x < tileCountX; ++x) {
             int lod = lodLevelCount - 1 - ((x + y) / 8);
@@ -53,8 +94,11 @@ vsg::ref_ptr<vsg::TopLevelAccelerationStructure> TerrainAccelerationStructureMan
 
             if (test) lod = lodLevel;
 
-            auto geometryInstance = blasTiles->at(x, y, lod);
-            tlas->geometryInstances.push_back(geometryInstance);
+            if (auto tile = findTile(x, y, lod)) {
+                // the instance id has to match the index of the tile's mesh in createScene()
+                tile->geometryInstance->id = instanceId++;
+                tlas->geometryInstances.push_back(tile->geometryInstance);
+            }
         }
     }
 
@@ -69,28 +113,14 @@ vsg::ref_ptr<vsg::Node> TerrainAccelerationStructureManager::createScene(int lod
 
     auto scenegraph = vsg::StateGroup::create();
 
-    //for (int y = 0; y < tileCountY; ++y) {
-    //    for (int x = 0; x < tileCountX; ++x) {
-    //        if (x % 2 == y % 2) {
-    //            auto tileNode = tileNodes->at(lodLevel)->at(x, y);
-    //            scenegraph->addChild(tileNode);
-    //        }
-    //        else {
-    //            auto tileNode = tileNodes->at(lodLevel + 1)->at(x, y);
-    //            scenegraph->addChild(tileNode);
-    //        }
-    //        //auto tileNode = tileNodes->at(lodLevel + 1)->at(x, y);
-    //        //scenegraph->addChild(tileNode);
-    //    }
-    //}
-
     for (int y = 0; y < tileCountY; ++y) {
         for (int x = 0; x < tileCountX; ++x) {
             int lod = lodLevelCount - 1 - ((x + y) / 8);
             if (lod < lodLevel) lod = lodLevel;
 
-            auto tileNode = tileNodes->at(lod)->at(x, y);
-            scenegraph->addChild(tileNode);
+            if (auto tile = findTile(x, y, lod)) {
+                scenegraph->addChild(tile->node);
+            }
         }
     }
 
@@ -98,35 +128,69 @@ vsg::ref_ptr<vsg::Node> TerrainAccelerationStructureManager::createScene(int lod
     return root;
 }
 
+int TerrainAccelerationStructureManager::getTileLod(uint32_t x, uint32_t y, int minLod, vsg::dvec3 eyePosInTileCoords) const
+{
+    vsg::dvec3 tilePos(x, y, 0);
+    tilePos += vsg::dvec3(0.5, 0.5, 0.0);
+    double distance = vsg::length(tilePos - eyePosInTileCoords);
+    distance *= 0.1;
+    int lod = lodLevelCount - 1 - round(distance);
+    if (lod < minLod) lod = minLod;
+    return lod;
+}
+
 std::pair<vsg::ref_ptr<vsg::TopLevelAccelerationStructure>, vsg::ref_ptr<vsg::Node>> TerrainAccelerationStructureManager::createTlasAndScene(int minLod, vsg::dvec3 eyePosInTileCoords)
 {
-    auto tlas = vsg::TopLevelAccelerationStructure::create(context->device);
+    auto tlas = vsg::TopLevelAccelerationStructure::create(device());
+
+    auto [slots, sceneRoot] = selectTiles(minLod, eyePosInTileCoords);
+    for (auto& geometryInstance : slots) {
+        if (geometryInstance) tlas->geometryInstances.push_back(geometryInstance);
+    }
+
+    return { tlas, sceneRoot };
+}
+
+std::pair<vsg::GeometryInstances, vsg::ref_ptr<vsg::Node>> TerrainAccelerationStructureManager::selectTiles(int minLod, vsg::dvec3 eyePosInTileCoords, bool assignInstanceIds)
+{
+    vsg::GeometryInstances slots(tileCountX * tileCountY);
 
     auto sceneRoot = vsg::MatrixTransform::create();
     sceneRoot->matrix = vsg::mat4();
 
     auto scenegraph = vsg::StateGroup::create();
 
-    for (int y = 0; y < tileCountY; ++y) {
-        for (int x = 0; x < tileCountX; ++x) {
-            vsg::dvec3 tilePos(x, y, 0);
-            tilePos += vsg::dvec3(0.5, 0.5, 0.0);
-            double distance = vsg::length(tilePos - eyePosInTileCoords);
-            distance *= 0.1;
-            int lod = lodLevelCount - 1 - round(distance);
-            if (lod < minLod) lod = minLod;
-
-            auto geometryInstance = blasTiles->at(x, y, lod);
-            tlas->geometryInstances.push_back(geometryInstance);
-
-            auto tileNode = tileNodes->at(lod)->at(x, y);
-            scenegraph->addChild(tileNode);
+    ++selectionGeneration;
+    uint32_t instanceId = 0;
+    for (uint32_t y = 0; y < tileCountY; ++y) {
+        for (uint32_t x = 0; x < tileCountX; ++x) {
+            int lod = getTileLod(x, y, minLod, eyePosInTileCoords);
+
+            // while streaming the required lod might not be resident yet, the closest resident lod is used instead
+            auto tile = findTile(x, y, lod);
+            if (!tile) continue;
+            tile->lastUsed = selectionGeneration;
+
+            // the instance id has to match the index of the tile's mesh in the scene
+            if (assignInstanceIds) tile->geometryInstance->id = instanceId++;
+            slots[y * tileCountX + x] = tile->geometryInstance;
+            scenegraph->addChild(tile->node);
         }
     }
 
     sceneRoot->addChild(scenegraph);
 
-    return { tlas, sceneRoot };
+    evictTiles();
+
+    return { slots, sceneRoot };
+}
+
+vsg::ref_ptr<TerrainTopLevelAccelerationStructure> TerrainAccelerationStructureManager::getPersistentTlas()
+{
+    if (!persistentTlas) {
+        persistentTlas = TerrainTopLevelAccelerationStructure::create(device(), tileCountX * tileCountY);
+    }
+    return persistentTlas;
 }
 
 vsg::ref_ptr<vsg::Node> TerrainAccelerationStructureManager::createCompleteScene(int minLod)
@@ -136,13 +200,15 @@ vsg::ref_ptr<vsg::Node> TerrainAccelerationStructureManager::createCompleteScene
 
     auto scenegraph = vsg::StateGroup::create();
 
+    uint32_t instanceId = 0;
     for (int currentLod = minLod; currentLod < lodLevelCount; ++currentLod) {
-    //for (int currentLod = lodLevelCount-1; currentLod >= minLod; --currentLod) {
-        auto currentLodTiles = tileNodes->at(currentLod);
-        for (int y = 0; y < tileCountY; ++y) {
-            for (int x = 0; x < tileCountX; ++x) {
-                auto tileNode = currentLodTiles->at(x, y);
-                scenegraph->addChild(tileNode);
+        for (uint32_t y = 0; y < tileCountY; ++y) {
+            for (uint32_t x = 0; x < tileCountX; ++x) {
+                auto itr = residentTiles.find({ x, y, currentLod });
+                if (itr != residentTiles.end()) {
+                    itr->second.geometryInstance->id = instanceId++;
+                    scenegraph->addChild(itr->second.node);
+                }
             }
         }
     }
@@ -150,3 +216,121 @@ vsg::ref_ptr<vsg::Node> TerrainAccelerationStructureManager::createCompleteScene
     root->addChild(scenegraph);
     return root;
 }
+
+TerrainTile* TerrainAccelerationStructureManager::findTile(uint32_t x, uint32_t y, int lodLevel)
+{
+    auto exact = residentTiles.find({ x, y, lodLevel });
+    if (exact != residentTiles.end()) return &exact->second;
+
+    // prefer the coarser lod if two resident lods are equally far away
+    TerrainTile* closest = nullptr;
+    int closestDistance = INT_MAX;
+    auto end = residentTiles.upper_bound({ x, y, INT_MAX });
+    for (auto itr = residentTiles.lower_bound({ x, y, INT_MIN }); itr != end; ++itr) {
+        int lod = std::get<2>(itr->first);
+        int distance = std::abs(lod - lodLevel);
+        if (distance < closestDistance || (distance == closestDistance && lod > lodLevel)) {
+            closest = &itr->second;
+            closestDistance = distance;
+        }
+    }
+    return closest;
+}
+
+void TerrainAccelerationStructureManager::setLodImporter(int lodLevel, vsg::ref_ptr<TerrainImporter> terrainImporter)
+{
+    lodImporters[lodLevel] = terrainImporter;
+}
+
+void TerrainAccelerationStructureManager::startStreaming(uint32_t workerCount, size_t maxResidentTiles)
+{
+    stopStreaming();
+    this->maxResidentTiles = maxResidentTiles;
+    // only a few tiles are queued at once, so requests for tiles that are no longer needed after a camera move stay cheap
+    maxPendingTiles = 2 * workerCount;
+    streamingThreads = vsg::OperationThreads::create(workerCount);
+}
+
+void TerrainAccelerationStructureManager::stopStreaming()
+{
+    if (!streamingThreads) return;
+
+    streamingThreads->stop();
+    streamingThreads = nullptr;
+    pendingTiles.clear();
+    finishedTiles.clear();
+}
+
+void TerrainAccelerationStructureManager::requestTiles(int minLod, vsg::dvec3 eyePosInTileCoords)
+{
+    if (!streamingThreads || pendingTiles.size() >= maxPendingTiles) return;
+
+    std::vector<std::pair<double, TerrainTileKey>> missingTiles;
+    for (uint32_t y = 0; y < tileCountY; ++y) {
+        for (uint32_t x = 0; x < tileCountX; ++x) {
+            TerrainTileKey key{ x, y, getTileLod(x, y, minLod, eyePosInTileCoords) };
+            if (residentTiles.count(key) || pendingTiles.count(key) || !lodImporters.count(std::get<2>(key))) continue;
+
+            vsg::dvec3 tilePos(x + 0.5, y + 0.5, 0.0);
+            missingTiles.emplace_back(vsg::length(tilePos - eyePosInTileCoords), key);
+        }
+    }
+
+    // closest tiles first
+    std::sort(missingTiles.begin(), missingTiles.end());
+    for (auto& [distance, key] : missingTiles) {
+        if (pendingTiles.size() >= maxPendingTiles) break;
+        pendingTiles.insert(key);
+        streamingThreads->add(LoadTerrainTileOperation::create(this, lodImporters[std::get<2>(key)], key));
+    }
+}
+
+bool TerrainAccelerationStructureManager::swapInFinishedTiles()
+{
+    std::vector<std::pair<TerrainTileKey, TerrainTile>> tiles;
+    {
+        std::scoped_lock lock(finishedTilesMutex);
+        tiles.swap(finishedTiles);
+    }
+
+    size_t swappedIn = 0;
+    for (auto& [key, tile] : tiles) {
+        pendingTiles.erase(key);
+        if (!tile.node) {
+            // the lod could not be imported, it is not requested again and the closest resident lod is used instead
+            std::cout << "Error: terrain lod " << std::get<2>(key) << " could not be imported, it is no longer streamed" << std::endl;
+            lodImporters.erase(std::get<2>(key));
+            continue;
+        }
+        residentTiles[key] = tile;
+        ++swappedIn;
+    }
+    if (swappedIn > 0) ++residentTilesVersion;
+    return swappedIn > 0;
+}
+
+bool TerrainAccelerationStructureManager::isResident(uint32_t x, uint32_t y, int lodLevel) const
+{
+    return residentTiles.count({ x, y, lodLevel }) > 0;
+}
+
+void TerrainAccelerationStructureManager::evictTiles()
+{
+    if (!streamingThreads) return;
+
+    std::vector<std::pair<uint64_t, TerrainTileKey>> candidates;
+    for (auto& [key, tile] : residentTiles) {
+        if (!tile.pinned) candidates.emplace_back(tile.lastUsed, key);
+    }
+    if (candidates.size() <= maxResidentTiles) return;
+
+    // least recently used first, tiles of the current and the previous selection may still be in use on the gpu
+    std::sort(candidates.begin(), candidates.end());
+    size_t evictCount = candidates.size() - maxResidentTiles;
+    for (auto& [lastUsed, key] : candidates) {
+        if (evictCount == 0 || lastUsed + 1 >= selectionGeneration) break;
+        residentTiles.erase(key);
+        ++residentTilesVersion;
+        --evictCount;
+    }
+}
@@ -2,25 +2,87 @@
 
 #include <vsg/all.h>
 #include "TerrainImporter.hpp"
+#include "TerrainTopLevelAccelerationStructure.hpp"
 
-using BlasTiles = vsg::Array3D<vsg::ref_ptr<vsg::GeometryInstance>>;
-using TileNodes = vsg::Array<vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>>>;
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
+
+// node and bottom level acceleration structure of a single tile at a single lod level
+struct TerrainTile
+{
+    vsg::ref_ptr<vsg::Node> node;
+    vsg::ref_ptr<vsg::GeometryInstance> geometryInstance;
+    uint64_t lastUsed = 0;      // selection generation in which the tile was last part of the scene
+    bool pinned = false;        // pinned tiles are never evicted
+};
+// tile x, tile y, lod level
+using TerrainTileKey = std::tuple<uint32_t, uint32_t, int>;
 
 class TerrainAccelerationStructureManager : public vsg::Inherit<vsg::Object, TerrainAccelerationStructureManager>
 {
 public:
+    // without a context the acceleration structures are created without a device and can't be compiled, e.g. in the cpu tests
     TerrainAccelerationStructureManager(uint32_t tileCountX, uint32_t tileCountY, uint32_t lodLevelCount, vsg::ref_ptr<vsg::Context> context);
     void loadLodLevel(vsg::ref_ptr<TerrainImporter> terrainImporter, int lodLevel);
     vsg::ref_ptr<vsg::TopLevelAccelerationStructure> createTlas(int lodLevel, bool test);
     vsg::ref_ptr<vsg::Node> createScene(int lodLevel);
     std::pair<vsg::ref_ptr<vsg::TopLevelAccelerationStructure>, vsg::ref_ptr<vsg::Node>> createTlasAndScene(int minLod, vsg::dvec3 eyePosInTileCoords);
+    // scene of all resident tiles from minLod on, the instance id of every tile is set to the index of its mesh in the scene
     vsg::ref_ptr<vsg::Node> createCompleteScene(int minLod);
+
+    // selected geometry instance of every tile slot (y * tileCountX + x, nullptr if the tile is not resident) and the matching scene
+    // without assignInstanceIds the tiles keep the instance ids of the last createCompleteScene()
+    std::pair<vsg::GeometryInstances, vsg::ref_ptr<vsg::Node>> selectTiles(int minLod, vsg::dvec3 eyePosInTileCoords, bool assignInstanceIds = true);
+    // tlas with one slot per tile which is kept over lod changes, see TerrainTopLevelAccelerationStructure::updateInstances()
+    vsg::ref_ptr<TerrainTopLevelAccelerationStructure> getPersistentTlas();
+
+    // lod level a tile should be displayed with for the given eye position
+    int getTileLod(uint32_t x, uint32_t y, int minLod, vsg::dvec3 eyePosInTileCoords) const;
+
+    // streaming: tiles of lod levels with an importer are imported on worker threads when requested by requestTiles()
+    // at most maxResidentTiles unpinned tiles are kept, the least recently used ones are evicted first
+    void setLodImporter(int lodLevel, vsg::ref_ptr<TerrainImporter> terrainImporter);
+    void startStreaming(uint32_t workerCount, size_t maxResidentTiles);
+    void stopStreaming();
+    // queues the import of all tiles needed for the eye position which are neither resident nor pending
+    void requestTiles(int minLod, vsg::dvec3 eyePosInTileCoords);
+    // moves finished tiles into the resident set, returns true if new tiles became available
+    bool swapInFinishedTiles();
+    bool isResident(uint32_t x, uint32_t y, int lodLevel) const;
+    size_t residentTileCount() const { return residentTiles.size(); }
+    size_t pendingTileCount() const { return pendingTiles.size(); }
+    // changes whenever tiles become resident or are evicted, a complete scene has to be recreated then
+    uint64_t getResidentTilesVersion() const { return residentTilesVersion; }
+
+protected:
+    virtual ~TerrainAccelerationStructureManager();
+
 private:
+    friend class LoadTerrainTileOperation;
+
+    // returns the resident tile closest to the requested lod level, nullptr if the tile is not resident at any lod level
+    TerrainTile* findTile(uint32_t x, uint32_t y, int lodLevel);
+    void evictTiles();
+    vsg::Device* device() const { return context ? context->device.get() : nullptr; }
+
     uint32_t tileCountX;
     uint32_t tileCountY;
     uint32_t lodLevelCount;
     vsg::ref_ptr<vsg::Context> context;
 
-    vsg::ref_ptr<BlasTiles> blasTiles;
-    vsg::ref_ptr<TileNodes> tileNodes;
+    std::map<TerrainTileKey, TerrainTile> residentTiles;
+    vsg::ref_ptr<TerrainTopLevelAccelerationStructure> persistentTlas;
+    uint64_t selectionGeneration = 0;
+    uint64_t residentTilesVersion = 0;
+
+    std::map<int, vsg::ref_ptr<TerrainImporter>> lodImporters;
+    vsg::ref_ptr<vsg::OperationThreads> streamingThreads;
+    uint32_t maxPendingTiles = 0;
+    size_t maxResidentTiles = 0;
+    std::set<TerrainTileKey> pendingTiles;
+    std::mutex finishedTilesMutex;
+    std::vector<std::pair<TerrainTileKey, TerrainTile>> finishedTiles;
 };
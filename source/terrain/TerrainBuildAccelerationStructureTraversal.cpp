@@ -0,0 +1,27 @@
+#include "TerrainBuildAccelerationStructureTraversal.hpp"
+#include "TerrainImporter.hpp"
+
+TerrainBuildAccelerationStructureTraversal::TerrainBuildAccelerationStructureTraversal(vsg::Device* device) :
+    vsg::BuildAccelerationStructureTraversal(device)
+{
+}
+
+void TerrainBuildAccelerationStructureTraversal::apply(vsg::VertexIndexDraw& vid)
+{
+    uint32_t gridWidth = 0;
+    if (vid.arrays.empty() || !vid.getValue("gridWidth", gridWidth)) {
+        vsg::BuildAccelerationStructureTraversal::apply(vid);
+        return;
+    }
+
+    auto& blas = _vertexIndexDrawBlasMap[&vid];
+    if (!blas) {
+        blas = vsg::BottomLevelAccelerationStructure::create(_device);
+        auto accelGeom = vsg::AccelerationGeometry::create();
+        accelGeom->assignVertices(TerrainImporter::gridPositions(vid));
+        accelGeom->assignIndices(vid.indices->data);
+        blas->geometries.push_back(accelGeom);
+    }
+
+    createGeometryInstance(blas);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vsg/all.h>
+
+// creates the bottom level acceleration structures like vsg::BuildAccelerationStructureTraversal. compact terrain tiles only
+// store heights, their full positions are expanded for the acceleration structure build
+class TerrainBuildAccelerationStructureTraversal : public vsg::BuildAccelerationStructureTraversal
+{
+public:
+    explicit TerrainBuildAccelerationStructureTraversal(vsg::Device* device);
+
+    using vsg::BuildAccelerationStructureTraversal::apply;
+    void apply(vsg::VertexIndexDraw& vid) override;
+};
@@ -1,18 +1,59 @@
 #include "TerrainImporter.hpp"
+#include "La2dFile.hpp"
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+namespace {
+    // the index and normal arrays shared between tiles are only observed, they are released with the last tile using them
+    std::mutex gridDataMutex;
+    std::map<std::tuple<long, long, bool>, vsg::observer_ptr<vsg::Data>> gridIndices;
+    vsg::observer_ptr<vsg::vec3Array> gridNormals;
+}
 
-TerrainImporter::TerrainImporter(const vsg::Path& heightmapPath, const vsg::Path& texturePath, float terrainScale, float terrainScaleVertexHeight, bool terrainFormatLa2d, bool textureFormatS3tc, int heightmapLod, int textureLod, int test, uint32_t tileCountX, uint32_t tileCountY, int tileLengthLodFactor) :
-    heightmapPath(heightmapPath), texturePath(texturePath), terrainScale(terrainScale), terrainScaleVertexHeight(terrainScaleVertexHeight), terrainFormatLa2d(terrainFormatLa2d), textureFormatS3tc(textureFormatS3tc), heightmapLod(heightmapLod), textureLod(textureLod), test(test), tileCountX(tileCountX), tileCountY(tileCountY), tileLengthLodFactor(tileLengthLodFactor) {
+TerrainImporter::TerrainImporter(const vsg::Path& heightmapPath, const vsg::Path& texturePath, float terrainScale, float terrainScaleVertexHeight, bool terrainFormatLa2d, bool textureFormatS3tc, int heightmapLod, int textureLod, int test, uint32_t tileCountX, uint32_t tileCountY, int tileLengthLodFactor, bool compactVertices, bool edgeSkirts) :
+    heightmapPath(heightmapPath), texturePath(texturePath), terrainScale(terrainScale), terrainScaleVertexHeight(terrainScaleVertexHeight), terrainFormatLa2d(terrainFormatLa2d), textureFormatS3tc(textureFormatS3tc), heightmapLod(heightmapLod), textureLod(textureLod), test(test), tileCountX(tileCountX), tileCountY(tileCountY), tileLengthLodFactor(tileLengthLodFactor), compactVertices(compactVertices), edgeSkirts(edgeSkirts) {
     if (heightmapLod < -tileLengthLodFactor) {
         std::cout << "Error: TerrainImporter: heightmapLod < -tileLengthLodFactor!" << std::endl;
     }
 }
 
 vsg::ref_ptr<vsg::Node> TerrainImporter::importTerrain() {
+    std::call_once(dataImported, [this]() { importData(); });
+
+    std::cout << "creating geometry...";
+    auto terrain = createGeometry();
+    std::cout << "done" << std::endl;
+    loadedScene = terrain;
+    releaseData();
+    return terrain;
+}
+
+vsg::ref_ptr<vsg::Node> TerrainImporter::importTile(int tileX, int tileY) {
+    std::call_once(dataImported, [this]() { importData(); });
+
+    if (dataReleased) {
+        throw vsg::Exception{"Error: TerrainImporter::importTile(...) the source data was released by importTerrain()."};
+    }
+    return createTileNode(tileX, tileY);
+}
+
+void TerrainImporter::releaseData() {
+    // all tiles are built, the texture stays referenced by the tile state until it is uploaded
+    std::vector<float>().swap(heightmapLa2dBuffer);
+    heightmap = nullptr;
+    texture = nullptr;
+    dataReleased = true;
+}
+
+void TerrainImporter::importData() {
     auto options = vsg::Options::create(vsgXchange::assimp::create(), vsgXchange::dds::create(), vsgXchange::stbi::create(), vsgXchange::openexr::create());
 
     if (terrainFormatLa2d) {
-        int headerSize = 8192;
-
         std::cout << "importing heightmap la2d data...";
 
         vsg::Path heightmapFullPath = heightmapPath;
@@ -25,45 +66,19 @@ vsg::ref_ptr<vsg::Node> TerrainImporter::importTerrain() {
             heightmapFullPath.append(".la2d");
         }
 
-        heightmapIfs = std::ifstream(heightmapFullPath, std::ios::in | std::ios::binary);
-        heightmapIfs.seekg(24);
-        heightmapIfs.read(reinterpret_cast<char*>(&heightmapActualWidth), sizeof(heightmapActualWidth));
-        heightmapIfs.read(reinterpret_cast<char*>(&heightmapActualHeight), sizeof(heightmapActualHeight));
-        uint32_t heightmapTileWidth;
-        uint32_t heightmapTileHeight;
-        heightmapIfs.read(reinterpret_cast<char*>(&heightmapTileWidth), sizeof(heightmapTileWidth));
-        heightmapIfs.read(reinterpret_cast<char*>(&heightmapTileHeight), sizeof(heightmapTileHeight));
-        heightmapIfs.seekg(headerSize);
-
-        heightmapFullWidth = ((heightmapActualWidth / heightmapTileWidth) + 1) * heightmapTileWidth;
-        heightmapFullHeight = ((heightmapActualHeight / heightmapTileHeight) + 1) * heightmapTileHeight;
-
-        heightmapLa2dBuffer = new float[heightmapFullWidth * heightmapFullHeight];
-
-        for (int yOffset = 0; yOffset < heightmapFullHeight; yOffset += heightmapTileHeight) {
-            for (int xOffset = 0; xOffset < heightmapFullWidth; xOffset += heightmapTileWidth) {
-                for (int y = 0; y < heightmapTileHeight; y++) {
-                    for (int x = 0; x < heightmapTileWidth; x++) {
-                        float inputValue;
-                        if (heightmapIfs.read(reinterpret_cast<char*>(&inputValue), sizeof(inputValue))) {
-                            heightmapLa2dBuffer[heightmapFullWidth * (yOffset + y) + xOffset + x] = inputValue;
-                        }
-                        else {
-                            std::cout << "error: could not read from file" << std::endl;
-                        }
-                    }
-                }
-            }
-        }
-        uint8_t inputValue;
-        if (!heightmapIfs.read(reinterpret_cast<char*>(&inputValue), sizeof(inputValue))) {
-            //std::cout << "end of file check" << std::endl;
-            std::cout << "done" << std::endl;
-        }
-        else {
-            std::cout << "error: end of file not yet reached?" << std::endl;
+        auto heightmapFile = La2dFile::create(heightmapFullPath);
+        heightmapActualWidth = heightmapFile->actualWidth;
+        heightmapActualHeight = heightmapFile->actualHeight;
+        heightmapFullWidth = heightmapFile->fullWidth;
+        heightmapFullHeight = heightmapFile->fullHeight;
+
+        heightmapLa2dBuffer.resize(size_t(heightmapFullWidth) * heightmapFullHeight);
+        if (!heightmapFile->detile(heightmapLa2dBuffer.data(), sizeof(float))) {
+            std::vector<float>().swap(heightmapLa2dBuffer);
+            throw vsg::Exception{"Error: TerrainImporter::importData() could not read the heightmap " + heightmapFullPath + "."};
         }
-        //std::cout << "heightmap la2d data imported" << std::endl;
+        std::cout << "done" << std::endl;
+        heightmapFile = nullptr;
 
 
 
@@ -82,66 +97,31 @@ vsg::ref_ptr<vsg::Node> TerrainImporter::importTerrain() {
             textureFullPath.append(".la2d");
         }
 
-        textureIfs = std::ifstream(textureFullPath, std::ios::in | std::ios::binary);
-        textureIfs.seekg(24);
-        textureIfs.read(reinterpret_cast<char*>(&textureActualWidth), sizeof(textureActualWidth));
-        textureIfs.read(reinterpret_cast<char*>(&textureActualHeight), sizeof(textureActualHeight));
-        uint32_t textureTileWidth;
-        uint32_t textureTileHeight;
-        textureIfs.read(reinterpret_cast<char*>(&textureTileWidth), sizeof(textureTileWidth));
-        textureIfs.read(reinterpret_cast<char*>(&textureTileHeight), sizeof(textureTileHeight));
-        textureIfs.seekg(headerSize);
+        auto textureFile = La2dFile::create(textureFullPath);
+        textureActualWidth = textureFile->actualWidth;
+        textureActualHeight = textureFile->actualHeight;
+        textureFullWidth = textureFile->fullWidth;
+        textureFullHeight = textureFile->fullHeight;
 
-        textureFullWidth = ((textureActualWidth / textureTileWidth) + 1) * textureTileWidth;
-        textureFullHeight = ((textureActualHeight / textureTileHeight) + 1) * textureTileHeight;
-
-        auto textureLa2dBufferS3tc = new uint8_t[0][8];
-        auto textureLa2dBufferRgb = new uint8_t[0][3];
-
-        int channelsToLoad;
-        int componentsToLoad;
+        uint8_t(*textureLa2dBufferS3tc)[8] = nullptr;
+        uint8_t(*textureLa2dBufferRgb)[3] = nullptr;
 
+        bool textureLoaded;
         if (textureFormatS3tc) {
-            channelsToLoad = 8;
-            //componentsToLoad = width / 4 * height / 4;
-            componentsToLoad = textureFullWidth * textureFullHeight;
             textureLa2dBufferS3tc = new uint8_t[textureFullWidth * textureFullHeight * 16][8];
+            textureLoaded = textureFile->detile(textureLa2dBufferS3tc, sizeof(uint8_t[8]));
         } else {
-            channelsToLoad = 3;
-            componentsToLoad = textureFullWidth * textureFullHeight;
             textureLa2dBufferRgb = new uint8_t[textureFullWidth * textureFullHeight][3];
+            textureLoaded = textureFile->detile(textureLa2dBufferRgb, sizeof(uint8_t[3]));
         }
-
-        for (int yOffset = 0; yOffset < textureFullHeight; yOffset += textureTileHeight) {
-            for (int xOffset = 0; xOffset < textureFullWidth; xOffset += textureTileWidth) {
-                for (int y = 0; y < textureTileHeight; y++) {
-                    for (int x = 0; x < textureTileWidth; x++) {
-                        for (int channel = 0; channel < channelsToLoad; channel++) {
-                            if (textureIfs.read(reinterpret_cast<char*>(&inputValue), sizeof(inputValue))) {
-                                if (textureFormatS3tc) {
-                                    textureLa2dBufferS3tc[textureFullWidth * (yOffset + y) + xOffset + x][channel] = inputValue;
-                                }
-                                else {
-                                    textureLa2dBufferRgb[textureFullWidth * (yOffset + y) + xOffset + x][channel] = inputValue;
-                                }
-                            }
-                            else {
-                                std::cout << "error: could not read from file" << std::endl;
-                            }
-                        }
-                    }
-                }
-            }
+        if (!textureLoaded) {
+            delete[] textureLa2dBufferS3tc;
+            delete[] textureLa2dBufferRgb;
+            std::vector<float>().swap(heightmapLa2dBuffer);
+            throw vsg::Exception{"Error: TerrainImporter::importData() could not read the texture " + textureFullPath + "."};
         }
-
-        if (!textureIfs.read(reinterpret_cast<char*>(&inputValue), sizeof(inputValue))) {
-            //std::cout << "end of file check" << std::endl;
-            std::cout << "done" << std::endl;
-        }
-        else {
-            std::cout << "error: end of file not yet reached?" << std::endl;
-        }
-        //std::cout << "texture la2d data imported" << std::endl;
+        std::cout << "done" << std::endl;
+        textureFile = nullptr;
 
         VkFormat textureFormat;
         if (textureFormatS3tc) {
@@ -180,11 +160,7 @@ vsg::ref_ptr<vsg::Node> TerrainImporter::importTerrain() {
         }
     }
 
-    std::cout << "creating geometry...";
-    auto terrain = createGeometry();
-    std::cout << "done" << std::endl;
-    loadedScene = terrain;
-    return terrain;
+    prepareTiles();
 }
 
 uint32_t TerrainImporter::getVertexIndex(long x, long y, long width)
@@ -252,9 +228,32 @@ vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>> TerrainImporter::createTileN
 {
     auto tileNodes = vsg::Array2D<vsg::ref_ptr<vsg::Node>>::create(tileCountX, tileCountY);
 
-    auto state = loadTextureMaterials();
+    // tiles are independent of each other, so they are distributed over worker threads which fetch the next free tile
+    uint32_t tileCount = tileCountX * tileCountY;
+    uint32_t threadCount = std::max(1u, std::min(workerCount ? workerCount : std::thread::hardware_concurrency(), tileCount));
+    std::atomic<uint32_t> nextTile{ 0 };
+    std::vector<std::future<void>> workers;
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        workers.push_back(std::async(std::launch::async, [&]() {
+            for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++) {
+                int tileX = tile % tileCountX;
+                int tileY = tile / tileCountX;
+                tileNodes->set(tileX, tileY, createTileNode(tileX, tileY));
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+
+    return tileNodes;
+}
+
+void TerrainImporter::prepareTiles()
+{
+    tileState = loadTextureMaterials();
 
-    float heightOffset = -heightmapLa2dBuffer[0];
+    heightOffset = terrainFormatLa2d ? -heightmapLa2dBuffer[0] : 0.0f;
 
     scaleModifier = terrainScale * 20.0f;
     if (terrainFormatLa2d) {
@@ -264,96 +263,258 @@ vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>> TerrainImporter::createTileN
         scaleModifier /= heightmapFullWidth;
     }
 
-    long tileLength = 1L << (heightmapLod + tileLengthLodFactor);
+    tileLength = 1L << (heightmapLod + tileLengthLodFactor);
+}
 
-    for (int tileY = 0; tileY < tileCountY; ++tileY)
-    {
-        for (int tileX = 0; tileX < tileCountX; ++tileX)
-        {
-            //int tileStartX = (heightmapActualWidth - 1) * tileX / tileCountX;
-            //int tileEndX = (heightmapActualWidth - 1) * (tileX + 1) / tileCountX;
-            //int tileWidth = tileEndX - tileStartX + 1;
-
-            //int tileStartY = (heightmapActualHeight - 1) * tileY / tileCountY;
-            //int tileEndY = (heightmapActualHeight - 1) * (tileY + 1) / tileCountY;
-            //int tileHeight = tileEndY - tileStartY + 1;
-
-            long tileStartX = tileLength * tileX;
-            long tileEndX = tileLength * (tileX + 1);
-            long tileWidth = tileLength + 1;
-
-            long tileStartY = tileLength * tileY;
-            long tileEndY = tileLength * (tileY + 1);
-            long tileHeight = tileLength + 1;
-
-
-            long numPixels = tileWidth * tileHeight;
-            long mNumVertices = numPixels;
-            auto vertices = vsg::vec3Array::create(mNumVertices);
-            auto normals = vsg::vec3Array::create(mNumVertices);
-            auto texcoords = vsg::vec2Array::create(mNumVertices);
-            std::vector<uint32_t> indices;
-
-            for (long y = 0; y < tileHeight; ++y) {
-                for (long x = 0; x < tileWidth; ++x) {
-                    vertices->at(getVertexIndex(x, y, tileWidth)) = getHeightmapVertexPosition(x, y, tileStartX, tileStartY, heightOffset);
-                    texcoords->at(getVertexIndex(x, y, tileWidth)) = getTextureCoordinate(x + tileStartX, y + tileStartY);
-
-                    if (x < tileWidth - 1 && y < tileHeight - 1) {
-                        indices.push_back(getVertexIndex(x, y, tileWidth));
-                        indices.push_back(getVertexIndex(x, y + 1, tileWidth));
-                        indices.push_back(getVertexIndex(x + 1, y, tileWidth));
-
-                        indices.push_back(getVertexIndex(x, y + 1, tileWidth));
-                        indices.push_back(getVertexIndex(x + 1, y + 1, tileWidth));
-                        indices.push_back(getVertexIndex(x + 1, y, tileWidth));
-                    }
-                }
-            }
+vsg::ref_ptr<vsg::Node> TerrainImporter::createTileNode(int tileX, int tileY)
+{
+    long tileStartX = tileLength * tileX;
+    long tileWidth = tileLength + 1;
+
+    long tileStartY = tileLength * tileY;
+    long tileHeight = tileLength + 1;
+
+    long numPixels = tileWidth * tileHeight;
+    long borderVertexCount = edgeSkirts ? getBorderVertexCount(tileWidth, tileHeight) : 0;
+    // every border vertex gets a top and a bottom skirt vertex after the grid vertices
+    long mNumVertices = numPixels + 2 * borderVertexCount;
+    // compact tiles only store the height of every vertex, x and y follow from the grid position and the vertex spacing
+    vsg::ref_ptr<vsg::vec3Array> vertices;
+    vsg::ref_ptr<vsg::floatArray> heights;
+    if (compactVertices) {
+        heights = vsg::floatArray::create(mNumVertices);
+    }
+    else {
+        vertices = vsg::vec3Array::create(mNumVertices);
+    }
+    auto setVertex = [&](long index, const vsg::vec3& vertex) {
+        if (heights) {
+            heights->at(index) = vertex.z;
+        }
+        else {
+            vertices->at(index) = vertex;
+        }
+    };
 
-            for (int j = 0; j < mNumVertices; ++j)
-            {
-                normals->at(j) = vsg::vec3(0, 0, 0);
-                //texcoords->at(j) = vsg::vec2(0, 0);
-            }
+    float minHeight = std::numeric_limits<float>::max();
+    float maxHeight = std::numeric_limits<float>::lowest();
+    for (long y = 0; y < tileHeight; ++y) {
+        for (long x = 0; x < tileWidth; ++x) {
+            auto vertex = getHeightmapVertexPosition(x, y, tileStartX, tileStartY, heightOffset);
+            setVertex(getVertexIndex(x, y, tileWidth), vertex);
+            minHeight = std::min(minHeight, vertex.z);
+            maxHeight = std::max(maxHeight, vertex.z);
+        }
+    }
 
-            vsg::ref_ptr<vsg::Data> vsg_indices;
+    // skirts hang down from the tile border and close the cracks to neighbouring tiles with a different lod,
+    // they don't depend on the neighbours, so the same tile mesh works for every combination of neighbour lods
+    // the skirt reaches the height range of the tile below the lowest vertex, which covers the border of any coarser or finer neighbour
+    float skirtBottom = minHeight - std::max(maxHeight - minHeight, 0.01f * float(tileLength) * scaleModifier);
+    for (long k = 0; k < borderVertexCount; ++k) {
+        long x, y;
+        getBorderVertex(k, tileWidth, tileHeight, x, y);
+        auto top = getHeightmapVertexPosition(x, y, tileStartX, tileStartY, heightOffset);
+        setVertex(numPixels + 2 * k, top);
+        setVertex(numPixels + 2 * k + 1, vsg::vec3(top.x, top.y, skirtBottom));
+    }
 
-            if (indices.size() < std::numeric_limits<uint16_t>::max())
-            {
-                auto myindices = vsg::ushortArray::create(static_cast<uint16_t>(indices.size()));
-                std::copy(indices.begin(), indices.end(), myindices->data());
-                vsg_indices = myindices;
-            }
-            else
-            {
-                auto myindices = vsg::uintArray::create(static_cast<uint32_t>(indices.size()));
-                std::copy(indices.begin(), indices.end(), myindices->data());
-                vsg_indices = myindices;
+    vsg::ref_ptr<vsg::vec3Array> normals;
+    vsg::ref_ptr<vsg::vec2Array> texcoords;
+    if (compactVertices) {
+        // positions, normals and texture coordinates are derived from the grid position in the closest hit shader, the texcoord
+        // array only holds the uv of the first vertex, the uv step between two vertices and the vertex spacing. the tile origin
+        // is the translation of the tile transform
+        normals = getGridNormals();
+        texcoords = vsg::vec2Array::create(3);
+        texcoords->at(0) = getTextureCoordinate(tileStartX, tileStartY);
+        texcoords->at(1) = getTextureCoordinate(1, 1) - getTextureCoordinate(0, 0);
+        texcoords->at(2) = vsg::vec2(scaleModifier, -scaleModifier);
+    }
+    else {
+        normals = vsg::vec3Array::create(mNumVertices);
+        texcoords = vsg::vec2Array::create(mNumVertices);
+        for (long y = 0; y < tileHeight; ++y) {
+            for (long x = 0; x < tileWidth; ++x) {
+                texcoords->at(getVertexIndex(x, y, tileWidth)) = getTextureCoordinate(x + tileStartX, y + tileStartY);
             }
+        }
+        for (long k = 0; k < borderVertexCount; ++k) {
+            long x, y;
+            getBorderVertex(k, tileWidth, tileHeight, x, y);
+            texcoords->at(numPixels + 2 * k) = texcoords->at(numPixels + 2 * k + 1) = texcoords->at(getVertexIndex(x, y, tileWidth));
+        }
+
+        for (int j = 0; j < mNumVertices; ++j)
+        {
+            normals->at(j) = vsg::vec3(0, 0, 0);
+        }
+    }
+
+    auto vsg_indices = getGridIndices(tileWidth, tileHeight, edgeSkirts);
+
+    auto xform = vsg::MatrixTransform::create();
+    xform->matrix = vsg::translate(double(tileStartX) * scaleModifier, -double(tileStartY) * scaleModifier, 0.0);
+
+    auto stategroup = vsg::StateGroup::create();
+    xform->addChild(stategroup);
 
+    stategroup->add(tileState.first);
+    stategroup->add(tileState.second);
+
+    auto vid = vsg::VertexIndexDraw::create();
+    vsg::ref_ptr<vsg::Data> positions = vertices;
+    if (heights) {
+        positions = heights;
+    }
+    vid->assignArrays(vsg::DataList{ positions, normals, texcoords });
+    vid->assignIndices(vsg_indices);
+    vid->indexCount = vsg_indices->valueCount();
+    vid->instanceCount = 1;
+    if (compactVertices) {
+        vid->setValue("gridWidth", static_cast<uint32_t>(tileWidth));
+        vid->setValue("gridHeight", static_cast<uint32_t>(tileHeight));
+    }
+    stategroup->addChild(vid);
 
-            auto xform = vsg::MatrixTransform::create();
-            xform->matrix = vsg::translate(double(tileStartX) * scaleModifier, -double(tileStartY) * scaleModifier, 0.0);
-            //scenegraph->addChild(xform);
-            tileNodes->set(tileX, tileY, xform);
+    return xform;
+}
+
+vsg::ref_ptr<vsg::Data> TerrainImporter::getGridIndices(long tileWidth, long tileHeight, bool skirts)
+{
+    // all tiles of a resolution share the same topology, so one index array per resolution is used for every tile and lod level
+    std::scoped_lock lock(gridDataMutex);
+    auto& cachedIndices = gridIndices[{ tileWidth, tileHeight, skirts }];
+    vsg::ref_ptr<vsg::Data> indices = cachedIndices;
+    if (indices) {
+        return indices;
+    }
+
+    // the index count of a regular grid is known up front, so the index array is allocated at its final size
+    size_t gridIndexCount = size_t(tileWidth - 1) * size_t(tileHeight - 1) * 6;
+    size_t indexCount = gridIndexCount + (skirts ? size_t(getBorderVertexCount(tileWidth, tileHeight)) * 6 : 0);
+    if (indexCount < std::numeric_limits<uint16_t>::max())
+    {
+        auto myindices = vsg::ushortArray::create(static_cast<uint16_t>(indexCount));
+        fillGridIndices(myindices->data(), tileWidth, tileHeight);
+        if (skirts) fillSkirtIndices(myindices->data() + gridIndexCount, tileWidth, tileHeight);
+        indices = myindices;
+    }
+    else
+    {
+        auto myindices = vsg::uintArray::create(static_cast<uint32_t>(indexCount));
+        fillGridIndices(myindices->data(), tileWidth, tileHeight);
+        if (skirts) fillSkirtIndices(myindices->data() + gridIndexCount, tileWidth, tileHeight);
+        indices = myindices;
+    }
+    cachedIndices = indices;
+    return indices;
+}
 
-            auto stategroup = vsg::StateGroup::create();
-            xform->addChild(stategroup);
+vsg::ref_ptr<vsg::vec3Array> TerrainImporter::getGridNormals()
+{
+    // the single normal of the compact tiles, the shader derives the actual normals
+    std::scoped_lock lock(gridDataMutex);
+    vsg::ref_ptr<vsg::vec3Array> normals = gridNormals;
+    if (!normals) {
+        normals = vsg::vec3Array::create(1, vsg::vec3(0.0f, 0.0f, 1.0f));
+        gridNormals = normals;
+    }
+    return normals;
+}
 
-            stategroup->add(state.first);
-            stategroup->add(state.second);
+vsg::ref_ptr<vsg::vec3Array> TerrainImporter::gridPositions(const vsg::VertexIndexDraw& vid)
+{
+    uint32_t gridWidth = 0, gridHeight = 0;
+    vid.getValue("gridWidth", gridWidth);
+    vid.getValue("gridHeight", gridHeight);
+    auto heights = vid.arrays[0]->data.cast<vsg::floatArray>();
+    auto spacing = vid.arrays[2]->data.cast<vsg::vec2Array>()->at(2);
+
+    // same layout as unpackGridVertex() in geometry.glsl: the grid row by row, then pairs of top and bottom skirt vertices
+    auto positions = vsg::vec3Array::create(heights->size());
+    long numPixels = long(gridWidth) * gridHeight;
+    for (long i = 0; i < long(heights->size()); ++i) {
+        long x = i % gridWidth, y = i / gridWidth;
+        if (i >= numPixels) {
+            getBorderVertex((i - numPixels) / 2, gridWidth, gridHeight, x, y);
+        }
+        positions->at(i) = vsg::vec3(float(x) * spacing.x, float(y) * spacing.y, heights->at(i));
+    }
+    return positions;
+}
 
-            auto vid = vsg::VertexIndexDraw::create();
-            vid->assignArrays(vsg::DataList{ vertices, normals, texcoords });
-            vid->assignIndices(vsg_indices);
-            vid->indexCount = indices.size();
-            vid->instanceCount = 1;
-            stategroup->addChild(vid);
+template<typename T>
+void TerrainImporter::fillGridIndices(T* indices, long tileWidth, long tileHeight)
+{
+    size_t i = 0;
+    for (long y = 0; y < tileHeight - 1; ++y) {
+        for (long x = 0; x < tileWidth - 1; ++x) {
+            indices[i++] = static_cast<T>(getVertexIndex(x, y, tileWidth));
+            indices[i++] = static_cast<T>(getVertexIndex(x, y + 1, tileWidth));
+            indices[i++] = static_cast<T>(getVertexIndex(x + 1, y, tileWidth));
+
+            indices[i++] = static_cast<T>(getVertexIndex(x, y + 1, tileWidth));
+            indices[i++] = static_cast<T>(getVertexIndex(x + 1, y + 1, tileWidth));
+            indices[i++] = static_cast<T>(getVertexIndex(x + 1, y, tileWidth));
         }
     }
+}
 
-    return tileNodes;
+template<typename T>
+void TerrainImporter::fillSkirtIndices(T* indices, long tileWidth, long tileHeight)
+{
+    // one quad between each pair of consecutive border vertices, the skirt uses its own top vertices
+    // so the skirt faces don't change the computed normals of the grid
+    long gridVertexCount = tileWidth * tileHeight;
+    long borderVertexCount = getBorderVertexCount(tileWidth, tileHeight);
+    size_t i = 0;
+    for (long k = 0; k < borderVertexCount; ++k) {
+        long next = (k + 1) % borderVertexCount;
+        T top = static_cast<T>(gridVertexCount + 2 * k);
+        T bottom = static_cast<T>(gridVertexCount + 2 * k + 1);
+        T nextTop = static_cast<T>(gridVertexCount + 2 * next);
+        T nextBottom = static_cast<T>(gridVertexCount + 2 * next + 1);
+
+        indices[i++] = top;
+        indices[i++] = bottom;
+        indices[i++] = nextTop;
+
+        indices[i++] = bottom;
+        indices[i++] = nextBottom;
+        indices[i++] = nextTop;
+    }
+}
+
+long TerrainImporter::getBorderVertexCount(long tileWidth, long tileHeight)
+{
+    return 2 * (tileWidth - 1) + 2 * (tileHeight - 1);
+}
+
+void TerrainImporter::getBorderVertex(long k, long tileWidth, long tileHeight, long& x, long& y)
+{
+    // walks around the tile: first row, last column, last row backwards, first column backwards
+    // has to match gridBorderVertex() in geometry.glsl
+    if (k < tileWidth - 1) {
+        x = k;
+        y = 0;
+        return;
+    }
+    k -= tileWidth - 1;
+    if (k < tileHeight - 1) {
+        x = tileWidth - 1;
+        y = k;
+        return;
+    }
+    k -= tileHeight - 1;
+    if (k < tileWidth - 1) {
+        x = tileWidth - 1 - k;
+        y = tileHeight - 1;
+        return;
+    }
+    k -= tileWidth - 1;
+    x = 0;
+    y = tileHeight - 1 - k;
 }
 
 //using code from vsgXchange/assimp/assimp.cpp
@@ -5,6 +5,8 @@
 #include <vsgXchange/images.h>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <vector>
 
 //from vsgXchange/assimp/assimp.cpp
 struct SamplerData
@@ -39,9 +41,17 @@ enum aiTextureMapMode
 class TerrainImporter : public vsg::Inherit<vsg::Object, TerrainImporter>
 {
 public:
-    TerrainImporter(const vsg::Path& heightmapPath, const vsg::Path& texturePath, float terrainScale, float terrainVertexHeightToPixelRatio, bool terrainFormatLa2d, bool textureFormatS3tc, int heightmapLod, int textureLod, int test, uint32_t tileCountX, uint32_t tileCountY, int tileLengthLodFactor);
+    TerrainImporter(const vsg::Path& heightmapPath, const vsg::Path& texturePath, float terrainScale, float terrainVertexHeightToPixelRatio, bool terrainFormatLa2d, bool textureFormatS3tc, int heightmapLod, int textureLod, int test, uint32_t tileCountX, uint32_t tileCountY, int tileLengthLodFactor, bool compactVertices = false, bool edgeSkirts = false);
 
-    vsg::ref_ptr<vsg::Node> TerrainImporter::importTerrain();
+    // imports all tiles and releases the heightmap and texture data afterwards, importTile() can't be used after it
+    vsg::ref_ptr<vsg::Node> importTerrain();
+    // imports a single tile, the heightmap and texture data is loaded on the first call; safe to call from multiple threads
+    vsg::ref_ptr<vsg::Node> importTile(int tileX, int tileY);
+    // full positions of a compact tile, which only stores heights, for building its acceleration structure
+    static vsg::ref_ptr<vsg::vec3Array> gridPositions(const vsg::VertexIndexDraw& vid);
+
+    // threads used by importTerrain() to build the tiles, 0 uses one thread per core
+    uint32_t workerCount = 0;
 
     vsg::ref_ptr<vsg::Node> loadedScene;
     vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>> loadedTileNodes;
@@ -51,7 +61,7 @@ private:
     using State = std::pair<StateCommandPtr, StateCommandPtr>;
     using BindState = std::vector<State>;
 
-    const vsg::Path& heightmapPath, texturePath;
+    vsg::Path heightmapPath, texturePath;
     float terrainScale;
     float terrainScaleVertexHeight;
     bool terrainFormatLa2d;
@@ -61,14 +71,17 @@ private:
     uint32_t tileCountX;
     uint32_t tileCountY;
     int tileLengthLodFactor;
+    // tiles only store heights plus the vertex spacing, positions, normals and texture coordinates are derived from the grid in the shader
+    bool compactVertices;
+    // tiles get vertical skirts along their border which hide the cracks between tiles of different lod levels, off by default
+    // as the skirts add 2 * border vertices to every tile (--terrain-skirts)
+    bool edgeSkirts;
 
     int test;
 
 
 
-    std::ifstream heightmapIfs;
-    float* heightmapLa2dBuffer;
-    std::ifstream textureIfs;
+    std::vector<float> heightmapLa2dBuffer;
 
     vsg::ref_ptr<vsg::ubvec4Array2D> heightmap;
     vsg::ref_ptr<vsg::Data> texture;
@@ -85,12 +98,29 @@ private:
     int textureFullHeight;
 
     float scaleModifier;
-
-    uint32_t TerrainImporter::getVertexIndex(long x, long y, long width);
-    vsg::vec3 TerrainImporter::getHeightmapVertexPosition(long xTile, long yTile, long tileStartX, long tileStartY, float heightOffset);
-    vsg::vec2 TerrainImporter::getTextureCoordinate(long x, long y);
-    vsg::ref_ptr<vsg::Node> TerrainImporter::createGeometry();
-    vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>> TerrainImporter::createTileNodes();
-    TerrainImporter::State TerrainImporter::loadTextureMaterials();
-    std::string TerrainImporter::mat4ToString(vsg::mat4 m);
+    float heightOffset;
+    long tileLength;
+    State tileState;
+    std::once_flag dataImported;
+    bool dataReleased = false;
+
+    static uint32_t getVertexIndex(long x, long y, long width);
+    vsg::vec3 getHeightmapVertexPosition(long xTile, long yTile, long tileStartX, long tileStartY, float heightOffset);
+    vsg::vec2 getTextureCoordinate(long x, long y);
+    vsg::ref_ptr<vsg::Node> createGeometry();
+    vsg::ref_ptr<vsg::Array2D<vsg::ref_ptr<vsg::Node>>> createTileNodes();
+    void importData();
+    void releaseData();
+    void prepareTiles();
+    vsg::ref_ptr<vsg::Node> createTileNode(int tileX, int tileY);
+    static vsg::ref_ptr<vsg::Data> getGridIndices(long tileWidth, long tileHeight, bool skirts);
+    static vsg::ref_ptr<vsg::vec3Array> getGridNormals();
+    template<typename T>
+    static void fillGridIndices(T* indices, long tileWidth, long tileHeight);
+    template<typename T>
+    static void fillSkirtIndices(T* indices, long tileWidth, long tileHeight);
+    static long getBorderVertexCount(long tileWidth, long tileHeight);
+    static void getBorderVertex(long k, long tileWidth, long tileHeight, long& x, long& y);
+    TerrainImporter::State loadTextureMaterials();
+    std::string mat4ToString(vsg::mat4 m);
 };
\ No newline at end of file
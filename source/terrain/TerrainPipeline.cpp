@@ -22,10 +22,16 @@ namespace
 }
 
 TerrainPipeline::TerrainPipeline(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<GBuffer> gBuffer,
-                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin, uint32_t maxRecursionDepth) :
+                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin, uint32_t maxRecursionDepth,
+                 vsg::ref_ptr<RayCounters> rayCounters, vsg::ref_ptr<EnvironmentMap> environmentMap,
+                 vsg::ref_ptr<SobolSampler> sampler, vsg::ref_ptr<AdaptiveSampler> adaptiveSampler) :
     Inherit(gBuffer, illuminationBuffer)
 {
     this->maxRecursionDepth = maxRecursionDepth;
+    this->rayCounters = rayCounters;
+    this->environmentMap = environmentMap;
+    this->sampler = sampler;
+    this->adaptiveSampler = adaptiveSampler;
 
     if (writeGBuffer) assert(gBuffer);
     bool useExternalGBuffer = rayTracingRayOrigin == RayTracingRayOrigin::GBUFFER;
@@ -36,14 +42,7 @@ void TerrainPipeline::updateTlas(vsg::ref_ptr<vsg::AccelerationStructure> as, vs
 {
     auto tlas = as.cast<vsg::TopLevelAccelerationStructure>();
     assert(tlas);
-    for (int i = 0; i < tlas->geometryInstances.size(); ++i)
-    {
-        if (opaqueGeometries[i])
-            tlas->geometryInstances[i]->shaderOffset = 0;
-        else
-            tlas->geometryInstances[i]->shaderOffset = 1;
-        tlas->geometryInstances[i]->flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
-    }
+    setupGeometryInstances(tlas->geometryInstances);
     auto accelDescriptor = vsg::DescriptorAccelerationStructure::create(vsg::AccelerationStructures{ as }, 0, 0);
 
     //bindRayTracingDescriptorSet->descriptorSet->descriptors = vsg::Descriptors{ accelDescriptor };
@@ -73,14 +72,27 @@ void TerrainPipeline::updateTlas(vsg::ref_ptr<vsg::AccelerationStructure> as, vs
     bindRayTracingDescriptorSet->descriptorSet->compile(*context);
 }
 
+void TerrainPipeline::setupGeometryInstances(vsg::GeometryInstances& geometryInstances)
+{
+    // empty slots of a persistent tlas have no mesh in the scene, the instance id is the index of the mesh
+    for (auto& geometryInstance : geometryInstances)
+    {
+        if (!geometryInstance) continue;
+        if (opaqueGeometries[geometryInstance->id])
+            geometryInstance->shaderOffset = 0;
+        else
+            geometryInstance->shaderOffset = 1;
+        geometryInstance->flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
+    }
+}
+
 void TerrainPipeline::updateScene(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<vsg::Context> context) {
     // parsing data from scene
     TerrainRayTracingSceneDescriptorCreationVisitor buildDescriptorBinding;
     scene->accept(buildDescriptorBinding);
     opaqueGeometries = buildDescriptorBinding.isOpaque;
 
-    const int maxLights = 800;
-    if (buildDescriptorBinding.packedLights.size() > maxLights) lightSamplingMethod = LightSamplingMethod::SampleUniform;
+    // the light sampling method is compiled into the raygen shader, only the light bvh is rebuilt for the new lights
 
     std::cout << "descriptors: " << bindRayTracingDescriptorSet->descriptorSet->descriptors.size() << std::endl;
 
@@ -103,6 +115,24 @@ void TerrainPipeline::updateScene(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<vs
     illuminationBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
     if (gBuffer)
         gBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (rayCounters)
+        rayCounters->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (environmentMap)
+        environmentMap->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (sampler)
+        sampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (adaptiveSampler)
+        adaptiveSampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightBVH)
+    {
+        lightTree = LightBVH::create(buildDescriptorBinding.packedLights);
+        lightTree->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightStrength)
+    {
+        lightAliasTable = LightAliasTable::create(buildDescriptorBinding.packedLights);
+        lightAliasTable->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
 
     std::cout << "descriptors: " << bindRayTracingDescriptorSet->descriptorSet->descriptors.size() << std::endl;
 
@@ -115,11 +145,12 @@ void TerrainPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     scene->accept(buildDescriptorBinding);
     opaqueGeometries = buildDescriptorBinding.isOpaque;
 
+    // looping over all lights per shading point gets too expensive for many lights, the light bvh picks one in O(log n)
     const int maxLights = 800;
-    if(buildDescriptorBinding.packedLights.size() > maxLights) lightSamplingMethod = LightSamplingMethod::SampleUniform;
+    if(buildDescriptorBinding.packedLights.size() > maxLights) lightSamplingMethod = LightSamplingMethod::SampleLightBVH;
 
     //creating the shader stages and shader binding table
-    std::string raygenPath = "shaders/ptRaygen.rgen"; //raygen shader not yet precompiled
+    std::string raygenPath = "shaders/ptRaygen.rgen"; //precompiled per define set, see ShaderPermutations
     std::string raymissPath = "shaders/ptMiss.rmiss.spv";
     std::string shadowMissPath = "shaders/shadow.rmiss.spv";
     std::string closesthitPath = "shaders/ptClosesthit.rchit.spv";
@@ -129,7 +160,7 @@ void TerrainPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     auto raymissShader = vsg::ShaderStage::read(VK_SHADER_STAGE_MISS_BIT_KHR, "main", raymissPath);
     auto shadowMissShader = vsg::ShaderStage::read(VK_SHADER_STAGE_MISS_BIT_KHR, "main", shadowMissPath);
     auto closesthitShader = vsg::ShaderStage::read(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, "main", closesthitPath);
-    auto anyHitShader = vsg::ShaderStage::read(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, "main", anyHitPath);
+    auto anyHitShader = setupAnyHitShader(anyHitPath);
     if (!raygenShader || !raymissShader || !closesthitShader || !shadowMissShader || !anyHitShader)
     {
         throw vsg::Exception{"Error: TerrainPipeline::TerrainPipeline(...) failed to create shader stages."};
@@ -187,4 +218,22 @@ void TerrainPipeline::setupPipeline(vsg::Node *scene, bool useExternalGbuffer)
     illuminationBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
     if (gBuffer)
         gBuffer->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (rayCounters)
+        rayCounters->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (environmentMap)
+        environmentMap->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (sampler)
+        sampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (adaptiveSampler)
+        adaptiveSampler->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightBVH)
+    {
+        lightTree = LightBVH::create(buildDescriptorBinding.packedLights);
+        lightTree->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
+    if (lightSamplingMethod == LightSamplingMethod::SampleLightStrength)
+    {
+        lightAliasTable = LightAliasTable::create(buildDescriptorBinding.packedLights);
+        lightAliasTable->updateDescriptor(bindRayTracingDescriptorSet, bindingMap);
+    }
 }
\ No newline at end of file
@@ -15,10 +15,14 @@ class TerrainPipeline : public vsg::Inherit<PBRTPipeline, TerrainPipeline>
 {
 public:
     TerrainPipeline(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<GBuffer> gBuffer,
-                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin, uint32_t maxRecursionDepth);
+                 vsg::ref_ptr<IlluminationBuffer> illuminationBuffer, bool writeGBuffer, RayTracingRayOrigin rayTracingRayOrigin, uint32_t maxRecursionDepth,
+                 vsg::ref_ptr<RayCounters> rayCounters = {}, vsg::ref_ptr<EnvironmentMap> environmentMap = {},
+                 vsg::ref_ptr<SobolSampler> sampler = {}, vsg::ref_ptr<AdaptiveSampler> adaptiveSampler = {});
 
     void updateTlas(vsg::ref_ptr<vsg::AccelerationStructure> as, vsg::ref_ptr<vsg::Context> context);
     void updateScene(vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<vsg::Context> context);
+    // sets shader offset and flags of the geometry instances according to the scene of the last updateScene() call
+    void setupGeometryInstances(vsg::GeometryInstances& geometryInstances);
 protected:
     void setupPipeline(vsg::Node* scene, bool useExternalGBuffer);
 };
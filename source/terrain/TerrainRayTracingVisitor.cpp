@@ -37,6 +37,7 @@ void TerrainRayTracingSceneDescriptorCreationVisitor::apply(vsg::BindDescriptorS
                 if (vsgMat.transmissionFactor.x != 1 || vsgMat.transmissionFactor.y != 1 || vsgMat.transmissionFactor.z != 1)
                     mat.transmittanceIllum.w = 7;   // means that refraction and reflection should be active
                 _materialArray.push_back(mat);
+                currentMaterial = static_cast<int>(_materialArray.size()) - 1;
             }
             else
             {
@@ -61,6 +62,7 @@ void TerrainRayTracingSceneDescriptorCreationVisitor::apply(vsg::BindDescriptorS
                 if (vsgMat.transmissive.x != 1 || vsgMat.transmissive.y != 1 || vsgMat.transmissive.z != 1)
                     mat.transmittanceIllum.w = 7;   // means that refraction and reflection should be active
                 _materialArray.push_back(mat);
+                currentMaterial = static_cast<int>(_materialArray.size()) - 1;
             }
             continue;
         }
@@ -0,0 +1,181 @@
+#include "TerrainTopLevelAccelerationStructure.hpp"
+
+#include <cstring>
+
+namespace
+{
+    // build or refit of the terrain tlas, the changed instances are copied from a staging buffer into the instance buffer first.
+    // the barriers order the copy and the build after the ray tracing of the frames submitted before, which still read the old
+    // tlas, and the ray tracing of later frames after the build
+    class TerrainTlasBuildCommand : public vsg::Inherit<vsg::BuildAccelerationStructureCommand, TerrainTlasBuildCommand>
+    {
+    public:
+        TerrainTlasBuildCommand(vsg::Context& context, const VkAccelerationStructureBuildGeometryInfoKHR& info, const VkAccelerationStructureKHR& structure,
+                                const std::vector<uint32_t>& primitiveCounts) :
+            Inherit(context.device, info, structure, primitiveCounts, context.getAllocator()),
+            deviceID(context.deviceID)
+        {
+        }
+
+        void record(vsg::CommandBuffer& commandBuffer) const override
+        {
+            VkMemoryBarrier before{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR };
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &before, 0, nullptr, 0, nullptr);
+            if (!regions.empty()) {
+                vkCmdCopyBuffer(commandBuffer, staging->buffer->vk(deviceID), instances->buffer->vk(deviceID), static_cast<uint32_t>(regions.size()), regions.data());
+                VkMemoryBarrier copied{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT };
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &copied, 0, nullptr, 0, nullptr);
+            }
+
+            Inherit::record(commandBuffer);
+
+            VkMemoryBarrier built{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR };
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &built, 0, nullptr, 0, nullptr);
+        }
+
+        uint32_t deviceID;
+        vsg::ref_ptr<vsg::BufferInfo> staging, instances;
+        std::vector<VkBufferCopy> regions;
+    };
+}
+
+TerrainTopLevelAccelerationStructure::TerrainTopLevelAccelerationStructure(vsg::Device* device, uint32_t slotCount) :
+    Inherit(device),
+    slotCount(slotCount)
+{
+    _accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    geometryInstances.resize(slotCount);
+}
+
+void TerrainTopLevelAccelerationStructure::compile(vsg::Context& context)
+{
+    if (_instances) return; // already compiled
+
+    for (auto& geometryInstance : geometryInstances) {
+        if (geometryInstance) geometryInstance->accelerationStructure->compile(context);
+    }
+    _instances = vsg::VkGeometryInstanceArray::create(slotCount);
+    packInstances(geometryInstances, *_instances);
+
+    instanceBufferInfo = vsg::createHostVisibleBuffer(context.device, vsg::DataList{ _instances }, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE);
+    vsg::copyDataListToBuffers(context.device, instanceBufferInfo);
+    _instanceBuffer = instanceBufferInfo[0]->buffer;
+
+    vsg::Extensions* extensions = vsg::Extensions::Get(context.device, true);
+    VkBufferDeviceAddressInfo bufferDeviceAddressInfo{ VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, nullptr, _instanceBuffer->vk(context.deviceID) };
+    instancesGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    instancesGeometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    instancesGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+    instancesGeometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    instancesGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
+    instancesGeometry.geometry.instances.data.deviceAddress = extensions->vkGetBufferDeviceAddressKHR(*context.device, &bufferDeviceAddressInfo) + instanceBufferInfo[0]->offset;
+
+    _accelerationStructureBuildGeometryInfo.geometryCount = 1;
+    _accelerationStructureBuildGeometryInfo.pGeometries = &instancesGeometry;
+    _geometryPrimitiveCounts = { slotCount };
+
+    vsg::AccelerationStructure::compile(context);
+
+    addBuildCommand(context, false);
+}
+
+TerrainTlasChangeSet TerrainTopLevelAccelerationStructure::updateInstances(vsg::Context& context, const vsg::GeometryInstances& slots)
+{
+    if (slots.size() != slotCount) {
+        throw vsg::Exception{ "Error: TerrainTopLevelAccelerationStructure::updateInstances(...) slot count mismatch." };
+    }
+
+    if (!_instances) {
+        // first use, the whole tlas is built by compile
+        geometryInstances = slots;
+        compile(context);
+
+        TerrainTlasChangeSet changes;
+        changes.requiresRebuild = true;
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            if (slots[i]) changes.changedInstances.push_back(i);
+        }
+        return changes;
+    }
+
+    // newly streamed tiles need their blas built before the tlas references them
+    for (auto& geometryInstance : slots) {
+        if (geometryInstance) geometryInstance->accelerationStructure->compile(context);
+    }
+    geometryInstances = slots;
+
+    auto packed = vsg::VkGeometryInstanceArray::create(slotCount);
+    packInstances(slots, *packed);
+    auto changes = diffInstances(*_instances, *packed);
+    if (changes.empty()) return changes;
+
+    // the changed slots are staged and copied by the build command, runs of consecutive slots are copied as one region
+    auto& changed = changes.changedInstances;
+    auto staged = vsg::VkGeometryInstanceArray::create(static_cast<uint32_t>(changed.size()));
+    std::vector<VkBufferCopy> regions;
+    VkDeviceSize instanceSize = sizeof(vsg::VkGeometryInstance);
+    for (size_t i = 0; i < changed.size(); ++i) {
+        _instances->set(changed[i], packed->at(changed[i]));
+        staged->set(static_cast<uint32_t>(i), packed->at(changed[i]));
+        if (i > 0 && changed[i] == changed[i - 1] + 1) {
+            regions.back().size += instanceSize;
+        } else {
+            regions.push_back({ i * instanceSize, instanceBufferInfo[0]->offset + changed[i] * instanceSize, instanceSize });
+        }
+    }
+    auto stagingInfo = vsg::createHostVisibleBuffer(context.device, vsg::DataList{ staged }, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE);
+    vsg::copyDataListToBuffers(context.device, stagingInfo);
+    for (auto& region : regions) region.srcOffset += stagingInfo[0]->offset;
+
+    addBuildCommand(context, !changes.requiresRebuild, stagingInfo[0], regions);
+    return changes;
+}
+
+void TerrainTopLevelAccelerationStructure::packInstances(const vsg::GeometryInstances& slots, vsg::VkGeometryInstanceArray& packed)
+{
+    for (uint32_t i = 0; i < packed.valueCount(); ++i) {
+        if (i < slots.size() && slots[i]) {
+            packed.set(i, *slots[i]);
+        }
+        else {
+            // a null acceleration structure handle marks the instance as inactive
+            std::memset(&packed.at(i), 0, sizeof(vsg::VkGeometryInstance));
+        }
+    }
+}
+
+TerrainTlasChangeSet TerrainTopLevelAccelerationStructure::diffInstances(const vsg::VkGeometryInstanceArray& previous, const vsg::VkGeometryInstanceArray& current)
+{
+    TerrainTlasChangeSet changes;
+    if (previous.valueCount() != current.valueCount()) {
+        changes.requiresRebuild = true;
+        for (uint32_t i = 0; i < current.valueCount(); ++i) changes.changedInstances.push_back(i);
+        return changes;
+    }
+
+    for (uint32_t i = 0; i < current.valueCount(); ++i) {
+        auto& a = previous.at(i);
+        auto& b = current.at(i);
+        if (std::memcmp(&a, &b, sizeof(vsg::VkGeometryInstance)) == 0) continue;
+
+        changes.changedInstances.push_back(i);
+        if ((a.accelerationStructureHandle == 0) != (b.accelerationStructureHandle == 0)) changes.requiresRebuild = true;
+    }
+    return changes;
+}
+
+void TerrainTopLevelAccelerationStructure::addBuildCommand(vsg::Context& context, bool update, vsg::ref_ptr<vsg::BufferInfo> staging, const std::vector<VkBufferCopy>& regions)
+{
+    auto buildCommand = TerrainTlasBuildCommand::create(context, _accelerationStructureBuildGeometryInfo, _accelerationStructure, _geometryPrimitiveCounts);
+    buildCommand->staging = staging;
+    buildCommand->instances = instanceBufferInfo[0];
+    buildCommand->regions = regions;
+    if (update) {
+        // refit in place, src and dst are the same acceleration structure
+        buildCommand->_accelerationStructureInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+        buildCommand->_accelerationStructureInfo.srcAccelerationStructure = _accelerationStructure;
+    }
+    context.buildAccelerationStructureCommands.push_back(buildCommand);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vsg/all.h>
+#include <vector>
+
+// instance slots of a terrain tlas that differ between two tile selections
+struct TerrainTlasChangeSet
+{
+    std::vector<uint32_t> changedInstances;
+    // instances were activated or deactivated, which has to be handled by a full build instead of an update
+    bool requiresRebuild = false;
+
+    bool empty() const { return changedInstances.empty(); }
+};
+
+// top level acceleration structure with a fixed number of instance slots, one per terrain tile
+// the instance buffer is kept after compile, so a lod change only copies the changed slots into it and
+// refits the tlas with an update build instead of creating a new acceleration structure
+class TerrainTopLevelAccelerationStructure : public vsg::Inherit<vsg::TopLevelAccelerationStructure, TerrainTopLevelAccelerationStructure>
+{
+public:
+    TerrainTopLevelAccelerationStructure(vsg::Device* device, uint32_t slotCount);
+
+    void compile(vsg::Context& context) override;
+
+    // replaces the instances of all slots, nullptr marks an empty slot
+    // compiles the tlas on first use, the needed build commands are added to context.buildAccelerationStructureCommands
+    // the changed instances are copied on the gpu by the build command, which waits for the ray tracing of the frames submitted
+    // before, so frames may still be in flight
+    TerrainTlasChangeSet updateInstances(vsg::Context& context, const vsg::GeometryInstances& slots);
+
+    // cpu side of updateInstances, usable without a device
+    static void packInstances(const vsg::GeometryInstances& slots, vsg::VkGeometryInstanceArray& packed);
+    static TerrainTlasChangeSet diffInstances(const vsg::VkGeometryInstanceArray& previous, const vsg::VkGeometryInstanceArray& current);
+
+private:
+    // the regions are copied from staging into the instance buffer before the build
+    void addBuildCommand(vsg::Context& context, bool update, vsg::ref_ptr<vsg::BufferInfo> staging = {}, const std::vector<VkBufferCopy>& regions = {});
+
+    uint32_t slotCount;
+    vsg::BufferInfoList instanceBufferInfo;
+    VkAccelerationStructureGeometryKHR instancesGeometry{};
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+// checks of the cpu side unit tests, a failed check is reported and the test returns checkResult() != 0 from main
+inline int& checkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                                  \
+    do                                                                                                    \
+    {                                                                                                     \
+        if (!(condition))                                                                                 \
+        {                                                                                                 \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;       \
+            ++checkFailures();                                                                            \
+        }                                                                                                 \
+    } while (false)
+
+#define CHECK_NEAR(a, b, tolerance)                                                                       \
+    do                                                                                                    \
+    {                                                                                                     \
+        double checkA = (a), checkB = (b);                                                                \
+        if (!(std::abs(checkA - checkB) <= (tolerance)))                                                  \
+        {                                                                                                 \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #a " = " << checkA << " is not " \
+                      << checkB << " +- " << (tolerance) << std::endl;                                    \
+            ++checkFailures();                                                                            \
+        }                                                                                                 \
+    } while (false)
+
+inline int checkResult()
+{
+    if (checkFailures()) std::cout << checkFailures() << " checks failed" << std::endl;
+    return checkFailures() ? 1 : 0;
+}
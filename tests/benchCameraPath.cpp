@@ -0,0 +1,84 @@
+#include <io/CameraPath.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    template<typename F>
+    double measureMs(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double fileSizeMiB(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        return static_cast<double>(file.tellg()) / (1024.0 * 1024.0);
+    }
+}
+
+// writes an orbiting camera path as json and as binary camera path and compares importing all frames with MatrixIO to reading
+// them one by one from the mapped camera path, which is how the benchmark mode of the renderer plays a binary path
+int main(int argc, char** argv)
+{
+    uint32_t frameCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 100000;
+    CameraMatricesVec matrices(frameCount);
+    auto proj = vsg::perspective(vsg::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    for (uint32_t f = 0; f < frameCount; ++f)
+    {
+        float angle = 0.001f * f;
+        auto view = vsg::lookAt(vsg::vec3(10.0f * std::cos(angle), 10.0f * std::sin(angle), 2.0f), vsg::vec3(0.0f, 0.0f, 0.0f), vsg::vec3(0.0f, 0.0f, 1.0f));
+        matrices[f] = {view, vsg::inverse(view), proj, vsg::inverse(proj)};
+    }
+
+    const std::string jsonPath = "benchCameraPath.json";
+    const std::string binaryPath = std::string("benchCameraPath") + CameraPathFormat::extension;
+    double jsonWrite = measureMs([&]() { MatrixIO::exportMatrices(jsonPath, matrices); });
+    double binaryWrite = measureMs([&]() { MatrixIO::exportMatrices(binaryPath, matrices); });
+
+    CameraMatricesVec imported;
+    double jsonImport = measureMs([&]() { imported = MatrixIO::importMatrices(jsonPath); });
+    bool jsonValid = imported.size() == frameCount;
+    double binaryImport = measureMs([&]() { imported = MatrixIO::importMatrices(binaryPath); });
+    bool binaryValid = imported.size() == frameCount;
+
+    // the first frame is available right after mapping, the remaining frames are read while they are rendered
+    vsg::ref_ptr<CameraPath> cameraPath;
+    float checksum = 0.0f;
+    double binaryFirstFrame = measureMs([&]() {
+        cameraPath = CameraPath::open(binaryPath);
+        if (cameraPath) checksum += cameraPath->matrices(0).invView[3][0];
+    });
+    double binaryPerFrame = measureMs([&]() {
+        for (uint32_t f = 0; cameraPath && f < cameraPath->frameCount(); ++f)
+            checksum += cameraPath->matrices(static_cast<int>(f)).invView[3][0];
+    });
+    bool perFrameValid = cameraPath && cameraPath->frameCount() == frameCount;
+    cameraPath = {};
+
+    std::cout << frameCount << " frames, checksum " << checksum << std::endl;
+    std::cout << std::setw(28) << "" << std::setw(12) << "MiB" << std::setw(14) << "write ms" << std::setw(14) << "import ms"
+              << std::setw(18) << "first frame ms" << std::setw(16) << "ns / frame" << std::endl;
+    std::cout << std::setw(28) << "json importMatrices" << std::setw(12) << fileSizeMiB(jsonPath) << std::setw(14) << jsonWrite
+              << std::setw(14) << jsonImport << std::setw(18) << jsonImport << std::setw(16) << jsonImport * 1e6 / frameCount << std::endl;
+    std::cout << std::setw(28) << "campath importMatrices" << std::setw(12) << fileSizeMiB(binaryPath) << std::setw(14) << binaryWrite
+              << std::setw(14) << binaryImport << std::setw(18) << binaryImport << std::setw(16) << binaryImport * 1e6 / frameCount << std::endl;
+    std::cout << std::setw(28) << "campath per frame" << std::setw(12) << fileSizeMiB(binaryPath) << std::setw(14) << binaryWrite
+              << std::setw(14) << "-" << std::setw(18) << binaryFirstFrame << std::setw(16) << binaryPerFrame * 1e6 / frameCount << std::endl;
+
+    std::remove(jsonPath.c_str());
+    std::remove(binaryPath.c_str());
+    if (!jsonValid || !binaryValid || !perFrameValid)
+    {
+        std::cout << "a camera path could not be read back" << std::endl;
+        return 1;
+    }
+    return 0;
+}
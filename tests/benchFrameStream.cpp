@@ -0,0 +1,118 @@
+#include <io/FrameStream.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    using Frame = std::shared_ptr<std::vector<float>>;
+
+    // stands in for decoding an exr frame, every value of the frame is written
+    Frame loadFrame(int frame, size_t valueCount)
+    {
+        auto values = std::make_shared<std::vector<float>>(valueCount);
+        for (size_t i = 0; i < valueCount; ++i)
+            (*values)[i] = float((i * 2654435761u + frame) % 1024) / 1024.0f;
+        return values;
+    }
+
+    // stands in for the upload of a frame, reads every value of it
+    float consume(const Frame& frame)
+    {
+        float sum = 0.0f;
+        for (float value : *frame) sum += value;
+        return sum;
+    }
+
+    // the import before FrameStream: one std::async per frame, all frames are decoded and kept before the first is rendered
+    float renderAsync(int frameCount, size_t valueCount)
+    {
+        std::vector<std::future<Frame>> futures;
+        for (int frame = 0; frame < frameCount; ++frame)
+            futures.push_back(std::async(std::launch::async, loadFrame, frame, valueCount));
+        std::vector<Frame> frames;
+        for (auto& future : futures) frames.push_back(future.get());
+
+        float checksum = 0.0f;
+        for (auto& frame : frames) checksum += consume(frame);
+        return checksum;
+    }
+
+    float renderStream(int frameCount, size_t valueCount, int workerCount, int windowSize)
+    {
+        auto stream = FrameStream<Frame>::create([&](int frame) { return loadFrame(frame, valueCount); }, frameCount, workerCount, windowSize);
+        float checksum = 0.0f;
+        for (int frame = 0; frame < frameCount; ++frame) checksum += consume(stream->get(frame));
+        return checksum;
+    }
+
+    struct Result
+    {
+        double seconds = 0.0;
+        float checksum = 0.0f;
+        long peakRssKiB = 0;
+    };
+
+    // runs the import in a child process, so the peak resident set of one import does not hide the one of the other
+    template<typename F>
+    Result runInChild(F&& render)
+    {
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0) return {};
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(pipeFds[0]);
+            Result result;
+            auto start = std::chrono::steady_clock::now();
+            result.checksum = render();
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ssize_t written = write(pipeFds[1], &result, sizeof(result));
+            _exit(written == sizeof(result) ? 0 : 1);
+        }
+        close(pipeFds[1]);
+        Result result;
+        if (pid < 0 || read(pipeFds[0], &result, sizeof(result)) != sizeof(result)) result = {};
+        close(pipeFds[0]);
+
+        int status = 0;
+        struct rusage usage{};
+        if (pid > 0 && wait4(pid, &status, 0, &usage) == pid) result.peakRssKiB = usage.ru_maxrss;
+        return result;
+    }
+}
+
+// frames per second and peak resident memory of rendering a long sequence of external frames, imported with one std::async
+// per frame as before and streamed through a FrameStream with the default --io-threads and --prefetch-window of the renderer
+int main(int argc, char** argv)
+{
+    int frameCount = argc > 1 ? std::stoi(argv[1]) : 1000;
+    size_t frameKiB = argc > 2 ? std::stoul(argv[2]) : 1024;
+    size_t valueCount = frameKiB * 1024 / sizeof(float);
+    int workerCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int windowSize = 16;
+
+    std::cout << frameCount << " frames of " << frameKiB << " KiB, " << workerCount << " workers, window " << windowSize << std::endl;
+    std::cout << std::setw(16) << "" << std::setw(12) << "frames/s" << std::setw(16) << "peak RSS MiB" << std::endl;
+    auto report = [&](const char* name, const Result& result) {
+        std::cout << std::setw(16) << name << std::setw(12) << frameCount / result.seconds << std::setw(16) << result.peakRssKiB / 1024.0
+                  << std::endl;
+    };
+
+    auto async = runInChild([&]() { return renderAsync(frameCount, valueCount); });
+    report("std::async", async);
+    auto stream = runInChild([&]() { return renderStream(frameCount, valueCount, workerCount, windowSize); });
+    report("FrameStream", stream);
+
+    bool equal = async.seconds > 0.0 && stream.seconds > 0.0 && async.checksum == stream.checksum;
+    if (!equal) std::cout << "the imports rendered different frames" << std::endl;
+    return equal ? 0 : 1;
+}
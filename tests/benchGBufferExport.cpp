@@ -0,0 +1,92 @@
+#include <io/RenderIO.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// bytes written and throughput of the G-buffer export for the exr compressions with and without half precision floats
+// the throughput is measured against the size of the G-buffer in memory
+int main(int argc, char** argv)
+{
+    vsg::CommandLine arguments(&argc, argv);
+    uint32_t width = arguments.value(1920u, "--width");
+    uint32_t height = arguments.value(1080u, "--height");
+    int frames = arguments.value(8, "--frames");
+
+    auto gBuffer = OfflineGBuffer::create();
+    auto depth = vsg::floatArray2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+    auto normal = vsg::vec2Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+    auto material = vsg::ubvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    auto albedo = vsg::ubvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    // smooth content with some detail, roughly like a rendered frame
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            size_t i = size_t(y) * width + x;
+            float u = float(x) / width, v = float(y) / height;
+            depth->data()[i] = 2.0f + 3.0f * u + std::sin(40.0f * v);
+            normal->data()[i] = vsg::vec2(0.3f + 2.5f * v, -3.0f + 6.0f * u);
+            material->data()[i] = vsg::ubvec4(uint8_t(255 * u), uint8_t(128 + 127 * std::sin(9.0f * u)), 0, 255);
+            albedo->data()[i] = vsg::ubvec4(uint8_t(255 * u), uint8_t(255 * v), uint8_t((x ^ y) & 0xff), 255);
+        }
+    }
+    gBuffer->depth = depth;
+    gBuffer->normal = normal;
+    gBuffer->material = material;
+    gBuffer->albedo = albedo;
+    double memoryBytes = double(depth->dataSize() + normal->dataSize() + material->dataSize() + albedo->dataSize());
+
+    CameraMatrices matrices;
+    matrices.view = matrices.invView = vsg::mat4();
+    matrices.proj = vsg::perspective(vsg::radians(60.0f), float(width) / height, 0.1f, 100.0f);
+    matrices.invProj = vsg::inverse(*matrices.proj);
+
+    std::string positionFormat = "benchGBufferExport_position_%d.exr", depthFormat = "benchGBufferExport_depth_%d.exr",
+                normalFormat = "benchGBufferExport_normal_%d.exr", materialFormat = "benchGBufferExport_material_%d.exr",
+                albedoFormat = "benchGBufferExport_albedo_%d.exr";
+    auto fileSize = [](const std::string& format, int frame) {
+        char filename[200];
+        snprintf(filename, sizeof(filename), format.c_str(), frame);
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        auto size = file ? static_cast<double>(file.tellg()) : 0.0;
+        file.close();
+        std::remove(filename);
+        return size;
+    };
+
+    std::cout << width << "x" << height << ", " << frames << " frames, " << memoryBytes / (1 << 20) << " MiB per frame in memory" << std::endl;
+    std::cout << std::setw(8) << "exr" << std::setw(6) << "half" << std::setw(14) << "MiB/frame" << std::setw(12) << "ratio" << std::setw(14) << "MiB/s" << std::endl;
+    for (auto compression : {"none", "rle", "zips", "zip", "piz", "pxr24", "b44", "dwaa"})
+    {
+        for (bool half : {false, true})
+        {
+            auto options = GBufferIO::exportOptions();
+            options->setValue(vsgXchange::openexr::compression, std::string(compression));
+            options->setValue(vsgXchange::openexr::half_float, half);
+
+            auto start = std::chrono::steady_clock::now();
+            bool written = true;
+            for (int f = 0; f < frames; ++f)
+                written &= GBufferIO::exportGBufferFrame(positionFormat, depthFormat, normalFormat, materialFormat, albedoFormat, f, gBuffer, matrices, options, 0);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            double fileBytes = 0;
+            for (int f = 0; f < frames; ++f)
+                for (auto& format : {positionFormat, depthFormat, normalFormat, materialFormat, albedoFormat})
+                    fileBytes += fileSize(format, f);
+            if (!written)
+            {
+                std::cout << std::setw(8) << compression << std::setw(6) << half << "  export failed" << std::endl;
+                continue;
+            }
+            std::cout << std::setw(8) << compression << std::setw(6) << half << std::setw(14) << fileBytes / frames / (1 << 20)
+                      << std::setw(12) << fileBytes / (memoryBytes * frames) << std::setw(14) << memoryBytes * frames / (1 << 20) / seconds << std::endl;
+        }
+    }
+    return 0;
+}
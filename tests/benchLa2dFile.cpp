@@ -0,0 +1,103 @@
+#include <terrain/La2dFile.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t la2dTileSize = 128;
+
+    template<typename F>
+    double measureMs(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // heightmap of width x width floats, the payload is written tile row by tile row so that the file is not held in memory
+    void writeLa2d(const std::string& path, uint32_t width)
+    {
+        std::vector<uint8_t> header(La2dFile::headerSize);
+        uint32_t fields[4] = {width, width, la2dTileSize, la2dTileSize};
+        std::memcpy(header.data() + 24, fields, sizeof(fields));
+        uint32_t fullWidth = ((width / la2dTileSize) + 1) * la2dTileSize;
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        std::vector<float> tileRow(size_t(fullWidth) * la2dTileSize);
+        for (uint32_t yOffset = 0; yOffset < fullWidth; yOffset += la2dTileSize)
+        {
+            for (size_t i = 0; i < tileRow.size(); ++i)
+                tileRow[i] = float((yOffset * 31 + i) % 4099) * 0.5f;
+            file.write(reinterpret_cast<const char*>(tileRow.data()), tileRow.size() * sizeof(float));
+        }
+    }
+
+    // the import of TerrainImporter before La2dFile, one ifstream::read per height
+    std::vector<float> detileStream(const std::string& path)
+    {
+        std::ifstream ifs(path, std::ios::in | std::ios::binary);
+        uint32_t actualWidth, actualHeight, tileWidth, tileHeight;
+        ifs.seekg(24);
+        ifs.read(reinterpret_cast<char*>(&actualWidth), sizeof(actualWidth));
+        ifs.read(reinterpret_cast<char*>(&actualHeight), sizeof(actualHeight));
+        ifs.read(reinterpret_cast<char*>(&tileWidth), sizeof(tileWidth));
+        ifs.read(reinterpret_cast<char*>(&tileHeight), sizeof(tileHeight));
+        ifs.seekg(La2dFile::headerSize);
+        uint32_t fullWidth = ((actualWidth / tileWidth) + 1) * tileWidth;
+        uint32_t fullHeight = ((actualHeight / tileHeight) + 1) * tileHeight;
+
+        std::vector<float> heights(size_t(fullWidth) * fullHeight);
+        for (uint32_t yOffset = 0; yOffset < fullHeight; yOffset += tileHeight)
+            for (uint32_t xOffset = 0; xOffset < fullWidth; xOffset += tileWidth)
+                for (uint32_t y = 0; y < tileHeight; y++)
+                    for (uint32_t x = 0; x < tileWidth; x++)
+                    {
+                        float inputValue;
+                        if (ifs.read(reinterpret_cast<char*>(&inputValue), sizeof(inputValue)))
+                            heights[size_t(fullWidth) * (yOffset + y) + xOffset + x] = inputValue;
+                    }
+        return heights;
+    }
+}
+
+// detiles a synthetic heightmap of several hundred MiB with the per value stream reads TerrainImporter used before and with the
+// memory mapped La2dFile. both read the file from the page cache, it was written right before
+int main(int argc, char** argv)
+{
+    uint32_t width = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 10000;
+    const std::string path = "benchLa2dFile_heightmap.la2d";
+    double writeMs = measureMs([&]() { writeLa2d(path, width); });
+    std::ifstream sizeCheck(path, std::ios::binary | std::ios::ate);
+    double fileMiB = static_cast<double>(sizeCheck.tellg()) / (1024.0 * 1024.0);
+    std::cout << width << " x " << width << " heights, " << fileMiB << " MiB, written in " << writeMs << " ms" << std::endl;
+
+    std::vector<float> streamed;
+    double streamMs = measureMs([&]() { streamed = detileStream(path); });
+
+    std::vector<float> mapped;
+    bool detiled = false;
+    double mappedMs = measureMs([&]() {
+        auto file = La2dFile::create(path);
+        mapped.resize(size_t(file->fullWidth) * file->fullHeight);
+        detiled = file->detile(mapped.data(), sizeof(float));
+    });
+    bool equal = detiled && streamed == mapped;
+
+    std::cout << std::setw(16) << "" << std::setw(12) << "ms" << std::setw(12) << "MiB/s" << std::endl;
+    auto report = [&](const char* name, double ms) {
+        std::cout << std::setw(16) << name << std::setw(12) << ms << std::setw(12) << fileMiB / (ms / 1000.0) << std::endl;
+    };
+    report("ifstream", streamMs);
+    report("La2dFile", mappedMs);
+    std::cout << "speedup " << streamMs / mappedMs << ", outputs " << (equal ? "equal" : "DIFFER") << std::endl;
+
+    std::remove(path.c_str());
+    return equal ? 0 : 1;
+}
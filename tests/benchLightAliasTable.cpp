@@ -0,0 +1,57 @@
+#include <scene/LightAliasTable.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// builds the alias table for many lights and compares picking a light with it to the binary search over the inclusive strengths
+// that LIGHT_SAMPLE_LIGHT_STRENGTH did before
+int main(int argc, char** argv)
+{
+    uint32_t lightCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1000000;
+    constexpr uint32_t sampleCount = 1 << 24;
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::vector<vsg::Light::PackedLight> lights(lightCount);
+    for (auto& light : lights)
+    {
+        light.type = static_cast<float>(vsg::LightSourceType::Point);
+        light.colorDiffuse = vsg::vec4(uniform(rng), uniform(rng), uniform(rng), 0) * std::pow(10.f, uniform(rng) * 4 - 2);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto table = LightAliasTable::create(lights);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<float> inclusiveStrengths(lightCount);
+    float sum = 0;
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        sum += lights[i].colorDiffuse.x + lights[i].colorDiffuse.y + lights[i].colorDiffuse.z;
+        inclusiveStrengths[i] = sum;
+    }
+
+    std::vector<float> randoms(2 * sampleCount);
+    for (auto& random : randoms)
+        random = uniform(rng);
+    uint64_t checksum = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sampleCount; ++s)
+        checksum += table->sample(randoms[2 * s], randoms[2 * s + 1]);
+    double aliasNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / sampleCount;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sampleCount; ++s)
+        checksum += std::upper_bound(inclusiveStrengths.begin(), inclusiveStrengths.end(), randoms[2 * s] * sum) - inclusiveStrengths.begin();
+    double searchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / sampleCount;
+
+    std::cout << lightCount << " lights, checksum " << checksum << std::endl;
+    std::cout << std::setw(24) << "build ms" << std::setw(12) << buildMs << std::endl;
+    std::cout << std::setw(24) << "alias table ns / pick" << std::setw(12) << aliasNs << std::endl;
+    std::cout << std::setw(24) << "binary search ns / pick" << std::setw(12) << searchNs << std::endl;
+    return 0;
+}
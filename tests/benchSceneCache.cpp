@@ -0,0 +1,78 @@
+#include <io/SceneCache.hpp>
+
+#include <vsgXchange/models.h>
+#include <vsgXchange/images.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    template<typename F>
+    double measureMs(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double fileSizeMiB(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        return file ? static_cast<double>(file.tellg()) / (1024.0 * 1024.0) : 0.0;
+    }
+
+    // wavy grid of gridSize x gridSize quads as obj file
+    void writeGrid(const std::string& path, int gridSize)
+    {
+        std::ofstream file(path);
+        for (int y = 0; y <= gridSize; ++y)
+            for (int x = 0; x <= gridSize; ++x)
+                file << "v " << x << ' ' << y << ' ' << 0.1f * ((x * 7 + y * 3) % 11) << '\n';
+        for (int y = 0; y < gridSize; ++y)
+        {
+            for (int x = 0; x < gridSize; ++x)
+            {
+                int i = y * (gridSize + 1) + x + 1;
+                file << "f " << i << ' ' << i + 1 << ' ' << i + gridSize + 2 << '\n';
+                file << "f " << i << ' ' << i + gridSize + 2 << ' ' << i + gridSize + 1 << '\n';
+            }
+        }
+    }
+}
+
+// loads a scene through the scene cache twice, the cold load imports it with assimp and writes the cache entry, the warm load
+// reads the entry. the scene is the file given as argument or a generated obj grid of 512 x 512 quads
+int main(int argc, char** argv)
+{
+    std::string sceneFilename = argc > 1 ? argv[1] : "benchSceneCache_grid.obj";
+    if (argc <= 1) writeGrid(sceneFilename, 512);
+    const std::string cacheDirectory = "benchSceneCache";
+    SceneCache cache(cacheDirectory);
+    nlohmann::json config;
+    auto options = vsg::Options::create(vsgXchange::assimp::create(), vsgXchange::dds::create(), vsgXchange::stbi::create());
+
+    // a cache entry of an earlier run would make the cold load warm
+    auto entry = cache.cacheFilename(sceneFilename, SceneCache::cacheKey(sceneFilename, config));
+    std::remove(entry.c_str());
+
+    vsg::ref_ptr<vsg::Node> cold, warm;
+    double coldMs = measureMs([&]() { cold = cache.load(sceneFilename, config, options); });
+    double warmMs = measureMs([&]() { warm = cache.load(sceneFilename, config, options); });
+    if (!cold || !warm)
+    {
+        std::cout << "Scene could not be loaded: " << sceneFilename << std::endl;
+        return 1;
+    }
+
+    std::cout << sceneFilename << " " << fileSizeMiB(sceneFilename) << " MiB, cache entry " << fileSizeMiB(entry) << " MiB" << std::endl;
+    std::cout << std::setw(16) << "cold ms" << std::setw(16) << "warm ms" << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::setw(16) << coldMs << std::setw(16) << warmMs << std::setw(10) << coldMs / warmMs << std::endl;
+
+    std::remove(entry.c_str());
+    if (argc <= 1) std::remove(sceneFilename.c_str());
+    return 0;
+}
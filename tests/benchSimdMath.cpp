@@ -0,0 +1,98 @@
+#include <io/SimdMath.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    template<typename F>
+    double measureNs(size_t count, F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+    }
+
+    template<typename F>
+    void simdLoop(const float* in, float* out, size_t count, F f)
+    {
+        for (size_t i = 0; i < count; i += simd::FloatV::width)
+        {
+            int lanes = static_cast<int>(std::min<size_t>(simd::FloatV::width, count - i));
+            simd::storeStrided(f(simd::loadStrided(in + i, 1, lanes)), out + i, 1, lanes);
+        }
+    }
+
+    // times the functions for one frame of count values
+    void run(size_t count)
+    {
+        std::vector<float> in(count), simdOut(count), scalarOut(count);
+        std::vector<uint8_t> simdBytes(count), scalarBytes(count);
+        for (size_t i = 0; i < count; ++i)
+            in[i] = std::sin(i * 0.618034f);
+
+        auto report = [&](const char* name, double simdNs, double scalarNs, double error) {
+            std::cout << std::setw(16) << name << std::setw(14) << simdNs << std::setw(14) << scalarNs << std::setw(10)
+                      << scalarNs / simdNs << std::setw(14) << error << std::endl;
+        };
+        auto maxError = [&]() {
+            double error = 0;
+            for (size_t i = 0; i < count; ++i)
+                error = std::max(error, double(std::abs(simdOut[i] - scalarOut[i])));
+            return error;
+        };
+
+        double simdNs = measureNs(count, [&]() { simdLoop(in.data(), simdOut.data(), count, [](simd::FloatV x) { return simd::acos(x); }); });
+        double scalarNs = measureNs(count, [&]() { for (size_t i = 0; i < count; ++i) scalarOut[i] = std::acos(in[i]); });
+        report("acos", simdNs, scalarNs, maxError());
+
+        simdNs = measureNs(count, [&]() {
+            simdLoop(in.data(), simdOut.data(), count, [](simd::FloatV x) { return simd::atan2(x, simd::FloatV(1.0f) - x * x); });
+        });
+        scalarNs = measureNs(count, [&]() { for (size_t i = 0; i < count; ++i) scalarOut[i] = std::atan2(in[i], 1.0f - in[i] * in[i]); });
+        report("atan2", simdNs, scalarNs, maxError());
+
+        simdNs = measureNs(count, [&]() {
+            simdLoop(in.data(), simdOut.data(), count, [](simd::FloatV x) {
+                simd::FloatV s, c;
+                simd::sincos(x * simd::pi, s, c);
+                return s * c;
+            });
+        });
+        scalarNs = measureNs(count, [&]() { for (size_t i = 0; i < count; ++i) scalarOut[i] = std::sin(in[i] * simd::pi) * std::cos(in[i] * simd::pi); });
+        report("sincos", simdNs, scalarNs, maxError());
+
+        simdNs = measureNs(count, [&]() { simd::floatToUnorm(in.data(), simdBytes.data(), count); });
+        scalarNs = measureNs(count, [&]() {
+            for (size_t i = 0; i < count; ++i)
+                scalarBytes[i] = static_cast<uint8_t>(std::clamp(in[i] * 255.0f, 0.0f, 255.0f) + 0.5f);
+        });
+        report("floatToUnorm", simdNs, scalarNs, simdBytes == scalarBytes ? 0.0 : 1.0);
+    }
+}
+
+// time per value of the simd functions used by the GBufferIO conversions against the scalar functions of the standard
+// library, for a full hd and a 4k frame or for the value count given as argument. the error column is the largest absolute
+// difference between both
+int main(int argc, char** argv)
+{
+    std::vector<std::pair<std::string, size_t>> frames = {{"1920x1080", 1920 * 1080}, {"3840x2160", 3840 * 2160}};
+    if (argc > 1)
+        frames = {{argv[1], std::stoul(argv[1])}};
+
+    std::cout << "simd width " << simd::FloatV::width << std::endl;
+    for (auto& [name, count] : frames)
+    {
+        std::cout << name << ", " << count << " values" << std::endl;
+        std::cout << std::setw(16) << "" << std::setw(14) << "simd ns" << std::setw(14) << "scalar ns" << std::setw(10) << "speedup"
+                  << std::setw(14) << "max error" << std::endl;
+        run(count);
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <renderModules/SobolSampler.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// rmse of a pixel estimate against the reference for the scrambled Sobol points and white noise, averaged over many pixels.
+// the integrand is a soft shadow like step with a smooth falloff, the reference is computed with the midpoint rule
+int main(int argc, char** argv)
+{
+    uint32_t pixelCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 4096;
+    auto integrand = [](float x, float y) { return (x + y * .3f < .7f ? 1.f : .1f) * std::exp(-x * y); };
+
+    double reference = 0;
+    constexpr int referenceResolution = 4096;
+    for (int y = 0; y < referenceResolution; ++y)
+        for (int x = 0; x < referenceResolution; ++x)
+            reference += integrand((x + .5f) / referenceResolution, (y + .5f) / referenceResolution);
+    reference /= double(referenceResolution) * referenceResolution;
+
+    SobolSampler sampler;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::cout << std::setw(8) << "spp" << std::setw(16) << "rmse sobol" << std::setw(16) << "rmse random" << std::setw(10) << "ratio"
+              << std::setw(16) << "ns / sample" << std::endl;
+    for (uint32_t samples = 1; samples <= 1024; samples *= 2)
+    {
+        double errorSobol = 0, errorRandom = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t pixel = 0; pixel < pixelCount; ++pixel)
+        {
+            uint32_t seed = pixel * 0x9e3779b9u + 1;
+            double sum = 0;
+            for (uint32_t i = 0; i < samples; ++i)
+            {
+                uint32_t index = SobolSampler::scramble(i, seed);
+                sum += integrand(sampler.sample(index, 0, seed * 31 + 1), sampler.sample(index, 1, seed * 31 + 2));
+            }
+            errorSobol += std::pow(sum / samples - reference, 2);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (uint32_t pixel = 0; pixel < pixelCount; ++pixel)
+        {
+            double sum = 0;
+            for (uint32_t i = 0; i < samples; ++i)
+                sum += integrand(uniform(rng), uniform(rng));
+            errorRandom += std::pow(sum / samples - reference, 2);
+        }
+        double rmseSobol = std::sqrt(errorSobol / pixelCount), rmseRandom = std::sqrt(errorRandom / pixelCount);
+        std::cout << std::setw(8) << samples << std::setw(16) << rmseSobol << std::setw(16) << rmseRandom << std::setw(10)
+                  << rmseRandom / rmseSobol << std::setw(16) << seconds * 1e9 / (double(pixelCount) * samples * 2) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <terrain/La2dFile.hpp>
+#include <terrain/TerrainImporter.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int tileLengthLodFactor = 6;
+    constexpr uint32_t la2dTileSize = 128;
+
+    template<typename F>
+    double measureMs(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // la2d file for a grid of tileCount x tileCount tiles of 64 x 64 vertices, heights or texels of elementSize bytes
+    void writeLa2d(const std::string& path, uint32_t tileCount, size_t elementSize)
+    {
+        uint32_t actualWidth = tileCount << tileLengthLodFactor;
+        std::vector<uint8_t> header(La2dFile::headerSize);
+        uint32_t fields[4] = {actualWidth, actualWidth, la2dTileSize, la2dTileSize};
+        std::memcpy(header.data() + 24, fields, sizeof(fields));
+        uint32_t fullWidth = ((actualWidth / la2dTileSize) + 1) * la2dTileSize;
+
+        std::vector<uint8_t> payload(size_t(fullWidth) * fullWidth * elementSize);
+        for (size_t i = 0; i < payload.size() / elementSize; ++i)
+        {
+            float value = 10.0f * std::sin(0.01f * float(i % fullWidth)) + float(i / fullWidth) * 0.01f;
+            std::memcpy(payload.data() + i * elementSize, &value, elementSize);
+        }
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+}
+
+// time of importTerrain() building all tiles of a 16 x 16 and a 64 x 64 tile grid with 1, 2, 4, ... worker threads up to the
+// number of cores. the la2d data is loaded before the measurement, so only the tile construction is timed
+int main(int argc, char** argv)
+{
+    uint32_t maxWorkers = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+    const std::string heightmapPath = "benchTerrainImporter_heightmap";
+    const std::string texturePath = "benchTerrainImporter_texture";
+
+    std::cout << std::setw(8) << "tiles" << std::setw(10) << "workers" << std::setw(12) << "ms" << std::setw(12) << "tiles/s"
+              << std::setw(10) << "speedup" << std::endl;
+    for (uint32_t tileCount : {16u, 64u})
+    {
+        writeLa2d(heightmapPath + "_L00.la2d", tileCount, sizeof(float));
+        writeLa2d(texturePath + "_L00.la2d", tileCount, 3);
+
+        double serialMs = 0.0;
+        for (uint32_t workers = 1;; workers = std::min(2 * workers, maxWorkers))
+        {
+            auto importer = TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1.0f, true, false, 0, 0, 0, tileCount, tileCount,
+                                                    tileLengthLodFactor);
+            importer->workerCount = workers;
+            // loads the source data once, importTerrain() reuses it
+            importer->importTile(0, 0);
+            double ms = measureMs([&]() { importer->importTerrain(); });
+            if (workers == 1) serialMs = ms;
+
+            std::cout << std::setw(8) << (std::to_string(tileCount) + "^2") << std::setw(10) << workers << std::setw(12) << ms
+                      << std::setw(12) << tileCount * tileCount / (ms / 1000.0) << std::setw(10) << serialMs / ms << std::endl;
+            if (workers == maxWorkers) break;
+        }
+    }
+
+    std::remove((heightmapPath + "_L00.la2d").c_str());
+    std::remove((texturePath + "_L00.la2d").c_str());
+    return 0;
+}
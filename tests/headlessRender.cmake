@@ -0,0 +1,50 @@
+## renders one frame of SCENE with VULKANPBRT --headless and checks the exported gbuffer, illumination and matrices
+# cmake -DVULKANPBRT=<executable> -DSCENE=<model> -DOUTPUT_DIR=<directory> [-DREQUIRE_GPU=ON] -P headlessRender.cmake
+# has to run in the build directory, the renderer loads its shaders from there
+file(REMOVE_RECURSE ${OUTPUT_DIR})
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+execute_process(
+    COMMAND ${VULKANPBRT} --headless -f 1 -w 64 48 -i ${SCENE}
+            --exportDepth ${OUTPUT_DIR}/depth_%d.exr
+            --exportNormal ${OUTPUT_DIR}/normal_%d.exr
+            --exportAlbedo ${OUTPUT_DIR}/albedo_%d.exr
+            --exportIllumination ${OUTPUT_DIR}/illumination_%d.exr
+            --exportMatrices ${OUTPUT_DIR}/matrices.json
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+message("${output}")
+# machines without a vulkan driver or without a ray tracing capable device can't run the test. the skip is reported on its own
+# line, the SKIP_REGULAR_EXPRESSION of the test only matches that line, so every other failure fails the test
+if(output MATCHES "(failed to create VkInstance|no suitable Vulkan PhysicalDevice|failed to create logical device)")
+    if(REQUIRE_GPU)
+        message(FATAL_ERROR "no ray tracing capable Vulkan device available and REQUIRE_GPU is set: ${CMAKE_MATCH_1}")
+    endif()
+    message("headlessRender SKIPPED: ${CMAKE_MATCH_1}")
+    return()
+endif()
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "VulkanPBRT exited with ${result}")
+endif()
+
+foreach(IMAGE depth_0 normal_0 albedo_0 illumination_0)
+    set(path ${OUTPUT_DIR}/${IMAGE}.exr)
+    if(NOT EXISTS ${path})
+        message(FATAL_ERROR "${IMAGE}.exr was not exported")
+    endif()
+    # every exr file starts with the magic number 20000630
+    file(READ ${path} magic LIMIT 4 HEX)
+    if(NOT magic STREQUAL "762f3101")
+        message(FATAL_ERROR "${IMAGE}.exr is not an exr file")
+    endif()
+endforeach()
+
+if(NOT EXISTS ${OUTPUT_DIR}/matrices.json)
+    message(FATAL_ERROR "matrices.json was not exported")
+endif()
+file(READ ${OUTPUT_DIR}/matrices.json matrices)
+string(REGEX MATCH "\"amtOfFrames\": *([0-9]+)" frames "${matrices}")
+if(NOT CMAKE_MATCH_1 EQUAL 1)
+    message(FATAL_ERROR "matrices.json contains ${CMAKE_MATCH_1} frames instead of 1")
+endif()
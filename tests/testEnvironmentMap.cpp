@@ -0,0 +1,105 @@
+#include <Check.hpp>
+#include <scene/EnvironmentMap.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+    constexpr float pi = 3.14159265358979f;
+    constexpr uint32_t width = 64, height = 32;
+
+    // half precision bits of values that are exact in half, here only powers of two times 1.5
+    uint16_t toHalf(float value)
+    {
+        if (value == 0) return 0;
+        int exponent;
+        float mantissa = std::frexp(value, &exponent);
+        return static_cast<uint16_t>(((exponent + 14) << 10) | static_cast<uint16_t>((mantissa * 2 - 1) * 1024));
+    }
+
+    // dim sky with a gradient towards the horizon and a bright sun texel
+    float radiance(uint32_t x, uint32_t y)
+    {
+        if (x == 40 && y == 9) return 1024;
+        return y < height / 2 ? 1.5f * float(1 << (y / 4)) / 16 : 0.25f;
+    }
+}
+
+// the directions drawn by EnvironmentMap::sample follow EnvironmentMap::pdf, which the shader divides out of the radiance
+int main()
+{
+    auto image = vsg::vec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    auto halfImage = vsg::usvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R16G16B16A16_SFLOAT});
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float value = radiance(x, y);
+            image->at(x, y) = vsg::vec4(value, value, value, 1);
+            halfImage->at(x, y) = vsg::usvec4(toHalf(value), toHalf(value), toHalf(value), toHalf(1));
+        }
+    }
+    auto map = EnvironmentMap::create(image);
+    auto halfMap = EnvironmentMap::create(halfImage);
+    CHECK(map->getWidth() == width && map->getHeight() == height);
+
+    // the pdf of a sampled direction is the pdf evaluated for that direction, away from the texel borders where rounding
+    // can put the direction into the neighbouring texel
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    constexpr uint32_t sampleCount = 1 << 20;
+    uint32_t sunSamples = 0, mismatches = 0;
+    for (uint32_t s = 0; s < sampleCount; ++s)
+    {
+        vsg::vec2 u((s + uniform(rng)) / sampleCount, uniform(rng));
+        float pdf;
+        vsg::vec3 direction = map->sample(u, pdf);
+        CHECK_NEAR(vsg::length(direction), 1, 1e-5);
+        CHECK(pdf > 0);
+        float evaluated = map->pdf(direction);
+        if (std::abs(evaluated - pdf) > 1e-3f * pdf) ++mismatches;
+
+        float theta = std::acos(std::clamp(direction.z, -1.f, 1.f));
+        float phi = std::atan2(direction.y, direction.x);
+        if (phi < 0) phi += 2 * pi;
+        if (static_cast<uint32_t>(phi / (2 * pi) * width) == 40 && static_cast<uint32_t>(theta / pi * height) == 9) ++sunSamples;
+    }
+    CHECK(mismatches < sampleCount / 1000);
+
+    // the share of the sun is its radiance weighted by the solid angle of its row
+    double weightSum = 0;
+    for (uint32_t y = 0; y < height; ++y)
+        for (uint32_t x = 0; x < width; ++x)
+            weightSum += radiance(x, y) * std::sin(pi * (y + .5f) / height);
+    double sunShare = radiance(40, 9) * std::sin(pi * 9.5f / height) / weightSum;
+    CHECK_NEAR(double(sunSamples) / sampleCount, sunShare, 5 * std::sqrt(sunShare / sampleCount));
+
+    // the pdf integrates to one over the sphere, midpoint rule with several points per texel
+    constexpr uint32_t subdivision = 4;
+    double integral = 0;
+    for (uint32_t y = 0; y < height * subdivision; ++y)
+    {
+        float theta = pi * (y + .5f) / (height * subdivision);
+        for (uint32_t x = 0; x < width * subdivision; ++x)
+        {
+            float phi = 2 * pi * (x + .5f) / (width * subdivision);
+            vsg::vec3 direction(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+            integral += map->pdf(direction) * std::sin(theta);
+            CHECK(halfMap->pdf(direction) == map->pdf(direction));
+        }
+    }
+    integral *= (pi / (height * subdivision)) * (2 * pi / (width * subdivision));
+    CHECK_NEAR(integral, 1, 1e-2);
+
+    // a black map falls back to uniform sampling of the texels
+    auto black = vsg::vec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+    std::fill(black->data(), black->data() + black->valueCount(), vsg::vec4(0, 0, 0, 1));
+    auto blackMap = EnvironmentMap::create(black);
+    float pdf;
+    vsg::vec3 direction = blackMap->sample(vsg::vec2(.3f, .6f), pdf);
+    CHECK_NEAR(pdf, blackMap->pdf(direction), 1e-4 * pdf);
+    CHECK_NEAR(pdf * std::sin(std::acos(direction.z)), 1 / (2 * pi * pi), 1e-2);
+
+    return checkResult();
+}
@@ -0,0 +1,58 @@
+#include <Check.hpp>
+#include <io/FrameStream.hpp>
+
+#include <stdexcept>
+#include <string>
+
+// a frame whose load throws is reported by get() for that frame, the workers keep loading the frames after it
+int main()
+{
+    const int frameCount = 16;
+    const int failingFrame = 5;
+    auto load = [&](int frame) {
+        if (frame == failingFrame) throw vsg::Exception{"Error: load(...) frame " + std::to_string(frame) + " is corrupt."};
+        if (frame == failingFrame + 1) throw std::runtime_error("frame " + std::to_string(frame) + " is missing");
+        return frame * 10;
+    };
+
+    for (int workerCount : {1, 4})
+    {
+        auto stream = FrameStream<int>::create(load, frameCount, workerCount, 3);
+        for (int frame = 0; frame < frameCount; ++frame)
+        {
+            bool threwException = false, threwStd = false;
+            int value = -1;
+            try
+            {
+                value = stream->get(frame);
+            }
+            catch (const vsg::Exception& exception)
+            {
+                threwException = exception.message.find("frame 5") != std::string::npos;
+            }
+            catch (const std::runtime_error&)
+            {
+                threwStd = true;
+            }
+            CHECK(threwException == (frame == failingFrame));
+            CHECK(threwStd == (frame == failingFrame + 1));
+            if (frame != failingFrame && frame != failingFrame + 1)
+                CHECK(value == frame * 10);
+        }
+
+        // jumping back to the failing frame loads it again and fails again
+        bool threw = false;
+        try
+        {
+            stream->get(failingFrame);
+        }
+        catch (const vsg::Exception&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(stream->get(0) == 0);
+    }
+
+    return checkResult();
+}
@@ -0,0 +1,59 @@
+#include <Check.hpp>
+#include <io/RenderIO.hpp>
+
+#include <cstdio>
+#include <string>
+
+// exports a G-buffer frame and imports it again, the 8 bit albedo stored with half precision has to come back unchanged
+int main()
+{
+    const uint32_t width = 64, height = 16;
+    auto gBuffer = OfflineGBuffer::create();
+    auto depth = vsg::floatArray2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+    auto normal = vsg::vec2Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+    auto albedo = vsg::ubvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+    gBuffer->depth = depth;
+    gBuffer->normal = normal;
+    gBuffer->material = albedo;
+    gBuffer->albedo = albedo;
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        depth->data()[i] = 1.0f + i * 0.01f;
+        normal->data()[i] = vsg::vec2(0.5f + 2.0f * i / (width * height), -3.0f + 6.0f * i / (width * height));
+        // every byte value in every channel
+        albedo->data()[i] = vsg::ubvec4(i % 256, (i * 7 + 3) % 256, (255 - i) % 256, (i / 4) % 256);
+    }
+
+    std::string depthFormat = "testGBufferExport_depth_%d.exr", normalFormat = "testGBufferExport_normal_%d.exr",
+                materialFormat = "testGBufferExport_material_%d.exr", albedoFormat = "testGBufferExport_albedo_%d.exr";
+    CHECK(GBufferIO::exportGBufferFrame("", depthFormat, normalFormat, materialFormat, albedoFormat, 0, gBuffer, CameraMatrices{},
+                                        GBufferIO::exportOptions(), 0));
+
+    auto imported = GBufferIO::importGBufferDepth(depthFormat, normalFormat, materialFormat, albedoFormat, 1, 0);
+    CHECK(imported.size() == 1);
+    auto importedAlbedo = imported.front()->albedo.cast<vsg::ubvec4Array2D>();
+    auto importedNormal = imported.front()->normal.cast<vsg::vec2Array2D>();
+    CHECK(importedAlbedo && importedAlbedo->valueCount() == albedo->valueCount());
+    CHECK(importedNormal && importedNormal->valueCount() == normal->valueCount());
+    if (importedAlbedo && importedNormal)
+    {
+        uint32_t changedValues = 0;
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+                changedValues += importedAlbedo->data()[i][c] != albedo->data()[i][c];
+            // the normal is stored as half precision unit vector
+            CHECK_NEAR(importedNormal->data()[i].x, normal->data()[i].x, 2e-3);
+            CHECK_NEAR(importedNormal->data()[i].y, normal->data()[i].y, 2e-3);
+        }
+        CHECK(changedValues == 0);
+    }
+
+    for (auto format : {depthFormat, normalFormat, materialFormat, albedoFormat})
+    {
+        char filename[200];
+        snprintf(filename, sizeof(filename), format.c_str(), 0);
+        std::remove(filename);
+    }
+    return checkResult();
+}
@@ -0,0 +1,156 @@
+#include <Check.hpp>
+#include <io/GBufferSequence.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t width = 5, height = 3;
+    const int frameCount = 3;
+
+    vsg::ref_ptr<OfflineGBuffer> createGBuffer(int frame)
+    {
+        auto gBuffer = OfflineGBuffer::create();
+        auto depth = vsg::floatArray2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32_SFLOAT});
+        auto normal = vsg::vec2Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32_SFLOAT});
+        auto material = vsg::ubvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+        auto albedo = vsg::ubvec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R8G8B8A8_UNORM});
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            depth->data()[i] = frame + i * 0.25f;
+            normal->data()[i] = vsg::vec2(frame * 0.5f, i * -0.125f);
+            material->data()[i] = vsg::ubvec4(frame, i, 7, 255);
+            albedo->data()[i] = vsg::ubvec4(i, frame, 200, 3);
+        }
+        gBuffer->depth = depth;
+        gBuffer->normal = normal;
+        gBuffer->material = material;
+        gBuffer->albedo = albedo;
+        return gBuffer;
+    }
+
+    vsg::ref_ptr<OfflineIllumination> createIllumination(int frame)
+    {
+        auto illumination = OfflineIllumination::create();
+        auto noisy = vsg::vec4Array2D::create(width, height, vsg::Data::Layout{VK_FORMAT_R32G32B32A32_SFLOAT});
+        for (uint32_t i = 0; i < width * height; ++i)
+            noisy->data()[i] = vsg::vec4(frame, i, frame * 0.5f, 1.0f);
+        illumination->noisy = noisy;
+        return illumination;
+    }
+
+    template<class T>
+    bool sameValues(vsg::ref_ptr<vsg::Data> a, vsg::ref_ptr<vsg::Data> b)
+    {
+        auto arrayA = a.cast<T>(), arrayB = b.cast<T>();
+        return arrayA && arrayB && arrayA->dataSize() == arrayB->dataSize() && std::memcmp(arrayA->dataPointer(), arrayB->dataPointer(), arrayA->dataSize()) == 0;
+    }
+
+    std::vector<char> readFile(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // writes the modified bytes of a valid sequence to another file and opens it
+    template<class F>
+    vsg::ref_ptr<GBufferSequence> openModified(const std::vector<char>& bytes, F modify)
+    {
+        const std::string filename = "testGBufferSequence_modified.seq";
+        auto modified = bytes;
+        modify(modified);
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            file.write(modified.data(), modified.size());
+        }
+        auto sequence = GBufferSequence::open(filename);
+        sequence = {};
+        std::remove(filename.c_str());
+        return sequence;
+    }
+
+    template<class T>
+    void setValue(std::vector<char>& bytes, size_t offset, T value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+}
+
+// converts generated frames into a sequence and reads them back, sequences whose frame table points outside of the file are rejected
+int main()
+{
+    using namespace GBufferSequenceFormat;
+    const std::string filename = "testGBufferSequence.seq";
+
+    CameraMatricesVec matrices(frameCount);
+    for (int f = 0; f < frameCount; ++f)
+    {
+        matrices[f].view = vsg::translate(float(f), 1.0f, 2.0f);
+        matrices[f].invView = vsg::inverse(matrices[f].view);
+        if (f != 1)
+        {
+            matrices[f].proj = vsg::perspective(vsg::radians(45.0f + f), 1.5f, 0.1f, 100.0f);
+            matrices[f].invProj = vsg::inverse(matrices[f].proj.value());
+        }
+    }
+    {
+        auto gBuffers = OfflineGBufferStream::create(createGBuffer, frameCount, 2, 2);
+        auto illuminations = OfflineIlluminationStream::create(createIllumination, frameCount, 2, 2);
+        CHECK(GBufferSequenceIO::convert(filename, gBuffers, illuminations, matrices, frameCount, 0));
+    }
+
+    {
+        auto sequence = GBufferSequence::open(filename);
+        CHECK(sequence);
+        if (sequence)
+        {
+            CHECK(sequence->width() == width && sequence->height() == height && sequence->frameCount() == frameCount);
+            auto readMatrices = sequence->matrices();
+            CHECK(readMatrices.size() == frameCount);
+            for (int f = 0; f < frameCount && f < static_cast<int>(readMatrices.size()); ++f)
+            {
+                auto expected = createGBuffer(f);
+                auto gBuffer = sequence->gBuffer(f);
+                CHECK(sameValues<vsg::floatArray2D>(gBuffer->depth, expected->depth));
+                CHECK(sameValues<vsg::vec2Array2D>(gBuffer->normal, expected->normal));
+                CHECK(sameValues<vsg::ubvec4Array2D>(gBuffer->material, expected->material));
+                CHECK(sameValues<vsg::ubvec4Array2D>(gBuffer->albedo, expected->albedo));
+                CHECK(sameValues<vsg::vec4Array2D>(sequence->illumination(f)->noisy, createIllumination(f)->noisy));
+
+                CHECK(readMatrices[f].view == matrices[f].view && readMatrices[f].invView == matrices[f].invView);
+                CHECK(readMatrices[f].proj.has_value() == matrices[f].proj.has_value());
+                if (readMatrices[f].proj && matrices[f].proj)
+                    CHECK(readMatrices[f].proj.value() == matrices[f].proj.value() && readMatrices[f].invProj.value() == matrices[f].invProj.value());
+            }
+            CHECK(!sequence->gBuffer(frameCount)->depth);
+        }
+    }
+
+    auto bytes = readFile(filename);
+    const size_t lastFrameOffset = sizeof(Header) + (frameCount - 1) * sizeof(FrameEntry) + offsetof(FrameEntry, offset);
+    uint64_t lastFrame;
+    std::memcpy(&lastFrame, bytes.data() + lastFrameOffset, sizeof(lastFrame));
+
+    CHECK(openModified(bytes, [](std::vector<char>&) {}));
+    // the data of the last frame is cut off
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { b.resize(lastFrame + 1); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { b.resize(sizeof(Header) + sizeof(FrameEntry)); }));
+    // frame offsets behind the end of the file, wrapping around and into the frame table
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint64_t>(b, lastFrameOffset, b.size()); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint64_t>(b, lastFrameOffset, UINT64_MAX - 16); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint64_t>(b, lastFrameOffset, sizeof(Header)); }));
+    // unknown layers and a header whose sizes do not match the file
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint32_t>(b, lastFrameOffset + sizeof(uint64_t), 1u << 6); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint32_t>(b, offsetof(Header, illuminationValueSize), 1u << 30); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint32_t>(b, offsetof(Header, width), 1u << 31); }));
+    CHECK(!openModified(bytes, [&](std::vector<char>& b) { setValue<uint32_t>(b, offsetof(Header, frameCount), 1u << 30); }));
+
+    std::remove(filename.c_str());
+    return checkResult();
+}
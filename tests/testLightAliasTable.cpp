@@ -0,0 +1,77 @@
+#include <Check.hpp>
+#include <scene/LightAliasTable.hpp>
+
+#include <random>
+
+namespace
+{
+    // exact probability of every slot of the table, slot i is drawn with 1 / n and keeps i or moves to its alias
+    std::vector<double> pickProbabilities(const std::vector<LightAliasTable::Entry>& entries)
+    {
+        std::vector<double> probabilities(entries.size());
+        for (uint32_t i = 0; i < entries.size(); ++i)
+        {
+            probabilities[i] += double(entries[i].probability) / entries.size();
+            probabilities[entries[i].alias] += (1 - double(entries[i].probability)) / entries.size();
+        }
+        return probabilities;
+    }
+}
+
+// the lights picked with the alias table have to follow the light strengths that the shader divides out of the contribution
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    std::vector<vsg::Light::PackedLight> lights;
+    double strengthSum = 0;
+    std::vector<double> strengths;
+    for (int i = 0; i < 300; ++i)
+    {
+        vsg::Light::PackedLight light{};
+        light.type = static_cast<float>(i % 3 ? vsg::LightSourceType::Area : vsg::LightSourceType::Point);
+        // strengths over several orders of magnitude, every 7th light is dark
+        float scale = i % 7 ? std::pow(10.f, uniform(rng) * 4 - 2) : 0.f;
+        light.colorAmbient = vsg::vec4(uniform(rng), uniform(rng), uniform(rng), 0) * scale;
+        light.colorDiffuse = vsg::vec4(uniform(rng), 0, uniform(rng), 0) * scale;
+        light.colorSpecular = vsg::vec4(0, uniform(rng), 0, 0) * scale;
+        lights.push_back(light);
+        strengths.push_back(double(light.colorAmbient.x) + light.colorAmbient.y + light.colorAmbient.z + light.colorDiffuse.x + light.colorDiffuse.y +
+                            light.colorDiffuse.z + light.colorSpecular.x + light.colorSpecular.y + light.colorSpecular.z);
+        strengthSum += strengths.back();
+    }
+
+    LightAliasTable table(lights);
+    const auto& entries = table.getEntries();
+    CHECK(entries.size() == lights.size());
+    auto probabilities = pickProbabilities(entries);
+    for (uint32_t i = 0; i < lights.size(); ++i)
+    {
+        CHECK(entries[i].probability >= 0 && entries[i].probability <= 1 && entries[i].alias < lights.size());
+        CHECK_NEAR(probabilities[i], strengths[i] / strengthSum, 1e-6);
+        if (strengths[i] == 0) CHECK(probabilities[i] == 0);
+    }
+
+    // stratified random numbers for the slot, the picks of the cpu reference of the shader lookup follow the strengths
+    constexpr uint32_t sampleCount = 1 << 22;
+    std::vector<uint32_t> picks(lights.size());
+    for (uint32_t s = 0; s < sampleCount; ++s)
+        ++picks[table.sample((s + .5f) / sampleCount, uniform(rng))];
+    for (uint32_t i = 0; i < lights.size(); ++i)
+    {
+        double expected = strengths[i] / strengthSum;
+        // a few standard deviations of the binomial count of the alias draws
+        CHECK_NEAR(double(picks[i]) / sampleCount, expected, 5 * std::sqrt(expected / sampleCount) + 1e-6);
+        if (strengths[i] == 0) CHECK(picks[i] == 0);
+    }
+
+    // a single light and lights without any strength are picked uniformly
+    auto single = LightAliasTable::build({2.f});
+    CHECK(single.size() == 1 && single[0].probability == 1 && single[0].alias == 0);
+    for (double probability : pickProbabilities(LightAliasTable::build({0.f, 0.f, 0.f, 0.f})))
+        CHECK_NEAR(probability, .25, 1e-7);
+    CHECK(LightAliasTable::build({}).empty());
+
+    return checkResult();
+}
@@ -0,0 +1,79 @@
+#include <Check.hpp>
+#include <scene/LightBVH.hpp>
+
+#include <random>
+
+// the picks of LightBVH::sample have to follow LightBVH::pdf, which the shader divides out of the light contribution
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    auto randomVec = [&]() { return vsg::vec3(uniform(rng), uniform(rng), uniform(rng)); };
+
+    std::vector<vsg::Light::PackedLight> lights;
+    for (int i = 0; i < 500; ++i)
+    {
+        vsg::Light::PackedLight light{};
+        light.type = static_cast<float>(vsg::LightSourceType::Area);
+        vsg::vec3 center = randomVec() * 10.f;
+        light.v0 = center;
+        light.v1 = center + (randomVec() - vsg::vec3(.5f, .5f, .5f)) * .3f;
+        light.v2 = center + (randomVec() - vsg::vec3(.5f, .5f, .5f)) * .3f;
+        light.colorAmbient = vsg::vec4(uniform(rng), uniform(rng), uniform(rng), 0);
+        lights.push_back(light);
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        vsg::Light::PackedLight light{};
+        light.type = static_cast<float>(vsg::LightSourceType::Point);
+        light.v0 = randomVec() * 10.f;
+        light.colorDiffuse = vsg::vec4(uniform(rng), uniform(rng), uniform(rng), 0);
+        lights.push_back(light);
+    }
+    vsg::Light::PackedLight directional{};
+    directional.type = static_cast<float>(vsg::LightSourceType::Directional);
+    directional.colorDiffuse = vsg::vec4(1, 1, 1, 0);
+    lights.push_back(directional);
+    // lights without power are never picked
+    vsg::Light::PackedLight dark{};
+    dark.type = static_cast<float>(vsg::LightSourceType::Point);
+    lights.push_back(dark);
+
+    LightBVH bvh(lights);
+    CHECK(bvh.getInfiniteLightCount() == 1);
+    CHECK(bvh.getTreeNodeCount() == 2 * 520 - 1);
+
+    constexpr uint32_t sampleCount = 1 << 20;
+    for (int point = 0; point < 8; ++point)
+    {
+        vsg::vec3 p = randomVec() * 10.f;
+        vsg::vec3 n = vsg::normalize(randomVec() - vsg::vec3(.5f, .5f, .5f));
+
+        double pdfSum = 0;
+        for (uint32_t i = 0; i < lights.size(); ++i)
+            pdfSum += bvh.pdf(i, p, n);
+        CHECK(pdfSum <= 1 + 1e-4);
+        CHECK(bvh.pdf(static_cast<uint32_t>(lights.size() - 1), p, n) == 0);
+
+        // stratified random numbers, every light covers an interval of length pdf of [0, 1)
+        std::vector<uint32_t> picks(lights.size());
+        uint32_t misses = 0;
+        for (uint32_t s = 0; s < sampleCount; ++s)
+        {
+            float pdf;
+            int light = bvh.sample(p, n, (s + .5f) / sampleCount, pdf);
+            if (light < 0)
+            {
+                CHECK(pdf == 0);
+                ++misses;
+                continue;
+            }
+            ++picks[light];
+            CHECK_NEAR(pdf, bvh.pdf(light, p, n), 1e-5 + 1e-4 * pdf);
+        }
+        CHECK_NEAR(1 - double(misses) / sampleCount, pdfSum, 1e-3);
+        for (uint32_t i = 0; i < lights.size(); ++i)
+            CHECK_NEAR(double(picks[i]) / sampleCount, bvh.pdf(i, p, n), 1e-4 + 1e-2 * bvh.pdf(i, p, n));
+    }
+    return checkResult();
+}
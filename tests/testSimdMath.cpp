@@ -0,0 +1,119 @@
+#include <Check.hpp>
+#include <io/SimdMath.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr float pi = 3.14159265358979f;
+
+    // applies f to the inputs the way GBufferIO does, full vectors followed by a partially filled one
+    template<typename F>
+    std::vector<float> apply(const std::vector<float>& a, const std::vector<float>& b, F f)
+    {
+        std::vector<float> out(a.size());
+        for (size_t i = 0; i < a.size(); i += simd::FloatV::width)
+        {
+            int lanes = static_cast<int>(std::min<size_t>(simd::FloatV::width, a.size() - i));
+            simd::storeStrided(f(simd::loadStrided(a.data() + i, 1, lanes), simd::loadStrided(b.data() + i, 1, lanes)), out.data() + i, 1, lanes);
+        }
+        return out;
+    }
+
+    template<typename F>
+    std::vector<float> apply(const std::vector<float>& a, F f)
+    {
+        return apply(a, a, [&](simd::FloatV x, simd::FloatV) { return f(x); });
+    }
+
+    std::vector<float> range(float begin, float end, size_t count)
+    {
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = begin + (end - begin) * i / (count - 1);
+        return values;
+    }
+}
+
+// the simd functions against the scalar functions of the standard library, the error bounds are the ones documented in
+// SimdMath.hpp. the count of the inputs is no multiple of the vector width so the partially filled vector is covered
+int main()
+{
+    const size_t count = 100003;
+
+    auto cosines = range(-1.0f, 1.0f, count);
+    auto acos = apply(cosines, [](simd::FloatV x) { return simd::acos(x); });
+    double maxError = 0;
+    for (size_t i = 0; i < count; ++i)
+        maxError = std::max(maxError, std::abs(double(acos[i]) - std::acos(double(cosines[i]))));
+    CHECK(maxError < 5e-7 + 1e-7);
+
+    // atan2 on circles of different radii through all octants, then the axes and the origin
+    maxError = 0;
+    for (float radius : {1.0f, 1e-3f, 1e3f})
+    {
+        auto angles = range(-pi, pi, count);
+        std::vector<float> xs(count), ys(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            xs[i] = radius * std::cos(angles[i]);
+            ys[i] = radius * std::sin(angles[i]);
+        }
+        auto atan2 = apply(ys, xs, [](simd::FloatV y, simd::FloatV x) { return simd::atan2(y, x); });
+        for (size_t i = 0; i < count; ++i)
+            maxError = std::max(maxError, std::abs(double(atan2[i]) - std::atan2(double(ys[i]), double(xs[i]))));
+    }
+    CHECK(maxError < 2e-6 + 1e-6);
+    float axes[4][3] = {{1, 0, 0}, {0, 1, pi / 2}, {-1, 0, pi}, {0, -1, -pi / 2}};
+    for (auto& axis : axes)
+    {
+        alignas(32) float result[simd::FloatV::width];
+        simd::atan2(axis[1], axis[0]).store(result);
+        CHECK_NEAR(result[0], axis[2], 1e-6);
+    }
+    alignas(32) float origin[simd::FloatV::width];
+    simd::atan2(0.0f, 0.0f).store(origin);
+    CHECK(origin[0] == 0.0f);
+
+    // sincos over the range of the spherical normal angles and a bit beyond
+    auto angles = range(-2 * pi, 2 * pi, count);
+    auto sin = apply(angles, [](simd::FloatV x) { simd::FloatV s, c; simd::sincos(x, s, c); return s; });
+    auto cos = apply(angles, [](simd::FloatV x) { simd::FloatV s, c; simd::sincos(x, s, c); return c; });
+    double maxSinError = 0, maxCosError = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        maxSinError = std::max(maxSinError, std::abs(double(sin[i]) - std::sin(double(angles[i]))));
+        maxCosError = std::max(maxCosError, std::abs(double(cos[i]) - std::cos(double(angles[i]))));
+    }
+    CHECK(maxSinError < 1e-7 * 4);
+    CHECK(maxCosError < 1e-7 * 4);
+
+    // every byte survives the round trip over float, the vector lanes and the scalar tail of floatToUnorm agree
+    std::vector<uint8_t> bytes(256 + 3);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i);
+    std::vector<float> unorm(bytes.size());
+    size_t i = 0;
+    for (; i + simd::FloatV::width <= bytes.size(); i += simd::FloatV::width)
+        (simd::FloatV::loadBytes(bytes.data() + i) * (1.0f / 255.0f)).store(unorm.data() + i);
+    for (; i < bytes.size(); ++i) unorm[i] = bytes[i] * (1.0f / 255.0f);
+    std::vector<uint8_t> roundTrip(bytes.size());
+    simd::floatToUnorm(unorm.data(), roundTrip.data(), unorm.size());
+    CHECK(roundTrip == bytes);
+
+    // values are clamped to [0, 1] and rounded to the nearest byte, for the vector lanes as for the scalar tail
+    std::vector<float> outside = {-1.0f, -1e-3f, 0.5f, 1.0f + 1e-3f, 2.0f, 1e30f, 1.9f / 255.0f, 2.1f / 255.0f, -1e30f};
+    std::vector<uint8_t> expected = {0, 0, 128, 255, 255, 255, 2, 2, 0};
+    for (size_t offset = 0; offset < outside.size(); ++offset)
+    {
+        std::vector<float> rotated(outside.begin() + offset, outside.end());
+        rotated.insert(rotated.end(), outside.begin(), outside.begin() + offset);
+        std::vector<uint8_t> compressed(rotated.size());
+        simd::floatToUnorm(rotated.data(), compressed.data(), rotated.size());
+        for (size_t j = 0; j < rotated.size(); ++j)
+            CHECK(compressed[j] == expected[(j + offset) % expected.size()]);
+    }
+
+    return checkResult();
+}
@@ -0,0 +1,76 @@
+#include <Check.hpp>
+#include <renderModules/SobolSampler.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // point of the sample index of a pixel as drawn by randomFloat in random.glsl: the index is shuffled per pixel, the point
+    // scrambled per pixel and dimension
+    uint32_t pixelSample(const SobolSampler& sampler, uint32_t sampleIndex, uint32_t dimension, uint32_t pixelSeed)
+    {
+        uint32_t index = SobolSampler::scramble(sampleIndex, pixelSeed);
+        return SobolSampler::scramble(sampler.sample(index, dimension), pixelSeed * 31 + dimension + 1);
+    }
+
+    // every elementary interval of the 2d projection with volume 1 / count holds exactly one of the first count samples
+    bool isNet(const SobolSampler& sampler, uint32_t d0, uint32_t d1, uint32_t log2Count, uint32_t pixelSeed)
+    {
+        uint32_t count = 1u << log2Count;
+        for (uint32_t a = 0; a <= log2Count; ++a)
+        {
+            uint32_t b = log2Count - a;
+            std::vector<uint32_t> cells(count, 0);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t x = a ? pixelSample(sampler, i, d0, pixelSeed) >> (32 - a) : 0;
+                uint32_t y = b ? pixelSample(sampler, i, d1, pixelSeed) >> (32 - b) : 0;
+                if (++cells[(x << b) | y] > 1) return false;
+            }
+        }
+        return true;
+    }
+}
+
+// the samples a pixel accumulates have to be stratified, which only holds if consecutive samples draw consecutive indices
+int main()
+{
+    SobolSampler sampler;
+    CHECK(sampler.getDimensionCount() == SobolSampler::maxDimensions);
+    CHECK(sampler.getMatrices().size() == SobolSampler::maxDimensions * 32);
+
+    // the first dimension is the van der Corput sequence
+    CHECK(sampler.sample(0, 0) == 0);
+    CHECK(sampler.sample(1, 0) == 0x80000000u);
+    CHECK(sampler.sample(2, 0) == 0x40000000u);
+    CHECK(sampler.sample(3, 0) == 0xc0000000u);
+
+    // the scramble is a permutation of the 0.32 fixed point numbers, here of the top 16 bits
+    std::vector<bool> hit(1 << 16, false);
+    for (uint32_t x = 0; x < (1u << 16); ++x)
+        hit[SobolSampler::scramble(x << 16, 0x12345678u) >> 16] = true;
+    CHECK(std::find(hit.begin(), hit.end(), false) == hit.end());
+
+    for (uint32_t pixelSeed : {1u, 0x9e3779b9u, 0xdeadbeefu})
+    {
+        // every power of two prefix of the samples of a pixel is stratified in every dimension
+        for (uint32_t dimension = 0; dimension < sampler.getDimensionCount(); ++dimension)
+        {
+            for (uint32_t log2Count = 0; log2Count <= 10; ++log2Count)
+            {
+                uint32_t count = 1u << log2Count;
+                std::vector<bool> strata(count, false);
+                for (uint32_t i = 0; i < count; ++i)
+                    strata[log2Count ? pixelSample(sampler, i, dimension, pixelSeed) >> (32 - log2Count) : 0] = true;
+                CHECK(std::find(strata.begin(), strata.end(), false) == strata.end());
+            }
+            float u = sampler.sample(SobolSampler::scramble(1023, pixelSeed), dimension, pixelSeed);
+            CHECK(u >= 0 && u < 1);
+        }
+        // the first two dimensions form a (0, 2)-sequence, which Owen scrambling preserves
+        for (uint32_t log2Count = 1; log2Count <= 10; ++log2Count)
+            CHECK(isNet(sampler, 0, 1, log2Count, pixelSeed));
+    }
+    return checkResult();
+}
@@ -0,0 +1,136 @@
+#include <Check.hpp>
+#include <terrain/La2dFile.hpp>
+#include <terrain/TerrainImporter.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t tileCountX = 5;
+    constexpr uint32_t tileCountY = 3;
+    constexpr int tileLengthLodFactor = 3;
+    constexpr uint32_t la2dTileSize = 8;
+
+    // la2d file of a height field or of a texture with varying colors, the payload is stored tile by tile
+    void writeLa2d(const std::string& path, size_t elementSize)
+    {
+        uint32_t actualWidth = tileCountX << tileLengthLodFactor;
+        uint32_t actualHeight = tileCountY << tileLengthLodFactor;
+        std::vector<uint8_t> header(La2dFile::headerSize);
+        uint32_t fields[4] = {actualWidth, actualHeight, la2dTileSize, la2dTileSize};
+        std::memcpy(header.data() + 24, fields, sizeof(fields));
+        uint32_t fullWidth = ((actualWidth / la2dTileSize) + 1) * la2dTileSize;
+        uint32_t fullHeight = ((actualHeight / la2dTileSize) + 1) * la2dTileSize;
+
+        std::vector<uint8_t> payload;
+        payload.reserve(size_t(fullWidth) * fullHeight * elementSize);
+        for (uint32_t yOffset = 0; yOffset < fullHeight; yOffset += la2dTileSize)
+            for (uint32_t xOffset = 0; xOffset < fullWidth; xOffset += la2dTileSize)
+                for (uint32_t y = yOffset; y < yOffset + la2dTileSize; ++y)
+                    for (uint32_t x = xOffset; x < xOffset + la2dTileSize; ++x)
+                    {
+                        uint8_t element[sizeof(float)] = {uint8_t(x * 5), uint8_t(y * 3), uint8_t(x ^ y), 0};
+                        if (elementSize == sizeof(float))
+                        {
+                            float value = 20.0f * std::sin(0.3f * x) * std::cos(0.2f * y) + 0.5f * y;
+                            std::memcpy(element, &value, sizeof(float));
+                        }
+                        payload.insert(payload.end(), element, element + elementSize);
+                    }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+
+    std::string lodPath(const std::string& path)
+    {
+        return path + "_L00.la2d";
+    }
+
+    vsg::ref_ptr<vsg::VertexIndexDraw> tileDraw(const vsg::ref_ptr<vsg::Node>& tile)
+    {
+        auto transform = tile.cast<vsg::MatrixTransform>();
+        return transform->children.front().cast<vsg::StateGroup>()->children.front().cast<vsg::VertexIndexDraw>();
+    }
+
+    bool sameBytes(const vsg::ref_ptr<vsg::Data>& a, const vsg::ref_ptr<vsg::Data>& b)
+    {
+        return a && b && a->dataSize() == b->dataSize() && std::memcmp(a->dataPointer(), b->dataPointer(), a->dataSize()) == 0;
+    }
+}
+
+// importTerrain() builds the tiles on worker threads, every tile has to be byte for byte the tile importTile() builds on the
+// calling thread: the transform, the vertices, the texture coordinates and the indices. compact tiles have to describe the
+// same positions as the full tiles
+int main()
+{
+    std::string heightmapPath = "testTerrainImporter_heightmap";
+    std::string texturePath = "testTerrainImporter_texture";
+    writeLa2d(lodPath(heightmapPath), sizeof(float));
+    writeLa2d(lodPath(texturePath), 3);
+
+    for (bool skirts : {false, true})
+    {
+        for (uint32_t workerCount : {1u, 4u, 0u})
+        {
+            auto createImporter = [&]() {
+                return TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1.0f, true, false, 0, 0, 0, tileCountX, tileCountY,
+                                               tileLengthLodFactor, false, skirts);
+            };
+            auto serial = createImporter();
+            auto parallel = createImporter();
+            parallel->workerCount = workerCount;
+            parallel->importTerrain();
+            CHECK(parallel->loadedTileNodes && parallel->loadedTileNodes->width() == tileCountX &&
+                  parallel->loadedTileNodes->height() == tileCountY);
+            if (!parallel->loadedTileNodes) continue;
+
+            for (uint32_t tileY = 0; tileY < tileCountY; ++tileY)
+            {
+                for (uint32_t tileX = 0; tileX < tileCountX; ++tileX)
+                {
+                    auto serialTransform = serial->importTile(tileX, tileY).cast<vsg::MatrixTransform>();
+                    auto parallelTransform = parallel->loadedTileNodes->at(tileX, tileY).cast<vsg::MatrixTransform>();
+                    CHECK(serialTransform && parallelTransform);
+                    if (!serialTransform || !parallelTransform) continue;
+                    CHECK(serialTransform->matrix == parallelTransform->matrix);
+
+                    auto serialDraw = tileDraw(serialTransform);
+                    auto parallelDraw = tileDraw(parallelTransform);
+                    CHECK(serialDraw->arrays.size() == 3 && parallelDraw->arrays.size() == 3);
+                    CHECK(sameBytes(serialDraw->arrays[0]->data, parallelDraw->arrays[0]->data));
+                    CHECK(sameBytes(serialDraw->arrays[2]->data, parallelDraw->arrays[2]->data));
+                    CHECK(sameBytes(serialDraw->indices->data, parallelDraw->indices->data));
+                    CHECK(serialDraw->indexCount == parallelDraw->indexCount);
+                }
+            }
+        }
+
+        // compact tiles only store heights, the positions expanded for the acceleration structure are the positions of the full tile
+        auto full = TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1.0f, true, false, 0, 0, 0, tileCountX, tileCountY,
+                                            tileLengthLodFactor, false, skirts);
+        auto compact = TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1.0f, true, false, 0, 0, 0, tileCountX, tileCountY,
+                                               tileLengthLodFactor, true, skirts);
+        for (uint32_t tileY = 0; tileY < tileCountY; ++tileY)
+        {
+            for (uint32_t tileX = 0; tileX < tileCountX; ++tileX)
+            {
+                auto fullDraw = tileDraw(full->importTile(tileX, tileY));
+                auto compactDraw = tileDraw(compact->importTile(tileX, tileY));
+                auto vertices = fullDraw->arrays[0]->data.cast<vsg::vec3Array>();
+                CHECK(compactDraw->arrays[0]->data.cast<vsg::floatArray>());
+                CHECK(sameBytes(vertices, TerrainImporter::gridPositions(*compactDraw)));
+                CHECK(sameBytes(fullDraw->indices->data, compactDraw->indices->data));
+            }
+        }
+    }
+
+    std::remove(lodPath(heightmapPath).c_str());
+    std::remove(lodPath(texturePath).c_str());
+    return checkResult();
+}
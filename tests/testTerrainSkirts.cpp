@@ -0,0 +1,187 @@
+#include <Check.hpp>
+#include <terrain/La2dFile.hpp>
+#include <terrain/TerrainImporter.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t tileCountX = 2;
+    constexpr uint32_t tileCountY = 1;
+    constexpr int tileLengthLodFactor = 2;
+    constexpr uint32_t la2dTileSize = 8;
+
+    // continuous height field in units of lod 0 vertices, every lod samples it at its own vertex spacing
+    float height(float u, float v)
+    {
+        return 30.0f * std::sin(1.9f * u) * std::cos(1.3f * v) + 4.0f * v;
+    }
+
+    std::string lodPath(const std::string& path, int lod)
+    {
+        return path + "_L0" + std::to_string(lod) + ".la2d";
+    }
+
+    // la2d file of the height field or of a constant texture for one lod, the payload is stored tile by tile
+    void writeLa2d(const std::string& path, int lod, size_t elementSize)
+    {
+        uint32_t actualWidth = tileCountX << (lod + tileLengthLodFactor);
+        uint32_t actualHeight = tileCountY << (lod + tileLengthLodFactor);
+        std::vector<uint8_t> header(La2dFile::headerSize);
+        uint32_t fields[4] = {actualWidth, actualHeight, la2dTileSize, la2dTileSize};
+        std::memcpy(header.data() + 24, fields, sizeof(fields));
+        uint32_t fullWidth = ((actualWidth / la2dTileSize) + 1) * la2dTileSize;
+        uint32_t fullHeight = ((actualHeight / la2dTileSize) + 1) * la2dTileSize;
+
+        std::vector<uint8_t> payload;
+        payload.reserve(size_t(fullWidth) * fullHeight * elementSize);
+        for (uint32_t yOffset = 0; yOffset < fullHeight; yOffset += la2dTileSize)
+            for (uint32_t xOffset = 0; xOffset < fullWidth; xOffset += la2dTileSize)
+                for (uint32_t y = yOffset; y < yOffset + la2dTileSize; ++y)
+                    for (uint32_t x = xOffset; x < xOffset + la2dTileSize; ++x)
+                    {
+                        uint8_t element[sizeof(float)] = {128, 128, 128, 0};
+                        if (elementSize == sizeof(float))
+                        {
+                            float value = height(float(x) / (1 << lod), float(y) / (1 << lod));
+                            std::memcpy(element, &value, sizeof(float));
+                        }
+                        payload.insert(payload.end(), element, element + elementSize);
+                    }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+
+    // world space triangles of a tile node, a transform above a state group with a single VertexIndexDraw
+    std::vector<vsg::vec3> triangles(vsg::ref_ptr<vsg::Node> tile)
+    {
+        auto transform = tile.cast<vsg::MatrixTransform>();
+        auto draw = transform->children.front().cast<vsg::StateGroup>()->children.front().cast<vsg::VertexIndexDraw>();
+        auto vertices = draw->arrays[0]->data.cast<vsg::vec3Array>();
+        std::vector<vsg::vec3> result;
+        auto add = [&](auto indices) {
+            for (auto index : *indices)
+                result.push_back(vsg::vec3(transform->matrix * vsg::dvec3(vertices->at(index))));
+        };
+        if (auto indices = draw->indices->data.cast<vsg::ushortArray>()) add(indices);
+        if (auto indices = draw->indices->data.cast<vsg::uintArray>()) add(indices);
+        return result;
+    }
+
+    struct EdgeSection
+    {
+        std::vector<float> surfaces;
+        std::vector<std::pair<float, float>> intervals;
+    };
+
+    // intersects the triangles with the vertical line through (edgeX, y). triangles with an edge on the plane x = edgeX give the
+    // surface height at the line, vertical triangles in that plane (the skirts) cover an interval of heights
+    void intersect(const std::vector<vsg::vec3>& triangles, float edgeX, float y, EdgeSection& section)
+    {
+        auto onPlane = [&](const vsg::vec3& p) { return std::abs(p.x - edgeX) < 1e-3f; };
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            const vsg::vec3* corners = triangles.data() + t;
+            std::vector<float> heights;
+            for (int e = 0; e < 3; ++e)
+            {
+                const vsg::vec3 &a = corners[e], &b = corners[(e + 1) % 3];
+                if (!onPlane(a) || !onPlane(b) || y <= std::min(a.y, b.y) || y >= std::max(a.y, b.y)) continue;
+                heights.push_back(a.z + (b.z - a.z) * (y - a.y) / (b.y - a.y));
+            }
+            if (heights.empty()) continue;
+            if (onPlane(corners[0]) && onPlane(corners[1]) && onPlane(corners[2]))
+                section.intervals.emplace_back(*std::min_element(heights.begin(), heights.end()), *std::max_element(heights.begin(), heights.end()));
+            else
+                section.surfaces.insert(section.surfaces.end(), heights.begin(), heights.end());
+        }
+    }
+
+    // true if the skirts and surfaces of both tiles close the gap between their surface heights at the line
+    bool closed(const EdgeSection& left, const EdgeSection& right)
+    {
+        if (left.surfaces.empty() || right.surfaces.empty()) return false;
+        float low = std::min(left.surfaces.front(), right.surfaces.front());
+        float high = std::max(left.surfaces.front(), right.surfaces.front());
+        auto intervals = left.intervals;
+        intervals.insert(intervals.end(), right.intervals.begin(), right.intervals.end());
+        for (float surface : {left.surfaces.front(), right.surfaces.front()})
+            intervals.emplace_back(surface, surface);
+        std::sort(intervals.begin(), intervals.end());
+        const float epsilon = 1e-3f;
+        float covered = low;
+        for (auto& [begin, end] : intervals)
+        {
+            if (end < low) continue;
+            if (begin > covered + epsilon) break;
+            covered = std::max(covered, end);
+        }
+        return covered >= high - epsilon;
+    }
+}
+
+// two neighbouring tiles of different lod levels share an edge whose surface heights differ between the vertices of the coarser
+// tile. with skirts every height between both surfaces is covered by one of the skirts, without them rays can pass the crack
+int main()
+{
+    const int lodLevelCount = 3;
+    std::string heightmapPath = "testTerrainSkirts_heightmap";
+    std::string texturePath = "testTerrainSkirts_texture";
+    for (int lod = 0; lod < lodLevelCount; ++lod)
+    {
+        writeLa2d(lodPath(heightmapPath, lod), lod, sizeof(float));
+        writeLa2d(lodPath(texturePath, lod), lod, 3);
+    }
+
+    auto importTile = [&](int lod, int tileX, bool skirts) {
+        auto importer = TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1000.0f, true, false, lod, lod, 0, tileCountX, tileCountY,
+                                                tileLengthLodFactor, false, skirts);
+        return triangles(importer->importTile(tileX, 0));
+    };
+
+    // the edge between tile 0 and tile 1 is at x = 80 for every lod and runs from y = 0 to y = -80, the lines avoid the vertices
+    const float edgeX = 80.0f;
+    const int lineCount = 64;
+    std::pair<int, int> lodPairs[] = {{1, 0}, {0, 1}, {2, 0}, {2, 1}};
+    for (auto [leftLod, rightLod] : lodPairs)
+    {
+        for (bool skirts : {true, false})
+        {
+            auto left = importTile(leftLod, 0, skirts);
+            auto right = importTile(rightLod, 1, skirts);
+            int open = 0;
+            float maxGap = 0.0f;
+            for (int line = 0; line < lineCount; ++line)
+            {
+                float y = -(line + 0.37f) * edgeX / lineCount;
+                EdgeSection leftSection, rightSection;
+                intersect(left, edgeX, y, leftSection);
+                intersect(right, edgeX, y, rightSection);
+                CHECK(!leftSection.surfaces.empty() && !rightSection.surfaces.empty());
+                if (leftSection.surfaces.empty() || rightSection.surfaces.empty()) continue;
+                maxGap = std::max(maxGap, std::abs(leftSection.surfaces.front() - rightSection.surfaces.front()));
+                if (!closed(leftSection, rightSection)) ++open;
+            }
+            // the height field is not linear along the edge, so the surfaces of different lods don't meet
+            CHECK(maxGap > 1.0f);
+            if (skirts)
+                CHECK(open == 0);
+            else
+                CHECK(open > lineCount / 2);
+        }
+    }
+
+    for (int lod = 0; lod < lodLevelCount; ++lod)
+    {
+        std::remove(lodPath(heightmapPath, lod).c_str());
+        std::remove(lodPath(texturePath, lod).c_str());
+    }
+    return checkResult();
+}
@@ -0,0 +1,190 @@
+#include <Check.hpp>
+#include <terrain/La2dFile.hpp>
+#include <terrain/TerrainAccelerationStructureManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t tileCountX = 32;
+    constexpr uint32_t tileCountY = 2;
+    constexpr uint32_t la2dTileSize = 8;
+
+    // la2d file of actualWidth x actualHeight elements, the payload is only sized correctly, its content does not matter here
+    void writeLa2d(const std::string& path, uint32_t actualWidth, uint32_t actualHeight, size_t elementSize)
+    {
+        std::vector<uint8_t> header(La2dFile::headerSize);
+        uint32_t fields[4] = {actualWidth, actualHeight, la2dTileSize, la2dTileSize};
+        std::memcpy(header.data() + 24, fields, sizeof(fields));
+        size_t fullWidth = ((actualWidth / la2dTileSize) + 1) * la2dTileSize;
+        size_t fullHeight = ((actualHeight / la2dTileSize) + 1) * la2dTileSize;
+        std::vector<uint8_t> payload(fullWidth * fullHeight * elementSize);
+        for (size_t i = 0; i < payload.size(); ++i)
+            payload[i] = static_cast<uint8_t>(i * 7);
+        if (elementSize == sizeof(float))
+        {
+            for (size_t i = 0; i < fullWidth * fullHeight; ++i)
+            {
+                float height = float(i % 13) * 0.25f;
+                std::memcpy(payload.data() + i * sizeof(float), &height, sizeof(float));
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+
+    std::string lodPath(const std::string& path, int lod)
+    {
+        return path + "_L0" + std::to_string(lod) + ".la2d";
+    }
+
+    vsg::ref_ptr<TerrainImporter> createImporter(const std::string& heightmapPath, const std::string& texturePath, int lod)
+    {
+        return TerrainImporter::create(heightmapPath, texturePath, 1.0f, 1.0f, true, false, lod, lod, 0, tileCountX, tileCountY, 0);
+    }
+}
+
+// moves the eye along the terrain and streams the tiles like the render loop does, the instance ids have to match the scene
+// order and the number of resident tiles has to stay bounded by the cache size
+int main()
+{
+    const int lodLevelCount = 3;
+    const size_t maxResidentTiles = 16;
+    std::string heightmapPath = "testTerrainStreaming_heightmap";
+    std::string texturePath = "testTerrainStreaming_texture";
+    for (int lod = 0; lod < lodLevelCount; ++lod)
+    {
+        // the tile length of a lod is 1 << lod vertices
+        writeLa2d(lodPath(heightmapPath, lod), tileCountX << lod, tileCountY << lod, sizeof(float));
+        writeLa2d(lodPath(texturePath, lod), tileCountX << lod, tileCountY << lod, 3);
+    }
+
+    {
+        // no context, the acceleration structures are only created, not compiled
+        auto manager = TerrainAccelerationStructureManager::create(tileCountX, tileCountY, lodLevelCount, vsg::ref_ptr<vsg::Context>{});
+        auto fullImporter = createImporter(heightmapPath, texturePath, lodLevelCount - 1);
+        manager->loadLodLevel(fullImporter, lodLevelCount - 1);
+        for (int lod = 0; lod < lodLevelCount - 1; ++lod)
+            manager->setLodImporter(lod, createImporter(heightmapPath, texturePath, lod));
+        manager->startStreaming(2, maxResidentTiles);
+        CHECK(manager->residentTileCount() == tileCountX * tileCountY);
+
+        // importTerrain() released the source data of the fully imported lod
+        bool threw = false;
+        try
+        {
+            fullImporter->importTile(0, 0);
+        }
+        catch (const vsg::Exception&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+
+        for (double eyeX = 0.0; eyeX <= tileCountX; eyeX += 2.0)
+        {
+            vsg::dvec3 eye(eyeX, 1.0, 0.0);
+
+            size_t streamedTiles = 0;
+            auto allRequiredResident = [&]() {
+                streamedTiles = 0;
+                for (uint32_t y = 0; y < tileCountY; ++y)
+                {
+                    for (uint32_t x = 0; x < tileCountX; ++x)
+                    {
+                        int lod = manager->getTileLod(x, y, 0, eye);
+                        if (!manager->isResident(x, y, lod)) return false;
+                        if (lod != lodLevelCount - 1) ++streamedTiles;
+                    }
+                }
+                return true;
+            };
+
+            auto start = std::chrono::steady_clock::now();
+            while (!allRequiredResident() && std::chrono::steady_clock::now() - start < std::chrono::seconds(60))
+            {
+                manager->requestTiles(0, eye);
+                if (!manager->swapInFinishedTiles())
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                manager->selectTiles(0, eye);
+            }
+            CHECK(allRequiredResident());
+
+            // the second selection of the same tiles makes every tile of the previous one evictable
+            manager->selectTiles(0, eye);
+            auto [slots, scene] = manager->selectTiles(0, eye);
+            uint32_t instanceId = 0;
+            for (auto& geometryInstance : slots)
+            {
+                CHECK(geometryInstance);
+                if (geometryInstance)
+                    CHECK(geometryInstance->id == instanceId++);
+            }
+            CHECK(manager->residentTileCount() <= tileCountX * tileCountY + std::max(maxResidentTiles, streamedTiles));
+            CHECK(manager->pendingTileCount() <= 4);
+        }
+
+        // the eye moved on, a tile streamed for the start of the path was evicted
+        CHECK(!manager->isResident(10, 0, 1));
+
+        // createTlas() numbers the instances in the order of the meshes of createScene()
+        for (int lod = 0; lod < lodLevelCount; ++lod)
+        {
+            auto tlas = manager->createTlas(lod, false);
+            auto scene = manager->createScene(lod);
+            auto stateGroup = scene.cast<vsg::Group>()->children.front().cast<vsg::StateGroup>();
+            CHECK(stateGroup && stateGroup->children.size() == tlas->geometryInstances.size());
+            for (uint32_t i = 0; i < tlas->geometryInstances.size(); ++i)
+                CHECK(tlas->geometryInstances[i]->id == i);
+        }
+
+        manager->stopStreaming();
+    }
+
+    // a truncated heightmap is zero filled by detile() and the importer refuses to build tiles from it
+    {
+        std::vector<char> bytes;
+        {
+            std::ifstream file(lodPath(heightmapPath, 0), std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        bytes.resize(bytes.size() - 100);
+        {
+            std::ofstream file(lodPath(heightmapPath, 0), std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), bytes.size());
+        }
+
+        auto truncated = La2dFile::create(lodPath(heightmapPath, 0));
+        CHECK(truncated->valid());
+        std::vector<float> heights(size_t(truncated->fullWidth) * truncated->fullHeight, -1.0f);
+        CHECK(!truncated->detile(heights.data(), sizeof(float)));
+        CHECK(std::all_of(heights.begin(), heights.end(), [](float h) { return h == 0.0f; }));
+
+        bool threw = false;
+        try
+        {
+            createImporter(heightmapPath, texturePath, 0)->importTile(0, 0);
+        }
+        catch (const vsg::Exception&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    for (int lod = 0; lod < lodLevelCount; ++lod)
+    {
+        std::remove(lodPath(heightmapPath, lod).c_str());
+        std::remove(lodPath(texturePath, lod).c_str());
+    }
+    return checkResult();
+}
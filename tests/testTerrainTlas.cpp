@@ -0,0 +1,84 @@
+#include <Check.hpp>
+#include <terrain/TerrainTopLevelAccelerationStructure.hpp>
+
+namespace
+{
+    // blas without a device, only the handle of a compiled acceleration structure is needed to pack an instance
+    class FakeBlas : public vsg::Inherit<vsg::BottomLevelAccelerationStructure, FakeBlas>
+    {
+    public:
+        explicit FakeBlas(uint64_t handle) :
+            Inherit(nullptr)
+        {
+            _handle = handle;
+        }
+    };
+
+    vsg::ref_ptr<vsg::GeometryInstance> createInstance(uint32_t id, uint64_t handle)
+    {
+        auto geometryInstance = vsg::GeometryInstance::create();
+        geometryInstance->id = id;
+        geometryInstance->accelerationStructure = FakeBlas::create(handle);
+        geometryInstance->transform = vsg::translate(float(id), 0.0f, 0.0f);
+        return geometryInstance;
+    }
+
+    vsg::ref_ptr<vsg::VkGeometryInstanceArray> pack(const vsg::GeometryInstances& slots)
+    {
+        auto packed = vsg::VkGeometryInstanceArray::create(static_cast<uint32_t>(slots.size()));
+        TerrainTopLevelAccelerationStructure::packInstances(slots, *packed);
+        return packed;
+    }
+}
+
+// the change set of a lod change decides which slots updateInstances copies and whether the tlas can be refit
+int main()
+{
+    const uint32_t slotCount = 8;
+    vsg::GeometryInstances slots(slotCount);
+    for (uint32_t i = 0; i < slotCount; ++i)
+    {
+        if (i != 5) slots[i] = createInstance(i, 100 + i);
+    }
+    auto previous = pack(slots);
+
+    // empty slots are packed as inactive instances with all fields zeroed
+    CHECK(previous->at(5).accelerationStructureHandle == 0);
+    CHECK(previous->at(5).instanceId == 0);
+    CHECK(previous->at(5).transform[3] == 0.0f);
+    CHECK(previous->at(2).accelerationStructureHandle == 102);
+    CHECK(previous->at(2).instanceId == 2);
+    CHECK(previous->at(2).transform[3] == 2.0f);
+
+    // the same selection packed again does not change anything
+    CHECK(TerrainTopLevelAccelerationStructure::diffInstances(*previous, *pack(slots)).empty());
+
+    // a tile of another lod only changes its slot, the tlas can be refit
+    slots[3] = createInstance(3, 200);
+    slots[6]->id = 9;
+    auto changes = TerrainTopLevelAccelerationStructure::diffInstances(*previous, *pack(slots));
+    CHECK(changes.changedInstances == std::vector<uint32_t>({3, 6}));
+    CHECK(!changes.requiresRebuild);
+
+    // activating an empty slot needs a full build
+    slots[5] = createInstance(5, 105);
+    changes = TerrainTopLevelAccelerationStructure::diffInstances(*previous, *pack(slots));
+    CHECK(changes.changedInstances == std::vector<uint32_t>({3, 5, 6}));
+    CHECK(changes.requiresRebuild);
+
+    // deactivating a slot needs a full build as well
+    previous = pack(slots);
+    slots[0] = {};
+    changes = TerrainTopLevelAccelerationStructure::diffInstances(*previous, *pack(slots));
+    CHECK(changes.changedInstances == std::vector<uint32_t>({0}));
+    CHECK(changes.requiresRebuild);
+
+    // a different slot count rebuilds every slot
+    vsg::GeometryInstances moreSlots(slots);
+    moreSlots.push_back(createInstance(8, 108));
+    changes = TerrainTopLevelAccelerationStructure::diffInstances(*previous, *pack(moreSlots));
+    CHECK(changes.changedInstances.size() == slotCount + 1);
+    CHECK(changes.requiresRebuild);
+
+    return checkResult();
+}